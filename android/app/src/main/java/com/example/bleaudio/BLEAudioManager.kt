@@ -39,6 +39,7 @@ class BLEAudioManager(
         private const val SCAN_TIMEOUT_MS = 10000L
         private const val CONNECTION_TIMEOUT_MS = 10000L
         private const val MAX_RETRY_ATTEMPTS = 3
+        private const val FLOW_PAUSE_TIMEOUT_MS = 500L  // resume if the coordinator's XON is lost
         private const val RETRY_DELAY_MS = 100L
         private const val TARGET_MTU = 512
     }
@@ -57,6 +58,9 @@ class BLEAudioManager(
     private var rxFrameIndex: Int = 0
     private var currentFrameSizeBytes: Int = 200
     private var startupFrameUntilMs: Long = 0L
+    // Coordinator backpressure: frames are shed at the source until this time
+    @Volatile private var txPausedUntilMs: Long = 0L
+    private val txShedFrames = AtomicInteger(0)
     
     private val isScanning = AtomicBoolean(false)
     private val isConnected = AtomicBoolean(false)
@@ -394,6 +398,14 @@ class BLEAudioManager(
             val opusData = data.copyOf(size)
             val wmFrame = OpusFrameFormat.createFrame(opusData)
             
+            // Coordinator asked us to pause: shed this frame here rather than queue it.
+            // The sequence and timestamp still advance, so receivers see the gap.
+            if (System.currentTimeMillis() < txPausedUntilMs) {
+                val shed = txShedFrames.incrementAndGet()
+                if (shed % 50 == 1) Log.w(TAG, "Coordinator backpressure: shed $shed frames")
+                return true
+            }
+            
             Log.d(TAG, "=== SENDING OPUS WM FRAME (MTU-AWARE CHUNKING) ===")
             Log.d(TAG, "WM frame size: ${wmFrame.size} bytes, negotiatedMtu=$negotiatedMtu, mtuReady=$mtuReady")
             val maxPayload = kotlin.math.max(20, negotiatedMtu - 3)
@@ -458,6 +470,15 @@ class BLEAudioManager(
         }
     }
 
+    // Talk group request (OpusFrameFormat.GROUP_OP_*); the ESP32 answers with its state
+    fun sendTalkGroupControl(op: Int, value: Int): Boolean {
+        val characteristic = audioCharacteristic
+        if (!isConnected.get() || characteristic == null) return false
+        characteristic.writeType = BluetoothGattCharacteristic.WRITE_TYPE_DEFAULT
+        characteristic.setValue(OpusFrameFormat.createGroupControl(op, value))
+        return bluetoothGatt?.writeCharacteristic(characteristic) ?: false
+    }
+
     // Convenience method to send a test beep control packet
     fun sendTestBeep(): Boolean {
         val payload = "BEEP".toByteArray()
@@ -511,15 +532,14 @@ class BLEAudioManager(
                     rxFrameIndex = remain
                 }
 
-                // We now have header at position 0
-                if (rxFrameIndex < 7) {
+                // We now have header at position 0 (v1 or v2, see OpusFrameFormat)
+                val totalLen = OpusFrameFormat.frameLength(rxFrameBuffer, rxFrameIndex)
+                if (totalLen == 0) {
                     // Need more bytes for header
                     break
                 }
-                val expectedLen = (rxFrameBuffer[5].toInt() and 0xFF) or ((rxFrameBuffer[6].toInt() and 0xFF) shl 8)
-                val totalLen = 7 + expectedLen
-                if (expectedLen <= 0 || totalLen > maxFrameSizeBytes) {
-                    Log.w(TAG, "Invalid WM length ($expectedLen), dropping header and realigning")
+                if (totalLen < 0 || totalLen > maxFrameSizeBytes) {
+                    Log.w(TAG, "Invalid WM header ($totalLen), dropping header and realigning")
                     // Drop the 'W' and continue scanning
                     System.arraycopy(rxFrameBuffer, 1, rxFrameBuffer, 0, rxFrameIndex - 1)
                     rxFrameIndex -= 1
@@ -534,9 +554,17 @@ class BLEAudioManager(
 
                 // We have a complete frame at [0, totalLen)
                 val frame = rxFrameBuffer.copyOfRange(0, totalLen)
-                val parsed = OpusFrameFormat.parseFrame(frame)
-                if (parsed != null) {
-                    Log.d(TAG, "Complete WM frame parsed: seq=${parsed.sequenceNumber}, payload=${parsed.opusPayload.size} bytes")
+                val pause = OpusFrameFormat.parseFlowControl(frame)
+                val groups = if (pause == null) OpusFrameFormat.parseGroupState(frame) else null
+                val parsed = if (pause == null && groups == null) OpusFrameFormat.parseFrame(frame) else null
+                if (groups != null) {
+                    Log.i(TAG, "Talk groups: listening to mask 0x${groups.first.toString(16)}, talking to ${groups.second}")
+                } else if (pause != null) {
+                    // Resume on our own if the XON is lost
+                    txPausedUntilMs = if (pause) System.currentTimeMillis() + FLOW_PAUSE_TIMEOUT_MS else 0L
+                    Log.i(TAG, "Coordinator flow control: ${if (pause) "pause" else "resume"}")
+                } else if (parsed != null) {
+                    Log.d(TAG, "Complete WM frame parsed: stream=${parsed.streamId}, seq=${parsed.sequenceNumber}, payload=${parsed.opusPayload.size} bytes")
                     onAudioDataReceived(parsed.opusPayload, parsed.opusPayload.size)
                 } else {
                     Log.w(TAG, "Failed to parse WM frame despite full length: $totalLen bytes")
@@ -6,13 +6,31 @@ import java.nio.ByteOrder
 
 /**
  * Opus frame format implementation for WiFi mesh communication.
+ * Mirrors lib/WmFrame/WmFrame.h in the firmware.
  * 
- * Frame format: 'W','M', type=1 (Opus), seq(le16), len(le16), payload (Opus bytes)
+ * v1 frame: 'W','M', type=1 (Opus), seq(le16), len(le16), payload (Opus bytes)
  * - 'W','M': Magic bytes (2 bytes)
  * - type: Frame type, 1 for Opus (1 byte)
  * - seq: Sequence number, little-endian (2 bytes)
  * - len: Payload length, little-endian (2 bytes)
  * - payload: Opus encoded audio data (variable length)
+ *
+ * v2 frame (sent by this app): the v1 prefix with bit 0x80 set in type, then
+ * - extLen: Bytes after this one, 8 plus optional fields; unknown extensions are skipped (1 byte)
+ * - flags: bit0 = first frame of a talk spurt, bit1 = transcoded, bit2 = membership,
+ *   bit3 = talk group (1 byte)
+ * - streamId: Talker ID, 1 = coordinator, 2 = coordinator test signals, apps pick 3..255 (1 byte)
+ * - seqHigh: Upper 16 bits of the 32-bit sequence, little-endian (2 bytes)
+ * - timestamp: Media time in 48 kHz ticks, little-endian (4 bytes)
+ * - optional, in flag order: members + membersVersion (2 bytes, coordinator only),
+ *   talk group (1 byte)
+ *
+ * Type 3 (flow control) is sent by the coordinator as a v1 frame with a
+ * 1-byte payload: 1 = pause sending, 0 = resume.
+ *
+ * Type 4 (talk group) is a v1 frame both ways: the app sends op, value
+ * (join/leave a group, set the listen mask, pick the talk group) and the
+ * ESP32 answers with op 0x80, listen mask, talk group (lib/TalkGroup).
  */
 object OpusFrameFormat {
     private const val TAG = "OpusFrameFormat"
@@ -20,45 +38,98 @@ object OpusFrameFormat {
     // Frame format constants
     private const val MAGIC_W = 'W'.code.toByte()
     private const val MAGIC_M = 'M'.code.toByte()
-    private const val TYPE_OPUS = 1.toByte()
+    private const val TYPE_OPUS = 1
+    private const val TYPE_FLOW = 3
+    private const val TYPE_GROUP = 4
+    private const val TYPE_V2_BIT = 0x80
+    private const val TYPE_MASK = 0x7F
     private const val HEADER_SIZE = 7 // 'W','M',type,seq(2),len(2)
+    private const val HEADER_V2_SIZE = 16 // v1 prefix + extLen,flags,stream,seqHigh(2),timestamp(4)
+    private const val V2_EXT_SIZE = HEADER_V2_SIZE - HEADER_SIZE - 1
     private const val MAX_PAYLOAD_SIZE = 4000 // Maximum Opus packet size
+    private const val TIMESTAMP_HZ = 48000
+    const val FLAG_MARKER = 0x01
+    const val FLAG_TRANSCODED = 0x02
+    const val FLAG_MEMBERSHIP = 0x04
+    const val FLAG_GROUP = 0x08
+    const val GROUP_OP_JOIN = 1
+    const val GROUP_OP_LEAVE = 2
+    const val GROUP_OP_SET = 3
+    const val GROUP_OP_TALK = 4
+    private const val GROUP_OP_STATE = 0x80
+    const val MAX_TALK_GROUPS = 4
     
-    private var sequenceNumber = 0
+    private var sequenceNumber = 0L
+    private var mediaTimestamp = 0L
+    private var streamId = newStreamId()
+    
+    /** Talk group stamped on outgoing frames, or -1 to leave it to the coordinator. */
+    var talkGroup = -1
+    
+    private fun newStreamId(): Int = 3 + kotlin.random.Random.nextInt(253)
     
     /**
-     * Create a WM frame with Opus payload.
+     * Create a v2 WM frame with Opus payload.
      * 
      * @param opusData Encoded Opus audio data
+     * @param frameDurationMs Audio duration of the packet, advances the media timestamp
      * @return Complete WM frame with header and payload
      */
-    fun createFrame(opusData: ByteArray): ByteArray {
+    fun createFrame(opusData: ByteArray, frameDurationMs: Int = 20): ByteArray {
         if (opusData.size > MAX_PAYLOAD_SIZE) {
             Log.w(TAG, "Opus payload too large: ${opusData.size} bytes, max: $MAX_PAYLOAD_SIZE")
         }
         
-        val frameSize = HEADER_SIZE + opusData.size
+        val grouped = talkGroup in 0 until MAX_TALK_GROUPS
+        val headerSize = HEADER_V2_SIZE + if (grouped) 1 else 0
+        val frameSize = headerSize + opusData.size
         val frame = ByteArray(frameSize)
         val buffer = ByteBuffer.wrap(frame).order(ByteOrder.LITTLE_ENDIAN)
         
-        // Write header
+        // Write v1-compatible prefix
         buffer.put(MAGIC_W)
         buffer.put(MAGIC_M)
-        buffer.put(TYPE_OPUS)
+        buffer.put((TYPE_OPUS or TYPE_V2_BIT).toByte())
         buffer.putShort(sequenceNumber.toShort())
         buffer.putShort(opusData.size.toShort())
         
+        // Write v2 extension
+        buffer.put((headerSize - HEADER_SIZE - 1).toByte())
+        val flags = (if (sequenceNumber == 0L) FLAG_MARKER else 0) or (if (grouped) FLAG_GROUP else 0)
+        buffer.put(flags.toByte())
+        buffer.put(streamId.toByte())
+        buffer.putShort((sequenceNumber ushr 16).toShort())
+        buffer.putInt(mediaTimestamp.toInt())
+        if (grouped) buffer.put(talkGroup.toByte())
+        
         // Write payload
         buffer.put(opusData)
         
-        sequenceNumber = (sequenceNumber + 1) and 0xFFFF // Wrap at 16 bits
-        
-        Log.v(TAG, "Created WM frame: seq=$sequenceNumber, payload=${opusData.size} bytes")
+        Log.v(TAG, "Created WM frame: stream=$streamId, seq=$sequenceNumber, ts=$mediaTimestamp, payload=${opusData.size} bytes")
+        sequenceNumber = (sequenceNumber + 1) and 0xFFFFFFFFL // Wrap at 32 bits
+        mediaTimestamp = (mediaTimestamp + frameDurationMs * (TIMESTAMP_HZ / 1000)) and 0xFFFFFFFFL
         return frame
     }
     
     /**
-     * Parse a WM frame and extract Opus payload.
+     * Total length (header + payload) of the frame starting at offset 0 of buffer.
+     * 
+     * @return frame length, 0 if more bytes are needed, -1 if the header is invalid
+     */
+    fun frameLength(buffer: ByteArray, available: Int): Int {
+        if (available < HEADER_SIZE) return 0
+        if (buffer[0] != MAGIC_W || buffer[1] != MAGIC_M) return -1
+        val payloadLen = (buffer[5].toInt() and 0xFF) or ((buffer[6].toInt() and 0xFF) shl 8)
+        if (payloadLen <= 0 || payloadLen > MAX_PAYLOAD_SIZE) return -1
+        if ((buffer[2].toInt() and TYPE_V2_BIT) == 0) return HEADER_SIZE + payloadLen
+        if (available < HEADER_SIZE + 1) return 0
+        val extLen = buffer[HEADER_SIZE].toInt() and 0xFF
+        if (extLen < V2_EXT_SIZE) return -1
+        return HEADER_SIZE + 1 + extLen + payloadLen
+    }
+    
+    /**
+     * Parse a v1 or v2 WM frame and extract Opus payload.
      * 
      * @param frameData Complete WM frame data
      * @return OpusFrameData if parsing successful, null otherwise
@@ -80,11 +151,41 @@ object OpusFrameFormat {
         }
         
         // Read header
-        val type = buffer.get()
-        val seq = buffer.short.toInt() and 0xFFFF
+        val rawType = buffer.get().toInt() and 0xFF
+        var seq = (buffer.short.toInt() and 0xFFFF).toLong()
         val len = buffer.short.toInt() and 0xFFFF
+        var version = 1
+        var flags = 0
+        var stream = 0
+        var timestamp = 0L
+        var group = -1
+        var headerSize = HEADER_SIZE
+        
+        if ((rawType and TYPE_V2_BIT) != 0) {
+            if (frameData.size < HEADER_V2_SIZE) {
+                Log.w(TAG, "v2 frame too small: ${frameData.size} bytes, minimum: $HEADER_V2_SIZE")
+                return null
+            }
+            val extLen = buffer.get().toInt() and 0xFF
+            if (extLen < V2_EXT_SIZE) {
+                Log.w(TAG, "Invalid v2 extension length: $extLen")
+                return null
+            }
+            version = 2
+            flags = buffer.get().toInt() and 0xFF
+            stream = buffer.get().toInt() and 0xFF
+            seq = seq or ((buffer.short.toLong() and 0xFFFF) shl 16)
+            timestamp = buffer.int.toLong() and 0xFFFFFFFFL
+            headerSize = HEADER_SIZE + 1 + extLen
+            var field = HEADER_V2_SIZE + if ((flags and FLAG_MEMBERSHIP) != 0) 2 else 0
+            if ((flags and FLAG_GROUP) != 0 && field < headerSize && field < frameData.size) {
+                group = frameData[field].toInt() and 0xFF
+            }
+            buffer.position(headerSize.coerceAtMost(frameData.size))
+        }
         
         // Validate type
+        val type = rawType and TYPE_MASK
         if (type != TYPE_OPUS) {
             Log.w(TAG, "Unsupported frame type: $type")
             return null
@@ -96,8 +197,8 @@ object OpusFrameFormat {
             return null
         }
         
-        if (frameData.size < HEADER_SIZE + len) {
-            Log.w(TAG, "Frame truncated: ${frameData.size} bytes, expected: ${HEADER_SIZE + len}")
+        if (frameData.size < headerSize + len) {
+            Log.w(TAG, "Frame truncated: ${frameData.size} bytes, expected: ${headerSize + len}")
             return null
         }
         
@@ -105,8 +206,55 @@ object OpusFrameFormat {
         val payload = ByteArray(len)
         buffer.get(payload)
         
-        Log.v(TAG, "Parsed WM frame: seq=$seq, payload=$len bytes")
-        return OpusFrameData(seq, payload)
+        Log.v(TAG, "Parsed WM v$version frame: stream=$stream, seq=$seq, ts=$timestamp, payload=$len bytes")
+        return OpusFrameData(seq, payload, version, stream, timestamp, flags, group)
+    }
+    
+    /**
+     * Decode a coordinator flow-control frame.
+     * 
+     * @param frameData Complete WM frame data
+     * @return true to pause, false to resume, null if this is not a flow-control frame
+     */
+    fun parseFlowControl(frameData: ByteArray): Boolean? {
+        if (frameData.size < HEADER_SIZE + 1 || !isWmFrame(frameData)) return null
+        if ((frameData[2].toInt() and TYPE_MASK) != TYPE_FLOW) return null
+        val headerSize = frameLength(frameData, frameData.size) - 1
+        if (headerSize < HEADER_SIZE || headerSize >= frameData.size) return null
+        return frameData[headerSize].toInt() != 0
+    }
+    
+    /**
+     * Build a talk group request for the ESP32 this phone is connected to.
+     *
+     * @param op GROUP_OP_JOIN / GROUP_OP_LEAVE (value = group), GROUP_OP_SET (value = mask)
+     *           or GROUP_OP_TALK (value = group, coordinator phone only)
+     */
+    fun createGroupControl(op: Int, value: Int): ByteArray {
+        val frame = ByteArray(HEADER_SIZE + 2)
+        val buffer = ByteBuffer.wrap(frame).order(ByteOrder.LITTLE_ENDIAN)
+        buffer.put(MAGIC_W)
+        buffer.put(MAGIC_M)
+        buffer.put(TYPE_GROUP.toByte())
+        buffer.putShort(0)
+        buffer.putShort(2)
+        buffer.put(op.toByte())
+        buffer.put(value.toByte())
+        return frame
+    }
+    
+    /**
+     * Decode the ESP32's talk group state.
+     *
+     * @return listen mask to talk group, or null if this is not a talk group state frame
+     */
+    fun parseGroupState(frameData: ByteArray): Pair<Int, Int>? {
+        if (frameData.size < HEADER_SIZE + 3 || !isWmFrame(frameData)) return null
+        if ((frameData[2].toInt() and TYPE_MASK) != TYPE_GROUP) return null
+        val headerSize = frameLength(frameData, frameData.size) - 3
+        if (headerSize < HEADER_SIZE || headerSize + 3 > frameData.size) return null
+        if ((frameData[headerSize].toInt() and 0xFF) != GROUP_OP_STATE) return null
+        return Pair(frameData[headerSize + 1].toInt() and 0xFF, frameData[headerSize + 2].toInt() and 0xFF)
     }
     
     /**
@@ -120,9 +268,9 @@ object OpusFrameFormat {
     }
     
     /**
-     * Get the expected header size.
+     * Get the header size of frames created by this app (v2).
      */
-    fun getHeaderSize(): Int = HEADER_SIZE
+    fun getHeaderSize(): Int = HEADER_V2_SIZE
     
     /**
      * Get the maximum payload size.
@@ -130,25 +278,36 @@ object OpusFrameFormat {
     fun getMaxPayloadSize(): Int = MAX_PAYLOAD_SIZE
     
     /**
-     * Reset sequence number (useful for testing or reconnection).
+     * Reset sequence number and start a new stream (useful for testing or reconnection).
      */
     fun resetSequenceNumber() {
         sequenceNumber = 0
-        Log.d(TAG, "Sequence number reset")
+        streamId = newStreamId()
+        Log.d(TAG, "Sequence number reset, new stream $streamId")
     }
     
     /**
      * Get current sequence number.
      */
-    fun getCurrentSequenceNumber(): Int = sequenceNumber
+    fun getCurrentSequenceNumber(): Long = sequenceNumber
+    
+    /**
+     * Get the stream ID stamped on outgoing frames.
+     */
+    fun getStreamId(): Int = streamId
 }
 
 /**
  * Data class representing parsed Opus frame data.
  */
 data class OpusFrameData(
-    val sequenceNumber: Int,
-    val opusPayload: ByteArray
+    val sequenceNumber: Long,
+    val opusPayload: ByteArray,
+    val version: Int = 1,
+    val streamId: Int = 0,
+    val timestamp: Long = 0,
+    val flags: Int = 0,
+    val talkGroup: Int = -1
 ) {
     override fun equals(other: Any?): Boolean {
         if (this === other) return true
@@ -158,13 +317,23 @@ data class OpusFrameData(
 
         if (sequenceNumber != other.sequenceNumber) return false
         if (!opusPayload.contentEquals(other.opusPayload)) return false
+        if (version != other.version) return false
+        if (streamId != other.streamId) return false
+        if (timestamp != other.timestamp) return false
+        if (flags != other.flags) return false
+        if (talkGroup != other.talkGroup) return false
 
         return true
     }
 
     override fun hashCode(): Int {
-        var result = sequenceNumber
+        var result = sequenceNumber.hashCode()
         result = 31 * result + opusPayload.contentHashCode()
+        result = 31 * result + version
+        result = 31 * result + streamId
+        result = 31 * result + timestamp.hashCode()
+        result = 31 * result + flags
+        result = 31 * result + talkGroup
         return result
     }
 }
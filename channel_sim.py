@@ -0,0 +1,279 @@
+#!/usr/bin/env python3
+"""
+Simulate mesh channel selection against a model of the 2.4 GHz band
+
+Builds lib/MeshChannel on the host together with a small driver and runs the
+firmware's own selection code second by second against simulated channels,
+so the numbers track the firmware and its constants.
+
+  channels:     each candidate channel has a mean share of airtime taken by
+                other networks (--busy) and a noise floor (--noise). What a
+                12 ms dwell sees is drawn from a beta distribution around the
+                mean; lower --concentration makes traffic burstier. --event
+                changes a channel's mean at a given second, e.g. building
+                Wi-Fi starting up on channel 1.
+  mesh traffic: the coordinator offers --sends unicasts of --bytes a second,
+                needing --load of the airtime. The share delivered is what
+                the free airtime allows, less a loss of 1% per dB of noise
+                above -95 dBm. Sends during an off-channel dwell are dropped.
+  coordinator:  one survey per second (chanNextSurvey, chanRecordSurvey),
+                send outcomes per second (chanRecordSends), then chanChoose.
+                A move takes effect at once and the throughput window before
+                and after it is reported as the firmware does.
+
+Per trial it reports the moves, the time from the first --event to the
+first move after it, and the delivery with channel selection against
+staying on the boot channel.
+
+Examples:
+  ./channel_sim.py
+  ./channel_sim.py --busy 1=0.1 6=0.1 11=0.1 --event --trials 200
+  ./channel_sim.py --event 120:1=0.8 300:6=0.6 --seconds 900 --verbose
+  ./channel_sim.py --concentration 1 --load 0.5 -DCHAN_HYSTERESIS_PCT=25
+"""
+
+import argparse
+import shutil
+import subprocess
+import sys
+import tempfile
+from pathlib import Path
+
+REPO_ROOT = Path(__file__).resolve().parent
+LIB_DIR = REPO_ROOT / "lib" / "MeshChannel"
+
+DRIVER_SOURCE = r"""
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "MeshChannel.h"
+
+struct Event { int second; int channel; double busy; };
+
+static double busyMean[CHAN_MAX + 1], noiseDbm[CHAN_MAX + 1];
+static std::vector<Event> events;
+static int seconds = 600, trials = 1, boot = 1, sends = 500, bytes = 120, verbose = 0;
+static double load = 0.3, concentration = 4;
+static unsigned seed = 1;
+
+static double draw(std::mt19937& rng, double mean) {
+  if (mean <= 0) return 0;
+  if (mean >= 1) return 1;
+  std::gamma_distribution<double> a(mean * concentration, 1), b((1 - mean) * concentration, 1);
+  double x = a(rng), y = b(rng);
+  return x + y > 0 ? x / (x + y) : mean;
+}
+
+static double delivery(double busy, double noise) {
+  double d = std::min(1.0, (1 - busy) / load);
+  return d * (1 - std::min(1.0, std::max(0.0, noise - CHAN_NOISE_REF_DBM) / 100));
+}
+
+struct Result { int moves; int reactionS; double delivered, stayed; };
+
+static Result run(unsigned trialSeed, bool print) {
+  std::mt19937 rng(trialSeed);
+  std::normal_distribution<double> jitter(0, 1.5);
+  double mean[CHAN_MAX + 1];
+  memcpy(mean, busyMean, sizeof(mean));
+  ChannelPlan plan;
+  chanPlanInit(plan, MESH_CHANNEL_MASK, boot, 0);
+  ChanThroughput tput;
+  chanTputReset(tput);
+  Result r = {0, -1, 0, 0};
+  int firstEvent = events.empty() ? -1 : events.front().second;
+  int reportAt = -1;
+  uint32_t beforeBps = 0, beforePct = 0;
+  uint8_t from = 0;
+  for (int s = 0; s < seconds; s++) {
+    uint32_t nowMs = (uint32_t)s * 1000;
+    for (const Event& e : events) {
+      if (e.second == s) mean[e.channel] = e.busy;
+    }
+    uint8_t survey = chanNextSurvey(plan);
+    bool away = survey != plan.current;
+    double dwell = away ? CHAN_DWELL_MS / 1000.0 : 0;
+    uint32_t sent = (uint32_t)lround(sends * (1 - dwell));
+    double d = delivery(draw(rng, mean[plan.current]), noiseDbm[plan.current]);
+    uint32_t ok = (uint32_t)lround(sent * d);
+    chanTputTick(tput, sent * bytes, ok, sent - ok);
+    chanRecordSends(plan, sent, sent - ok);
+    r.delivered += (double)ok / sends;
+    r.stayed += delivery(draw(rng, mean[boot]), noiseDbm[boot]);
+
+    ChannelSample sample = {};
+    sample.dwellUs = CHAN_DWELL_MS * 1000;
+    sample.busyUs = (uint32_t)(draw(rng, mean[survey]) * sample.dwellUs);
+    sample.frames = (uint16_t)(sample.busyUs / 300);
+    sample.noiseCount = 1;
+    sample.noiseSum = (int32_t)lround(noiseDbm[survey] + jitter(rng));
+    chanRecordSurvey(plan, survey, sample);
+
+    if (s == reportAt && print) {
+      uint32_t bps, pct;
+      chanTputSummary(tput, bps, pct);
+      printf("  %4d s  channel %2u -> %2u: %6u B/s delivered (%3u%%) before, %6u B/s (%3u%%) after\n",
+             s, from, plan.current, beforeBps, beforePct, bps, pct);
+    }
+    uint8_t target = chanChoose(plan, nowMs);
+    if (target) {
+      if (print && verbose) {
+        printf("  %4d s  cost %s", s, "");
+        for (int c = 1; c <= CHAN_MAX; c++) {
+          if (chanValid(plan.mask, c)) printf(" ch%d=%.2f", c, chanCost(plan.ch[c]));
+        }
+        printf("\n");
+      }
+      chanTputSummary(tput, beforeBps, beforePct);
+      from = plan.current;
+      chanMoved(plan, target, nowMs);
+      chanTputReset(tput);
+      reportAt = s + CHAN_TPUT_SECONDS;
+      r.moves++;
+      if (firstEvent >= 0 && s >= firstEvent && r.reactionS < 0) r.reactionS = s - firstEvent;
+    }
+  }
+  r.delivered /= seconds;
+  r.stayed /= seconds;
+  return r;
+}
+
+int main() {
+  for (int c = 0; c <= CHAN_MAX; c++) noiseDbm[c] = CHAN_NOISE_REF_DBM;
+  char key[32];
+  while (scanf("%31s", key) == 1) {
+    int c, t;
+    double v;
+    if (!strcmp(key, "busy") && scanf("%d %lf", &c, &v) == 2) busyMean[c] = v;
+    else if (!strcmp(key, "noise") && scanf("%d %lf", &c, &v) == 2) noiseDbm[c] = v;
+    else if (!strcmp(key, "event") && scanf("%d %d %lf", &t, &c, &v) == 3) events.push_back({t, c, v});
+    else if (!strcmp(key, "seconds")) scanf("%d", &seconds);
+    else if (!strcmp(key, "trials")) scanf("%d", &trials);
+    else if (!strcmp(key, "boot")) scanf("%d", &boot);
+    else if (!strcmp(key, "sends")) scanf("%d", &sends);
+    else if (!strcmp(key, "bytes")) scanf("%d", &bytes);
+    else if (!strcmp(key, "load")) scanf("%lf", &load);
+    else if (!strcmp(key, "concentration")) scanf("%lf", &concentration);
+    else if (!strcmp(key, "seed")) scanf("%u", &seed);
+    else if (!strcmp(key, "verbose")) scanf("%d", &verbose);
+  }
+  std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.second < b.second; });
+
+  printf("candidates:");
+  for (int c = 1; c <= CHAN_MAX; c++) {
+    if (chanValid(MESH_CHANNEL_MASK, c)) printf(" %d (busy %.2f, noise %.0f dBm)", c, busyMean[c], noiseDbm[c]);
+  }
+  printf("\nboot on %d, %d s per trial, mesh load %.2f of the airtime\n", boot, seconds, load);
+  for (const Event& e : events) printf("event at %d s: channel %d busy %.2f\n", e.second, e.channel, e.busy);
+  printf("hysteresis %d%%, hold %d s, %d surveys before a move, dwell %d ms\n\n",
+         CHAN_HYSTERESIS_PCT, CHAN_HOLD_MS / 1000, CHAN_MIN_SURVEYS, CHAN_DWELL_MS);
+
+  std::vector<int> reactions;
+  double moves = 0, delivered = 0, stayed = 0;
+  int unreacted = 0;
+  for (int t = 0; t < trials; t++) {
+    if (t == 0) printf("trial 1:\n");
+    Result r = run(seed + t, t == 0);
+    moves += r.moves;
+    delivered += r.delivered;
+    stayed += r.stayed;
+    if (!events.empty()) {
+      if (r.reactionS >= 0) reactions.push_back(r.reactionS);
+      else unreacted++;
+    }
+  }
+  std::sort(reactions.begin(), reactions.end());
+  printf("\n%d trials: %.2f moves per trial (%.1f per hour)\n", trials, moves / trials,
+         moves / trials * 3600 / seconds);
+  printf("delivery %.1f%% with selection, %.1f%% staying on channel %d\n",
+         delivered / trials * 100, stayed / trials * 100, boot);
+  if (!events.empty()) {
+    if (reactions.empty()) {
+      printf("no move after the first event\n");
+    } else {
+      auto pct = [&](int p) { return reactions[std::min(reactions.size() - 1, reactions.size() * p / 100)]; };
+      printf("first move after the first event: p50 %d s, p90 %d s, max %d s", pct(50), pct(90), reactions.back());
+      printf(", %d trials without one\n", unreacted);
+    }
+  }
+  return 0;
+}
+"""
+
+
+def parse_pairs(items, what):
+    """CH=VALUE pairs"""
+    pairs = []
+    for item in items:
+        channel, _, value = item.partition("=")
+        try:
+            pairs.append((int(channel), float(value)))
+        except ValueError:
+            raise SystemExit(f"{what} expects CH=VALUE, got {item!r}")
+    return pairs
+
+
+def parse_events(items):
+    """SECOND:CH=BUSY triples"""
+    events = []
+    for item in items:
+        second, _, pair = item.partition(":")
+        try:
+            (channel, busy), = parse_pairs([pair], "--event")
+            events.append((int(second), channel, busy))
+        except ValueError:
+            raise SystemExit(f"--event expects SECOND:CH=BUSY, got {item!r}")
+    return events
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--busy", nargs="+", default=["1=0.05", "6=0.2", "11=0.35"], metavar="CH=FRAC",
+                        help="mean airtime share used by other networks")
+    parser.add_argument("--noise", nargs="+", default=[], metavar="CH=DBM", help="noise floor (default -95 dBm)")
+    parser.add_argument("--event", nargs="*", default=["120:1=0.7"], metavar="SECOND:CH=FRAC",
+                        help="change a channel's busy share at a given second (no value: none)")
+    parser.add_argument("--boot", type=int, default=1, help="channel the mesh starts on (MESH_CHANNEL)")
+    parser.add_argument("--load", type=float, default=0.3, help="airtime share the mesh traffic needs")
+    parser.add_argument("--sends", type=int, default=500, help="unicasts per second")
+    parser.add_argument("--bytes", type=int, default=120, help="bytes per unicast")
+    parser.add_argument("--concentration", type=float, default=4, help="beta concentration, lower = burstier")
+    parser.add_argument("--seconds", type=int, default=600)
+    parser.add_argument("--trials", type=int, default=100)
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--verbose", action="store_true", help="print channel costs at every move")
+    parser.add_argument("--cxx", default="g++")
+    args, defines = parser.parse_known_args()
+    if any(not d.startswith("-D") for d in defines):
+        parser.error(f"unrecognised arguments: {' '.join(d for d in defines if not d.startswith('-D'))}")
+
+    config = [f"busy {c} {v}" for c, v in parse_pairs(args.busy, "--busy")]
+    config += [f"noise {c} {v}" for c, v in parse_pairs(args.noise, "--noise")]
+    config += [f"event {t} {c} {v}" for t, c, v in parse_events(args.event)]
+    config += [f"{name} {getattr(args, name)}" for name in
+               ("boot", "load", "sends", "bytes", "concentration", "seconds", "trials", "seed")]
+    config.append(f"verbose {int(args.verbose)}")
+
+    if not shutil.which(args.cxx):
+        print(f"channel_sim: {args.cxx} not found", file=sys.stderr)
+        return 1
+    with tempfile.TemporaryDirectory() as tmp:
+        src = Path(tmp) / "channel_sim.cpp"
+        exe = Path(tmp) / "channel_sim"
+        src.write_text(DRIVER_SOURCE)
+        cmd = [args.cxx, "-std=c++17", "-O2", f"-I{LIB_DIR}", *defines, str(src), str(LIB_DIR / "MeshChannel.cpp"),
+               "-o", str(exe)]
+        build = subprocess.run(cmd, capture_output=True, text=True)
+        if build.returncode != 0:
+            print(build.stderr, file=sys.stderr)
+            return 1
+        run = subprocess.run([str(exe)], input="\n".join(config) + "\n", capture_output=True, text=True)
+        print(run.stdout, end="")
+        return run.returncode
+
+
+if __name__ == "__main__":
+    sys.exit(main())
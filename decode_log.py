@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+"""
+Decode deferred binary log records (log_mode:binary) back into text
+
+Reads a raw serial capture (or a live port with --port, needs pyserial),
+finds the 'D','L' framed records written by dlogDrainTask and formats them
+with the DLOG_FORMATS table in lib/DeferredLog/DeferredLog.h, so the table
+is the single source of truth. Ordinary serial text between records is
+passed through unless --records-only is given.
+
+Examples:
+  ./decode_log.py capture.bin
+  ./decode_log.py --port /dev/ttyACM0 --baud 115200
+"""
+
+import argparse
+import re
+import struct
+import sys
+from pathlib import Path
+
+REPO_ROOT = Path(__file__).resolve().parent
+HEADER = REPO_ROOT / "lib" / "DeferredLog" / "DeferredLog.h"
+
+MODULES = ["audio", "mesh", "ble"]
+LEVELS = "-EWID"
+MAX_ARGS = 4
+
+
+def load_formats(header: Path):
+    text = header.read_text()
+    body = text[text.index("#define DLOG_FORMATS(X)"):]
+    body = body[:body.index("enum DlogFormat")]
+    return [fmt.encode().decode("unicode_escape") for _, fmt in re.findall(r'X\((\w+),\s*"((?:[^"\\]|\\.)*)"\)', body)]
+
+
+def c_format(fmt: str, args):
+    """Apply a C format string that only uses integer conversions"""
+    index = 0
+
+    def convert(match):
+        nonlocal index
+        spec = match.group(0)
+        if spec == "%%":
+            return "%"
+        value = args[index] if index < len(args) else 0
+        index += 1
+        if spec.endswith("d") and value >= 0x80000000:
+            value -= 1 << 32
+        return ("%" + spec[1:-1] + ("d" if spec.endswith("u") else spec[-1])) % value
+
+    return re.sub(r"%%|%0?\d*[udxX]", convert, fmt)
+
+
+def decode_record(payload: bytes, formats):
+    if len(payload) < 8:
+        return None
+    timestamp, fmt_id, level_module, argc = struct.unpack_from("<IHBB", payload, 0)
+    if fmt_id >= len(formats) or argc > MAX_ARGS or len(payload) != 8 + 4 * argc:
+        return None
+    args = list(struct.unpack_from("<%dI" % argc, payload, 8))
+    module = level_module & 0x0F
+    level = level_module >> 4
+    return "[%10u] %s %-5s %s" % (
+        timestamp,
+        LEVELS[level] if level < len(LEVELS) else "?",
+        MODULES[module] if module < len(MODULES) else "?",
+        c_format(formats[fmt_id], args),
+    )
+
+
+def decode_stream(data: bytes, formats, records_only: bool, out):
+    """Decode everything complete in data, return the unconsumed tail"""
+    pos = 0
+    text_start = 0
+    while True:
+        start = data.find(b"DL", pos)
+        if start < 0 or start + 3 > len(data):
+            break
+        length = data[start + 2]
+        if start + 3 + length > len(data):
+            break  # wait for the rest of the frame
+        line = decode_record(data[start + 3:start + 3 + length], formats)
+        if line is None:
+            pos = start + 1  # "DL" inside ordinary text
+            continue
+        if not records_only and start > text_start:
+            out.write(data[text_start:start].decode("utf-8", "replace"))
+        out.write(line + "\n")
+        pos = text_start = start + 3 + length
+    keep_from = text_start
+    if not records_only and pos > text_start:
+        # Flush text that cannot start a frame any more
+        cut = max(text_start, len(data) - 2 - 3 - 8 - 4 * MAX_ARGS)
+        out.write(data[text_start:cut].decode("utf-8", "replace"))
+        keep_from = cut
+    return data[keep_from:]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("capture", nargs="?", help="raw serial capture file ('-' for stdin)")
+    parser.add_argument("--port", help="read a live serial port instead (pyserial)")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--records-only", action="store_true", help="drop ordinary serial text")
+    parser.add_argument("--header", type=Path, default=HEADER, help="DeferredLog.h with the format table")
+    args = parser.parse_args()
+
+    formats = load_formats(args.header)
+    out = sys.stdout
+
+    if args.port:
+        try:
+            import serial  # type: ignore
+        except ImportError:
+            sys.exit("pyserial is required for --port (pip install pyserial)")
+        pending = b""
+        with serial.Serial(args.port, args.baud, timeout=0.2) as port:
+            while True:
+                pending = decode_stream(pending + port.read(4096), formats, args.records_only, out)
+                out.flush()
+
+    if not args.capture:
+        parser.error("give a capture file or --port")
+    data = sys.stdin.buffer.read() if args.capture == "-" else Path(args.capture).read_bytes()
+    tail = decode_stream(data, formats, args.records_only, out)
+    if tail and not args.records_only:
+        out.write(tail.decode("utf-8", "replace"))
+
+
+if __name__ == "__main__":
+    main()
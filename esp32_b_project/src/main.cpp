@@ -19,20 +19,41 @@
 #include <BLE2902.h>
 #include <ArduinoJson.h>
 #include <Adafruit_NeoPixel.h>
+#include <AudioMeter.h>
+#include <G711.h>
+#include <Resampler.h>
+#include <WmFrame.h>
+#include <TaskLayout.h>
+#include <TimerWheel.h>
+#include <DeferredLog.h>
+#include <AllocTrack.h>
+#include <DeadlineMonitor.h>
+#include <MemPlace.h>
+#include <BufferConfig.h>
+#include <MeshBeacon.h>
+#include <MeshState.h>
+#include <MeshAirtime.h>
+#include <MeshMembers.h>
+#include <FailureDetector.h>
+#include <MeshChannel.h>
+#include <TalkGroup.h>
+#include <esp_timer.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/portmacro.h>
 
 // Mesh Network Configuration for Client Device
-#define MESH_CHANNEL 1
+#define MESH_CHANNEL 1  // boot channel until the coordinator moves the mesh (lib/MeshChannel)
 #define MESH_BROADCAST_INTERVAL 10000  // 10 seconds
 #define MESH_HEARTBEAT_INTERVAL 5000   // 5 seconds (matching coordinator)
-#define DEVICE_TIMEOUT 30000           // 30 seconds (matching coordinator)
+
+// Audio rates (matching coordinator); WM frame types are in WmFrame.h
+#define AUDIO_SAMPLE_RATE 16000  // rate Phone B plays
+#define MESH_NB_SAMPLE_RATE 8000 // narrowband mesh rate
 
 // Mesh network state
 bool isMeshConnected = false;
 bool esp32_a_connected = false;
 uint8_t esp32_a_mac[6] = {0};
-unsigned long lastMeshJoinAttempt = 0;
 unsigned long lastMeshHeartbeat = 0;
 unsigned long lastMeshStatus = 0;
 
@@ -74,36 +95,62 @@ static volatile bool bleResetPending = false;
 
 // BLE error handling removed - simplified to match working coordinator
 
-// Audio buffer
-uint8_t audioBuffer[200];
-size_t audioBufferIndex = 0;
-
 // Statistics
 unsigned long packetsReceived = 0;
 unsigned long bytesReceived = 0;
 unsigned long lastStatsTime = 0;
 
-// Notification queue (lockless, IRQ-safe) for BLE forwards
+// Level meter for 8-bit audio received from the mesh (read with meter_stats)
+AudioMeter meterMeshIn;
+
+// 8 kHz -> 16 kHz for narrowband mesh frames (used only from OnDataRecv)
+static Resampler meshUpsampler;
+
+// WM receive tracking: loss/reorder/duplicates from the extended sequence, RFC 3550
+// interarrival jitter and latency drift from the v2 media timestamp
+struct WmRxStats {
+  volatile uint32_t v1Frames;
+  volatile uint32_t v2Frames;
+  volatile uint32_t lost;
+  volatile uint32_t reordered;
+  volatile uint32_t duplicates;
+  volatile uint32_t streamChanges;
+  volatile uint32_t jitterQ4;      // WM_TIMESTAMP_HZ ticks, x16
+  volatile int32_t latencyDrift;   // ticks relative to the first frame of the stream
+  uint8_t streamId;
+  bool haveSequence;
+  uint32_t highestSequence;
+  int32_t firstTransit;
+  int32_t lastTransit;
+};
+static WmRxStats wmRx;
+
+// Notification queue (lockless, IRQ-safe) for BLE forwards. At ~17 KB it
+// is the jitter buffer between ESP-NOW and BLE, so it lives in PSRAM
+// (MEM_BULK, allocated in setup); each slot is touched once per packet.
 struct NotifyItem {
   uint16_t length;
-  uint8_t data[512];
+  uint32_t queuedUs;
+  uint8_t data[kNotifySlotBytes];
   uint8_t isPcm8; // 1 if data are 8-bit PCM samples to upconvert
 };
+static_assert(sizeof(NotifyItem) == kBufferPools[BUF_POOL_NOTIFY_QUEUE].slotBytes, "update NOTIFY_QUEUE in BufferConfig.h");
 static volatile uint16_t notifyHead = 0;
 static volatile uint16_t notifyTail = 0;
-#define NOTIFY_RING_SIZE 64
-#define NOTIFY_RING_MASK (NOTIFY_RING_SIZE - 1)
-static NotifyItem notifyQueue[NOTIFY_RING_SIZE];
+static NotifyItem* notifyQueue = nullptr;  // kNotifyRingSlots slots
 
 static inline bool notifyQueuePushFromISR(const uint8_t* buf, uint16_t len, uint8_t isPcm8) {
-  if (len > 256) len = 256;
-  uint16_t nextHead = (notifyHead + 1) & NOTIFY_RING_MASK;
+  if (len > kNotifySlotBytes) len = kNotifySlotBytes;
+  if (!notifyQueue) return false;
+  uint16_t nextHead = (notifyHead + 1) & kNotifyRingMask;
   if (nextHead == notifyTail) return false; // full
-  NotifyItem &slot = notifyQueue[notifyHead & NOTIFY_RING_MASK];
+  NotifyItem &slot = notifyQueue[notifyHead & kNotifyRingMask];
   slot.length = len;
   memcpy(slot.data, buf, len);
   slot.isPcm8 = isPcm8;
+  slot.queuedUs = taskStageNowUs();
   __atomic_store_n(&notifyHead, nextHead, __ATOMIC_RELEASE);
+  bufferNoteLevel(BUF_POOL_NOTIFY_QUEUE, (nextHead - notifyTail) & kNotifyRingMask);
   return true;
 }
 
@@ -111,24 +158,85 @@ static inline bool notifyQueuePop(NotifyItem &out) {
   uint16_t tail = __atomic_load_n(&notifyTail, __ATOMIC_ACQUIRE);
   uint16_t head = __atomic_load_n(&notifyHead, __ATOMIC_ACQUIRE);
   if (tail == head) return false; // empty
-  NotifyItem &slot = notifyQueue[tail & NOTIFY_RING_MASK];
+  NotifyItem &slot = notifyQueue[tail & kNotifyRingMask];
   out.length = slot.length;
+  out.queuedUs = slot.queuedUs;
   memcpy(out.data, slot.data, slot.length);
-  __atomic_store_n(&notifyTail, (uint16_t)((tail + 1) & NOTIFY_RING_MASK), __ATOMIC_RELEASE);
+  __atomic_store_n(&notifyTail, (uint16_t)((tail + 1) & kNotifyRingMask), __ATOMIC_RELEASE);
   return true;
 }
 
 // Forward declarations
 void setStatusLED(uint8_t r, uint8_t g, uint8_t b);
 void blinkStatusLED(uint8_t r, uint8_t g, uint8_t b, int times);
-void startScanningForESP32A();
-void sendJoinMessage();
+void startMeshDiscovery();
+static void resumeMeshSession();
+static void handleBeacon(const uint8_t* mac, const MeshBeacon& beacon);
 void setupESPNOWMesh();
 void OnDataRecv(const uint8_t *mac, const uint8_t *data, int len);
-void handleTestAudioData(const uint8_t* data, int len, const DynamicJsonDocument& doc);
-void sendTestAck(const uint8_t* mac, int testId, const String& status);
+void handleTestAudioData(const uint8_t* data, int len, const JsonDocument& doc);
+void sendTestAck(const uint8_t* mac, int testId, const char* status);
 void processReceivedAudioData(const uint8_t* audioData, int length, int sequence, int chunk, int totalChunks);
-void sendAudioAck(const uint8_t* mac, int sequence, int chunk, const String& status);
+void sendAudioAck(const uint8_t* mac, int sequence, int chunk, const char* status);
+void handleSerialCommand(const String& command);
+static void wmTrackFrame(const WmHeader& h);
+
+// Every ESP-NOW send goes through here so allocations inside the Wi-Fi
+// stack are charged to "radio", not to the caller's subsystem, and airtime
+// is accounted per traffic class (lib/MeshAirtime)
+static inline esp_err_t meshSend(const uint8_t* mac, const uint8_t* data, size_t len) {
+  AllocScope radio(ALLOC_SUB_RADIO);
+  esp_err_t result = esp_now_send(mac, data, len);
+  if (result == ESP_OK) airtimeNoteSend(mac, data, len, millis());
+  return result;
+}
+
+// Membership log mirrored from the coordinator (lib/MeshMembers), touched
+// only by the ESP-NOW receive callback. Deltas arrive as broadcasts. Audio
+// frames (WM_FLAG_MEMBERSHIP) and heartbeats carry the coordinator's
+// version, so a missed delta is noticed even if no further change follows.
+static MemberList meshMembers;
+static MemberSnapshot meshMembersSnapshot;
+static unsigned long membersRequestMs = 0;
+static uint32_t membersRequests = 0;
+
+// Ask the coordinator for the whole list, at most every MESH_MEMBERS_REQUEST_MS
+static void requestMemberSnapshot() {
+  unsigned long now = millis();
+  if (!isMeshConnected || now - membersRequestMs < MESH_MEMBERS_REQUEST_MS) return;
+  uint8_t frame[MESH_MEMBERS_HEADER_SIZE];
+  int len = membersEncodeRequest(meshMembers.epoch, meshMembers.version, frame);
+  if (meshSend(esp32_a_mac, frame, len) == ESP_OK) {
+    membersRequestMs = now;
+    membersRequests++;
+  }
+}
+
+static void handleMembersFrame(const uint8_t* mac, const uint8_t* data, int len) {
+  if (!isMeshConnected || memcmp(mac, esp32_a_mac, 6) != 0) return;
+  MembersResult result = membersHandleFrame(meshMembers, meshMembersSnapshot, data, len);
+  if (result == MEMBERS_APPLIED) {
+    DLOG(MESH, INFO, MEMBERSHIP, meshMembers.count, meshMembers.version);
+  } else if (result == MEMBERS_GAP) {
+    requestMemberSnapshot();
+  }
+}
+
+static void printMembers() {
+  Serial.printf("=== MESH MEMBERS (session %08lX, v%u, %s) ===\n", (unsigned long)meshMembers.epoch,
+                meshMembers.version, meshMembers.complete ? "complete" : "waiting for snapshot");
+  for (int i = 0; i < meshMembers.count; i++) {
+    const MemberEntry& e = meshMembers.entries[i];
+    Serial.printf("  %02X:%02X:%02X:%02X:%02X:%02X %-23s %s\n", e.mac[0], e.mac[1], e.mac[2],
+                  e.mac[3], e.mac[4], e.mac[5], e.name, (e.flags & MEMBER_FLAG_ACTIVE) ? "active" : "joining");
+  }
+  Serial.printf("  deltas %lu, snapshots %lu, gaps %lu, requests %lu\n",
+                (unsigned long)meshMembers.deltasApplied, (unsigned long)meshMembers.snapshotsApplied,
+                (unsigned long)meshMembers.gaps, (unsigned long)membersRequests);
+}
+
+static uint32_t heartbeatsSent = 0;
+static uint32_t heartbeatsSuppressed = 0;
 
 // RAW PCM: No decompression - direct data passthrough
 static int decompressOptimizedAudio(const uint8_t* compressedData, int compressedLen,
@@ -147,21 +255,8 @@ static int decompressOptimizedAudio(const uint8_t* compressedData, int compresse
 void processReceivedAudioData(const uint8_t* audioData, int length, int sequence, int chunk, int totalChunks) {
   Serial.printf("🎵 Processing audio chunk %d/%d (sequence %d)\n", chunk + 1, totalChunks, sequence);
   
-  // Calculate audio statistics
-  uint32_t sum = 0;
-  uint8_t minVal = 255;
-  uint8_t maxVal = 0;
-  
-  for (int i = 0; i < length; i++) {
-    sum += audioData[i];
-    if (audioData[i] < minVal) minVal = audioData[i];
-    if (audioData[i] > maxVal) maxVal = audioData[i];
-  }
-  
-  uint8_t avgVal = sum / length;
-  
-  Serial.printf("🎵 Audio Stats - Min: %d, Max: %d, Avg: %d, Length: %d bytes\n", 
-                minVal, maxVal, avgVal, length);
+  // Level metering (counters only, read via meter_stats)
+  audioMeterUpdateUlaw(meterMeshIn, audioData, length);
   
   // Update statistics
   packetsReceived++;
@@ -196,8 +291,8 @@ void processReceivedAudioData(const uint8_t* audioData, int length, int sequence
   // 3. Implement audio decompression if needed
 }
 
-void sendAudioAck(const uint8_t* mac, int sequence, int chunk, const String& status) {
-  DynamicJsonDocument ackDoc(256);
+void sendAudioAck(const uint8_t* mac, int sequence, int chunk, const char* status) {
+  StaticJsonDocument<256> ackDoc;
   ackDoc["type"] = "audio_ack";
   ackDoc["sequence"] = sequence;
   ackDoc["chunk"] = chunk;
@@ -205,10 +300,10 @@ void sendAudioAck(const uint8_t* mac, int sequence, int chunk, const String& sta
   ackDoc["source"] = "ESP32_B_Client";
   ackDoc["timestamp"] = millis();
   
-  String ackString;
-  serializeJson(ackDoc, ackString);
+  char ackString[ESP_NOW_MAX_DATA_LEN + 1];
+  size_t ackLen = serializeJson(ackDoc, ackString, sizeof(ackString));
   
-  esp_err_t result = esp_now_send(mac, (uint8_t*)ackString.c_str(), ackString.length());
+  esp_err_t result = meshSend(mac, (uint8_t*)ackString, ackLen);
   if (result == ESP_OK) {
     Serial.printf("✅ Audio ACK sent to coordinator for chunk %d\n", chunk);
   } else {
@@ -246,121 +341,337 @@ void setupESPNOWMesh() {
   
   Serial.println("ESP-NOW Mesh initialized successfully");
   
-  // Start broadcasting presence to ESP32 A
-  startScanningForESP32A();
+  // Resume the saved session, else join the first coordinator beacon heard
+  startMeshDiscovery();
+  resumeMeshSession();
+}
+
+// Coordinator discovery (lib/MeshBeacon). The ESP-NOW receive callback
+// records beacons and picks whom to join; the housekeeping task sends the
+// join or resync (esp_now_add_peer and JSON stay out of the Wi-Fi task) and
+// restarts discovery. joinScan, joinSentMs, the resync flags and the
+// pending join are shared between them under joinMux.
+enum JoinAction { JOIN_NONE, JOIN_FULL, JOIN_RESYNC };
+
+static BeaconScan joinScan;
+static portMUX_TYPE joinMux = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t joinAction = JOIN_NONE;      // picked by handleBeacon, sent by housekeeping
+static uint8_t joinTargetMac[6];
+static uint32_t joinTargetEpoch = 0;
+static uint32_t coordinatorEpoch = 0;       // epoch of the coordinator we joined
+static uint32_t joinEpoch = 0;              // epoch of the coordinator asked
+static unsigned long joinSentMs = 0;        // pending mesh_join, 0 = none
+static unsigned long discoveryStartMs = 0;
+static unsigned long lastJoinMs = 0;        // time-to-join of the last join
+static bool lastJoinResync = false;         // resumed the saved session (lib/MeshState)
+static bool resyncPending = false;
+static bool resyncTried = false;            // one resync per discovery, then a full join
+static unsigned long coordinatorLeaseMs = MESH_LEASE_BEACONS * MESH_BEACON_INTERVAL_MS;
+static unsigned long failoverFromMs = 0;    // last frame from a coordinator whose lease ran out
+static unsigned long lastFailoverMs = 0;    // that frame to the rejoin
+static uint32_t failoverCount = 0;
+static volatile bool meshStateDirty = false;  // saved by the housekeeping persist timer
+static uint32_t joinRequests = 0;
+static uint32_t joinCount = 0;
+TaskHandle_t HousekeepingTaskHandle = NULL;
+
+// Channel moves (lib/MeshChannel): the receive callback takes the
+// coordinator's announcement, the housekeeping channel timer retunes at the
+// announced moment, or scans the candidates while no beacon is heard
+static volatile uint8_t meshChannel = MESH_CHANNEL;
+static volatile uint8_t switchChannel = 0;  // announced move, 0 = none
+static volatile unsigned long switchAtMs = 0;
+static volatile unsigned long lastBeaconMs = 0;  // any beacon of our network
+static uint32_t channelMoves = 0;
+static uint32_t channelScanHops = 0;
+
+// Talk groups (lib/TalkGroup): Phone B's requests are folded into the mask
+// it wants and sent to the coordinator by the housekeeping talk_group timer
+// until a state frame confirms them. The state goes back to Phone B from the
+// receive callback, the notify queue's only producer. BLE onWrite, the
+// receive callback and the timer all update the request, so it sits behind
+// talkGroupMux.
+static portMUX_TYPE talkGroupMux = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t talkGroupsWanted = TG_DEFAULT_MASK;
+static uint8_t talkGroupsConfirmed = TG_DEFAULT_MASK;
+static bool talkGroupPending = false;
+static uint8_t talkGroupTries = 0;
+static unsigned long talkGroupSentMs = 0;
+static uint32_t talkGroupRequests = 0;
+static uint32_t talkGroupStates = 0;
+
+// Called under talkGroupMux
+static void queueTalkGroupRequestLocked() {
+  talkGroupTries = 0;
+  talkGroupSentMs = 0;
+  talkGroupPending = true;
 }
 
-void startScanningForESP32A() {
-  Serial.println("Attempting to join mesh network...");
+void startMeshDiscovery() {
+  Serial.println("Listening for coordinator beacons...");
   setStatusLED(255, 165, 0); // Orange while joining
-  
-  // Create join message
-  DynamicJsonDocument doc(256);
+  portENTER_CRITICAL(&joinMux);
+  beaconScanReset(joinScan);
+  joinSentMs = 0;
+  joinAction = JOIN_NONE;
+  resyncTried = false;
+  portEXIT_CRITICAL(&joinMux);
+  discoveryStartMs = millis();
+}
+
+static void setJoinSentMs(unsigned long ms) {
+  portENTER_CRITICAL(&joinMux);
+  joinSentMs = ms;
+  portEXIT_CRITICAL(&joinMux);
+}
+
+static void sendJoinRequest(const uint8_t* mac, uint32_t epoch) {
+  esp_now_peer_info_t peerInfo;
+  memset(&peerInfo, 0, sizeof(peerInfo));
+  memcpy(peerInfo.peer_addr, mac, 6);
+  peerInfo.channel = 0;  // current channel, follows channel moves
+  peerInfo.encrypt = false;
+  peerInfo.ifidx = WIFI_IF_STA;
+  esp_err_t result = esp_now_add_peer(&peerInfo);
+  if (result != ESP_OK && result != ESP_ERR_ESPNOW_EXIST) {
+    Serial.printf("Failed to add coordinator peer: %d\n", result);
+    setJoinSentMs(0);  // retry on the next beacon
+    return;
+  }
+
+  StaticJsonDocument<256> doc;
   doc["type"] = "mesh_join";
-  doc["source"] = deviceName;
-  doc["device_name"] = deviceName;
-  doc["device_type"] = deviceType;
+  doc["source"] = deviceName.c_str();
+  doc["device_name"] = deviceName.c_str();
+  doc["device_type"] = deviceType.c_str();
   doc["timestamp"] = millis();
-  doc["mac"] = WiFi.macAddress();
-  
-  String jsonString;
-  serializeJson(doc, jsonString);
-  
-  // Use the same channel as ESP32 A (MESH_CHANNEL = 1)
-  int channel = MESH_CHANNEL;
-  
-  // Try to send to multiple potential coordinator MACs
-  // We'll try common ESP32 MAC patterns and also broadcast
-  uint8_t potentialCoordinators[][6] = {
-    {0x10, 0x00, 0x3B, 0x48, 0x9C, 0x3C}, // ESP32 A's actual MAC from logs
-    {0x10, 0x00, 0x3B, 0x48, 0x1A, 0x68}, // ESP32 B's MAC (for testing)
-    {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}  // Broadcast (fallback)
-  };
-  
-  bool joinSent = false;
-  
-  for (int attempt = 0; attempt < 3; attempt++) {
-    // Create peer info
-    esp_now_peer_info_t peerInfo;
-    memset(&peerInfo, 0, sizeof(peerInfo));
-    memcpy(peerInfo.peer_addr, potentialCoordinators[attempt], 6);
-    peerInfo.channel = channel;
-    peerInfo.encrypt = false;
-    peerInfo.ifidx = WIFI_IF_STA;
-    
-    // Remove any existing peer first
-    esp_now_del_peer(peerInfo.peer_addr);
-    
-    esp_err_t result = esp_now_add_peer(&peerInfo);
-    if (result == ESP_OK) {
-      Serial.printf("Attempting to send join request to MAC: %02X:%02X:%02X:%02X:%02X:%02X\n",
-                    peerInfo.peer_addr[0], peerInfo.peer_addr[1], peerInfo.peer_addr[2],
-                    peerInfo.peer_addr[3], peerInfo.peer_addr[4], peerInfo.peer_addr[5]);
-      
-      // Send the join message
-      esp_err_t sendResult = esp_now_send(peerInfo.peer_addr, (uint8_t*)jsonString.c_str(), jsonString.length());
-      if (sendResult == ESP_OK) {
-        Serial.println("Join request sent successfully");
-        lastMeshJoinAttempt = millis();
-        joinSent = true;
-        
-        // If this is a specific MAC (not broadcast), store it
-        if (attempt < 2) {
-          memcpy(esp32_a_mac, peerInfo.peer_addr, 6);
-          Serial.printf("Stored potential coordinator MAC: %02X:%02X:%02X:%02X:%02X:%02X\n",
-                        esp32_a_mac[0], esp32_a_mac[1], esp32_a_mac[2],
-                        esp32_a_mac[3], esp32_a_mac[4], esp32_a_mac[5]);
-        }
-      } else {
-        Serial.printf("Failed to send join request: %d\n", sendResult);
-      }
-      
-      // Clean up the peer
-      esp_now_del_peer(peerInfo.peer_addr);
-    } else {
-      Serial.printf("Failed to add peer for attempt %d: %d\n", attempt, result);
-    }
-    
-    delay(100); // Small delay between attempts
-  }
-  
-  if (joinSent) {
-    Serial.println("Join request sent, waiting for mesh coordinator response...");
+  char joinString[ESP_NOW_MAX_DATA_LEN + 1];
+  size_t joinLen = serializeJson(doc, joinString, sizeof(joinString));
+
+  result = meshSend(mac, (uint8_t*)joinString, joinLen);
+  if (result == ESP_OK) {
+    memcpy(esp32_a_mac, mac, 6);
+    joinEpoch = epoch;
+    portENTER_CRITICAL(&joinMux);
+    resyncPending = false;
+    joinSentMs = millis();
+    portEXIT_CRITICAL(&joinMux);
+    joinRequests++;
+    Serial.printf("Join request sent to %02X:%02X:%02X:%02X:%02X:%02X\n",
+                  mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
     setStatusLED(0, 255, 255); // Cyan while waiting
   } else {
-    Serial.println("Failed to send join request to any coordinator");
-    setStatusLED(255, 0, 0); // Red for failure
+    setJoinSentMs(0);
+    Serial.printf("Failed to send join request: %d\n", result);
   }
 }
 
-void sendJoinMessage() {
-  DynamicJsonDocument doc(256);
-  doc["type"] = "mesh_join";
-  doc["source"] = "ESP32_B_Client";
-  doc["timestamp"] = millis();
-  
-  String jsonString;
-  serializeJson(doc, jsonString);
-  
-  esp_err_t result = esp_now_send(esp32_a_mac, (uint8_t*)jsonString.c_str(), jsonString.length());
-  if (result == ESP_OK) {
-    Serial.println("Join message sent to ESP32 A");
-  } else {
-    Serial.println("Failed to send join message");
+// One resync frame to a coordinator that should still have us in its table
+// under epoch. Until it is acked (or MESH_JOIN_TIMEOUT_MS passes) beacons
+// do not trigger a join.
+static bool sendResync(const uint8_t* mac, uint32_t epoch) {
+  esp_now_peer_info_t peerInfo;
+  memset(&peerInfo, 0, sizeof(peerInfo));
+  memcpy(peerInfo.peer_addr, mac, 6);
+  peerInfo.channel = 0;  // current channel, follows channel moves
+  peerInfo.encrypt = false;
+  peerInfo.ifidx = WIFI_IF_STA;
+  esp_err_t result = esp_now_add_peer(&peerInfo);
+  if (result != ESP_OK && result != ESP_ERR_ESPNOW_EXIST) {
+    setJoinSentMs(0);
+    return false;
+  }
+
+  uint8_t frame[MESH_RESYNC_SIZE];
+  meshResyncEncode(0, epoch, frame);
+  memmove(esp32_a_mac, mac, 6);  // mac may already be esp32_a_mac
+  joinEpoch = epoch;
+  portENTER_CRITICAL(&joinMux);
+  joinSentMs = millis();
+  resyncPending = true;
+  resyncTried = true;
+  portEXIT_CRITICAL(&joinMux);
+  if (meshSend(esp32_a_mac, frame, sizeof(frame)) != ESP_OK) {
+    portENTER_CRITICAL(&joinMux);
+    resyncPending = false;
+    joinSentMs = 0;
+    portEXIT_CRITICAL(&joinMux);
+    return false;
+  }
+  return true;
+}
+
+// Resume the session saved before the reboot instead of the join handshake
+static void resumeMeshSession() {
+  MeshClientState state;
+  if (!meshStateLoadClient(state) || !chanValid(MESH_CHANNEL_MASK, state.channel)) return;
+  if (state.channel != meshChannel) {  // the mesh had moved before the reboot
+    meshChannel = state.channel;
+    esp_wifi_set_channel(meshChannel, WIFI_SECOND_CHAN_NONE);
+  }
+  if (!sendResync(state.coordinatorMac, state.epoch)) return;
+  Serial.printf("Resync sent to saved coordinator %02X:%02X:%02X:%02X:%02X:%02X (session %08lX)\n",
+                esp32_a_mac[0], esp32_a_mac[1], esp32_a_mac[2],
+                esp32_a_mac[3], esp32_a_mac[4], esp32_a_mac[5], (unsigned long)state.epoch);
+}
+
+// Joined by mesh_ack or by an acked resync
+static void markMeshJoined(bool resync) {
+  isMeshConnected = true;
+  esp32_a_connected = true;
+  lastMeshHeartbeat = millis();
+  coordinatorEpoch = joinEpoch;
+  portENTER_CRITICAL(&joinMux);
+  joinSentMs = 0;
+  resyncPending = false;
+  portEXIT_CRITICAL(&joinMux);
+  joinCount++;
+  lastJoinMs = millis() - discoveryStartMs;
+  lastJoinResync = resync;
+  coordinatorLeaseMs = MESH_LEASE_BEACONS * MESH_BEACON_INTERVAL_MS;  // until its first beacon
+  meshStateDirty = true;
+  membersReset(meshMembers, coordinatorEpoch, 0, false);
+  membersRequestMs = millis() - MESH_MEMBERS_REQUEST_MS;
+  requestMemberSnapshot();
+  // A full join starts in group 0 only; a resync keeps the coordinator's mask
+  if (!resync) {
+    portENTER_CRITICAL(&talkGroupMux);
+    if (talkGroupsWanted != TG_DEFAULT_MASK) queueTalkGroupRequestLocked();
+    portEXIT_CRITICAL(&talkGroupMux);
+  }
+  Serial.printf("%s in %lu ms\n", resync ? "Resynced" : "Joined", lastJoinMs);
+  if (failoverFromMs != 0) {
+    lastFailoverMs = millis() - failoverFromMs;
+    failoverFromMs = 0;
+    failoverCount++;
+    Serial.printf("Failover: audio rerouted %lu ms after the last frame from the old coordinator\n",
+                  lastFailoverMs);
+  }
+  setStatusLED(128, 0, 128); // Purple when connected
+}
+
+// Whom to join after a beacon, or JOIN_NONE. Called under joinMux.
+static uint8_t pickJoinLocked(const uint8_t* mac, const MeshBeacon& beacon, unsigned long now) {
+  if (isMeshConnected || joinAction != JOIN_NONE) return JOIN_NONE;
+  if (joinSentMs != 0 && now - joinSentMs < MESH_JOIN_TIMEOUT_MS) return JOIN_NONE;
+
+  // The lease ran out on lost beacons but the coordinator kept its session:
+  // it still has us in its table, so one resync frame is enough
+  if (!resyncTried && coordinatorEpoch != 0 && beacon.epoch == coordinatorEpoch &&
+      memcmp(mac, esp32_a_mac, 6) == 0) {
+    memcpy(joinTargetMac, mac, 6);
+    joinTargetEpoch = beacon.epoch;
+    return JOIN_RESYNC;
+  }
+
+  int best = beaconScanBest(joinScan, now, beacon.intervalMs);
+  if (best < 0) return JOIN_NONE;  // every coordinator heard is full
+  memcpy(joinTargetMac, joinScan.candidates[best].mac, 6);
+  joinTargetEpoch = joinScan.candidates[best].beacon.epoch;
+  return JOIN_FULL;
+}
+
+// Runs in the ESP-NOW receive callback for every beacon heard. A join or
+// resync is only picked here; sendPendingJoin sends it from housekeeping.
+static void handleBeacon(const uint8_t* mac, const MeshBeacon& beacon) {
+  unsigned long now = millis();
+  bool restarted = false;
+  portENTER_CRITICAL(&joinMux);
+  if (beaconScanUpdate(joinScan, mac, beacon, now) < 0) {  // another mesh
+    portEXIT_CRITICAL(&joinMux);
+    return;
+  }
+  lastBeaconMs = now;
+
+  if (resyncPending && memcmp(mac, esp32_a_mac, 6) == 0 && beacon.epoch != joinEpoch) {
+    resyncPending = false;  // the saved session is gone, join right away
+    joinSentMs = 0;
+  }
+
+  if (isMeshConnected && memcmp(mac, esp32_a_mac, 6) == 0) {
+    if (beacon.epoch == coordinatorEpoch) {
+      lastMeshHeartbeat = now;  // a beacon renews the coordinator's lease
+      if (beacon.leaseBeacons) coordinatorLeaseMs = meshBeaconLeaseMs(beacon);
+      portEXIT_CRITICAL(&joinMux);
+      return;
+    }
+    // Restarted coordinator: it no longer has us in its peer table
+    restarted = true;
+    isMeshConnected = false;
+    esp32_a_connected = false;
+    discoveryStartMs = now;
+    joinSentMs = 0;
+  }
+  uint8_t action = pickJoinLocked(mac, beacon, now);
+  if (action != JOIN_NONE) {
+    joinAction = action;
+    joinSentMs = now;  // no second pick until this one is sent and times out
+  }
+  portEXIT_CRITICAL(&joinMux);
+
+  if (restarted) {
+    Serial.println("Coordinator restarted (new epoch), rejoining");
+    digitalWrite(MESH_LED_PIN, LOW);
+  }
+  if (action != JOIN_NONE && HousekeepingTaskHandle) xTaskNotifyGive(HousekeepingTaskHandle);
+}
+
+// Housekeeping task: send the join or resync handleBeacon picked
+static void sendPendingJoin() {
+  uint8_t mac[6];
+  portENTER_CRITICAL(&joinMux);
+  uint8_t action = joinAction;
+  uint32_t epoch = joinTargetEpoch;
+  memcpy(mac, joinTargetMac, 6);
+  joinAction = JOIN_NONE;
+  portEXIT_CRITICAL(&joinMux);
+  if (action == JOIN_FULL) sendJoinRequest(mac, epoch);
+  else if (action == JOIN_RESYNC) sendResync(mac, epoch);
+}
+
+static void printBeaconStats() {
+  static BeaconScan scan;  // console only
+  portENTER_CRITICAL(&joinMux);
+  scan = joinScan;
+  portEXIT_CRITICAL(&joinMux);
+  Serial.printf("=== DISCOVERY (network 0x%04X, beacons heard %lu, other networks %lu) ===\n",
+                MESH_NETWORK_ID, (unsigned long)scan.heard, (unsigned long)scan.foreign);
+  Serial.printf("  joined: %s, joins %lu, join requests %lu, last time-to-join %lu ms (%s)\n",
+                isMeshConnected ? "yes" : "no", (unsigned long)joinCount,
+                (unsigned long)joinRequests, lastJoinMs, lastJoinResync ? "resync" : "beacon join");
+  Serial.printf("  coordinator lease %lu ms, failovers %lu, last failover %lu ms\n",
+                coordinatorLeaseMs, (unsigned long)failoverCount, lastFailoverMs);
+  Serial.printf("  channel %u (candidates 0x%04X), moves followed %lu, scan hops %lu\n",
+                meshChannel, MESH_CHANNEL_MASK, (unsigned long)channelMoves, (unsigned long)channelScanHops);
+  portENTER_CRITICAL(&talkGroupMux);
+  uint8_t confirmed = talkGroupsConfirmed, wanted = talkGroupsWanted;
+  bool pending = talkGroupPending;
+  portEXIT_CRITICAL(&talkGroupMux);
+  Serial.printf("  talk groups 0x%X (wanted 0x%X%s), requests %lu, states %lu\n",
+                confirmed, wanted, pending ? ", pending" : "",
+                (unsigned long)talkGroupRequests, (unsigned long)talkGroupStates);
+  unsigned long now = millis();
+  for (int i = 0; i < scan.count; i++) {
+    const BeaconCandidate& c = scan.candidates[i];
+    Serial.printf("  %02X:%02X:%02X:%02X:%02X:%02X epoch %08lX peers %u/%u%s, heard %lu ms ago\n",
+                  c.mac[0], c.mac[1], c.mac[2], c.mac[3], c.mac[4], c.mac[5],
+                  (unsigned long)c.beacon.epoch, c.beacon.peers, c.beacon.capacity,
+                  (c.beacon.flags & MESH_BEACON_FLAG_PHONE) ? " phone" : "",
+                  (unsigned long)(now - c.heardMs));
   }
 }
 
 void sendAudioAck(const uint8_t* mac) {
-  DynamicJsonDocument ackDoc(256);
+  StaticJsonDocument<256> ackDoc;
   ackDoc["type"] = "audio_ack";
-  ackDoc["source"] = deviceName;
+  ackDoc["source"] = deviceName.c_str();
   ackDoc["status"] = "received";
   ackDoc["timestamp"] = millis();
   
-  String ackString;
-  serializeJson(ackDoc, ackString);
+  char ackString[ESP_NOW_MAX_DATA_LEN + 1];
+  size_t ackLen = serializeJson(ackDoc, ackString, sizeof(ackString));
   
-  esp_err_t result = esp_now_send(mac, (uint8_t*)ackString.c_str(), ackString.length());
+  esp_err_t result = meshSend(mac, (uint8_t*)ackString, ackLen);
   if (result == ESP_OK) {
     Serial.println("Audio acknowledgment sent to coordinator");
   } else {
@@ -379,7 +690,7 @@ void sendReadyConfirmation() {
   String readyString;
   serializeJson(readyDoc, readyString);
   
-  esp_err_t result = esp_now_send(esp32_a_mac, (uint8_t*)readyString.c_str(), readyString.length());
+  esp_err_t result = meshSend(esp32_a_mac, (uint8_t*)readyString.c_str(), readyString.length());
   if (result == ESP_OK) {
     Serial.println("Ready confirmation sent to coordinator");
   } else {
@@ -443,22 +754,37 @@ class MyServerCallbacks: public BLEServerCallbacks {
 
 class MyCallbacks: public BLECharacteristicCallbacks {
     void onWrite(BLECharacteristic *pCharacteristic) {
-      std::string rxValue = pCharacteristic->getValue();
+      // Read the attribute in place: getValue() would copy it into a std::string
+      const uint8_t* rxValue = pCharacteristic->getData();
+      int rxLength = (int)pCharacteristic->getLength();
       
-      if (rxValue.length() > 0) {
+      WmHeader header;
+      uint8_t op, value;
+      if (wmParseHeader(rxValue, rxLength, header) > 0 && header.headerLen + header.payloadLen <= rxLength &&
+          tgPhoneParse(rxValue, header, op, value)) {
+        // Fold into the wanted mask; an invalid or TALK op still gets the state back
+        portENTER_CRITICAL(&talkGroupMux);
+        int next = tgApply(talkGroupsWanted, op, value);
+        if (next >= 0) talkGroupsWanted = (uint8_t)next;
+        queueTalkGroupRequestLocked();
+        portEXIT_CRITICAL(&talkGroupMux);
+        return;
+      }
+
+      if (rxLength > 0) {
         Serial.println("=== AUDIO DATA RECEIVED FROM PHONE B ===");
-        Serial.printf("Received %d bytes\n", rxValue.length());
+        Serial.printf("Received %d bytes\n", rxLength);
         
         // Print first 8 bytes for debugging
         Serial.print("First 8 bytes: ");
-        for (int i = 0; i < min(8, (int)rxValue.length()); i++) {
-          Serial.printf("0x%02X ", (uint8_t)rxValue[i]);
+        for (int i = 0; i < min(8, rxLength); i++) {
+          Serial.printf("0x%02X ", rxValue[i]);
         }
         Serial.println();
         
         // Update statistics
         packetsReceived++;
-        bytesReceived += rxValue.length();
+        bytesReceived += rxLength;
       }
     }
     
@@ -468,7 +794,7 @@ class MyCallbacks: public BLECharacteristicCallbacks {
 };
 
 // Handle test audio data
-void handleTestAudioData(const uint8_t* data, int len, const DynamicJsonDocument& doc) {
+void handleTestAudioData(const uint8_t* data, int len, const JsonDocument& doc) {
   int testId = doc["test_id"];
   int dataSize = doc["data_size"];
   String dataType = doc["data_type"];
@@ -490,15 +816,14 @@ void handleTestAudioData(const uint8_t* data, int len, const DynamicJsonDocument
                   testId, receivedChecksum);
     
     // Convert data to hex for logging
-    String hexData = "";
+    char hexData[2 * 32 + 4];
+    int hexLen = 0;
     for (int i = 0; i < len && i < 32; i++) {  // Limit to first 32 bytes for display
-      char hex[3];
-      sprintf(hex, "%02X", data[i]);
-      hexData += hex;
+      hexLen += sprintf(hexData + hexLen, "%02X", data[i]);
     }
-    if (len > 32) hexData += "...";
+    strcpy(hexData + hexLen, len > 32 ? "..." : "");
     
-    Serial.printf("🧪 TEST_AUDIO_RECEIVED:%d - DATA:%s\n", testId, hexData.c_str());
+    Serial.printf("🧪 TEST_AUDIO_RECEIVED:%d - DATA:%s\n", testId, hexData);
     
     // Send test acknowledgment back to coordinator
     sendTestAck(esp32_a_mac, testId, "received");
@@ -514,18 +839,18 @@ void handleTestAudioData(const uint8_t* data, int len, const DynamicJsonDocument
 }
 
 // Send test acknowledgment
-void sendTestAck(const uint8_t* mac, int testId, const String& status) {
-  DynamicJsonDocument ackDoc(256);
+void sendTestAck(const uint8_t* mac, int testId, const char* status) {
+  StaticJsonDocument<256> ackDoc;
   ackDoc["type"] = "test_ack";
   ackDoc["test_id"] = testId;
   ackDoc["status"] = status;
   ackDoc["source"] = "ESP32_B_Client";
   ackDoc["timestamp"] = millis();
   
-  String ackString;
-  serializeJson(ackDoc, ackString);
+  char ackString[ESP_NOW_MAX_DATA_LEN + 1];
+  size_t ackLen = serializeJson(ackDoc, ackString, sizeof(ackString));
   
-  esp_err_t result = esp_now_send(mac, (uint8_t*)ackString.c_str(), ackString.length());
+  esp_err_t result = meshSend(mac, (uint8_t*)ackString, ackLen);
   if (result == ESP_OK) {
     Serial.printf("✅ Test ACK sent to coordinator for test %d\n", testId);
   } else {
@@ -561,9 +886,16 @@ static bool parseCompactAudioHeader(const uint8_t* data, int len, int* values, i
   return false;
 }
 
+#define NOTIFY_PERIOD_MS 10
+#define LOOP_PERIOD_MS 100
+static int notifyDeadline = -1;  // DeadlineMonitor indices, registered in setup
+static int loopDeadline = -1;
+
+// Frames waiting for notify; memmoved every flush, so internal RAM
+static uint8_t coalesceBuf[kCoalesceBufferBytes] MEM_FAST_ATTR;
+
 // Dedicated BLE notify flush task (35 ms cadence, 1280B target)
 static void bleNotifyTask(void *pvParameters) {
-  static uint8_t coalesceBuf[4096];
   static int coalesceLen = 0;
   NotifyItem item;
   static bool startupFramingInitialized = false;
@@ -571,8 +903,11 @@ static void bleNotifyTask(void *pvParameters) {
   static int currentFrameSize = 200; // 100 during startup, then 200
   
   Serial.println("BLE notify task started");
+  allocTrackSetSubsystem(ALLOC_SUB_BLE);
 
   while(1) {
+    uint32_t busyStart = taskStageNowUs();
+    deadlineBegin(notifyDeadline);
     // Apply pending resets atomically
     if (bleResetPending) {
       __atomic_store_n(&notifyHead, 0, __ATOMIC_RELEASE);
@@ -584,11 +919,13 @@ static void bleNotifyTask(void *pvParameters) {
 
     // Drain the queue as much as possible into the coalesce buffer
     while (notifyQueuePop(item)) {
+        taskStageRecordLatency(TASK_STAGE_NOTIFY, item.queuedUs);
         if (coalesceLen + item.length <= sizeof(coalesceBuf)) {
             memcpy(coalesceBuf + coalesceLen, item.data, item.length);
             coalesceLen += item.length;
+            bufferNoteLevel(BUF_POOL_COALESCE_BUFFER, coalesceLen);
         } else {
-            Serial.println("Coalesce buffer overflow, discarding packet!");
+            DLOG(BLE, WARN, NOTIFY_OVERFLOW, item.length);
         }
     }
 
@@ -605,7 +942,9 @@ static void bleNotifyTask(void *pvParameters) {
     // If not subscribed or not connected, avoid accumulating backlog that would join speech later
     if (!bleDeviceConnected || !subscribed) {
       coalesceLen = 0; // drop until notifications are enabled
-      vTaskDelay(pdMS_TO_TICKS(10));
+      taskStageAddBusy(TASK_STAGE_NOTIFY, busyStart);
+      deadlineEnd(notifyDeadline);
+      vTaskDelay(pdMS_TO_TICKS(NOTIFY_PERIOD_MS));
       continue;
     }
 
@@ -626,6 +965,7 @@ static void bleNotifyTask(void *pvParameters) {
       int flushBytes = (coalesceLen / currentFrameSize) * currentFrameSize; // whole frames only
       
       int sent = 0;
+      AllocScope radio(ALLOC_SUB_RADIO);
       while (sent < flushBytes) {
         pAudioCharacteristic->setValue(coalesceBuf + sent, currentFrameSize);
         pAudioCharacteristic->notify();
@@ -646,13 +986,289 @@ static void bleNotifyTask(void *pvParameters) {
     }
     
     // Wait before checking the queue again
-    vTaskDelay(pdMS_TO_TICKS(10));
+    taskStageAddBusy(TASK_STAGE_NOTIFY, busyStart);
+    deadlineEnd(notifyDeadline);
+    vTaskDelay(pdMS_TO_TICKS(NOTIFY_PERIOD_MS));
   }
 }
 
+// Coordinator health and periodic status. Each job is a timer on
+// housekeepingWheel; HousekeepingTask (placed by the task layout) sleeps
+// until the next deadline. Rejoining needs no timer: the next coordinator
+// beacon triggers it (handleBeacon), whether it comes from the same node or
+// from a standby that took over (lib/MeshElection).
+static TimerWheel housekeepingWheel;
+
+static uint64_t wheelClockUs() {
+  return (uint64_t)esp_timer_get_time();
+}
+
+// Coordinator lease: each beacon renews it for leaseBeacons intervals. Once
+// it runs out the coordinator is presumed gone. esp32_a_mac and
+// coordinatorEpoch stay, so the same node coming back is resynced.
+static void healthTimer(void* arg) {
+  if (!isMeshConnected || !esp32_a_connected) return;
+  
+  unsigned long lastHeard = lastMeshHeartbeat;
+  unsigned long silentMs = millis() - lastHeard;
+  if (silentMs > coordinatorLeaseMs) {
+    Serial.printf("Mesh coordinator lease expired (%lu ms silent), marking as disconnected\n", silentMs);
+    failoverFromMs = lastHeard;
+    esp32_a_connected = false;
+    isMeshConnected = false;
+    setStatusLED(255, 0, 0); // Red when disconnected
+    digitalWrite(MESH_LED_PIN, LOW);
+    
+    // Clear the peer and rejoin on the next beacon
+    esp_now_del_peer(esp32_a_mac);
+    startMeshDiscovery();
+  }
+}
+
+// Follow an announced move; while no beacon of our network has been heard
+// for MESH_CHANNEL_SCAN_MS and we are not joined, try the next candidate.
+// A coordinator whose announcement we missed is found this way and
+// resynced with one frame, as after lost beacons. No hop while a join or
+// resync waits for its answer: that comes on the channel it was sent on.
+static void channelTimer(void* arg) {
+  unsigned long now = millis();
+  if (switchChannel && (long)(now - switchAtMs) >= 0) {
+    uint8_t to = switchChannel;
+    switchChannel = 0;
+    if (to != meshChannel) {
+      esp_wifi_set_channel(to, WIFI_SECOND_CHAN_NONE);
+      Serial.printf("📶 Followed the mesh from channel %u to %u\n", meshChannel, to);
+      meshChannel = to;
+      channelMoves++;
+      meshStateDirty = true;
+    }
+    lastMeshHeartbeat = now;  // the lease starts over on the new channel
+    lastBeaconMs = now;
+    return;
+  }
+  if (isMeshConnected || now - lastBeaconMs < MESH_CHANNEL_SCAN_MS) return;
+  portENTER_CRITICAL(&joinMux);
+  bool joining = joinSentMs != 0 && now - joinSentMs < MESH_JOIN_TIMEOUT_MS;
+  portEXIT_CRITICAL(&joinMux);
+  if (joining) return;
+  uint8_t next = chanNextScan(MESH_CHANNEL_MASK, meshChannel);
+  lastBeaconMs = now;
+  if (next == meshChannel) return;
+  meshChannel = next;
+  esp_wifi_set_channel(next, WIFI_SECOND_CHAN_NONE);
+  channelScanHops++;
+}
+
+// Save the coordinator we joined; at most one NVS write per MESH_STATE_MIN_SAVE_MS
+static void meshStatePersistTimer(void* arg) {
+  static uint32_t lastSaveMs = 0;
+  uint32_t now = millis();
+  if (!meshStateDirty || !isMeshConnected || !meshStateSaveDue(lastSaveMs, now)) return;
+  meshStateDirty = false;
+  lastSaveMs = now;
+  MeshClientState state;
+  memcpy(state.coordinatorMac, esp32_a_mac, 6);
+  state.channel = meshChannel;
+  state.epoch = coordinatorEpoch;
+  if (!meshStateSaveClient(state)) meshStateDirty = true;
+}
+
+static void statisticsTimer(void* arg) {
+  AllocScope scope(ALLOC_SUB_CONSOLE);
+  printStatistics();
+}
+
+// BLE status check and debugging
+static void bleDebugTimer(void* arg) {
+  AllocScope scope(ALLOC_SUB_CONSOLE);
+  Serial.printf("🔵 BLE Status - Server: %s, Advertising: %s, Connected: %s\n",
+                bleServerStarted ? "Running" : "Stopped",
+                bleAdvertising ? "Yes" : "No", 
+                bleDeviceConnected ? "Yes" : "No");
+  
+  // Check if BLE is actually advertising
+  if (bleServerStarted && bleAdvertising) {
+    Serial.println("✅ BLE Server should be advertising");
+  } else {
+    Serial.println("❌ BLE Server not advertising properly");
+  }
+}
+
+// Tell the coordinator we are alive, unless something else went to it
+// within the interval: any frame refreshes our entry in its table
+static void heartbeatTimer(void* arg) {
+  if (!isMeshConnected) return;
+  if (airtimeIdleMsAny(millis()) < MESH_HEARTBEAT_INTERVAL) {
+    heartbeatsSuppressed++;
+    return;
+  }
+  StaticJsonDocument<128> doc;
+  doc["type"] = "mesh_heartbeat";
+  doc["source"] = deviceName.c_str();
+  char heartbeat[ESP_NOW_MAX_DATA_LEN + 1];
+  size_t heartbeatLen = serializeJson(doc, heartbeat, sizeof(heartbeat));
+  if (meshSend(esp32_a_mac, (const uint8_t*)heartbeat, heartbeatLen) == ESP_OK) heartbeatsSent++;
+}
+
+// Runs in the receive callback: the coordinator's mask for us, after a
+// request or a resync. Without a request in flight it is the authority.
+static void handleTalkGroupState(uint8_t mask) {
+  portENTER_CRITICAL(&talkGroupMux);
+  talkGroupStates++;
+  talkGroupsConfirmed = mask;
+  if (!talkGroupPending) talkGroupsWanted = mask;
+  else if (mask == talkGroupsWanted) talkGroupPending = false;
+  portEXIT_CRITICAL(&talkGroupMux);
+  uint8_t frame[TG_PHONE_STATE_SIZE];
+  (void)notifyQueuePushFromISR(frame, (uint16_t)tgPhoneEncodeState(mask, 0, frame), 0);
+}
+
+// Send the wanted mask until the coordinator confirms it, TG_RETRIES times
+// TG_RETRY_MS apart; a later join sends it again. The try is counted before
+// the send, so a request queued meanwhile starts over.
+static void talkGroupTimer(void* arg) {
+  if (!isMeshConnected) return;
+  unsigned long now = millis();
+  portENTER_CRITICAL(&talkGroupMux);
+  bool due = talkGroupPending && (talkGroupSentMs == 0 || now - talkGroupSentMs >= TG_RETRY_MS);
+  bool gaveUp = due && talkGroupTries >= TG_RETRIES;
+  if (gaveUp) talkGroupPending = false;
+  if (due && !gaveUp) {
+    talkGroupTries++;
+    talkGroupSentMs = now;
+  }
+  uint8_t wanted = talkGroupsWanted;
+  portEXIT_CRITICAL(&talkGroupMux);
+  if (gaveUp) {
+    Serial.printf("⚠️ Talk groups 0x%X not confirmed by the coordinator\n", wanted);
+    return;
+  }
+  if (!due) return;
+  uint8_t frame[TG_MESH_SIZE];
+  if (meshSend(esp32_a_mac, frame, tgMeshEncode(TG_OP_SET, wanted, 0, frame)) == ESP_OK) {
+    talkGroupRequests++;
+  }
+}
+
+static void printAirtimeStats() {
+  airtimePrintStats();
+  Serial.printf("  heartbeats sent %lu, suppressed %lu; membership v%u, %lu snapshot requests\n",
+                (unsigned long)heartbeatsSent, (unsigned long)heartbeatsSuppressed,
+                meshMembers.version, (unsigned long)membersRequests);
+}
+
+#ifdef ALLOC_TRACK
+static void allocRateTimer(void* arg) {
+  allocTrackTick();
+}
+#endif
+
+static void setupHousekeepingTimers() {
+  timerWheelInit(housekeepingWheel, wheelClockUs);
+  timerWheelAdd(housekeepingWheel, "health", healthTimer, NULL,
+                MESH_BEACON_INTERVAL_MS * 1000UL, MESH_BEACON_INTERVAL_MS * 1000UL);
+  timerWheelAdd(housekeepingWheel, "heartbeat", heartbeatTimer, NULL,
+                MESH_HEARTBEAT_INTERVAL * 1000UL, MESH_HEARTBEAT_INTERVAL * 1000UL);
+  timerWheelAdd(housekeepingWheel, "channel", channelTimer, NULL, CHAN_TICK_MS * 1000UL, CHAN_TICK_MS * 1000UL);
+  timerWheelAdd(housekeepingWheel, "talk_group", talkGroupTimer, NULL, 100000UL, 100000UL);
+  timerWheelAdd(housekeepingWheel, "mesh_state", meshStatePersistTimer, NULL, 1000000UL, 1000000UL);
+  timerWheelAdd(housekeepingWheel, "statistics", statisticsTimer, NULL, 30000000UL, 30000000UL);  // reduced spam
+  timerWheelAdd(housekeepingWheel, "ble_debug", bleDebugTimer, NULL, 10000000UL, 10000000UL);
+#ifdef ALLOC_TRACK
+  timerWheelAdd(housekeepingWheel, "alloc_rate", allocRateTimer, NULL, 1000000UL, 1000000UL);
+#endif
+}
+
+void HousekeepingTask(void *pvParameters) {
+  allocTrackSetSubsystem(ALLOC_SUB_CONTROL);
+  for (;;) {
+    uint32_t start = taskStageNowUs();
+    sendPendingJoin();  // woken early by handleBeacon
+    uint32_t waitUs = timerWheelRunDue(housekeepingWheel);
+    taskStageAddBusy(TASK_STAGE_HOUSEKEEPING, start);
+    uint32_t dueUs = taskStageNowUs() + waitUs;
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS((waitUs + 999) / 1000));
+    if ((int32_t)(taskStageNowUs() - dueUs) >= 0) taskStageRecordLatency(TASK_STAGE_HOUSEKEEPING, dueUs);
+  }
+}
+
+// Layout benchmark on live traffic: the client has no synthetic source, so
+// run it while the coordinator streams
+static volatile uint32_t layoutBenchSeconds = 0;
+
+void layoutBenchTask(void *pvParameters) {
+  uint32_t windowUs = layoutBenchSeconds * 1000000UL;
+  Serial.printf("⏱️ Layout bench: %lu s on layout %d (%s)\n", (unsigned long)layoutBenchSeconds,
+                taskLayoutActiveIndex(), taskLayoutActive().name);
+  taskStageReset();
+  uint32_t startUs = taskStageNowUs();
+  while (taskStageNowUs() - startUs < windowUs) vTaskDelay(pdMS_TO_TICKS(100));
+  taskLayoutPrintStats(taskStageNowUs() - startUs, true);
+  layoutBenchSeconds = 0;
+  vTaskDelete(NULL);
+}
+
+// Allocation check: simulate the coordinator (a 20 ms narrowband WM frame
+// and one mesh heartbeat a second through OnDataRecv), so the upsampler,
+// notify queue and notify task see a live stream. Counters are reset after
+// a one second warm-up; any allocation in a steady subsystem fails. Run it
+// while the coordinator is not streaming: OnDataRecv keeps static state and
+// normally has the Wi-Fi task to itself.
+#define ALLOC_CHECK_SAMPLES 160  // 20 ms at 8 kHz
+static volatile uint32_t allocCheckSeconds = 0;  // non-zero while alloc_check runs
+
+void allocCheckTask(void *pvParameters) {
+  static const char kHeartbeat[] = "{\"type\":\"mesh_heartbeat\",\"devices\":1}";
+  uint8_t frame[WM_HEADER_V2_SIZE + ALLOC_CHECK_SAMPLES];
+  memset(frame + WM_HEADER_V2_SIZE, 0xFF, ALLOC_CHECK_SAMPLES);  // u-law silence
+  WmHeader header;
+  header.type = WM_TYPE_ULAW_NB;
+  header.streamId = 255;
+  header.payloadLen = ALLOC_CHECK_SAMPLES;
+
+  uint32_t windowUs = allocCheckSeconds * 1000000UL;
+  Serial.printf("🧮 Alloc check: %lu s simulated stream, BLE %s\n",
+                (unsigned long)allocCheckSeconds, bleDeviceConnected ? "connected" : "not connected");
+  uint32_t frames = 0;
+  uint32_t warmupUs = taskStageNowUs();
+  uint32_t startUs = 0;
+  bool measuring = false;
+  TickType_t xLastWakeTime = xTaskGetTickCount();
+  for (;;) {
+    uint32_t now = taskStageNowUs();
+    if (!measuring && now - warmupUs >= 1000000UL) {
+      allocTrackReset();
+      startUs = now;
+      measuring = true;
+    }
+    if (measuring && now - startUs >= windowUs) break;
+    header.flags = frames == 0 ? WM_FLAG_MARKER : 0;
+    header.sequence = frames;
+    header.timestamp = frames * ALLOC_CHECK_SAMPLES * (WM_TIMESTAMP_HZ / 8000);
+    wmWriteHeaderV2(frame, header);
+    OnDataRecv(esp32_a_mac, frame, sizeof(frame));
+    if (frames % 50 == 0) OnDataRecv(esp32_a_mac, (const uint8_t*)kHeartbeat, sizeof(kHeartbeat) - 1);
+    frames++;
+    vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(20));
+  }
+
+  uint32_t steady = allocTrackSteadyCount();
+  allocTrackPrintStats();
+  Serial.printf("%s Alloc check: %lu allocations in audio/mesh/ble/control over %lu s (%lu frames)\n",
+                steady ? "❌ FAIL" : "✅ PASS", (unsigned long)steady,
+                (unsigned long)allocCheckSeconds, (unsigned long)frames);
+  allocCheckSeconds = 0;
+  vTaskDelete(NULL);
+}
+
 void setup() {
   Serial.begin(115200);
   Serial.println("\n\n=== ESP32-S3 BLE AUDIO CLIENT STARTING ===");
+  dlogInit();
+
+  // Place large buffers before any callback can touch them
+  notifyQueue = (NotifyItem*)memPlaceAlloc(MEM_BULK, bufferPoolBytes(BUF_POOL_NOTIFY_QUEUE), "notifyQueue");
+  memPlaceRegister(MEM_FAST, coalesceBuf, sizeof(coalesceBuf), "coalesceBuf");
   
   // Initialize Neopixel LED
   pixels.begin();
@@ -665,6 +1281,16 @@ void setup() {
   digitalWrite(MESH_LED_PIN, LOW);
   digitalWrite(BLE_LED_PIN, LOW);
   
+  audioMeterInit(meterMeshIn, "mesh_in");
+  resamplerInit(meshUpsampler, MESH_NB_SAMPLE_RATE, AUDIO_SAMPLE_RATE);
+  
+  // Core, priority and stack of every stage come from the task layout table
+  taskLayoutLoad();
+  Serial.printf("Task layout %d (%s)\n", taskLayoutActiveIndex(), taskLayoutActive().name);
+  
+  // Low-priority drain for DLOG() records from the hot paths
+  taskLayoutSpawn(TASK_STAGE_LOG, dlogDrainTask, "LogDrain", NULL);
+  
   // Initialize BLE FIRST - Simplified to match working coordinator
   Serial.println("🔵 Initializing BLE...");
   
@@ -776,12 +1402,62 @@ void setup() {
   setupESPNOWMesh();
 
   // Start BLE notify flushing task to forward audio to Phone B
-  xTaskCreatePinnedToCore(bleNotifyTask, "bleNotifyTask", 4096, NULL, 1, NULL, 1);
+  notifyDeadline = deadlineRegister("bleNotify", NOTIFY_PERIOD_MS * 1000);
+  loopDeadline = deadlineRegister("loop", LOOP_PERIOD_MS * 1000);
+  taskLayoutSpawn(TASK_STAGE_NOTIFY, bleNotifyTask, "bleNotifyTask", NULL);
+  setupHousekeepingTimers();
+  taskLayoutSpawn(TASK_STAGE_HOUSEKEEPING, HousekeepingTask, "Housekeeping", &HousekeepingTaskHandle);
+
+  memPlacePrintMap();
 }
 
 // ESP-NOW Callback Functions
 void OnDataRecv(const uint8_t *mac, const uint8_t *data, int len) {
-  static unsigned long lastBrief = 0; if (millis() - lastBrief > 1000) { lastBrief = millis(); Serial.printf("Mesh RX len=%d\n", len); }
+  AllocScope scope(ALLOC_SUB_MESH);
+  DLOG(MESH, DEBUG, MESH_RX_LEN, len);
+
+  // Any frame from our coordinator renews its lease, audio included
+  if (isMeshConnected && memcmp(mac, esp32_a_mac, 6) == 0) lastMeshHeartbeat = millis();
+  // Coordinator liveness probe: the MAC-layer ack is the whole answer
+  if (fdIsProbe(data, len)) return;
+  uint8_t switchTo;
+  uint32_t switchEpoch;
+  uint16_t switchInMs;
+  if (chanSwitchParse(data, len, switchTo, switchEpoch, switchInMs)) {
+    // Our coordinator moves the mesh: retune at the same moment it does
+    if (isMeshConnected && memcmp(mac, esp32_a_mac, 6) == 0 && switchEpoch == coordinatorEpoch &&
+        chanValid(MESH_CHANNEL_MASK, switchTo)) {
+      switchAtMs = millis() + switchInMs;
+      switchChannel = switchTo;
+    }
+    return;
+  }
+
+  MeshBeacon beacon;
+  if (meshBeaconParse(data, len, beacon)) {
+    handleBeacon(mac, beacon);
+    return;
+  }
+  uint8_t resyncFlags;
+  uint32_t resyncEpoch;
+  if (meshResyncParse(data, len, resyncFlags, resyncEpoch)) {
+    if ((resyncFlags & MESH_RESYNC_FLAG_ACK) && resyncPending && resyncEpoch == joinEpoch &&
+        memcmp(mac, esp32_a_mac, 6) == 0) {
+      markMeshJoined(true);
+    }
+    return;
+  }
+  if (membersIsFrame(data, len)) {
+    handleMembersFrame(mac, data, len);
+    return;
+  }
+  uint8_t groupOp, groupMask, groupExtra;
+  if (tgMeshParse(data, len, groupOp, groupMask, groupExtra)) {
+    if (groupOp == TG_OP_STATE && isMeshConnected && memcmp(mac, esp32_a_mac, 6) == 0) {
+      handleTalkGroupState(groupMask);
+    }
+    return;
+  }
   
   // Check for raw PCM audio chunk format first (P:...)
   if (len > 2 && data[0] == 'P' && data[1] == ':') {
@@ -811,6 +1487,7 @@ void OnDataRecv(const uint8_t *mac, const uint8_t *data, int len) {
           processedLen = sizeof(silence);
           memcpy(processed, silence, sizeof(silence));
         }
+        audioMeterUpdateUlaw(meterMeshIn, processed, processedLen);
         if (bleDeviceConnected) {
           // Treat payload as 8-bit (µ-law) and forward as-is to Phone B
           (void)notifyQueuePushFromISR(processed, processedLen, 1);
@@ -830,15 +1507,37 @@ void OnDataRecv(const uint8_t *mac, const uint8_t *data, int len) {
     }
     return; // Skip JSON parsing for raw PCM format
   }
-  // Binary framing: 'W','M', type(1=Opus), seq(le16), len(le16), payload
-  if (len >= 7 && data[0] == 'W' && data[1] == 'M') {
-    uint8_t type = data[2];
-    uint16_t seq = (uint16_t)(data[3] | (data[4] << 8));
-    uint16_t plen = (uint16_t)(data[5] | (data[6] << 8));
-    if (7 + plen <= len && type == 1 && plen > 0) {
+  // Binary framing: WM v1/v2 header (WmFrame.h), payload
+  WmHeader wm;
+  if (len >= WM_HEADER_V1_SIZE && wmParseHeader(data, len, wm) > 0) {
+    uint8_t type = wm.type;
+    uint16_t plen = wm.payloadLen;
+    int hlen = wm.headerLen;
+    if (hlen + plen <= len && plen > 0) wmTrackFrame(wm);
+    if ((wm.flags & WM_FLAG_MEMBERSHIP) &&
+        (!meshMembers.complete || wm.membersVersion != (uint8_t)meshMembers.version)) {
+      requestMemberSnapshot();
+    }
+    if (hlen + plen <= len && type == WM_TYPE_ULAW_NB && plen > 0) {
+      // Narrowband u-law: upsample to the phone's rate and forward as 8-bit audio
+      static int16_t pcmIn[120];
+      static int16_t pcmOut[241];
+      static uint8_t ulawOut[241];
+      const uint8_t* payload = data + hlen;
+      for (int offset = 0; offset < plen; offset += 120) {
+        int count = (plen - offset) < 120 ? (plen - offset) : 120;
+        for (int i = 0; i < count; i++) pcmIn[i] = g711UlawToLinear(payload[offset + i]);
+        int outCount = resamplerProcess(meshUpsampler, pcmIn, count, pcmOut, 241);
+        for (int i = 0; i < outCount; i++) ulawOut[i] = g711LinearToUlaw(pcmOut[i]);
+        audioMeterUpdateUlaw(meterMeshIn, ulawOut, outCount);
+        (void)notifyQueuePushFromISR(ulawOut, (uint16_t)outCount, 1);
+      }
+      packetsReceived++;
+      bytesReceived += hlen + plen;
+    } else if (hlen + plen <= len && type == WM_TYPE_OPUS && plen > 0) {
       // Forward the COMPLETE WM frame unchanged to Phone B (Android reassembles/parses)
       const uint8_t* wmFrame = data;
-      uint16_t frameLen = (uint16_t)(7 + plen);
+      uint16_t frameLen = (uint16_t)(hlen + plen);
       if (!notifyQueuePushFromISR(wmFrame, frameLen, 0)) {
         // drop silently if queue full
       }
@@ -852,6 +1551,7 @@ void OnDataRecv(const uint8_t *mac, const uint8_t *data, int len) {
     int payload = len - 2;
     if (payload > 0) {
       const uint8_t* pcm8 = data + 2;
+      audioMeterUpdateUlaw(meterMeshIn, pcm8, payload);
       if (!notifyQueuePushFromISR(pcm8, (uint16_t)payload, 1)) {
         // Drop silently
       }
@@ -866,15 +1566,15 @@ void OnDataRecv(const uint8_t *mac, const uint8_t *data, int len) {
     return;
   }
   
-  // Parse the received data as JSON
-  DynamicJsonDocument doc(1024);
+  // Parse into a document reused across messages (ESP-NOW callbacks run one
+  // at a time in the Wi-Fi task), so steady-state heartbeats never touch the heap
+  static StaticJsonDocument<1024> doc;
   DeserializationError error = deserializeJson(doc, data, len);
   
   if (!error) {
-    String messageType = doc["type"];
-    String messageString = String((char*)data, len);
+    const char* messageType = doc["type"] | "";
     
-    if (messageType == "mesh_ack") {
+    if (strcmp(messageType, "mesh_ack") == 0) {
       // Mesh acknowledgment received
       String status = doc["status"];
       
@@ -891,16 +1591,14 @@ void OnDataRecv(const uint8_t *mac, const uint8_t *data, int len) {
         esp_now_peer_info_t peerInfo;
         memset(&peerInfo, 0, sizeof(esp_now_peer_info_t));
         memcpy(peerInfo.peer_addr, mac, 6);
-        peerInfo.channel = MESH_CHANNEL;
+        peerInfo.channel = 0;  // current channel
         peerInfo.encrypt = false;
         peerInfo.ifidx = WIFI_IF_STA;
         
         esp_err_t result = esp_now_add_peer(&peerInfo);
-        if (result == ESP_OK) {
+        if (result == ESP_OK || result == ESP_ERR_ESPNOW_EXIST) {  // added by sendJoinRequest
           Serial.println("Mesh coordinator added as peer successfully");
-          isMeshConnected = true;
-          esp32_a_connected = true;
-          setStatusLED(128, 0, 128); // Purple when connected
+          markMeshJoined(false);
           
           // Send ready confirmation to complete handshake
           sendReadyConfirmation();
@@ -913,7 +1611,7 @@ void OnDataRecv(const uint8_t *mac, const uint8_t *data, int len) {
         setStatusLED(255, 0, 0); // Red on failure
       }
       
-    } else if (messageType == "mesh_heartbeat") {
+    } else if (strcmp(messageType, "mesh_heartbeat") == 0) {
       // Heartbeat from coordinator
       Serial.println("Mesh heartbeat received from coordinator");
       lastMeshHeartbeat = millis();
@@ -923,80 +1621,43 @@ void OnDataRecv(const uint8_t *mac, const uint8_t *data, int len) {
         int totalDevices = doc["devices"];
         Serial.printf("Mesh heartbeat - Total devices: %d\n", totalDevices);
       }
-      
-    } else if (messageType == "mesh_status") {
-      // Mesh status update from coordinator
-      Serial.println("Mesh status received from coordinator");
-      
-      if (doc.containsKey("total_devices")) {
-        int totalDevices = doc["total_devices"];
-        Serial.printf("Total devices in mesh: %d\n", totalDevices);
-      }
-      
-      if (doc.containsKey("devices")) {
-        JsonArray devices = doc["devices"];
-        Serial.println("Connected devices:");
-        for (JsonObject device : devices) {
-          // Handle compressed format
-          String deviceName = device.containsKey("n") ? device["n"] : device["name"];
-          String deviceType = device.containsKey("t") ? device["t"] : device["type"];
-          String macStr = device.containsKey("m") ? device["m"] : device["mac"];
-          int lastSeen = device.containsKey("s") ? device["s"] : device["last_seen"];
-          int quality = device.containsKey("q") ? device["q"] : device["audio_quality"];
-          
-          Serial.printf("  - %s (%s) - MAC: %s, Last seen: %d s ago, Quality: %d%%\n", 
-                       deviceName.c_str(), deviceType.c_str(), macStr.c_str(), lastSeen, quality);
-        }
+      // Membership log version: a delta we missed shows up here when idle
+      if (doc.containsKey("mv") && (!meshMembers.complete || (uint16_t)doc["mv"] != meshMembers.version)) {
+        requestMemberSnapshot();
       }
       
-    } else if (messageType == "audio_data") {
+    } else if (strcmp(messageType, "audio_data") == 0) {
       // Audio data received from coordinator
-      Serial.println("Audio data received from coordinator!");
-      
-      // Get source device info
-      String sourceDevice = doc["source"];
-      Serial.printf("Audio from: %s\n", sourceDevice.c_str());
+      DLOG(AUDIO, DEBUG, AUDIO_DATA_RX, (uint32_t)(mac[4] << 8 | mac[5]), len);
       
       // Update statistics
       packetsReceived++;
       bytesReceived += len;
       
-      // Forward to Phone B via BLE (if connected)
-      if (bleDeviceConnected) {
-        // Here you would send the audio data to Phone B
-        Serial.println("Audio data forwarded to Phone B via BLE");
-      }
-      
       // Send acknowledgment back to coordinator
       sendAudioAck(mac);
       
-    } else if (messageType == "test_audio") {
+    } else if (strcmp(messageType, "test_audio") == 0) {
       // Test audio data received from coordinator
       Serial.println("Test audio data received from coordinator!");
       handleTestAudioData(data, len, doc);
       
-    } else if (messageType == "test_ack") {
+    } else if (strcmp(messageType, "test_ack") == 0) {
       // Test acknowledgment received
       int testId = doc["test_id"];
       String status = doc["status"];
       Serial.printf("Test ACK received: Test %d - %s\n", testId, status.c_str());
       
-    } else if (messageType == "audio_chunk") {
+    } else if (strcmp(messageType, "audio_chunk") == 0) {
       // Audio chunk received from coordinator
-      Serial.println("🎵 Audio chunk received from coordinator!");
-      
-      // Extract audio metadata
       int sequence = doc["sequence"];
       int chunk = doc["chunk"];
       int totalChunks = doc["total_chunks"];
       int sampleRate = doc["sample_rate"];
-      int bitsPerSample = doc["bits_per_sample"];
-      unsigned long timestamp = doc["timestamp"];
-      
-      Serial.printf("🎵 Audio Chunk %d/%d - Seq: %d, Rate: %d Hz, Bits: %d, Time: %lu\n", 
-                    chunk + 1, totalChunks, sequence, sampleRate, bitsPerSample, timestamp);
+      DLOG(AUDIO, DEBUG, AUDIO_CHUNK_RX, chunk + 1, totalChunks, sequence, sampleRate);
       
       // Extract audio data from the message
+      String messageString = String((char*)data, len);
       String audioDataHex = "";
       int dataStart = messageString.lastIndexOf(':') + 1;
       if (dataStart > 0) {
@@ -1005,7 +1666,6 @@ void OnDataRecv(const uint8_t *mac, const uint8_t *data, int len) {
       
       if (audioDataHex.length() > 0) {
         int audioDataSize = audioDataHex.length() / 2;
-        Serial.printf("🎵 Audio data: %d bytes\n", audioDataSize);
         
         // Convert hex to bytes for processing
         uint8_t audioData[audioDataSize];
@@ -1014,20 +1674,14 @@ void OnDataRecv(const uint8_t *mac, const uint8_t *data, int len) {
           audioData[i] = strtol(hexByte.c_str(), NULL, 16);
         }
         
-        // Enhanced data validation logging
-        Serial.printf("📊 Data Validation - Size: %d bytes\n", audioDataSize);
-        Serial.printf("   Data Preview: ");
-        for (int i = 0; i < min(8, audioDataSize); i++) {
-          Serial.printf("%02X ", audioData[i]);
-        }
-        Serial.println();
-        
-        // Calculate simple checksum for validation
+        // Size, first four bytes and a byte sum for validation
+        uint32_t preview = 0;
         uint32_t checksum = 0;
         for (int i = 0; i < audioDataSize; i++) {
+          if (i < 4) preview |= (uint32_t)audioData[i] << (24 - 8 * i);
           checksum += audioData[i];
         }
-        Serial.printf("   Checksum: 0x%08X\n", checksum);
+        DLOG(AUDIO, DEBUG, AUDIO_CHUNK_DATA, sequence, audioDataSize, preview, checksum);
         
         // Process the audio data (here you would play it or forward to BLE)
         processReceivedAudioData(audioData, audioDataSize, sequence, chunk, totalChunks);
@@ -1036,11 +1690,11 @@ void OnDataRecv(const uint8_t *mac, const uint8_t *data, int len) {
         sendAudioAck(esp32_a_mac, sequence, chunk, "received");
         
       } else {
-        Serial.println("❌ No audio data found in message");
+        DLOG(AUDIO, WARN, AUDIO_CHUNK_EMPTY, sequence);
       }
       
     } else {
-      Serial.printf("Unknown message type: %s\n", messageType.c_str());
+      Serial.printf("Unknown message type: %s\n", messageType);
     }
     
   } else {
@@ -1048,6 +1702,154 @@ void OnDataRecv(const uint8_t *mac, const uint8_t *data, int len) {
   }
 }
 
+// Called from OnDataRecv for every complete WM frame
+static void wmTrackFrame(const WmHeader& h) {
+  uint32_t sequence;
+  if (h.version == 1) {
+    wmRx.v1Frames++;
+    sequence = wmRx.haveSequence ? wmExtendSequence(wmRx.highestSequence, (uint16_t)h.sequence) : h.sequence;
+  } else {
+    wmRx.v2Frames++;
+    sequence = h.sequence;
+  }
+
+  // New talker or new talk spurt: restart sequence and timing state
+  bool restart = !wmRx.haveSequence || h.streamId != wmRx.streamId || (h.flags & WM_FLAG_MARKER);
+  if (wmRx.haveSequence && h.streamId != wmRx.streamId) wmRx.streamChanges++;
+  int32_t arrival = (int32_t)(uint32_t)(esp_timer_get_time() * (WM_TIMESTAMP_HZ / 1000) / 1000);
+  int32_t transit = arrival - (int32_t)h.timestamp;
+  if (restart) {
+    wmRx.streamId = h.streamId;
+    wmRx.highestSequence = sequence;
+    wmRx.haveSequence = true;
+    wmRx.firstTransit = transit;
+    wmRx.lastTransit = transit;
+    return;
+  }
+
+  int32_t gap = (int32_t)(sequence - wmRx.highestSequence);
+  if (gap > 0) {
+    wmRx.lost += gap - 1;
+    wmRx.highestSequence = sequence;
+  } else if (gap == 0) {
+    wmRx.duplicates++;
+  } else {
+    wmRx.reordered++;
+  }
+
+  if (h.version == 2) {
+    int32_t d = transit - wmRx.lastTransit;
+    if (d < 0) d = -d;
+    wmRx.jitterQ4 += d - ((wmRx.jitterQ4 + 8) >> 4);
+    wmRx.lastTransit = transit;
+    wmRx.latencyDrift = transit - wmRx.firstTransit;
+  }
+}
+
+// Serial console commands
+void handleSerialCommand(const String& command) {
+  if (command == "meter_stats") {
+    float rmsDb = meterMeshIn.lastRms > 0 ? 20.0f * log10f(meterMeshIn.lastRms / 32768.0f) : -99.0f;
+    float peakDb = meterMeshIn.maxPeak > 0 ? 20.0f * log10f(meterMeshIn.maxPeak / 32768.0f) : -99.0f;
+    Serial.printf("=== AUDIO METERS (%s kernel) ===\n", audioMeterUsesVectorUnit() ? "PIE" : "portable");
+    Serial.printf("  %-10s blocks=%lu samples=%lu peak=%u rms=%u (%.1f dBFS) max=%.1f dBFS clipped=%lu\n",
+                  meterMeshIn.name, (unsigned long)meterMeshIn.blocks, (unsigned long)meterMeshIn.samples,
+                  meterMeshIn.lastPeak, meterMeshIn.lastRms, rmsDb, peakDb, (unsigned long)meterMeshIn.clipped);
+  } else if (command == "meter_reset") {
+    audioMeterReset(meterMeshIn);
+    Serial.println("Audio meters reset");
+  } else if (command == "log_stats") {
+    dlogPrintStats();
+  } else if (command.startsWith("log_mode:")) {
+    if (dlogSetOutput(command.substring(9).c_str())) {
+      Serial.printf("Deferred log output: %s\n", command.substring(9).c_str());
+    } else {
+      Serial.println("Usage: log_mode:<text|binary|off>");
+    }
+  } else if (command == "timers") {
+    timerWheelPrintStats(housekeepingWheel, "HOUSEKEEPING");
+  } else if (command == "timers_reset") {
+    timerWheelResetStats(housekeepingWheel);
+    Serial.println("Timer stats reset");
+  } else if (command == "layouts") {
+    taskLayoutPrintResults();
+  } else if (command.startsWith("layout:")) {
+    int index = command.substring(7).toInt();
+    if (command.length() > 7 && taskLayoutSelect(index)) {
+      Serial.printf("Task layout %d (%s) saved, restarting\n", index, kTaskLayouts[index].name);
+      delay(100);
+      ESP.restart();
+    } else {
+      Serial.printf("Usage: layout:<0..%d>\n", kTaskLayoutCount - 1);
+    }
+  } else if (command == "layout_stats") {
+    taskLayoutPrintStats(0, false);
+  } else if (command == "deadline_stats") {
+    deadlinePrintStats();
+  } else if (command == "deadline_reset") {
+    deadlineReset();
+    Serial.println("Deadline counters reset");
+  } else if (command == "beacon_stats") {
+    printBeaconStats();
+  } else if (command == "members") {
+    printMembers();
+  } else if (command == "airtime_stats") {
+    printAirtimeStats();
+  } else if (command == "airtime_reset") {
+    airtimeReset();
+    heartbeatsSent = heartbeatsSuppressed = 0;
+    Serial.println("Airtime counters reset");
+  } else if (command == "mesh_forget") {
+    meshStateClear();
+    Serial.println("Saved mesh session cleared, the next start joins by beacon");
+  } else if (command == "mem_map") {
+    memPlacePrintMap();
+  } else if (command == "pool_stats") {
+    bufferPrintStats(BUF_FW_CLIENT);
+  } else if (command == "pool_reset") {
+    bufferHighWaterReset();
+    Serial.println("Buffer high-water marks reset");
+  } else if (command == "bench_mem") {
+    memPlaceBench();
+  } else if (command == "alloc_stats") {
+    allocTrackPrintStats();
+  } else if (command == "alloc_reset") {
+    allocTrackReset();
+    Serial.println("Allocation counters reset");
+  } else if (command == "alloc_check" || command.startsWith("alloc_check:")) {
+    uint32_t seconds = command.length() > 12 ? (uint32_t)command.substring(12).toInt() : 600;
+    if (!ALLOC_TRACK_ENABLED) {
+      Serial.println("alloc_check needs the alloc_track build (pio run -e alloc_track)");
+    } else if (allocCheckSeconds != 0) {
+      Serial.println("Alloc check already running");
+    } else if (seconds > 0 && seconds <= 3600) {
+      allocCheckSeconds = seconds;
+      xTaskCreatePinnedToCore(allocCheckTask, "allocCheck", 4096, NULL, 1, NULL, tskNO_AFFINITY);
+    }
+  } else if (command == "bench_layout" || command.startsWith("bench_layout:")) {
+    uint32_t seconds = command.length() > 13 ? (uint32_t)command.substring(13).toInt() : 10;
+    if (layoutBenchSeconds != 0) {
+      Serial.println("Layout bench already running");
+    } else if (seconds > 0 && seconds <= 300) {
+      layoutBenchSeconds = seconds;
+      xTaskCreatePinnedToCore(layoutBenchTask, "layoutBench", 4096, NULL, 1, NULL, tskNO_AFFINITY);
+    }
+  } else if (command == "wm_stats") {
+    const float ticksPerMs = WM_TIMESTAMP_HZ / 1000.0f;
+    Serial.println("=== WM RECEIVE ===");
+    Serial.printf("  frames v1=%lu v2=%lu stream=%u changes=%lu\n",
+                  (unsigned long)wmRx.v1Frames, (unsigned long)wmRx.v2Frames,
+                  wmRx.streamId, (unsigned long)wmRx.streamChanges);
+    Serial.printf("  seq=%lu lost=%lu reordered=%lu duplicates=%lu\n", (unsigned long)wmRx.highestSequence,
+                  (unsigned long)wmRx.lost, (unsigned long)wmRx.reordered, (unsigned long)wmRx.duplicates);
+    Serial.printf("  jitter=%.2f ms latency drift=%.1f ms\n",
+                  wmRx.jitterQ4 / 16.0f / ticksPerMs, wmRx.latencyDrift / ticksPerMs);
+  } else {
+    Serial.printf("Unknown command: %s\n", command.c_str());
+    Serial.println("Available commands: meter_stats, meter_reset, wm_stats, beacon_stats, mesh_forget, members, airtime_stats, airtime_reset, timers, timers_reset, log_stats, log_mode:<text|binary|off>, layouts, layout:<n>, layout_stats, bench_layout[:<s>], deadline_stats, deadline_reset, mem_map, bench_mem, pool_stats, pool_reset, alloc_stats, alloc_reset, alloc_check[:<s>]");
+  }
+}
+
 void OnDataSent(const uint8_t *mac, esp_now_send_status_t status) {
   if (status == ESP_NOW_SEND_SUCCESS) {
     Serial.println("Data sent successfully to ESP32 A");
@@ -1057,6 +1859,7 @@ void OnDataSent(const uint8_t *mac, esp_now_send_status_t status) {
 }
 
 void loop() {
+  deadlineBegin(loopDeadline);
   // Handle BLE connection state changes
   if (!bleDeviceConnected && oldBleDeviceConnected) {
      delay(500);
@@ -1078,74 +1881,17 @@ void loop() {
     delay(10);
   }
   
-  // Handle mesh reconnection with timeout
-  if (!isMeshConnected || !esp32_a_connected) {
-    unsigned long currentTime = millis();
-    
-    // Try to reconnect every 15 seconds, but limit total attempts
-    if (currentTime - lastMeshJoinAttempt > 15000) {
-      static int reconnectAttempts = 0;
-      const int MAX_RECONNECT_ATTEMPTS = 10; // Limit to 10 attempts
-      
-      if (reconnectAttempts < MAX_RECONNECT_ATTEMPTS) {
-        Serial.printf("Mesh connection lost, attempting to reconnect... (Attempt %d/%d)\n", 
-                      reconnectAttempts + 1, MAX_RECONNECT_ATTEMPTS);
-        lastMeshJoinAttempt = currentTime;
-        reconnectAttempts++;
-        
-        // Clear any existing peers
-        esp_now_del_peer(esp32_a_mac);
-        
-        // Try to join mesh again
-        startScanningForESP32A();
-      } else {
-        Serial.println("⚠️ Maximum reconnection attempts reached. Stopping mesh reconnection.");
-        setStatusLED(255, 165, 0); // Orange for warning
-      }
-    }
-  }
-  
-  // Check mesh connection health
-  if (isMeshConnected && esp32_a_connected) {
-    unsigned long currentTime = millis();
-    
-    // Check if we haven't received heartbeat for too long
-    if (currentTime - lastMeshHeartbeat > DEVICE_TIMEOUT) {
-      Serial.println("Mesh coordinator heartbeat timeout, marking as disconnected");
-      esp32_a_connected = false;
-      isMeshConnected = false;
-      setStatusLED(255, 0, 0); // Red when disconnected
-      digitalWrite(MESH_LED_PIN, LOW);
-      
-      // Clear the peer to force reconnection
-      esp_now_del_peer(esp32_a_mac);
+  // Handle commands from serial monitor
+  if (Serial.available()) {
+    String command = Serial.readStringUntil('\n');
+    command.trim();
+    if (command.length() > 0) {
+      handleSerialCommand(command);
     }
   }
 
-  // Print statistics every 30 seconds (reduced spam)
-  static unsigned long lastStatsTime = 0;
-  if (millis() - lastStatsTime > 30000) {
-    printStatistics();
-    lastStatsTime = millis();
-  }
+  // Health checks and statistics run in HousekeepingTask; rejoining is beacon-driven
   
-  // BLE status check and debugging
-  static unsigned long lastBLEDebug = 0;
-  if (millis() - lastBLEDebug > 10000) { // Every 10 seconds
-    lastBLEDebug = millis();
-    
-    Serial.printf("🔵 BLE Status - Server: %s, Advertising: %s, Connected: %s\n",
-                  bleServerStarted ? "Running" : "Stopped",
-                  bleAdvertising ? "Yes" : "No", 
-                  bleDeviceConnected ? "Yes" : "No");
-    
-    // Check if BLE is actually advertising
-    if (bleServerStarted && bleAdvertising) {
-      Serial.println("✅ BLE Server should be advertising");
-    } else {
-      Serial.println("❌ BLE Server not advertising properly");
-    }
-  }
-  
-  delay(100);
+  deadlineEnd(loopDeadline);
+  delay(LOOP_PERIOD_MS);
 }
@@ -0,0 +1,370 @@
+#!/usr/bin/env python3
+"""
+Simulate coordinator failover: time until every client has rerouted
+
+Event-driven model of several nodes running the coordinator firmware and a
+set of clients. The mesh runs in steady state, then the leader dies at
+t = 0. The model follows lib/MeshElection and the client's handleBeacon
+and health timer, and reads its constants from lib/MeshBeacon/MeshBeacon.h
+lib/MeshElection/MeshElection.h and lib/MeshChannel/MeshChannel.h, so the
+numbers track the firmware. The mesh stays on one of --channels candidates.
+
+  coordinators: the leader beacons every interval. Standbys renew the
+                leader's lease from each beacon. Once it runs out they listen
+                on each other candidate channel in turn, deaf to the mesh
+                channel, then claim after their backoff. A new leader beacons
+                at once. A leader that hears a higher-ranked leader steps
+                down and drops its table.
+  clients:      the health tick (every beacon interval) declares the
+                coordinator gone after one lease of silence. The next beacon
+                heard triggers mesh_join to the least loaded leader, retried
+                after the join timeout. A coordinator that comes back under
+                the same epoch gets one resync frame instead. A client that
+                hears no beacon for the scan time, with no join pending,
+                hops to the next candidate channel.
+
+Every timer starts at a random phase. Each frame is lost with probability
+--loss and otherwise arrives 1-3 ms later. A trial ends when every client
+is joined to the only live leader. The failover time is measured from the
+leader's death, and dual-leader episodes (step-downs) are counted.
+
+Examples:
+  ./failover_sim.py
+  ./failover_sim.py --coordinators 2 --clients 4 --loss 0 0.1
+  ./failover_sim.py --priorities 12 12 12 --trials 5000
+"""
+
+import argparse
+import heapq
+import itertools
+import random
+import re
+from pathlib import Path
+
+REPO_ROOT = Path(__file__).resolve().parent
+BEACON_HEADER = REPO_ROOT / "lib" / "MeshBeacon" / "MeshBeacon.h"
+ELECTION_HEADER = REPO_ROOT / "lib" / "MeshElection" / "MeshElection.h"
+CHANNEL_HEADER = REPO_ROOT / "lib" / "MeshChannel" / "MeshChannel.h"
+
+WARMUP_MS = 1000    # steady state before the leader dies
+LIMIT_MS = 10000    # give up on a trial after this long
+
+
+def header_define(header: Path, name: str) -> int:
+    match = re.search(rf"#define\s+{name}\s+(\d+)", header.read_text())
+    if not match:
+        raise SystemExit(f"{name} not found in {header}")
+    return int(match.group(1))
+
+
+class Config:
+    def __init__(self):
+        self.interval = header_define(BEACON_HEADER, "MESH_BEACON_INTERVAL_MS")
+        self.join_timeout = header_define(BEACON_HEADER, "MESH_JOIN_TIMEOUT_MS")
+        self.lease = header_define(BEACON_HEADER, "MESH_LEASE_BEACONS") * self.interval
+        self.priority_max = header_define(ELECTION_HEADER, "MESH_PRIORITY_MAX")
+        self.tick = header_define(ELECTION_HEADER, "MESH_ELECTION_TICK_MS")
+        self.subslot = header_define(ELECTION_HEADER, "MESH_ELECTION_SUBSLOT_MS")
+        self.slot = header_define(ELECTION_HEADER, "MESH_ELECTION_SLOT_MS")
+        self.default_priority = header_define(ELECTION_HEADER, "MESH_COORD_PRIORITY")
+        self.chan_tick = header_define(CHANNEL_HEADER, "CHAN_TICK_MS")
+        self.client_scan = header_define(CHANNEL_HEADER, "MESH_CHANNEL_SCAN_MS")
+        self.standby_listen = header_define(CHANNEL_HEADER, "CHAN_STANDBY_LISTEN_MS")
+        self.channels = 3
+
+    def backoff(self, priority, mac):
+        return (self.priority_max - priority) * self.slot + (mac[5] & 7) * self.subslot
+
+
+def outranks(a, b):
+    """electionOutranks: higher priority, then lower MAC"""
+    return a.priority > b.priority or (a.priority == b.priority and a.mac < b.mac)
+
+
+class Coordinator:
+    def __init__(self, cfg, priority, mac):
+        self.priority = priority
+        self.mac = mac
+        self.backoff = cfg.backoff(priority, mac)
+        self.alive = True
+        self.leader = False
+        self.lease_until = 0.0
+        self.claim_at = 0.0
+        self.away_until = None        # listening on the other channels
+        self.searched = None          # lease_until already searched for
+        self.epoch = 0
+        self.peers = set()
+
+
+class Client:
+    def __init__(self, index):
+        self.index = index
+        self.coordinator = None       # joined to, or None
+        self.epoch = 0
+        self.last_heard = 0.0
+        self.join_sent = None
+        self.join_to = None
+        self.join_epoch = 0
+        self.resync_pending = False
+        self.resync_tried = False
+        self.scan = {}                # coordinator -> (peers, epoch, heard)
+        self.hop = 0                  # channels away from the mesh channel
+        self.last_beacon = 0.0
+
+
+class Sim:
+    def __init__(self, cfg, rng, loss, priorities, clients):
+        self.cfg = cfg
+        self.rng = rng
+        self.loss = loss
+        self.events = []
+        self.seq = itertools.count()
+        self.step_downs = 0
+        self.coords = []
+        for priority in priorities:
+            mac = bytes([0x24, 0x6F, 0x28] + [rng.randrange(256) for _ in range(3)])
+            self.coords.append(Coordinator(cfg, priority, mac))
+        self.clients = [Client(i) for i in range(clients)]
+
+        # Steady state: the best-ranked node won at boot and everyone follows it
+        leader = self.coords[0]
+        for c in self.coords[1:]:
+            if outranks(c, leader):
+                leader = c
+        t0 = -WARMUP_MS
+        leader.leader = True
+        leader.epoch = rng.getrandbits(32) or 1
+        leader.peers = set(self.clients)
+        for c in self.coords:
+            c.lease_until = t0 + cfg.lease
+            c.claim_at = c.lease_until + c.backoff
+        for client in self.clients:
+            client.coordinator = leader
+            client.epoch = leader.epoch
+            client.last_heard = t0
+            client.last_beacon = t0
+        self.first_leader = leader
+
+        for c in self.coords:
+            self.at(t0 + rng.uniform(0, cfg.interval), "beacon_timer", c)
+            self.at(t0 + rng.uniform(0, cfg.tick), "election_tick", c)
+        for client in self.clients:
+            self.at(t0 + rng.uniform(0, cfg.interval), "health_tick", client)
+            self.at(t0 + rng.uniform(0, cfg.chan_tick), "scan_tick", client)
+        self.at(0.0, "kill", leader)
+
+    def at(self, t, kind, *args):
+        heapq.heappush(self.events, (t, next(self.seq), kind, args))
+
+    def send(self, t, dst, msg):
+        if self.rng.random() >= self.loss:
+            self.at(t + self.rng.uniform(1.0, 3.0), "deliver", dst, msg)
+
+    def broadcast_beacon(self, t, c):
+        msg = ("beacon", c, c.epoch, len(c.peers))
+        for other in self.coords:
+            if other is not c:
+                self.send(t, other, msg)
+        for client in self.clients:
+            self.send(t, client, msg)
+
+    # Coordinator side
+
+    def become_leader(self, t, c):
+        c.leader = True
+        c.epoch = self.rng.getrandbits(32) or 1
+        c.peers = set()
+        self.broadcast_beacon(t, c)
+
+    def election_tick(self, t, c):
+        """Standby: search the other channels once per lost lease, then claim"""
+        if c.away_until is not None:
+            if t >= c.away_until:
+                c.away_until = None
+                c.searched = c.lease_until
+                c.claim_at = t + c.backoff
+        elif t >= c.lease_until and c.searched != c.lease_until and self.cfg.channels > 1:
+            c.away_until = t + (self.cfg.channels - 1) * self.cfg.standby_listen
+        elif t >= c.claim_at:
+            self.become_leader(t, c)
+
+    def coordinator_receive(self, t, c, msg):
+        kind, src = msg[0], msg[1]
+        if kind == "beacon":
+            if c.leader:
+                if not outranks(src, c):
+                    return
+                c.leader = False
+                c.peers = set()
+                self.step_downs += 1
+            c.lease_until = t + self.cfg.lease
+            c.claim_at = c.lease_until + c.backoff
+            return
+        if not c.leader:
+            return  # a standby serves no mesh clients
+        if kind == "join":
+            c.peers.add(src)
+            self.send(t, src, ("ack", c, c.epoch))
+        elif kind == "resync" and src in c.peers and msg[2] == c.epoch:
+            self.send(t, src, ("resync_ack", c, c.epoch))
+
+    # Client side
+
+    def client_receive(self, t, client, msg):
+        kind, src = msg[0], msg[1]
+        if kind == "beacon":
+            self.client_beacon(t, client, src, msg[2], msg[3])
+        elif kind in ("ack", "resync_ack") and client.coordinator is None:
+            if client.join_sent is None or client.join_to is not src or msg[2] != client.join_epoch:
+                return
+            if kind == "resync_ack" and not client.resync_pending:
+                return
+            client.coordinator = src
+            client.epoch = msg[2]
+            client.last_heard = t
+            client.join_sent = None
+            client.resync_pending = False
+
+    def client_beacon(self, t, client, src, epoch, peers):
+        client.last_beacon = t
+        client.scan[src] = (peers, epoch, t)
+        if client.coordinator is src:
+            if epoch == client.epoch:
+                client.last_heard = t
+                return
+            client.coordinator = None  # restarted coordinator, rejoin
+            client.join_sent = None
+        if client.coordinator is not None:
+            return
+        if client.join_sent is not None and t - client.join_sent < self.cfg.join_timeout:
+            return
+        if not client.resync_tried and client.epoch and epoch == client.epoch and src is client.join_to:
+            client.resync_tried = True
+            client.resync_pending = True
+            self.client_send_join(t, client, src, epoch, "resync")
+            return
+        best = None
+        for c, (c_peers, _, heard) in client.scan.items():
+            if t - heard > self.cfg.interval:
+                continue
+            if best is None or (c_peers, c.mac) < (client.scan[best][0], best.mac):
+                best = c
+        if best is not None:
+            client.resync_pending = False
+            self.client_send_join(t, client, best, client.scan[best][1], "join")
+
+    def scan_tick(self, t, client):
+        if client.coordinator is not None or t - client.last_beacon < self.cfg.client_scan:
+            return
+        if client.join_sent is not None and t - client.join_sent < self.cfg.join_timeout:
+            return
+        client.hop = (client.hop + 1) % self.cfg.channels
+        client.last_beacon = t
+
+    def client_send_join(self, t, client, dst, epoch, kind):
+        client.join_sent = t
+        client.join_to = dst
+        client.join_epoch = epoch
+        self.send(t, dst, (kind, client, epoch))
+
+    def done(self):
+        leaders = [c for c in self.coords if c.alive and c.leader]
+        if len(leaders) != 1:
+            return False
+        return all(client.coordinator is leaders[0] for client in self.clients)
+
+    def run(self):
+        while self.events:
+            t, _, kind, args = heapq.heappop(self.events)
+            if t > LIMIT_MS:
+                return None
+            if kind == "kill":
+                args[0].alive = False
+                args[0].leader = False
+            elif kind == "beacon_timer":
+                c = args[0]
+                if c.alive and c.leader:
+                    self.broadcast_beacon(t, c)
+                self.at(t + self.cfg.interval, kind, c)
+            elif kind == "election_tick":
+                c = args[0]
+                if c.alive and not c.leader:
+                    self.election_tick(t, c)
+                self.at(t + self.cfg.tick, kind, c)
+            elif kind == "health_tick":
+                client = args[0]
+                if client.coordinator is not None and t - client.last_heard > self.cfg.lease:
+                    client.join_to = client.coordinator  # kept for a resync
+                    client.coordinator = None
+                    client.join_sent = None
+                    client.resync_tried = False
+                    client.scan = {}
+                self.at(t + self.cfg.interval, kind, client)
+            elif kind == "scan_tick":
+                client = args[0]
+                self.scan_tick(t, client)
+                self.at(t + self.cfg.chan_tick, kind, client)
+            elif kind == "deliver":
+                dst, msg = args
+                if isinstance(dst, Coordinator):
+                    if dst.alive and dst.away_until is None:
+                        self.coordinator_receive(t, dst, msg)
+                elif dst.hop == 0:
+                    self.client_receive(t, dst, msg)
+            if t >= 0 and kind != "kill" and self.done():
+                return t
+        return None
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return float("nan")
+    return sorted_values[min(len(sorted_values) - 1, int(p / 100 * len(sorted_values)))]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--coordinators", type=int, default=3, help="nodes running the coordinator firmware")
+    parser.add_argument("--priorities", type=int, nargs="+",
+                        help="one per coordinator (default: MESH_COORD_PRIORITY for all)")
+    parser.add_argument("--clients", type=int, default=4)
+    parser.add_argument("--trials", type=int, default=2000)
+    parser.add_argument("--loss", type=float, nargs="+", default=[0.0, 0.05, 0.2], help="frame loss rates")
+    parser.add_argument("--channels", type=int, default=3, help="candidate channels (MESH_CHANNEL_MASK)")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    cfg = Config()
+    cfg.channels = max(1, args.channels)
+    priorities = args.priorities or [cfg.default_priority] * args.coordinators
+    if len(priorities) < 2:
+        raise SystemExit("failover needs at least two coordinators")
+    rng = random.Random(args.seed)
+    print(f"{args.trials} trials, {len(priorities)} coordinators (priorities {' '.join(map(str, priorities))}), "
+          f"{args.clients} clients")
+    print(f"beacon every {cfg.interval} ms, lease {cfg.lease} ms, election tick {cfg.tick} ms, "
+          f"backoff {cfg.slot} ms per priority step + {cfg.subslot} ms per MAC subslot, "
+          f"join timeout {cfg.join_timeout} ms")
+    print(f"{cfg.channels} candidate channels: standby listens {cfg.standby_listen} ms on each other one, "
+          f"client hops after {cfg.client_scan} ms without a beacon")
+    print(f"\n{'loss':>5} {'p50 ms':>9} {'p90 ms':>9} {'p99 ms':>9} {'max ms':>9} {'never':>6} {'dual leader':>12}")
+    for loss in args.loss:
+        times = []
+        never = 0
+        dual = 0
+        for _ in range(args.trials):
+            sim = Sim(cfg, rng, loss, priorities, args.clients)
+            t = sim.run()
+            if t is None:
+                never += 1
+            else:
+                times.append(t)
+            if sim.step_downs:
+                dual += 1
+        times.sort()
+        print(f"{loss:5.2f} {percentile(times, 50):9.1f} {percentile(times, 90):9.1f} "
+              f"{percentile(times, 99):9.1f} {times[-1] if times else float('nan'):9.1f} {never:6d} {dual:12d}")
+
+
+if __name__ == "__main__":
+    main()
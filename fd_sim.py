@@ -0,0 +1,233 @@
+#!/usr/bin/env python3
+"""
+Simulate the coordinator's failure detector: detection time and false suspicions
+
+Event-driven model of one mesh peer as seen by lib/FailureDetector. The
+model reads its constants from lib/FailureDetector/FailureDetector.h and
+computes phi the same way, so the numbers track the firmware.
+
+  coordinator: sends the peer a frame every --interval ms (audio, or the
+               5 s heartbeat when idle) while it is not suspected. The send
+               callback reports an ack (an arrival) or a failure 1-4 ms later.
+               Suspected peers get probes with backoff instead.
+  peer:        sends the coordinator a frame every --peer-interval ms
+               (heartbeats, acks), each one an arrival if it gets through.
+  detector:    re-evaluated every FD_TICK_MS at a random phase.
+
+Frames are lost independently with probability --loss, or in bursts
+(--burst, a Gilbert-Elliott channel with that mean burst length and the
+same average loss). For the detection time the peer dies at a random time
+after a warm-up and the time until it is suspected is measured. For false
+suspicions the peer stays alive for --hours of simulated time.
+
+Examples:
+  ./fd_sim.py
+  ./fd_sim.py --loss 0.1 0.3 --burst 4
+  ./fd_sim.py --interval 5000 --peer-interval 5000 --hours 24
+  ./fd_sim.py --burst 4 --set FD_PAUSE_MS=100 FD_WINDOW=64
+"""
+
+import argparse
+import heapq
+import itertools
+import math
+import random
+import re
+from pathlib import Path
+
+REPO_ROOT = Path(__file__).resolve().parent
+FD_HEADER = REPO_ROOT / "lib" / "FailureDetector" / "FailureDetector.h"
+
+WARMUP_MS = 5000
+LIMIT_MS = 120000   # give up on a detection trial after this long
+
+
+def header_define(name: str) -> int:
+    match = re.search(rf"#define\s+{name}\s+(\d+)", FD_HEADER.read_text())
+    if not match:
+        raise SystemExit(f"{name} not found in {FD_HEADER}")
+    return int(match.group(1))
+
+
+class Config:
+    NAMES = ("FD_WINDOW", "FD_MIN_SAMPLES", "FD_BOOTSTRAP_MS", "FD_MIN_STD_MS", "FD_PAUSE_MS",
+             "FD_PHI_SUSPECT", "FD_MIN_FAILURES", "FD_TICK_MS", "FD_PROBE_MIN_MS", "FD_PROBE_MAX_MS")
+
+    def __init__(self, overrides):
+        for name in self.NAMES:
+            setattr(self, name[3:].lower(), header_define(name))
+        for item in overrides:
+            name, _, value = item.partition("=")
+            if name not in self.NAMES or not value.isdigit():
+                raise SystemExit(f"--set expects one of {', '.join(self.NAMES)} as NAME=<int>")
+            setattr(self, name[3:].lower(), int(value))
+
+
+class Detector:
+    """One FdPeer: fdHeard, fdSendFailed, fdPhi and fdUpdate"""
+
+    def __init__(self, cfg, now):
+        self.cfg = cfg
+        self.intervals = []
+        self.last = now
+        self.fail_streak = 0
+        self.suspected = False
+        self.probe_at = 0.0
+        self.probe_gap = cfg.probe_min_ms
+
+    def heard(self, now):
+        if not self.suspected:  # a gap we spent probing says nothing about the traffic
+            self.intervals.append(min(int(now - self.last), 0xFFFF))
+            if len(self.intervals) > self.cfg.window:
+                self.intervals.pop(0)
+        self.last = now
+        self.fail_streak = 0
+        self.suspected = False
+
+    def phi(self, now):
+        cfg = self.cfg
+        n = len(self.intervals)
+        if n < cfg.min_samples:
+            mean, std = cfg.bootstrap_ms, cfg.bootstrap_ms // 4
+        else:
+            mean = sum(self.intervals) / n
+            var = sum(i * i for i in self.intervals) / n - mean * mean
+            std = math.sqrt(var) if var > 0 else 0
+        std = max(std, cfg.min_std_ms)
+        y = (now - self.last - mean - cfg.pause_ms) / std
+        a = -y * (1.5976 + 0.070566 * y * y)
+        if a > 30:
+            return 0.0
+        return (-a + math.log1p(math.exp(a))) / math.log(10)
+
+    def update(self, now):
+        if self.suspected or self.fail_streak < self.cfg.min_failures:
+            return False
+        if self.phi(now) < self.cfg.phi_suspect:
+            return False
+        self.suspected = True
+        self.probe_gap = self.cfg.probe_min_ms
+        self.probe_at = now + self.cfg.probe_min_ms
+        return True
+
+
+class Channel:
+    """Bernoulli loss, or Gilbert-Elliott with every frame lost in the bad state"""
+
+    def __init__(self, rng, loss, burst):
+        self.rng = rng
+        self.loss = loss
+        self.burst = burst
+        self.bad = False
+        self.p_bg, self.p_gb = 1.0, 0.0
+        if burst > 1 and 0 < loss < 1:
+            self.p_bg = 1.0 / burst
+            self.p_gb = loss / (1 - loss) * self.p_bg
+
+    def lost(self):
+        if self.burst <= 1:
+            return self.rng.random() < self.loss
+        if self.bad:
+            self.bad = self.rng.random() >= self.p_bg
+        else:
+            self.bad = self.rng.random() < self.p_gb
+        return self.bad
+
+
+def run(cfg, rng, args, loss, dies_at, until):
+    """Returns (suspicions, time the dead peer was suspected or None, ms suspected while alive)"""
+    channel = Channel(rng, loss, args.burst)
+    events = []
+    seq = itertools.count()
+
+    def at(t, kind):
+        heapq.heappush(events, (t, next(seq), kind))
+
+    fd = Detector(cfg, 0.0)
+    at(rng.uniform(0, args.interval), "send")
+    at(rng.uniform(0, args.peer_interval), "peer_send")
+    at(rng.uniform(0, cfg.tick_ms), "tick")
+    suspicions = 0
+    suspected_since = None
+    suspected_ms = 0.0
+    while events:
+        t, _, kind = heapq.heappop(events)
+        if t > until:
+            break
+        alive = t < dies_at
+        if kind == "send":
+            if not fd.suspected:
+                # The send callback reports after the driver's retries
+                at(t + rng.uniform(1, 4), "ack" if alive and not channel.lost() else "fail")
+            at(t + args.interval, "send")
+        elif kind == "peer_send":
+            if alive:
+                if not channel.lost():
+                    at(t + rng.uniform(1, 3), "ack")
+                at(t + args.peer_interval, "peer_send")
+        elif kind == "ack":
+            if fd.suspected and suspected_since is not None:
+                suspected_ms += t - suspected_since
+                suspected_since = None
+            fd.heard(t)
+        elif kind == "fail":
+            fd.fail_streak += 1
+        elif kind == "tick":
+            if fd.update(t):
+                suspicions += 1
+                suspected_since = t
+            if fd.suspected and not alive:
+                return suspicions, t, suspected_ms
+            if fd.suspected and t >= fd.probe_at:
+                fd.probe_at = t + fd.probe_gap
+                fd.probe_gap = min(fd.probe_gap * 2, cfg.probe_max_ms)
+                at(t + rng.uniform(1, 4), "ack" if alive and not channel.lost() else "fail")
+            at(t + cfg.tick_ms, "tick")
+    if suspected_since is not None:
+        suspected_ms += until - suspected_since
+    return suspicions, None, suspected_ms
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return float("nan")
+    return sorted_values[min(len(sorted_values) - 1, int(p / 100 * len(sorted_values)))]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--interval", type=float, default=20, help="ms between coordinator sends to the peer")
+    parser.add_argument("--peer-interval", type=float, default=5000, help="ms between frames from the peer")
+    parser.add_argument("--loss", type=float, nargs="+", default=[0.0, 0.05, 0.2, 0.4], help="frame loss rates")
+    parser.add_argument("--burst", type=float, default=1, help="mean loss burst length in frames (1 = independent)")
+    parser.add_argument("--trials", type=int, default=500, help="peer deaths per loss rate")
+    parser.add_argument("--hours", type=float, default=2, help="simulated live hours per loss rate")
+    parser.add_argument("--set", nargs="+", default=[], metavar="NAME=V",
+                        help="try other values for FailureDetector.h constants")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    cfg = Config(args.set)
+    rng = random.Random(args.seed)
+    print(f"send every {args.interval:g} ms, peer frames every {args.peer_interval:g} ms, "
+          f"{'independent loss' if args.burst <= 1 else f'loss bursts of {args.burst:g} frames'}")
+    print(f"phi >= {cfg.phi_suspect} with >= {cfg.min_failures} failed sends, window {cfg.window}, "
+          f"min std {cfg.min_std_ms} ms, pause {cfg.pause_ms} ms, tick {cfg.tick_ms} ms")
+    print(f"\n{'loss':>5} {'detect p50':>11} {'p90':>7} {'p99':>7} {'max':>7} {'false/hour':>11} {'suspected':>10}")
+    for loss in args.loss:
+        times = []
+        for _ in range(args.trials):
+            dies_at = WARMUP_MS + rng.uniform(0, 1000)
+            _, detected, _ = run(cfg, rng, args, loss, dies_at, dies_at + LIMIT_MS)
+            if detected is not None:
+                times.append(detected - dies_at)
+        live_ms = args.hours * 3600e3
+        suspicions, _, suspected_ms = run(cfg, rng, args, loss, float("inf"), live_ms)
+        times.sort()
+        print(f"{loss:5.2f} {percentile(times, 50):9.0f}ms {percentile(times, 90):7.0f} "
+              f"{percentile(times, 99):7.0f} {times[-1] if times else float('nan'):7.0f} "
+              f"{suspicions / args.hours:11.2f} {suspected_ms / live_ms * 100:9.3f}%")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,46 @@
+#!/usr/bin/env python3
+"""
+Add sanitizer flags to a host test build
+
+Used as a PlatformIO pre script (extra_scripts = pre:host_sanitize.py) by
+the native test envs. Reads the env's custom_sanitize option, a comma
+separated -fsanitize list such as "address,undefined" or "thread", and adds
+it to both the compile and the link flags with frame pointers and debug
+info so reports carry usable stacks. With "undefined" in the list every
+UB report aborts the test instead of printing and carrying on.
+
+Example (platformio.ini):
+  [env:native]
+  platform = native
+  custom_sanitize = address,undefined
+  extra_scripts = pre:host_sanitize.py
+"""
+
+import sys
+
+
+def sanitize_flags(option: str):
+    """Compiler/linker flags for a custom_sanitize value; [] when empty"""
+    kinds = [k.strip() for k in option.split(",") if k.strip()]
+    if not kinds:
+        return []
+    flags = [f"-fsanitize={','.join(kinds)}", "-fno-omit-frame-pointer", "-g"]
+    if "undefined" in kinds:
+        flags.append("-fno-sanitize-recover=all")
+    return flags
+
+
+def pio_pre_script(env):
+    """Runs as extra_scripts = pre:...; before any source is compiled"""
+    flags = sanitize_flags(env.GetProjectOption("custom_sanitize", ""))
+    if flags:
+        env.Append(CCFLAGS=flags, LINKFLAGS=flags)
+
+
+try:
+    Import("env")  # noqa: F821 - defined when PlatformIO runs this file
+except NameError:
+    # Outside PlatformIO print the flags, e.g. for a manual g++ build
+    print(" ".join(sanitize_flags(sys.argv[1] if len(sys.argv) > 1 else "address,undefined")))
+else:
+    pio_pre_script(env)  # noqa: F821
@@ -0,0 +1,240 @@
+#!/usr/bin/env python3
+"""
+Simulate client time-to-join and reconnect after a reboot
+
+Monte Carlo model of one coordinator and one client. Beacon interval, join
+timeout and the election's boot listen are read from lib/MeshBeacon and
+lib/MeshElection, so the numbers track the firmware.
+
+Methods:
+  probe:  the old startScanningForESP32A. Three mesh_join sends 100 ms
+          apart (two hard-coded MACs, then broadcast), then one retry
+          round every ~16 s from the 1 s reconnect timer, up to 10 rounds.
+          A coordinator restart is only noticed through the 30 s heartbeat
+          timeout.
+  beacon: the coordinator listens for another leader for one lease plus
+          its election backoff, then beacons at once and every interval.
+          The client sends mesh_join on the first beacon heard and again on
+          a later beacon if no ack arrives within the join timeout. A
+          coordinator restart shows up as a new epoch in its beacons.
+  resync: beacon, plus the session saved in NVS (lib/MeshState). A
+          rebooted client sends one resync frame to the saved coordinator
+          and falls back to beacon after the join timeout. A restarted
+          coordinator restores its peers and epoch when it wins the
+          election, and the client resyncs on its first beacon.
+
+Scenarios (--scenario):
+  boot:           both power up in random order; time from both up to joined
+  client-reboot:  a joined client restarts; time from its mesh setup to joined
+  coord-reboot:   the coordinator restarts; time from its mesh setup until
+                  the client is a member again
+
+Each frame is lost with probability --loss and otherwise arrives 1-3 ms
+later (air time plus dispatch).
+
+Examples:
+  ./join_sim.py
+  ./join_sim.py --scenario client-reboot coord-reboot --loss 0 0.05
+  ./join_sim.py --loss 0 0.05 0.2 --trials 20000 --spread 5000
+"""
+
+import argparse
+import random
+import re
+from pathlib import Path
+
+REPO_ROOT = Path(__file__).resolve().parent
+HEADER = REPO_ROOT / "lib" / "MeshBeacon" / "MeshBeacon.h"
+ELECTION_HEADER = REPO_ROOT / "lib" / "MeshElection" / "MeshElection.h"
+
+# The probe loop this replaces (esp32_b_project/src/main.cpp before beacons)
+PROBE_GAP_MS = 100
+PROBE_SENDS = 3
+PROBE_HIT_INDEX = 2          # only the broadcast send reaches an unknown coordinator
+RECONNECT_TICK_MS = 1000
+RECONNECT_AFTER_MS = 15000
+MAX_RECONNECT_ATTEMPTS = 10
+HEARTBEAT_MS = 5000          # coordinator mesh_heartbeat period
+DEVICE_TIMEOUT_MS = 30000    # client declares the coordinator lost
+
+
+def header_define(name: str, header: Path = HEADER) -> int:
+    match = re.search(rf"#define\s+{name}\s+(\d+)", header.read_text())
+    if not match:
+        raise SystemExit(f"{name} not found in {header}")
+    return int(match.group(1))
+
+
+def boot_listen(rng, interval):
+    """Time from coordinator mesh setup to its first beacon: one lease plus
+    the election backoff at the default priority, for a random MAC"""
+    lease = header_define("MESH_LEASE_BEACONS") * interval
+    steps = header_define("MESH_PRIORITY_MAX", ELECTION_HEADER) - header_define("MESH_COORD_PRIORITY", ELECTION_HEADER)
+    backoff = steps * header_define("MESH_ELECTION_SLOT_MS", ELECTION_HEADER)
+    backoff += rng.randrange(8) * header_define("MESH_ELECTION_SUBSLOT_MS", ELECTION_HEADER)
+    tick = header_define("MESH_ELECTION_TICK_MS", ELECTION_HEADER)
+    return lease + backoff + rng.uniform(0, tick)
+
+
+def delivered(rng, loss):
+    """Latency of one frame in ms, or None if it is lost"""
+    return None if rng.random() < loss else rng.uniform(1.0, 3.0)
+
+
+def join_probe(rng, loss, coord_up, client_up):
+    rounds = [client_up]
+    # The reconnect timer ticks every second and fires once 15 s have passed
+    # since the last round's last send
+    for _ in range(MAX_RECONNECT_ATTEMPTS):
+        last_send = rounds[-1] + (PROBE_SENDS - 1) * PROBE_GAP_MS
+        ticks = int((last_send - client_up) // RECONNECT_TICK_MS) + 1
+        while client_up + ticks * RECONNECT_TICK_MS - last_send <= RECONNECT_AFTER_MS:
+            ticks += 1
+        rounds.append(client_up + ticks * RECONNECT_TICK_MS)
+    for start in rounds:
+        send = start + PROBE_HIT_INDEX * PROBE_GAP_MS
+        if send < coord_up:
+            continue
+        there = delivered(rng, loss)
+        back = delivered(rng, loss)
+        if there is not None and back is not None:
+            return send + there + back
+    return None
+
+
+def join_beacon(rng, loss, coord_up, client_up, interval, timeout, join_sent=None, first_beacon=None):
+    beacon = coord_up + boot_listen(rng, interval) if first_beacon is None else first_beacon
+    limit = max(coord_up, client_up) + 60000
+    while beacon < limit:
+        latency = delivered(rng, loss)
+        heard = beacon + latency if latency is not None else None
+        beacon += interval
+        if heard is None or heard < client_up:
+            continue
+        if join_sent is not None and heard - join_sent < timeout:
+            continue
+        join_sent = heard
+        there = delivered(rng, loss)
+        back = delivered(rng, loss)
+        if there is not None and back is not None:
+            return heard + there + back
+    return None
+
+
+def join_resync(rng, loss, client_up, coord_phase, interval, timeout):
+    """Rebooted client with a saved session; the coordinator never left"""
+    there = delivered(rng, loss)
+    back = delivered(rng, loss)
+    if there is not None and back is not None:
+        return client_up + there + back
+    # No ack: beacons are ignored until the join timeout, then a normal join
+    return join_beacon(rng, loss, coord_phase, client_up, interval, timeout,
+                       join_sent=client_up, first_beacon=first_after(coord_phase, client_up, interval))
+
+
+def resync_on_beacon(rng, loss, first_beacon, interval, timeout):
+    """Client whose coordinator came back under the same epoch: one resync
+    frame on the first beacon heard, a full join if that is not acked"""
+    beacon = first_beacon
+    while beacon < first_beacon + 60000:
+        heard = delivered(rng, loss)
+        if heard is not None:
+            there = delivered(rng, loss)
+            back = delivered(rng, loss)
+            if there is not None and back is not None:
+                return beacon + heard + there + back
+            sent = beacon + heard
+            return join_beacon(rng, loss, beacon, sent, interval, timeout, join_sent=sent,
+                               first_beacon=first_after(beacon, sent, interval))
+        beacon += interval
+    return None
+
+
+def first_after(phase, t, interval):
+    """First beacon time >= t on a schedule with the given phase"""
+    if t <= phase:
+        return phase
+    return phase + ((t - phase + interval - 1e-9) // interval) * interval
+
+
+def heartbeat_timeout(rng, reboot_up):
+    """When the old client notices a restarted coordinator: 30 s after the
+    last heartbeat it heard, on its 1 s health tick"""
+    last_heartbeat = reboot_up - rng.uniform(0, HEARTBEAT_MS) - rng.uniform(500, 1500)  # boot time
+    noticed = last_heartbeat + DEVICE_TIMEOUT_MS
+    return noticed + rng.uniform(0, 1000)
+
+
+def run_trial(rng, scenario, loss, spread, interval, timeout):
+    """(start, {method: joined time or None}) for one trial"""
+    if scenario == "boot":
+        coord_up = rng.uniform(0, spread)
+        client_up = rng.uniform(0, spread)
+        return max(coord_up, client_up), {
+            "probe": join_probe(rng, loss, coord_up, client_up),
+            "beacon": join_beacon(rng, loss, coord_up, client_up, interval, timeout),
+        }
+    if scenario == "client-reboot":
+        phase = rng.uniform(-interval, 0)  # the coordinator has been beaconing for a while
+        client_up = 0.0
+        return client_up, {
+            "probe": join_probe(rng, loss, -1e9, client_up),
+            "beacon": join_beacon(rng, loss, phase, client_up, interval, timeout,
+                                  first_beacon=first_after(phase, client_up, interval)),
+            "resync": join_resync(rng, loss, client_up, phase, interval, timeout),
+        }
+    # coord-reboot: the client was joined and keeps running. Its lease ran
+    # out while the coordinator was down.
+    coord_up = 0.0
+    noticed = heartbeat_timeout(rng, coord_up)
+    first = coord_up + boot_listen(rng, interval)
+    return coord_up, {
+        "probe": join_probe(rng, loss, coord_up, noticed),
+        "beacon": join_beacon(rng, loss, coord_up, coord_up, interval, timeout, first_beacon=first),
+        "resync": resync_on_beacon(rng, loss, first, interval, timeout),
+    }
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return float("nan")
+    return sorted_values[min(len(sorted_values) - 1, int(p / 100 * len(sorted_values)))]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--scenario", nargs="+", default=["boot", "client-reboot", "coord-reboot"],
+                        choices=["boot", "client-reboot", "coord-reboot"])
+    parser.add_argument("--trials", type=int, default=10000)
+    parser.add_argument("--loss", type=float, nargs="+", default=[0.0, 0.05, 0.2], help="frame loss rates")
+    parser.add_argument("--spread", type=float, default=3000, help="boot: power-up times are uniform in [0, spread] ms")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    interval = header_define("MESH_BEACON_INTERVAL_MS")
+    timeout = header_define("MESH_JOIN_TIMEOUT_MS")
+    rng = random.Random(args.seed)
+    print(f"{args.trials} trials, beacon every {interval} ms, join timeout {timeout} ms")
+    for scenario in args.scenario:
+        print(f"\n{scenario}")
+        print(f"{'loss':>5} {'method':<7} {'p50 ms':>9} {'p90 ms':>9} {'p99 ms':>9} {'max ms':>9} {'never':>6}")
+        for loss in args.loss:
+            results = {}
+            failed = {}
+            for _ in range(args.trials):
+                start, joined = run_trial(rng, scenario, loss, args.spread, interval, timeout)
+                for method, t in joined.items():
+                    results.setdefault(method, [])
+                    failed.setdefault(method, 0)
+                    if t is None:
+                        failed[method] += 1
+                    else:
+                        results[method].append(t - start)
+            for method, values in results.items():
+                values.sort()
+                print(f"{loss:5.2f} {method:<7} {percentile(values, 50):9.1f} {percentile(values, 90):9.1f} "
+                      f"{percentile(values, 99):9.1f} {values[-1] if values else float('nan'):9.1f} {failed[method]:6d}")
+
+
+if __name__ == "__main__":
+    main()
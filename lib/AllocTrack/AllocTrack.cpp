@@ -0,0 +1,145 @@
+/*
+ * Heap allocation tracker - see AllocTrack.h
+ */
+
+#include "AllocTrack.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+#ifdef ALLOC_TRACK
+
+static const char* const kSubsystemNames[ALLOC_SUB_COUNT] = {
+  "other", "audio", "mesh", "ble", "control", "console", "radio"
+};
+
+AllocCounters allocCounters[ALLOC_SUB_COUNT];
+
+// Subsystem tag per task. A task claims its slot the first time it tags
+// itself and is the only writer of it afterwards.
+struct AllocTaskSlot {
+  void* task;
+  uint8_t subsystem;
+};
+static AllocTaskSlot taskSlots[ALLOC_TRACK_MAX_TASKS];
+
+static void* currentTask() {
+#ifdef ARDUINO
+  if (xPortInIsrContext() || xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) return nullptr;
+  return (void*)xTaskGetCurrentTaskHandle();
+#else
+  static __thread char hostThread;  // one tag per host thread (test_alloc_free)
+  return &hostThread;
+#endif
+}
+
+static AllocTaskSlot* findSlot(void* task) {
+  for (int i = 0; i < ALLOC_TRACK_MAX_TASKS; i++) {
+    if (__atomic_load_n(&taskSlots[i].task, __ATOMIC_ACQUIRE) == task) return &taskSlots[i];
+  }
+  return nullptr;
+}
+
+void allocTrackSetSubsystem(uint8_t subsystem) {
+  void* task = currentTask();
+  if (!task || subsystem >= ALLOC_SUB_COUNT) return;
+  AllocTaskSlot* slot = findSlot(task);
+  for (int i = 0; !slot && i < ALLOC_TRACK_MAX_TASKS; i++) {
+    void* expected = nullptr;
+    if (__atomic_compare_exchange_n(&taskSlots[i].task, &expected, task, false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+      slot = &taskSlots[i];
+    }
+  }
+  if (slot) slot->subsystem = subsystem;
+}
+
+uint8_t allocTrackSubsystem() {
+  void* task = currentTask();
+  AllocTaskSlot* slot = task ? findSlot(task) : nullptr;
+  return slot ? slot->subsystem : ALLOC_SUB_OTHER;
+}
+
+// Runs inside malloc: no allocation, no locks, no logging
+void allocTrackRecord(size_t size, void* caller) {
+  AllocCounters& c = allocCounters[allocTrackSubsystem()];
+  __atomic_add_fetch(&c.count, 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&c.bytes, (uint32_t)size, __ATOMIC_RELAXED);
+  c.lastCaller = caller;
+}
+
+void allocTrackTick() {
+  for (int i = 0; i < ALLOC_SUB_COUNT; i++) {
+    AllocCounters& c = allocCounters[i];
+    uint32_t count = c.count;
+    c.perSecond = count - c.lastCount;
+    c.lastCount = count;
+    if (c.perSecond > c.peakPerSecond) c.peakPerSecond = c.perSecond;
+  }
+}
+
+void allocTrackReset() {
+  for (int i = 0; i < ALLOC_SUB_COUNT; i++) {
+    AllocCounters& c = allocCounters[i];
+    c.count = 0;
+    c.bytes = 0;
+    c.lastCount = 0;
+    c.perSecond = 0;
+    c.peakPerSecond = 0;
+    c.lastCaller = nullptr;
+  }
+}
+
+uint32_t allocTrackSteadyCount() {
+  uint32_t total = 0;
+  for (int i = 0; i < ALLOC_SUB_COUNT; i++) {
+    if (ALLOC_STEADY_MASK & (1u << i)) total += allocCounters[i].count;
+  }
+  return total;
+}
+
+// Linker wraps (-Wl,--wrap=malloc etc. in the alloc_track env)
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+  allocTrackRecord(size, __builtin_return_address(0));
+  return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+  allocTrackRecord(count * size, __builtin_return_address(0));
+  return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+  allocTrackRecord(size, __builtin_return_address(0));
+  return __real_realloc(ptr, size);
+}
+}
+
+#endif
+
+#ifdef ARDUINO
+void allocTrackPrintStats() {
+  Serial.printf("Heap: free %lu, min free %lu, largest block %lu bytes\n",
+                (unsigned long)ESP.getFreeHeap(), (unsigned long)ESP.getMinFreeHeap(),
+                (unsigned long)ESP.getMaxAllocHeap());
+#ifdef ALLOC_TRACK
+  Serial.println("=== HEAP ALLOCATIONS (since alloc_reset) ===");
+  for (int i = 0; i < ALLOC_SUB_COUNT; i++) {
+    const AllocCounters& c = allocCounters[i];
+    Serial.printf("  %c%-8s count=%lu bytes=%lu", (ALLOC_STEADY_MASK & (1u << i)) ? '*' : ' ',
+                  kSubsystemNames[i], (unsigned long)c.count, (unsigned long)c.bytes);
+    Serial.printf(" last_s=%lu peak_s=%lu caller=%p\n", (unsigned long)c.perSecond,
+                  (unsigned long)c.peakPerSecond, c.lastCaller);
+  }
+  Serial.println("  (* must stay at zero while streaming)");
+#else
+  Serial.println("Allocation tracking not built in (pio run -e alloc_track)");
+#endif
+}
+#endif
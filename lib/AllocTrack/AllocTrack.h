@@ -0,0 +1,92 @@
+/*
+ * Heap allocation tracker for the steady-state audio path (both firmwares)
+ *
+ * Debug builds (the alloc_track PlatformIO env) define ALLOC_TRACK and link
+ * with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc, so every allocation
+ * made through the C heap - including operator new, String, std::string
+ * and ArduinoJson pools - passes through allocTrackRecord() first. Heap
+ * calls the IDF makes internally through heap_caps_* are not seen.
+ *
+ * Allocations are charged to the subsystem of the calling task. Each task
+ * sets its own subsystem once (allocTrackSetSubsystem) and AllocScope
+ * re-tags a region, e.g. calls into the radio stacks, which allocate per
+ * packet internally and are reported as "radio" rather than blamed on the
+ * audio path. Untagged tasks (Wi-Fi/BLE stack tasks, loop) count as "other".
+ * On a host build each thread carries its own tag.
+ *
+ * The steady subsystems (audio, mesh, ble, control) must not allocate once
+ * streaming; alloc_check drives a simulated stream on the device and fails
+ * on any count, test/test_alloc_free does the same for the lib/ path on the
+ * host (pio test -e native_alloc).
+ * Without ALLOC_TRACK everything here compiles to nothing.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ALLOC_TRACK_MAX_TASKS 24
+
+enum AllocSubsystem {
+  ALLOC_SUB_OTHER,    // untagged tasks, boot
+  ALLOC_SUB_AUDIO,    // sender, transcode, generator
+  ALLOC_SUB_MESH,     // ESP-NOW receive and dispatch
+  ALLOC_SUB_BLE,      // BLE ingest and notify
+  ALLOC_SUB_CONTROL,  // heartbeats, status, cleanup, reconnect
+  ALLOC_SUB_CONSOLE,  // periodic reports and serial commands
+  ALLOC_SUB_RADIO,    // inside esp_now_send / notify
+  ALLOC_SUB_COUNT
+};
+
+// Subsystems that must stay at zero allocations while streaming
+#define ALLOC_STEADY_MASK ((1u << ALLOC_SUB_AUDIO) | (1u << ALLOC_SUB_MESH) | \
+                           (1u << ALLOC_SUB_BLE) | (1u << ALLOC_SUB_CONTROL))
+
+struct AllocCounters {
+  volatile uint32_t count;
+  volatile uint32_t bytes;
+  uint32_t lastCount;      // count at the previous 1 s tick
+  uint32_t perSecond;      // allocations in the last full second
+  uint32_t peakPerSecond;
+  void* volatile lastCaller;  // return address of the newest allocation
+};
+
+#ifdef ALLOC_TRACK
+#define ALLOC_TRACK_ENABLED 1
+
+extern AllocCounters allocCounters[ALLOC_SUB_COUNT];
+
+void allocTrackSetSubsystem(uint8_t subsystem);  // for the calling task
+uint8_t allocTrackSubsystem();
+void allocTrackRecord(size_t size, void* caller);
+
+struct AllocScope {
+  uint8_t saved;
+  explicit AllocScope(uint8_t subsystem) : saved(allocTrackSubsystem()) { allocTrackSetSubsystem(subsystem); }
+  ~AllocScope() { allocTrackSetSubsystem(saved); }
+};
+
+void allocTrackTick();  // call once a second
+void allocTrackReset();
+uint32_t allocTrackSteadyCount();
+
+#else
+#define ALLOC_TRACK_ENABLED 0
+
+static inline void allocTrackSetSubsystem(uint8_t) {}
+static inline uint8_t allocTrackSubsystem() { return ALLOC_SUB_OTHER; }
+
+struct AllocScope {
+  explicit AllocScope(uint8_t) {}
+};
+
+static inline void allocTrackTick() {}
+static inline void allocTrackReset() {}
+static inline uint32_t allocTrackSteadyCount() { return 0; }
+
+#endif
+
+#ifdef ARDUINO
+void allocTrackPrintStats();
+#endif
@@ -0,0 +1,228 @@
+/*
+ * Per-stream audio level metering - see AudioMeter.h
+ */
+
+#include "AudioMeter.h"
+
+#if __has_include("sdkconfig.h")
+#include "sdkconfig.h"
+#endif
+
+// PIE (ESP32-S3 vector extension) is used unless explicitly disabled
+#if defined(CONFIG_IDF_TARGET_ESP32S3) && !defined(AUDIO_METER_PORTABLE)
+#define AUDIO_METER_PIE 1
+#else
+#define AUDIO_METER_PIE 0
+#endif
+
+static inline uint16_t absSat16(int32_t x) {
+  if (x < 0) x = -x;
+  return (uint16_t)(x > 32767 ? 32767 : x);
+}
+
+static uint16_t isqrt32(uint32_t x) {
+  uint32_t root = 0;
+  uint32_t bit = 1UL << 30;
+  while (bit > x) bit >>= 2;
+  while (bit != 0) {
+    if (x >= root + bit) {
+      x -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint16_t)root;
+}
+
+// Scalar kernel, unrolled by 4 with independent accumulators
+static void measurePcm16Scalar(const int16_t* x, int n, int32_t& maxV, int32_t& minV, uint64_t& sumSq) {
+  int32_t mx0 = maxV, mx1 = maxV, mn0 = minV, mn1 = minV;
+  uint64_t s0 = 0, s1 = 0;
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    int32_t a = x[i], b = x[i + 1], c = x[i + 2], d = x[i + 3];
+    s0 += (uint32_t)(a * a) + (uint32_t)(b * b);
+    s1 += (uint32_t)(c * c) + (uint32_t)(d * d);
+    if (a > mx0) mx0 = a;
+    if (a < mn0) mn0 = a;
+    if (b > mx1) mx1 = b;
+    if (b < mn1) mn1 = b;
+    if (c > mx0) mx0 = c;
+    if (c < mn0) mn0 = c;
+    if (d > mx1) mx1 = d;
+    if (d < mn1) mn1 = d;
+  }
+  for (; i < n; i++) {
+    int32_t a = x[i];
+    s0 += (uint32_t)(a * a);
+    if (a > mx0) mx0 = a;
+    if (a < mn0) mn0 = a;
+  }
+  maxV = mx0 > mx1 ? mx0 : mx1;
+  minV = mn0 < mn1 ? mn0 : mn1;
+  sumSq += s0 + s1;
+}
+
+#if AUDIO_METER_PIE
+static const int16_t kLaneMin[8] __attribute__((aligned(16))) = {
+  -32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768 };
+static const int16_t kLaneMax[8] __attribute__((aligned(16))) = {
+  32767, 32767, 32767, 32767, 32767, 32767, 32767, 32767 };
+
+// Vector kernel: x must be 16-byte aligned, processes groups * 8 samples.
+// q1/q2 hold per-lane max/min, ACCX accumulates the 40-bit sum of squares.
+static void __attribute__((noinline)) measurePcm16Pie(const int16_t* x, int groups, int32_t& maxV,
+                                                      int32_t& minV, uint64_t& sumSq) {
+  int16_t laneMax[8] __attribute__((aligned(16)));
+  int16_t laneMin[8] __attribute__((aligned(16)));
+  const int16_t* p = x;
+  const int16_t* cMin = kLaneMin;
+  const int16_t* cMax = kLaneMax;
+  int16_t* oMax = laneMax;
+  int16_t* oMin = laneMin;
+  uint32_t accLo, accHi;
+
+  asm volatile(
+    "ee.zero.accx\n"
+    "ee.vld.128.ip q1, %[cMin], 0\n"
+    "ee.vld.128.ip q2, %[cMax], 0\n"
+    "loopnez %[n], 1f\n"
+    "ee.vld.128.ip q0, %[p], 16\n"
+    "ee.vmulas.s16.accx q0, q0\n"
+    "ee.vmax.s16 q1, q1, q0\n"
+    "ee.vmin.s16 q2, q2, q0\n"
+    "1:\n"
+    "ee.vst.128.ip q1, %[oMax], 0\n"
+    "ee.vst.128.ip q2, %[oMin], 0\n"
+    "rur.accx_0 %[lo]\n"
+    "rur.accx_1 %[hi]\n"
+    : [p] "+r"(p), [lo] "=r"(accLo), [hi] "=r"(accHi)
+    : [n] "r"(groups), [cMin] "r"(cMin), [cMax] "r"(cMax), [oMax] "r"(oMax), [oMin] "r"(oMin)
+    : "memory");
+
+  for (int lane = 0; lane < 8; lane++) {
+    if (laneMax[lane] > maxV) maxV = laneMax[lane];
+    if (laneMin[lane] < minV) minV = laneMin[lane];
+  }
+  sumSq += ((uint64_t)(accHi & 0xFF) << 32) | accLo;
+}
+#endif
+
+void audioMeterMeasurePcm16(const int16_t* samples, int count, AudioMeterBlock& out) {
+  out.peak = 0;
+  out.clipped = 0;
+  out.sumSquares = 0;
+  if (!samples || count <= 0) return;
+
+  int32_t maxV = -32768;
+  int32_t minV = 32767;
+  uint64_t sumSq = 0;
+
+#if AUDIO_METER_PIE
+  // Scalar head up to 16-byte alignment, vector body, scalar tail
+  int head = (int)((16 - ((uintptr_t)samples & 15)) & 15) / 2;
+  if ((uintptr_t)samples & 1) head = count;  // misaligned int16, stay scalar
+  if (head > count) head = count;
+  if (head > 0) measurePcm16Scalar(samples, head, maxV, minV, sumSq);
+  int groups = (count - head) / 8;
+  // ACCX is 40-bit signed: 32 groups of full-scale squares (2^38) still fit
+  int done = head;
+  while (groups > 0) {
+    int g = groups > 32 ? 32 : groups;
+    measurePcm16Pie(samples + done, g, maxV, minV, sumSq);
+    done += g * 8;
+    groups -= g;
+  }
+  if (done < count) measurePcm16Scalar(samples + done, count - done, maxV, minV, sumSq);
+#else
+  measurePcm16Scalar(samples, count, maxV, minV, sumSq);
+#endif
+
+  uint16_t peakPos = absSat16(maxV);
+  uint16_t peakNeg = absSat16(minV);
+  out.peak = peakPos > peakNeg ? peakPos : peakNeg;
+  out.sumSquares = sumSq;
+
+  // Clipping is rare: only rescan the block when the peak reached the limit
+  if (out.peak >= AUDIO_METER_CLIP_PCM16) {
+    uint16_t clipped = 0;
+    for (int i = 0; i < count; i++) {
+      if (absSat16(samples[i]) >= AUDIO_METER_CLIP_PCM16) clipped++;
+    }
+    out.clipped = clipped;
+  }
+}
+
+void audioMeterMeasureUlaw(const uint8_t* samples, int count, AudioMeterBlock& out) {
+  out.peak = 0;
+  out.clipped = 0;
+  out.sumSquares = 0;
+  if (!samples || count <= 0) return;
+
+  // u-law magnitude is monotonic in the low 7 bits of the complemented code,
+  // so the peak is found on codes and only squares need the expansion
+  uint8_t maxCode = 0;
+  uint16_t clipped = 0;
+  uint64_t sumSq = 0;
+  for (int i = 0; i < count; i++) {
+    uint8_t code = (uint8_t)(~samples[i]) & 0x7F;
+    int32_t t = (((code & 0x0F) << 3) + 0x84) << ((code & 0x70) >> 4);
+    uint32_t mag = (uint32_t)(t - 0x84);
+    sumSq += mag * mag;
+    if (code > maxCode) maxCode = code;
+    if (mag >= AUDIO_METER_CLIP_ULAW) clipped++;
+  }
+
+  int32_t t = (((maxCode & 0x0F) << 3) + 0x84) << ((maxCode & 0x70) >> 4);
+  out.peak = (uint16_t)(t - 0x84);
+  out.clipped = clipped;
+  out.sumSquares = sumSq;
+}
+
+uint16_t audioMeterRms(const AudioMeterBlock& block, int count) {
+  if (count <= 0) return 0;
+  return isqrt32((uint32_t)(block.sumSquares / (uint32_t)count));
+}
+
+static void foldBlock(AudioMeter& meter, const AudioMeterBlock& block, int count) {
+  meter.blocks++;
+  meter.samples += (uint32_t)count;
+  meter.clipped += block.clipped;
+  meter.lastPeak = block.peak;
+  meter.lastRms = audioMeterRms(block, count);
+  if (block.peak > meter.maxPeak) meter.maxPeak = block.peak;
+}
+
+void audioMeterUpdatePcm16(AudioMeter& meter, const int16_t* samples, int count) {
+  if (count <= 0) return;
+  AudioMeterBlock block;
+  audioMeterMeasurePcm16(samples, count, block);
+  foldBlock(meter, block, count);
+}
+
+void audioMeterUpdateUlaw(AudioMeter& meter, const uint8_t* samples, int count) {
+  if (count <= 0) return;
+  AudioMeterBlock block;
+  audioMeterMeasureUlaw(samples, count, block);
+  foldBlock(meter, block, count);
+}
+
+void audioMeterInit(AudioMeter& meter, const char* name) {
+  meter.name = name;
+  audioMeterReset(meter);
+}
+
+void audioMeterReset(AudioMeter& meter) {
+  meter.blocks = 0;
+  meter.samples = 0;
+  meter.clipped = 0;
+  meter.lastPeak = 0;
+  meter.lastRms = 0;
+  meter.maxPeak = 0;
+}
+
+bool audioMeterUsesVectorUnit() {
+  return AUDIO_METER_PIE != 0;
+}
@@ -0,0 +1,51 @@
+/*
+ * Per-stream audio level metering (peak, RMS, clip count)
+ *
+ * Shared by ESP32 A (coordinator) and ESP32 B (client). Blocks are either
+ * 16-bit PCM or 8-bit u-law (as sent by the Android app). On ESP32-S3 the
+ * PCM16 kernel uses the PIE vector unit (8 lanes of int16 per instruction);
+ * every other target uses the portable unrolled loop.
+ *
+ * Counters are plain 32-bit words written by the audio path and read by the
+ * serial console, so reading them never blocks the stream.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define AUDIO_METER_CLIP_PCM16 32767  // |x| at or above this is clipped
+#define AUDIO_METER_CLIP_ULAW  32124  // largest u-law magnitude
+
+// Result of measuring a single block
+struct AudioMeterBlock {
+  uint16_t peak;        // max |x|, saturated to 32767
+  uint16_t clipped;     // samples at or above the clip level
+  uint64_t sumSquares;  // sum of x^2 over the block
+};
+
+// Running counters for one stream
+struct AudioMeter {
+  const char* name;
+  volatile uint32_t blocks;
+  volatile uint32_t samples;
+  volatile uint32_t clipped;
+  volatile uint16_t lastPeak;
+  volatile uint16_t lastRms;
+  volatile uint16_t maxPeak;
+};
+
+void audioMeterInit(AudioMeter& meter, const char* name);
+void audioMeterReset(AudioMeter& meter);
+
+// Block kernels (no side effects)
+void audioMeterMeasurePcm16(const int16_t* samples, int count, AudioMeterBlock& out);
+void audioMeterMeasureUlaw(const uint8_t* samples, int count, AudioMeterBlock& out);
+
+// Measure a block and fold it into the stream counters
+void audioMeterUpdatePcm16(AudioMeter& meter, const int16_t* samples, int count);
+void audioMeterUpdateUlaw(AudioMeter& meter, const uint8_t* samples, int count);
+
+// Helpers
+uint16_t audioMeterRms(const AudioMeterBlock& block, int count);
+bool audioMeterUsesVectorUnit();
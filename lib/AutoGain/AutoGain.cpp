@@ -0,0 +1,85 @@
+/*
+ * Fixed-point AGC and noise gate - see AutoGain.h
+ */
+
+#include "AutoGain.h"
+
+#include <AudioMeter.h>
+
+void agcDefaultConfig(AgcConfig& cfg) {
+  cfg.targetRms = 4125;       // -18 dBFS
+  cfg.maxGainQ12 = 8 * 4096;  // +18 dB
+  cfg.minGainQ12 = 4096 / 8;  // -18 dB
+  cfg.attackQ15 = 16384;      // halve the error each block going down
+  cfg.releaseQ15 = 1638;      // ~5% per block going up (~200 ms at 10 ms blocks)
+  cfg.gateOpenRms = 164;      // -46 dBFS
+  cfg.gateCloseRms = 104;     // -50 dBFS
+  cfg.gateHoldBlocks = 20;    // 200 ms at 10 ms blocks
+  cfg.gateFloorQ12 = 130;     // -30 dB
+}
+
+void agcInit(Agc& agc, const AgcConfig& cfg) {
+  agc.cfg = cfg;
+  agcReset(agc);
+}
+
+void agcReset(Agc& agc) {
+  agc.agcGainQ12 = AGC_UNITY_Q12;
+  agc.appliedGainQ16 = (int32_t)agc.cfg.gateFloorQ12 << 4;
+  agc.holdCount = 0;
+  agc.gateOpen = false;
+  agc.blocks = 0;
+  agc.gatedBlocks = 0;
+  agc.lastInRms = 0;
+  agc.lastOutGainQ12 = agc.cfg.gateFloorQ12;
+}
+
+void agcProcess(Agc& agc, int16_t* samples, int count) {
+  if (!samples || count <= 0) return;
+  const AgcConfig& cfg = agc.cfg;
+
+  AudioMeterBlock level;
+  audioMeterMeasurePcm16(samples, count, level);
+  uint16_t rms = audioMeterRms(level, count);
+
+  // Gate with hysteresis and hold
+  if (rms >= cfg.gateOpenRms) {
+    agc.gateOpen = true;
+    agc.holdCount = 0;
+  } else if (rms < cfg.gateCloseRms && agc.gateOpen) {
+    if (++agc.holdCount >= cfg.gateHoldBlocks) agc.gateOpen = false;
+  }
+
+  // AGC adapts only on open blocks so it never boosts background noise
+  if (agc.gateOpen && rms > 0) {
+    int32_t wanted = (int32_t)(((uint32_t)cfg.targetRms << 12) / rms);
+    if (wanted > cfg.maxGainQ12) wanted = cfg.maxGainQ12;
+    if (wanted < cfg.minGainQ12) wanted = cfg.minGainQ12;
+    // Never let the smoothed gain push the block peak past full scale
+    if (level.peak > 0) {
+      int32_t peakLimit = (int32_t)((32767UL << 12) / level.peak);
+      if (wanted > peakLimit) wanted = peakLimit;
+    }
+    int32_t coeff = wanted < agc.agcGainQ12 ? cfg.attackQ15 : cfg.releaseQ15;
+    agc.agcGainQ12 += ((wanted - agc.agcGainQ12) * coeff) >> 15;
+  }
+
+  int32_t targetQ12 = agc.gateOpen ? agc.agcGainQ12 : cfg.gateFloorQ12;
+  if (!agc.gateOpen) agc.gatedBlocks++;
+
+  // Linear ramp from the previous block's gain, Q16 so short blocks still move
+  int32_t gainQ16 = agc.appliedGainQ16;
+  int32_t stepQ16 = (((int32_t)targetQ12 << 4) - gainQ16) / count;
+  for (int i = 0; i < count; i++) {
+    gainQ16 += stepQ16;
+    int32_t y = ((int32_t)samples[i] * (gainQ16 >> 4) + (1 << 11)) >> 12;
+    if (y > 32767) y = 32767;
+    if (y < -32768) y = -32768;
+    samples[i] = (int16_t)y;
+  }
+  agc.appliedGainQ16 = (int32_t)targetQ12 << 4;
+
+  agc.blocks++;
+  agc.lastInRms = rms;
+  agc.lastOutGainQ12 = (uint16_t)targetQ12;
+}
@@ -0,0 +1,47 @@
+/*
+ * Fixed-point AGC and noise gate for decoded PCM16 blocks
+ *
+ * One level estimate per block (block RMS from AudioMeter), one divide per
+ * block for the gain target, then a per-sample linear gain ramp so gain
+ * changes never step inside a block. All per-sample work is integer.
+ *
+ * Gains are Q12 (4096 = 1.0, 0 dB).
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define AGC_UNITY_Q12 4096
+
+struct AgcConfig {
+  uint16_t targetRms;      // desired output RMS (linear, full scale 32767)
+  uint16_t maxGainQ12;     // upper gain bound (boost limit)
+  uint16_t minGainQ12;     // lower gain bound (cut limit)
+  uint16_t attackQ15;      // per-block smoothing when gain must fall (fast)
+  uint16_t releaseQ15;     // per-block smoothing when gain may rise (slow)
+  uint16_t gateOpenRms;    // block RMS that opens the gate
+  uint16_t gateCloseRms;   // block RMS below which the gate starts to close
+  uint16_t gateHoldBlocks; // blocks below gateCloseRms before closing
+  uint16_t gateFloorQ12;   // gain applied while the gate is closed
+};
+
+struct Agc {
+  AgcConfig cfg;
+  int32_t agcGainQ12;      // smoothed AGC gain
+  int32_t appliedGainQ16;  // gain reached at the end of the last block (AGC x gate)
+  uint16_t holdCount;
+  bool gateOpen;
+  // Counters for the console
+  volatile uint32_t blocks;
+  volatile uint32_t gatedBlocks;
+  volatile uint16_t lastInRms;
+  volatile uint16_t lastOutGainQ12;
+};
+
+void agcDefaultConfig(AgcConfig& cfg);
+void agcInit(Agc& agc, const AgcConfig& cfg);
+void agcReset(Agc& agc);
+
+// Process a block in place
+void agcProcess(Agc& agc, int16_t* samples, int count);
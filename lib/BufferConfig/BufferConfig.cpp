@@ -0,0 +1,38 @@
+/*
+ * Buffer budgets and high-water marks - see BufferConfig.h
+ */
+
+#include "BufferConfig.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+volatile uint32_t bufferHighWater[BUF_POOL_COUNT];
+
+void bufferHighWaterReset() {
+  for (int i = 0; i < BUF_POOL_COUNT; i++) __atomic_store_n(&bufferHighWater[i], 0, __ATOMIC_RELAXED);
+}
+
+#ifdef ARDUINO
+void bufferPrintStats(uint8_t firmware) {
+  Serial.println("=== BUFFER POOLS (high water since boot or pool_reset) ===");
+  for (int i = 0; i < BUF_POOL_COUNT; i++) {
+    const BufferPoolInfo& p = kBufferPools[i];
+    if (!(p.firmware & firmware)) continue;
+    bool ring = p.slots > 1;
+    uint32_t capacity = ring ? p.slots : p.slotBytes;
+    uint32_t high = bufferHighWater[i];
+    Serial.printf("  %-14s %-5s %-8s %6lu B  high %lu/%lu %s (%lu%%)\n", p.name,
+                  kBufferSubsystemNames[p.subsystem], p.region == BUF_PSRAM ? "psram" : "internal",
+                  (unsigned long)(p.slots * p.slotBytes), (unsigned long)high, (unsigned long)capacity,
+                  ring ? "slots" : "bytes", (unsigned long)(high * 100 / capacity));
+  }
+  for (const BufferBudget& b : kBufferBudgets) {
+    if (b.firmware != firmware) continue;
+    Serial.printf("  budget %-8s %-5s %6lu / %6lu B\n", b.region == BUF_PSRAM ? "psram" : "internal",
+                  kBufferSubsystemNames[b.subsystem],
+                  (unsigned long)bufferBytesUsed(b.firmware, b.region, b.subsystem), (unsigned long)b.limit);
+  }
+}
+#endif
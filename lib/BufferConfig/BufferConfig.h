@@ -0,0 +1,196 @@
+/*
+ * Buffer sizes and RAM budgets for both firmwares
+ *
+ * Every fixed buffer and ring on the audio path takes its size from this
+ * header. BUFFER_POOLS lists each pool with its firmware, subsystem and
+ * memory region (the MemPlace policy), and BUFFER_BUDGETS caps the bytes
+ * per firmware, region and subsystem. The caps are static_asserts, so
+ * growing a buffer past its budget fails the build, not the radio.
+ *
+ * Each firmware asserts that its slot structs match the slot sizes listed
+ * here, so the table cannot drift from the code. ram_report.py prints the
+ * table and budget use at build time; pool_stats prints the run-time
+ * high-water mark of every pool, which shows what can be shrunk.
+ *
+ * Plain C++17 with no Arduino dependency, so the report can compile it on
+ * the host.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Coordinator: BLE writes from Phone A
+#ifndef BLE_IN_QUEUE_DEPTH
+#define BLE_IN_QUEUE_DEPTH 32  // power of two, override with -DBLE_IN_QUEUE_DEPTH=<n>
+#endif
+constexpr uint16_t kBleInQueueSlots = BLE_IN_QUEUE_DEPTH;
+constexpr uint16_t kBleInSlotBytes = 512;        // a full ATT write at the largest MTU
+constexpr uint16_t kWmRxBufferBytes = 4096;      // WM frame reassembly
+constexpr uint16_t kWmMaxFrameBytes = 4000;      // payload cap, leaves room for a second header
+
+// Coordinator: mesh and audio
+constexpr uint16_t kMeshRxPoolSlots = 16;
+constexpr uint16_t kMeshRxSlotBytes = 250;       // ESP_NOW_MAX_DATA_LEN
+constexpr uint16_t kAudioBufferBytes = 1024;     // sender accumulation buffer
+constexpr uint16_t kTranscodeQueueSlots = 8;
+constexpr uint16_t kTranscodeSlotBytes = 256;
+constexpr uint16_t kTranscodeStages = 4;         // one per talk group, allocated on first enable
+constexpr uint32_t kTranscodeStageBytes = 8192;  // TranscodeStage: PCM staging, AGC, counters
+constexpr uint32_t kOpusEncoderBytes = 32 * 1024;  // libopus mono state, checked at run time
+constexpr uint32_t kOpusDecoderBytes = 20 * 1024;
+constexpr uint16_t kSigGenSineTableBytes = 2 * (1024 + 1);  // SignalGen Q15 sine, +1 guard
+constexpr uint16_t kSigGenPinkTableBytes = 2 * 4096;        // SignalGen pink noise loop
+
+// Client: ESP-NOW -> BLE notify
+constexpr uint16_t kNotifyRingSlots = 64;
+constexpr uint16_t kNotifySlotBytes = 256;       // pushes are capped here
+constexpr uint16_t kCoalesceBufferBytes = 4096;  // frames waiting for notify
+
+// Both: deferred log
+constexpr uint16_t kDlogRingRecords = 256;
+
+constexpr uint16_t kBleInQueueMask = kBleInQueueSlots - 1;
+constexpr uint16_t kMeshRxPoolMask = kMeshRxPoolSlots - 1;
+constexpr uint16_t kTranscodeQueueMask = kTranscodeQueueSlots - 1;
+constexpr uint16_t kNotifyRingMask = kNotifyRingSlots - 1;
+
+constexpr bool bufferIsPowerOfTwo(uint32_t n) { return n && (n & (n - 1)) == 0; }
+static_assert(bufferIsPowerOfTwo(kBleInQueueSlots), "BLE_IN_QUEUE_DEPTH must be a power of two");
+static_assert(bufferIsPowerOfTwo(kMeshRxPoolSlots), "mesh RX pool must be a power of two");
+static_assert(bufferIsPowerOfTwo(kTranscodeQueueSlots), "transcode queue must be a power of two");
+static_assert(bufferIsPowerOfTwo(kNotifyRingSlots), "notify ring must be a power of two");
+static_assert(bufferIsPowerOfTwo(kDlogRingRecords), "deferred log ring must be a power of two");
+static_assert(kWmMaxFrameBytes < kWmRxBufferBytes, "WM reassembly buffer must hold a full frame");
+
+// Slot size of a ring item: its header fields plus payload, padded to 4
+constexpr uint32_t bufferSlotBytes(uint32_t header, uint32_t payload) { return (header + payload + 3) & ~3u; }
+
+enum BufferFirmware { BUF_FW_COORD = 1, BUF_FW_CLIENT = 2, BUF_FW_BOTH = 3 };
+enum BufferSubsystem { BUF_SUB_AUDIO, BUF_SUB_MESH, BUF_SUB_BLE, BUF_SUB_LOG, BUF_SUB_COUNT };
+enum BufferRegion { BUF_INTERNAL, BUF_PSRAM };  // MEM_FAST / MEM_BULK
+
+//  id               name              firmware       subsystem      region        slots                 bytes per slot
+#define BUFFER_POOLS(X) \
+  X(AUDIO_BUFFER,    "audioBuffer",    BUF_FW_COORD,  BUF_SUB_AUDIO, BUF_INTERNAL, 1,                    kAudioBufferBytes) \
+  X(TRANSCODE_QUEUE, "transcodeQueue", BUF_FW_COORD,  BUF_SUB_AUDIO, BUF_INTERNAL, kTranscodeQueueSlots, bufferSlotBytes(8, kTranscodeSlotBytes)) \
+  X(SIGGEN_SINE,     "sineTable",      BUF_FW_COORD,  BUF_SUB_AUDIO, BUF_INTERNAL, 1,                    kSigGenSineTableBytes) \
+  X(SIGGEN_PINK,     "pinkTable",      BUF_FW_COORD,  BUF_SUB_AUDIO, BUF_INTERNAL, 1,                    kSigGenPinkTableBytes) \
+  X(TRANSCODE_STAGE, "transcodeStage", BUF_FW_COORD,  BUF_SUB_AUDIO, BUF_PSRAM,    kTranscodeStages,     kTranscodeStageBytes) \
+  X(OPUS_ENCODER,    "opusEncoder",    BUF_FW_COORD,  BUF_SUB_AUDIO, BUF_PSRAM,    kTranscodeStages,     kOpusEncoderBytes) \
+  X(OPUS_DECODER,    "opusDecoder",    BUF_FW_COORD,  BUF_SUB_AUDIO, BUF_PSRAM,    kTranscodeStages,     kOpusDecoderBytes) \
+  X(MESH_RX_POOL,    "meshRxPool",     BUF_FW_COORD,  BUF_SUB_MESH,  BUF_INTERNAL, kMeshRxPoolSlots,     bufferSlotBytes(13, kMeshRxSlotBytes)) \
+  X(WM_RX_BUFFER,    "wmRxBuffer",     BUF_FW_COORD,  BUF_SUB_BLE,   BUF_INTERNAL, 1,                    kWmRxBufferBytes) \
+  X(BLE_IN_QUEUE,    "bleInQueue",     BUF_FW_COORD,  BUF_SUB_BLE,   BUF_PSRAM,    kBleInQueueSlots,     bufferSlotBytes(8, kBleInSlotBytes)) \
+  X(COALESCE_BUFFER, "coalesceBuf",    BUF_FW_CLIENT, BUF_SUB_BLE,   BUF_INTERNAL, 1,                    kCoalesceBufferBytes) \
+  X(NOTIFY_QUEUE,    "notifyQueue",    BUF_FW_CLIENT, BUF_SUB_BLE,   BUF_PSRAM,    kNotifyRingSlots,     bufferSlotBytes(9, kNotifySlotBytes)) \
+  X(DLOG_RING,       "dlogRing",       BUF_FW_BOTH,   BUF_SUB_LOG,   BUF_INTERNAL, kDlogRingRecords,     bufferSlotBytes(12, 16))
+
+// Bytes allowed per firmware, region and subsystem. A PSRAM pool falls
+// back to internal RAM on boards without PSRAM (see mem_map). The transcode
+// stages and their libopus state are heap blocks above the 4 KB internal
+// malloc threshold, so they land in PSRAM too.
+#define BUFFER_BUDGETS(X) \
+  X(BUF_FW_COORD,  BUF_INTERNAL, BUF_SUB_AUDIO, 14 * 1024) \
+  X(BUF_FW_COORD,  BUF_INTERNAL, BUF_SUB_MESH,  5 * 1024) \
+  X(BUF_FW_COORD,  BUF_INTERNAL, BUF_SUB_BLE,   5 * 1024) \
+  X(BUF_FW_COORD,  BUF_INTERNAL, BUF_SUB_LOG,   8 * 1024) \
+  X(BUF_FW_COORD,  BUF_PSRAM,    BUF_SUB_BLE,   32 * 1024) \
+  X(BUF_FW_COORD,  BUF_PSRAM,    BUF_SUB_AUDIO, 256 * 1024) \
+  X(BUF_FW_CLIENT, BUF_INTERNAL, BUF_SUB_BLE,   5 * 1024) \
+  X(BUF_FW_CLIENT, BUF_INTERNAL, BUF_SUB_LOG,   8 * 1024) \
+  X(BUF_FW_CLIENT, BUF_PSRAM,    BUF_SUB_BLE,   32 * 1024)
+
+enum BufferPool {
+#define BUFFER_POOL_ID(id, name, fw, sub, region, slots, slotBytes) BUF_POOL_##id,
+  BUFFER_POOLS(BUFFER_POOL_ID)
+#undef BUFFER_POOL_ID
+  BUF_POOL_COUNT
+};
+
+struct BufferPoolInfo {
+  const char* name;
+  uint8_t firmware;
+  uint8_t subsystem;
+  uint8_t region;
+  uint32_t slots;
+  uint32_t slotBytes;
+};
+
+inline constexpr BufferPoolInfo kBufferPools[BUF_POOL_COUNT] = {
+#define BUFFER_POOL_INFO(id, name, fw, sub, region, slots, slotBytes) { name, fw, sub, region, slots, slotBytes },
+  BUFFER_POOLS(BUFFER_POOL_INFO)
+#undef BUFFER_POOL_INFO
+};
+
+inline constexpr const char* kBufferSubsystemNames[BUF_SUB_COUNT] = { "audio", "mesh", "ble", "log" };
+
+constexpr uint32_t bufferPoolBytes(BufferPool pool) {
+  return kBufferPools[pool].slots * kBufferPools[pool].slotBytes;
+}
+
+constexpr uint32_t bufferBytesUsed(uint8_t firmware, uint8_t region, uint8_t subsystem) {
+  uint32_t total = 0;
+  for (int i = 0; i < BUF_POOL_COUNT; i++) {
+    const BufferPoolInfo& p = kBufferPools[i];
+    if ((p.firmware & firmware) && p.region == region && p.subsystem == subsystem) total += p.slots * p.slotBytes;
+  }
+  return total;
+}
+
+struct BufferBudget {
+  uint8_t firmware;
+  uint8_t region;
+  uint8_t subsystem;
+  uint32_t limit;
+};
+
+inline constexpr BufferBudget kBufferBudgets[] = {
+#define BUFFER_BUDGET_INFO(fw, region, sub, limit) { fw, region, sub, limit },
+  BUFFER_BUDGETS(BUFFER_BUDGET_INFO)
+#undef BUFFER_BUDGET_INFO
+};
+
+#define BUFFER_BUDGET_ASSERT(fw, region, sub, limit) \
+  static_assert(bufferBytesUsed(fw, region, sub) <= (limit), "RAM budget exceeded: " #fw " " #region " " #sub);
+BUFFER_BUDGETS(BUFFER_BUDGET_ASSERT)
+#undef BUFFER_BUDGET_ASSERT
+
+// Every pool with bytes must fall under some budget
+constexpr bool bufferPoolsBudgeted() {
+  for (int i = 0; i < BUF_POOL_COUNT; i++) {
+    const BufferPoolInfo& p = kBufferPools[i];
+    for (uint8_t fw = BUF_FW_COORD; fw <= BUF_FW_CLIENT; fw <<= 1) {
+      if (!(p.firmware & fw)) continue;
+      bool found = false;
+      for (const BufferBudget& b : kBufferBudgets) {
+        if (b.firmware == fw && b.region == p.region && b.subsystem == p.subsystem) found = true;
+      }
+      if (!found) return false;
+    }
+  }
+  return true;
+}
+static_assert(bufferPoolsBudgeted(), "a pool in BUFFER_POOLS has no entry in BUFFER_BUDGETS");
+
+// Run-time high-water marks: slots for rings, bytes for single buffers.
+// Safe from any task; the common not-a-new-maximum case is one load.
+extern volatile uint32_t bufferHighWater[BUF_POOL_COUNT];
+
+static inline void bufferNoteLevel(BufferPool pool, uint32_t level) {
+  uint32_t seen = __atomic_load_n(&bufferHighWater[pool], __ATOMIC_RELAXED);
+  while (level > seen &&
+         !__atomic_compare_exchange_n(&bufferHighWater[pool], &seen, level, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+  }
+}
+
+void bufferHighWaterReset();
+
+static inline void bufferHighWaterClear(BufferPool pool) {
+  __atomic_store_n(&bufferHighWater[pool], 0, __ATOMIC_RELAXED);
+}
+
+#ifdef ARDUINO
+void bufferPrintStats(uint8_t firmware);  // pool_stats
+#endif
@@ -0,0 +1,168 @@
+/*
+ * Deadline monitor - see DeadlineMonitor.h
+ */
+
+#include "DeadlineMonitor.h"
+
+#include <string.h>
+
+#include "DeferredLog.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+static inline uint32_t deadlineCycles() {
+  return ESP.getCycleCount();
+}
+static inline int8_t deadlineCore() {
+  return (int8_t)xPortGetCoreID();
+}
+static uint32_t cyclesPerUs() {
+  return ESP.getCpuFreqMHz();
+}
+#else
+#include <chrono>
+#include <x86intrin.h>
+static inline uint32_t deadlineCycles() {
+  return (uint32_t)__rdtsc();
+}
+static inline int8_t deadlineCore() {
+  return 0;  // host runs assume a constant, synchronised TSC
+}
+// Measure the TSC rate once against steady_clock (2 ms busy wait)
+static uint32_t cyclesPerUs() {
+  static uint32_t rate = 0;
+  if (!rate) {
+    auto t0 = std::chrono::steady_clock::now();
+    uint64_t c0 = __rdtsc();
+    while (std::chrono::steady_clock::now() - t0 < std::chrono::milliseconds(2)) {}
+    uint64_t cycles = __rdtsc() - c0;
+    uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count();
+    rate = us ? (uint32_t)(cycles / us) : 1;
+    if (!rate) rate = 1;
+  }
+  return rate;
+}
+#endif
+
+// Histogram bucket upper bounds in eighths of the period; the last bucket is open
+static const uint8_t kBucketEighths[DEADLINE_HIST_BUCKETS - 1] = { 1, 2, 4, 6, 8, 12, 16 };
+#ifdef ARDUINO
+static const char* const kBucketLabels[DEADLINE_HIST_BUCKETS] = {
+  "<1/8", "<1/4", "<1/2", "<3/4", "<1", "<1.5", "<2", ">=2"
+};
+#endif
+
+static DeadlineMonitor monitors[DEADLINE_MAX_MONITORS];
+static int monitorCount = 0;
+
+int deadlineRegister(const char* name, uint32_t periodUs) {
+  if (monitorCount >= DEADLINE_MAX_MONITORS || periodUs == 0) return -1;
+  DeadlineMonitor& m = monitors[monitorCount];
+  memset((void*)&m, 0, sizeof(m));
+  m.name = name;
+  m.periodUs = periodUs;
+  m.periodCycles = periodUs * cyclesPerUs();
+  for (int i = 0; i < DEADLINE_HIST_BUCKETS - 1; i++) {
+    m.bucketLimit[i] = (uint32_t)((uint64_t)m.periodCycles * kBucketEighths[i] / 8);
+  }
+  m.startCore = -1;
+  m.lastStartCore = -1;
+  return monitorCount++;
+}
+
+DeadlineMonitor* deadlineMonitor(int index) {
+  return index >= 0 && index < monitorCount ? &monitors[index] : nullptr;
+}
+
+int deadlineMonitorCount() {
+  return monitorCount;
+}
+
+static void clearCounters(DeadlineMonitor& m) {
+  m.runs = 0;
+  m.overruns = 0;
+  m.lateStarts = 0;
+  m.migrated = 0;
+  m.wcetCycles = 0;
+  m.maxGapCycles = 0;
+  m.execCycles = 0;
+  for (int i = 0; i < DEADLINE_HIST_BUCKETS; i++) m.hist[i] = 0;
+  m.lastStartCore = -1;  // no gap across the reset
+}
+
+void deadlineBegin(int index) {
+  if (index < 0 || index >= monitorCount) return;
+  DeadlineMonitor& m = monitors[index];
+  if (m.resetPending) {
+    clearCounters(m);
+    m.resetPending = false;
+  }
+  uint32_t now = deadlineCycles();
+  int8_t core = deadlineCore();
+  if (m.lastStartCore == core) {
+    uint32_t gap = now - m.lastStartCycles;
+    if (gap > m.maxGapCycles) m.maxGapCycles = gap;
+    if (gap > m.periodCycles + m.periodCycles / 2) {
+      m.lateStarts++;
+      DLOG(AUDIO, WARN, DEADLINE_LATE, (uint32_t)index, gap / cyclesPerUs(), m.periodUs);
+    }
+  }
+  m.lastStartCycles = now;
+  m.lastStartCore = core;
+  m.startCycles = now;
+  m.startCore = core;
+}
+
+void deadlineEnd(int index) {
+  if (index < 0 || index >= monitorCount) return;
+  DeadlineMonitor& m = monitors[index];
+  uint32_t now = deadlineCycles();
+  if (m.startCore < 0) return;  // no matching begin
+  if (deadlineCore() != m.startCore) {
+    m.migrated++;
+    m.startCore = -1;
+    return;
+  }
+  uint32_t exec = now - m.startCycles;
+  m.startCore = -1;
+  m.runs++;
+  m.execCycles += exec;
+  if (exec > m.wcetCycles) m.wcetCycles = exec;
+  int bucket = 0;
+  while (bucket < DEADLINE_HIST_BUCKETS - 1 && exec >= m.bucketLimit[bucket]) bucket++;
+  m.hist[bucket]++;
+  if (exec > m.periodCycles) {
+    m.overruns++;
+    DLOG(AUDIO, WARN, DEADLINE_OVERRUN, (uint32_t)index, exec / cyclesPerUs(), m.periodUs);
+  }
+}
+
+void deadlineReset() {
+  for (int i = 0; i < monitorCount; i++) monitors[i].resetPending = true;
+}
+
+#ifdef ARDUINO
+void deadlinePrintStats() {
+  uint32_t mhz = cyclesPerUs();
+  Serial.println("=== DEADLINES (since deadline_reset) ===");
+  for (int i = 0; i < monitorCount; i++) {
+    const DeadlineMonitor& m = monitors[i];
+    uint32_t runs = m.runs;
+    uint32_t avgUs = runs ? (uint32_t)(m.execCycles / runs / mhz) : 0;
+    Serial.printf("  [%d] %-12s period %lu us: runs %lu, misses %lu (overrun %lu, late %lu), migrated %lu\n",
+                  i, m.name, (unsigned long)m.periodUs, (unsigned long)runs,
+                  (unsigned long)(m.overruns + m.lateStarts), (unsigned long)m.overruns,
+                  (unsigned long)m.lateStarts, (unsigned long)m.migrated);
+    Serial.printf("      exec avg %lu us, WCET %lu us (%lu%% of period), max gap %lu us\n",
+                  (unsigned long)avgUs, (unsigned long)(m.wcetCycles / mhz),
+                  (unsigned long)((uint64_t)m.wcetCycles * 100 / m.periodCycles),
+                  (unsigned long)(m.maxGapCycles / mhz));
+    Serial.print("      exec/period:");
+    for (int b = 0; b < DEADLINE_HIST_BUCKETS; b++) {
+      Serial.printf(" %s=%lu", kBucketLabels[b], (unsigned long)m.hist[b]);
+    }
+    Serial.println();
+  }
+  if (monitorCount == 0) Serial.println("  (no monitors registered)");
+}
+#endif
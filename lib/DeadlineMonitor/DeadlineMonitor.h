@@ -0,0 +1,63 @@
+/*
+ * Deadline monitor for periodic tasks (both firmwares)
+ *
+ * A periodic task brackets each cycle's work with deadlineBegin() and
+ * deadlineEnd(). Both read the CPU cycle counter (ESP.getCycleCount(), rdtsc
+ * on the host), so the cost is a few dozen cycles and nothing is logged on
+ * the fast path. Per monitor we keep:
+ *   - execution time: worst case (WCET), sum, and a histogram in fractions
+ *     of the period, so tasks with different periods read the same way
+ *   - overruns: work took longer than the period
+ *   - late starts: the gap since the previous begin exceeded 1.5 periods,
+ *     i.e. the task was starved or blocked and skipped at least one slot
+ * Both count as deadline misses and each one is logged through DLOG with
+ * the monitor index, so an audio gap lines up with a log record.
+ *
+ * The cycle counter is per core. A cycle whose begin and end land on
+ * different cores (unpinned layouts) is counted as migrated and not timed.
+ * Counters are written by the owning task only; deadline_reset sets a flag
+ * that the owner applies at its next deadlineBegin().
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define DEADLINE_MAX_MONITORS 8
+#define DEADLINE_HIST_BUCKETS 8
+
+struct DeadlineMonitor {
+  const char* name;
+  uint32_t periodUs;
+  uint32_t periodCycles;
+  uint32_t bucketLimit[DEADLINE_HIST_BUCKETS - 1];  // cycles, ascending
+  // Owner-written counters
+  volatile uint32_t runs;
+  volatile uint32_t overruns;
+  volatile uint32_t lateStarts;
+  volatile uint32_t migrated;
+  volatile uint32_t wcetCycles;
+  volatile uint32_t maxGapCycles;
+  volatile uint64_t execCycles;
+  volatile uint32_t hist[DEADLINE_HIST_BUCKETS];
+  // Owner state
+  uint32_t startCycles;
+  uint32_t lastStartCycles;
+  int8_t startCore;
+  int8_t lastStartCore;
+  volatile bool resetPending;
+};
+
+// Register a monitor before its task starts; returns the index (-1 when full)
+int deadlineRegister(const char* name, uint32_t periodUs);
+DeadlineMonitor* deadlineMonitor(int index);
+
+void deadlineBegin(int index);
+void deadlineEnd(int index);
+
+void deadlineReset();  // all monitors, applied lazily by each owner
+int deadlineMonitorCount();
+
+#ifdef ARDUINO
+void deadlinePrintStats();
+#endif
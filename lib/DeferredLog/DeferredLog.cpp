@@ -0,0 +1,182 @@
+/*
+ * Deferred binary logging - see DeferredLog.h
+ */
+
+#include "DeferredLog.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <esp_timer.h>
+static inline uint32_t dlogNowUs() {
+  return (uint32_t)esp_timer_get_time();
+}
+#else
+#include <chrono>
+static inline uint32_t dlogNowUs() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+#define DLOG_RING_MASK (kDlogRingRecords - 1)
+static_assert(sizeof(DlogRecord) == kBufferPools[BUF_POOL_DLOG_RING].slotBytes, "update DLOG_RING in BufferConfig.h");
+
+static const char* const kFormats[DLOG_FORMAT_COUNT] = {
+#define DLOG_FORMAT_STRING(id, fmt) fmt,
+  DLOG_FORMATS(DLOG_FORMAT_STRING)
+#undef DLOG_FORMAT_STRING
+};
+
+static const char* const kModuleNames[DLOG_MOD_COUNT] = { "audio", "mesh", "ble" };
+static const char kLevelTags[] = "-EWID";
+
+// Bounded MPSC ring (Vyukov): each slot's sequence says whether it is free
+// for the producer at that position or holds a record for the consumer
+static DlogRecord ring[kDlogRingRecords];
+static uint32_t enqueuePos = 0;
+static uint32_t dequeuePos = 0;  // written by the drain task only
+DlogStats dlogStats;
+
+void dlogInit() {
+  for (uint32_t i = 0; i < kDlogRingRecords; i++) ring[i].sequence = i;
+  enqueuePos = 0;
+  dequeuePos = 0;
+  memset((void*)&dlogStats, 0, sizeof(dlogStats));
+}
+
+void dlogWriteRecord(uint8_t module, uint8_t level, uint16_t format, uint8_t argc, const uint32_t* args) {
+  uint32_t pos = __atomic_load_n(&enqueuePos, __ATOMIC_RELAXED);
+  DlogRecord* rec;
+  for (;;) {
+    rec = &ring[pos & DLOG_RING_MASK];
+    uint32_t seq = __atomic_load_n(&rec->sequence, __ATOMIC_ACQUIRE);
+    int32_t diff = (int32_t)(seq - pos);
+    if (diff == 0) {
+      if (__atomic_compare_exchange_n(&enqueuePos, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+    } else if (diff < 0) {
+      __atomic_add_fetch(&dlogStats.dropped, 1, __ATOMIC_RELAXED);  // full
+      return;
+    } else {
+      pos = __atomic_load_n(&enqueuePos, __ATOMIC_RELAXED);
+    }
+  }
+  bufferNoteLevel(BUF_POOL_DLOG_RING, pos + 1 - __atomic_load_n(&dequeuePos, __ATOMIC_RELAXED));
+  rec->timestampUs = dlogNowUs();
+  rec->format = format;
+  rec->levelModule = (uint8_t)((level << 4) | module);
+  rec->argc = argc > DLOG_MAX_ARGS ? DLOG_MAX_ARGS : argc;
+  for (int i = 0; i < rec->argc; i++) rec->args[i] = args[i];
+  __atomic_store_n(&rec->sequence, pos + 1, __ATOMIC_RELEASE);
+  __atomic_add_fetch(&dlogStats.written, 1, __ATOMIC_RELAXED);
+}
+
+bool dlogRead(DlogRecord& out) {
+  DlogRecord& rec = ring[dequeuePos & DLOG_RING_MASK];
+  if (__atomic_load_n(&rec.sequence, __ATOMIC_ACQUIRE) != dequeuePos + 1) return false;
+  out = rec;
+  __atomic_store_n(&rec.sequence, dequeuePos + kDlogRingRecords, __ATOMIC_RELEASE);
+  __atomic_store_n(&dequeuePos, dequeuePos + 1, __ATOMIC_RELAXED);  // producers read it for the high-water mark
+  dlogStats.drained++;
+  return true;
+}
+
+const char* dlogFormatString(uint16_t format) {
+  return format < DLOG_FORMAT_COUNT ? kFormats[format] : "?";
+}
+
+// printf with integer conversions only, one arg per conversion (%% takes none)
+int dlogFormat(const DlogRecord& rec, char* buf, int size) {
+  uint8_t module = rec.levelModule & 0x0F;
+  uint8_t level = rec.levelModule >> 4;
+  int n = snprintf(buf, size, "[%10lu] %c %-5s ", (unsigned long)rec.timestampUs,
+                   level < sizeof(kLevelTags) - 1 ? kLevelTags[level] : '?',
+                   module < DLOG_MOD_COUNT ? kModuleNames[module] : "?");
+  const char* fmt = dlogFormatString(rec.format);
+  int arg = 0;
+  while (*fmt && n < size - 1) {
+    if (*fmt != '%') {
+      buf[n++] = *fmt++;
+      continue;
+    }
+    if (fmt[1] == '%') {
+      buf[n++] = '%';  // literal, takes no argument
+      fmt += 2;
+      continue;
+    }
+    char spec[12];
+    int s = 0;
+    spec[s++] = *fmt++;
+    while ((*fmt == '0' || (*fmt >= '1' && *fmt <= '9')) && s < 8) spec[s++] = *fmt++;
+    char conv = *fmt ? *fmt++ : 'u';
+    spec[s++] = conv;
+    spec[s] = '\0';
+    uint32_t value = arg < rec.argc ? rec.args[arg] : 0;
+    arg++;
+    if (conv == 'd') {
+      n += snprintf(buf + n, size - n, spec, (int)value);
+    } else if (conv == 'u' || conv == 'x' || conv == 'X') {
+      n += snprintf(buf + n, size - n, spec, (unsigned)value);
+    } else {
+      buf[n++] = conv;  // unsupported
+    }
+    if (n > size - 1) n = size - 1;
+  }
+  buf[n] = '\0';
+  return n;
+}
+
+#ifdef ARDUINO
+volatile uint8_t dlogOutput = DLOG_OUT_TEXT;
+static const char* const kOutputNames[] = { "off", "text", "binary" };
+
+bool dlogSetOutput(const char* name) {
+  for (uint8_t i = 0; i <= DLOG_OUT_BINARY; i++) {
+    if (strcmp(name, kOutputNames[i]) == 0) {
+      dlogOutput = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Low priority: runs when the audio tasks are idle, at most every 20 ms
+void dlogDrainTask(void* pvParameters) {
+  DlogRecord rec;
+  char line[160];
+  uint8_t frame[3 + 8 + 4 * DLOG_MAX_ARGS];
+  for (;;) {
+    while (dlogRead(rec)) {
+      uint8_t mode = dlogOutput;
+      if (mode == DLOG_OUT_TEXT) {
+        dlogFormat(rec, line, sizeof(line));
+        Serial.println(line);
+      } else if (mode == DLOG_OUT_BINARY) {
+        int len = 8 + 4 * rec.argc;
+        frame[0] = 'D';
+        frame[1] = 'L';
+        frame[2] = (uint8_t)len;
+        memcpy(frame + 3, &rec.timestampUs, 4);  // little-endian target
+        memcpy(frame + 7, &rec.format, 2);
+        frame[9] = rec.levelModule;
+        frame[10] = rec.argc;
+        memcpy(frame + 11, rec.args, 4 * rec.argc);
+        Serial.write(frame, 3 + len);
+      }
+    }
+    vTaskDelay(pdMS_TO_TICKS(20));
+  }
+}
+
+void dlogPrintStats() {
+  Serial.printf("=== DEFERRED LOG (ring %d, mode %s) ===\n", (int)kDlogRingRecords,
+                dlogOutput <= DLOG_OUT_BINARY ? kOutputNames[dlogOutput] : "?");
+  Serial.printf("Written: %lu, dropped (ring full): %lu, drained: %lu\n",
+                (unsigned long)dlogStats.written, (unsigned long)dlogStats.dropped,
+                (unsigned long)dlogStats.drained);
+  Serial.printf("Levels: audio=%d mesh=%d ble=%d (compile time)\n",
+                DLOG_LEVEL_AUDIO, DLOG_LEVEL_MESH, DLOG_LEVEL_BLE);
+}
+#endif
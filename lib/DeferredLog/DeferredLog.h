@@ -0,0 +1,144 @@
+/*
+ * Deferred binary logging for hot paths (both firmwares)
+ *
+ * DLOG() stores a fixed-size record (format ID, level, module, esp_timer
+ * timestamp, up to four integer args) in a lock-free multi-producer ring
+ * and returns; formatting and the UART happen later in the low-priority
+ * drain task. A full ring drops the record and counts it, it never blocks.
+ * Safe from any task or the Wi-Fi/BLE callbacks.
+ *
+ * Each module has a compile-time level ceiling (DLOG_LEVEL_<MODULE>, set
+ * with -D in platformio.ini). A DLOG() above its ceiling is a constant
+ * false branch, so disabled logs compile to nothing.
+ *
+ * The drain prints text by default (log_mode:text) or, with
+ * log_mode:binary, writes the raw records framed as
+ *   'D','L', len, timestamp(le32), format(le16), level<<4|module, argc, args(le32 x argc)
+ * which decode_log.py turns back into text using DLOG_FORMATS below.
+ * Format strings take integer conversions only (%u %d %x %X, with width).
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "BufferConfig.h"
+
+#define DLOG_LEVEL_OFF   0
+#define DLOG_LEVEL_ERROR 1
+#define DLOG_LEVEL_WARN  2
+#define DLOG_LEVEL_INFO  3
+#define DLOG_LEVEL_DEBUG 4
+
+#ifndef DLOG_LEVEL_AUDIO
+#define DLOG_LEVEL_AUDIO DLOG_LEVEL_INFO
+#endif
+#ifndef DLOG_LEVEL_MESH
+#define DLOG_LEVEL_MESH DLOG_LEVEL_INFO
+#endif
+#ifndef DLOG_LEVEL_BLE
+#define DLOG_LEVEL_BLE DLOG_LEVEL_INFO
+#endif
+
+#define DLOG_MAX_ARGS  4
+
+enum DlogModule { DLOG_MOD_AUDIO, DLOG_MOD_MESH, DLOG_MOD_BLE, DLOG_MOD_COUNT };
+
+// One entry per log site. IDs are positions in this list: append only, so
+// old captures still decode.
+#define DLOG_FORMATS(X) \
+  X(MESH_RX,            "Mesh RX from %06X%06X, %u bytes") \
+  X(AUDIO_BUFFER,       "Audio buffer: %u bytes, %u mesh peers") \
+  X(AUDIO_SENT,         "Audio sent to peer %u (..%04X): %u bytes") \
+  X(AUDIO_SEND_FAILED,  "Failed to send audio to peer %u (..%04X): %d") \
+  X(WM_SEND_FAILED,     "Failed to forward WM to peer %u (..%04X): %d") \
+  X(AUDIO_ADDED,        "Audio data added: %u bytes, buffer now %u/%u bytes") \
+  X(AUDIO_OVERFLOW,     "Audio buffer full: %u + %u > %u bytes, dropping %u oldest") \
+  X(AUDIO_RELAYED,      "Audio relayed to peer (..%04X)") \
+  X(MESH_RX_LEN,        "Mesh RX len=%u") \
+  X(NOTIFY_OVERFLOW,    "Coalesce buffer overflow, discarded %u bytes") \
+  X(HEARTBEAT_SEND,     "Heartbeat to %u mesh devices, %u bytes") \
+  X(HEARTBEAT_SENT,     "Heartbeat sent to peer (..%04X)") \
+  X(STATUS_SEND,        "Status to %u mesh devices, %u bytes") \
+  X(STATUS_SENT,        "Status sent to peer (..%04X)") \
+  X(DEADLINE_OVERRUN,   "Deadline overrun: monitor %u ran %u us (period %u us)") \
+  X(DEADLINE_LATE,      "Deadline late start: monitor %u, %u us since last (period %u us)") \
+  X(MEMBERSHIP,         "Mesh membership: %u devices (v%u)") \
+  X(PEER_SUSPECTED,     "%u mesh peers suspected, last one %u ms after it was heard") \
+  X(PEER_RECOVERED,     "Suspected mesh peers heard again (%u recoveries)") \
+  X(AUDIO_DATA_RX,      "Audio data from mesh peer (..%04X), %u bytes") \
+  X(AUDIO_ACK_RX,       "Audio ack from mesh peer (..%04X)") \
+  X(AUDIO_CHUNK_RX,     "Audio chunk %u/%u seq %u at %u Hz") \
+  X(AUDIO_CHUNK_DATA,   "Audio chunk seq %u: %u bytes, first %08X, checksum %08X") \
+  X(AUDIO_CHUNK_EMPTY,  "Audio chunk seq %u carried no data") \
+  X(AUDIO_RELAY_FAILED, "Failed to relay audio to peer (..%04X): %d") \
+  X(AUDIO_ACK_SENT,     "Audio ack sent to peer (..%04X)") \
+  X(AUDIO_ACK_FAILED,   "Failed to send audio ack to peer (..%04X): %d") \
+  X(MESH_ACK_SENT,      "Mesh ack sent to peer (..%04X), %u mesh devices") \
+  X(MESH_ACK_FAILED,    "Failed to send mesh ack to peer (..%04X): %d")
+
+enum DlogFormat {
+#define DLOG_FORMAT_ID(id, fmt) DLOG_##id,
+  DLOG_FORMATS(DLOG_FORMAT_ID)
+#undef DLOG_FORMAT_ID
+  DLOG_FORMAT_COUNT
+};
+
+enum DlogOutput { DLOG_OUT_OFF, DLOG_OUT_TEXT, DLOG_OUT_BINARY };
+
+struct DlogRecord {
+  uint32_t sequence;     // ring slot state, not logged
+  uint32_t timestampUs;
+  uint16_t format;
+  uint8_t levelModule;   // level << 4 | module
+  uint8_t argc;
+  uint32_t args[DLOG_MAX_ARGS];
+};
+
+struct DlogStats {
+  volatile uint32_t written;
+  volatile uint32_t dropped;
+  volatile uint32_t drained;
+};
+
+extern DlogStats dlogStats;
+
+void dlogInit();
+void dlogWriteRecord(uint8_t module, uint8_t level, uint16_t format, uint8_t argc, const uint32_t* args);
+
+static inline void dlogWrite(uint8_t module, uint8_t level, uint16_t format) {
+  dlogWriteRecord(module, level, format, 0, nullptr);
+}
+static inline void dlogWrite(uint8_t module, uint8_t level, uint16_t format, uint32_t a) {
+  dlogWriteRecord(module, level, format, 1, &a);
+}
+static inline void dlogWrite(uint8_t module, uint8_t level, uint16_t format, uint32_t a, uint32_t b) {
+  uint32_t args[2] = { a, b };
+  dlogWriteRecord(module, level, format, 2, args);
+}
+static inline void dlogWrite(uint8_t module, uint8_t level, uint16_t format, uint32_t a, uint32_t b, uint32_t c) {
+  uint32_t args[3] = { a, b, c };
+  dlogWriteRecord(module, level, format, 3, args);
+}
+static inline void dlogWrite(uint8_t module, uint8_t level, uint16_t format, uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+  uint32_t args[4] = { a, b, c, d };
+  dlogWriteRecord(module, level, format, 4, args);
+}
+
+#define DLOG(module, level, id, ...)                                                         \
+  do {                                                                                       \
+    if (DLOG_LEVEL_##level <= DLOG_LEVEL_##module)                                           \
+      dlogWrite(DLOG_MOD_##module, DLOG_LEVEL_##level, DLOG_##id, ##__VA_ARGS__);           \
+  } while (0)
+
+// Consumer side (one drain task): copy the oldest record out, false if empty
+bool dlogRead(DlogRecord& out);
+const char* dlogFormatString(uint16_t format);
+int dlogFormat(const DlogRecord& rec, char* buf, int size);
+
+#ifdef ARDUINO
+extern volatile uint8_t dlogOutput;  // DlogOutput
+bool dlogSetOutput(const char* name);  // "text", "binary" or "off" (log_mode command)
+void dlogDrainTask(void* pvParameters);
+void dlogPrintStats();
+#endif
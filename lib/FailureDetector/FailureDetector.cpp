@@ -0,0 +1,146 @@
+/*
+ * Phi-accrual failure detector - see FailureDetector.h
+ */
+
+#include "FailureDetector.h"
+
+#include <math.h>
+#include <string.h>
+
+static FdPeer* findPeer(FailureDetector& fd, const uint8_t* mac) {
+  for (int i = 0; i < FD_MAX_PEERS; i++) {
+    if (fd.peers[i].used && memcmp(fd.peers[i].mac, mac, 6) == 0) return &fd.peers[i];
+  }
+  return nullptr;
+}
+
+void fdReset(FailureDetector& fd) {
+  memset(&fd, 0, sizeof(fd));
+}
+
+void fdTrack(FailureDetector& fd, const uint8_t* mac, uint32_t nowMs) {
+  FdPeer* p = findPeer(fd, mac);
+  if (!p) {
+    for (int i = 0; i < FD_MAX_PEERS && !p; i++) {
+      if (!fd.peers[i].used) p = &fd.peers[i];
+    }
+    if (!p) return;
+  }
+  memset(p, 0, sizeof(*p));
+  p->used = true;
+  memcpy(p->mac, mac, 6);
+  p->lastMs = nowMs;
+}
+
+void fdForget(FailureDetector& fd, const uint8_t* mac) {
+  FdPeer* p = findPeer(fd, mac);
+  if (p) p->used = false;
+}
+
+bool fdHeard(FailureDetector& fd, const uint8_t* mac, uint32_t nowMs) {
+  FdPeer* p = findPeer(fd, mac);
+  if (!p) return false;
+  fd.arrivals++;
+  p->failStreak = 0;
+  if (p->suspected) {
+    p->suspected = false;
+    p->lastMs = nowMs;
+    fd.recoveries++;
+    return true;
+  }
+  uint32_t gap = nowMs - p->lastMs;
+  uint16_t sample = gap > 0xFFFF ? 0xFFFF : (uint16_t)gap;
+  if (p->samples == FD_WINDOW) {
+    uint16_t old = p->intervals[p->next];
+    p->sum -= old;
+    p->sumSq -= (uint32_t)old * old;
+  } else {
+    p->samples++;
+  }
+  p->intervals[p->next] = sample;
+  p->next = (uint8_t)((p->next + 1) % FD_WINDOW);
+  p->sum += sample;
+  p->sumSq += (uint32_t)sample * sample;
+  p->lastMs = nowMs;
+  return false;
+}
+
+void fdSendFailed(FailureDetector& fd, const uint8_t* mac) {
+  FdPeer* p = findPeer(fd, mac);
+  if (!p) return;
+  if (p->failStreak < 0xFFFF) p->failStreak++;
+  fd.failures++;
+}
+
+float fdPhi(const FdPeer& p, uint32_t nowMs) {
+  float mean, std;
+  if (p.samples < FD_MIN_SAMPLES) {
+    mean = FD_BOOTSTRAP_MS;
+    std = FD_BOOTSTRAP_MS / 4;
+  } else {
+    mean = (float)p.sum / p.samples;
+    float var = (float)p.sumSq / p.samples - mean * mean;
+    std = var > 0 ? sqrtf(var) : 0;
+  }
+  if (std < FD_MIN_STD_MS) std = FD_MIN_STD_MS;
+  float y = ((float)(nowMs - p.lastMs) - mean - FD_PAUSE_MS) / std;
+  // -log10(e / (1 + e)) with e = exp(-y * k), written to stay finite
+  float k = 1.5976f + 0.070566f * y * y;
+  float a = -y * k;
+  if (a > 30) return 0;
+  return (-a + log1pf(expf(a))) / 2.302585f;
+}
+
+static bool isCandidate(const FdPeer& p) {
+  return p.used && !p.suspected && p.failStreak >= FD_MIN_FAILURES;
+}
+
+bool fdCandidate(const FailureDetector& fd, int slot, FdPeer& out) {
+  if (!isCandidate(fd.peers[slot])) return false;
+  out = fd.peers[slot];
+  return true;
+}
+
+bool fdSuspect(FailureDetector& fd, int slot, uint32_t lastMs, uint32_t nowMs) {
+  FdPeer& p = fd.peers[slot];
+  if (!isCandidate(p) || p.lastMs != lastMs) return false;
+  p.suspected = true;
+  p.suspectedAtMs = nowMs;
+  p.probeGapMs = FD_PROBE_MIN_MS;
+  p.probeAtMs = nowMs + FD_PROBE_MIN_MS;
+  p.suspicions++;
+  fd.suspicions++;
+  fd.lastDetectMs = nowMs - p.lastMs;
+  return true;
+}
+
+int fdUpdate(FailureDetector& fd, uint32_t nowMs) {
+  int changed = 0;
+  for (int i = 0; i < FD_MAX_PEERS; i++) {
+    const FdPeer& p = fd.peers[i];
+    if (!isCandidate(p) || fdPhi(p, nowMs) < FD_PHI_SUSPECT) continue;
+    if (fdSuspect(fd, i, p.lastMs, nowMs)) changed++;
+  }
+  return changed;
+}
+
+bool fdIsSuspected(const FailureDetector& fd, const uint8_t* mac) {
+  for (int i = 0; i < FD_MAX_PEERS; i++) {
+    const FdPeer& p = fd.peers[i];
+    if (p.used && memcmp(p.mac, mac, 6) == 0) return p.suspected;
+  }
+  return false;
+}
+
+int fdProbesDue(FailureDetector& fd, uint32_t nowMs, uint8_t (*macs)[6], int max) {
+  int n = 0;
+  for (int i = 0; i < FD_MAX_PEERS && n < max; i++) {
+    FdPeer& p = fd.peers[i];
+    if (!p.used || !p.suspected || (int32_t)(nowMs - p.probeAtMs) < 0) continue;
+    memcpy(macs[n++], p.mac, 6);
+    p.probeAtMs = nowMs + p.probeGapMs;
+    if (p.probeGapMs < FD_PROBE_MAX_MS) p.probeGapMs *= 2;
+    fd.probes++;
+  }
+  return n;
+}
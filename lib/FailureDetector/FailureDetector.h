@@ -0,0 +1,118 @@
+/*
+ * Phi-accrual failure detector for mesh peers (coordinator)
+ *
+ * Every sign of life from a peer is an arrival: a frame received from it,
+ * or an ESP-NOW send to it that the peer acked at the MAC layer (send
+ * callback status success). The detector keeps the last FD_WINDOW
+ * inter-arrival times per peer and turns the time since the last arrival
+ * into a suspicion level
+ *
+ *   phi = -log10(P(next arrival is later than now))
+ *
+ * under a normal fit of the window (mean + FD_PAUSE_MS, std at least
+ * FD_MIN_STD_MS), using the logistic approximation of the normal CDF. phi 1
+ * means a 10% chance the peer is still alive and just late, phi 8 one in
+ * 10^8. Because the window follows the traffic, a peer streaming audio
+ * every few ms is suspected within a couple of hundred ms, and an idle peer
+ * heard every few seconds is given seconds.
+ *
+ * A peer is suspected once phi reaches FD_PHI_SUSPECT and at least
+ * FD_MIN_FAILURES sends to it have failed since its last arrival. The
+ * failure requirement keeps a peer we simply have not talked to from being
+ * suspected. Any new arrival clears suspicion. Suspected peers get a small
+ * probe frame with exponential backoff (FD_PROBE_MIN_MS to FD_PROBE_MAX_MS),
+ * since they receive no audio that could be acked. The gap that ends a
+ * suspicion is left out of the window: it measures our probing, not the
+ * peer's traffic. fd_sim.py measures
+ * detection time and false suspicions under random and bursty loss.
+ *
+ * Peers are keyed by MAC, at most FD_MAX_PEERS. Portable C++ with no
+ * locking: the coordinator serialises calls with a spinlock, because
+ * arrivals come from the Wi-Fi task's send callback. It computes phi (expf,
+ * log1pf) outside that lock via fdCandidate/fdSuspect.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define FD_MAX_PEERS     32
+#define FD_WINDOW        32     // inter-arrival samples kept per peer
+#define FD_MIN_SAMPLES   4      // below this, assume FD_BOOTSTRAP_MS
+#define FD_BOOTSTRAP_MS  1000
+#define FD_MIN_STD_MS    20
+#define FD_PAUSE_MS      100    // tolerated extra delay on top of the mean
+#define FD_PHI_SUSPECT   8
+#define FD_MIN_FAILURES  2
+#define FD_TICK_MS       25     // housekeeping timer that re-evaluates
+#define FD_PROBE_MIN_MS  50
+#define FD_PROBE_MAX_MS  1000
+
+#define FD_PROBE_SIZE    4      // 'M','P', version, seq
+
+struct FdPeer {
+  bool used;
+  bool suspected;
+  uint8_t mac[6];
+  uint8_t next;                  // ring position
+  uint8_t samples;
+  uint16_t failStreak;           // sends failed since lastMs
+  uint16_t intervals[FD_WINDOW]; // ms, capped at 65535
+  uint32_t sum;
+  uint64_t sumSq;                // ms^2
+  uint32_t lastMs;               // last arrival
+  uint32_t suspectedAtMs;
+  uint32_t probeAtMs;
+  uint16_t probeGapMs;
+  uint32_t suspicions;
+};
+
+struct FailureDetector {
+  FdPeer peers[FD_MAX_PEERS];
+  uint32_t arrivals;
+  uint32_t failures;
+  uint32_t suspicions;
+  uint32_t recoveries;
+  uint32_t probes;
+  uint32_t lastDetectMs;         // last suspicion: time from the last arrival
+};
+
+void fdReset(FailureDetector& fd);
+
+// Start watching mac, as if it had just been heard
+void fdTrack(FailureDetector& fd, const uint8_t* mac, uint32_t nowMs);
+void fdForget(FailureDetector& fd, const uint8_t* mac);
+
+// A frame from mac or an acked send to it. Returns true if that cleared a
+// suspicion. Untracked MACs (broadcast, strangers) are ignored.
+bool fdHeard(FailureDetector& fd, const uint8_t* mac, uint32_t nowMs);
+void fdSendFailed(FailureDetector& fd, const uint8_t* mac);
+
+float fdPhi(const FdPeer& p, uint32_t nowMs);
+
+// Re-evaluate every peer; returns how many became suspected
+int fdUpdate(FailureDetector& fd, uint32_t nowMs);
+
+// fdUpdate in steps, so a caller holding a spinlock can evaluate phi
+// outside it: fdCandidate copies slot when it may become suspected, and
+// fdSuspect marks it unless it was heard since (lastMs changed)
+bool fdCandidate(const FailureDetector& fd, int slot, FdPeer& out);
+bool fdSuspect(FailureDetector& fd, int slot, uint32_t lastMs, uint32_t nowMs);
+
+bool fdIsSuspected(const FailureDetector& fd, const uint8_t* mac);
+
+// Suspected peers whose next probe is due, copied to macs. Schedules the
+// following probe with a doubled gap.
+int fdProbesDue(FailureDetector& fd, uint32_t nowMs, uint8_t (*macs)[6], int max);
+
+static inline int fdEncodeProbe(uint8_t seq, uint8_t* out) {
+  out[0] = 'M';
+  out[1] = 'P';
+  out[2] = 1;
+  out[3] = seq;
+  return FD_PROBE_SIZE;
+}
+
+static inline bool fdIsProbe(const uint8_t* buf, int len) {
+  return len == FD_PROBE_SIZE && buf[0] == 'M' && buf[1] == 'P';
+}
@@ -0,0 +1,41 @@
+/*
+ * Versioned fan-out set - see FanoutSet.h
+ */
+
+#include "FanoutSet.h"
+
+#include <string.h>
+
+void fanoutInit(FanoutSet& set) {
+  memset(&set, 0, sizeof(set));
+  set.building = FANOUT_BUFFERS;  // none
+}
+
+FanoutSnapshot* fanoutBeginWrite(FanoutSet& set) {
+  uint8_t current = __atomic_load_n(&set.current, __ATOMIC_RELAXED);  // only the writer stores it
+  for (uint8_t i = 0; i < FANOUT_BUFFERS; i++) {
+    if (i == current) continue;
+    // A non-zero count may also be a reader that is about to retry; skip it anyway
+    if (__atomic_load_n(&set.readers[i], __ATOMIC_SEQ_CST) != 0) continue;
+    set.building = i;
+    FanoutSnapshot& snap = set.buffers[i];
+    snap.count = 0;
+    memset(snap.groups, 0, sizeof(snap.groups));
+    return &snap;
+  }
+  set.building = FANOUT_BUFFERS;
+  set.publishStalls++;
+  return nullptr;
+}
+
+uint32_t fanoutPublish(FanoutSet& set) {
+  if (set.building >= FANOUT_BUFFERS) return set.version;
+  FanoutSnapshot& snap = set.buffers[set.building];
+  if (snap.count > FANOUT_MAX_PEERS) snap.count = FANOUT_MAX_PEERS;
+  for (int g = 0; g < FANOUT_MAX_GROUPS; g++) snap.groups[g] &= (uint8_t)((1u << snap.count) - 1);
+  snap.version = ++set.version;
+  __atomic_store_n(&set.current, set.building, __ATOMIC_SEQ_CST);
+  set.building = FANOUT_BUFFERS;
+  set.publishes++;
+  return snap.version;
+}
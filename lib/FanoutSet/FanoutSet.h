@@ -0,0 +1,95 @@
+/*
+ * Versioned, immutable fan-out set (who the audio senders transmit to)
+ *
+ * The control path (join, ready, timeout, remove) builds a new snapshot
+ * and publishes it with one atomic store; senders acquire the current
+ * snapshot, iterate it and release it without taking any lock. A snapshot
+ * is never modified after publication.
+ *
+ * Besides the peer list a snapshot carries one bitmask per talk group over
+ * its own peer indices, so a sender addressing one group walks
+ *   for (bits = snap->groups[g]; bits; bits &= bits - 1) snap->peers[ctz(bits)]
+ * and the peers and their groups always come from the same version.
+ *
+ * Snapshots live in a fixed pool of FANOUT_BUFFERS with one reader count
+ * each. A reader bumps the count of the buffer it loaded and re-checks that
+ * the buffer is still current; the writer only refills a buffer that is not
+ * current and whose count is zero, so a buffer is reclaimed as soon as its
+ * last reader has released it. Nothing is allocated.
+ *
+ * One writer at a time: callers serialise fanoutBeginWrite/fanoutPublish
+ * (the coordinator does so under its mesh table mutex). Any number of
+ * readers on either core. Portable C++ with __atomic builtins, so the same
+ * code runs on the host: test/test_fanout_stress drives one writer and four
+ * reader threads under ThreadSanitizer (pio test -e native_tsan), and the
+ * console fanout_stress does the same across both cores.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define FANOUT_MAX_PEERS 8
+#define FANOUT_NAME_LEN  24
+#define FANOUT_BUFFERS   4  // current + one being built + readers still on older ones
+#define FANOUT_MAX_GROUPS 4
+
+static_assert(FANOUT_MAX_PEERS <= 8, "group masks hold one bit per snapshot peer");
+
+struct FanoutPeer {
+  uint8_t mac[6];
+  char name[FANOUT_NAME_LEN];  // for logs only, truncated
+};
+
+struct FanoutSnapshot {
+  uint32_t version;
+  uint8_t count;
+  uint8_t groups[FANOUT_MAX_GROUPS];  // bit i: peers[i] listens to the group
+  FanoutPeer peers[FANOUT_MAX_PEERS];
+};
+
+struct FanoutSet {
+  FanoutSnapshot buffers[FANOUT_BUFFERS];
+  uint32_t readers[FANOUT_BUFFERS];
+  uint8_t current;
+  uint8_t building;      // buffer handed out by fanoutBeginWrite, writer only
+  uint32_t version;      // last published, writer only
+  // Counters
+  uint32_t publishes;
+  uint32_t publishStalls;  // every spare buffer still pinned by a reader
+  uint32_t readerRetries;  // reader lost a race with a publish
+};
+
+// Start with an empty snapshot at version 0
+void fanoutInit(FanoutSet& set);
+
+// Writer: get a reclaimed buffer to fill, or nullptr if every spare buffer
+// is still held by readers (try again later)
+FanoutSnapshot* fanoutBeginWrite(FanoutSet& set);
+
+// Writer: publish the buffer from fanoutBeginWrite, returns the new version
+uint32_t fanoutPublish(FanoutSet& set);
+
+// Reader: pin the current snapshot; never blocks, never returns nullptr
+static inline const FanoutSnapshot* fanoutAcquire(FanoutSet& set) {
+  for (;;) {
+    uint8_t idx = __atomic_load_n(&set.current, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&set.readers[idx], 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&set.current, __ATOMIC_SEQ_CST) == idx) return &set.buffers[idx];
+    __atomic_sub_fetch(&set.readers[idx], 1, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&set.readerRetries, 1, __ATOMIC_RELAXED);
+  }
+}
+
+// Reader: unpin; the snapshot must not be touched afterwards
+static inline void fanoutRelease(FanoutSet& set, const FanoutSnapshot* snap) {
+  __atomic_sub_fetch(&set.readers[snap - set.buffers], 1, __ATOMIC_RELEASE);
+}
+
+// Peer count of the current snapshot
+static inline uint8_t fanoutCount(FanoutSet& set) {
+  const FanoutSnapshot* snap = fanoutAcquire(set);
+  uint8_t count = snap->count;
+  fanoutRelease(set, snap);
+  return count;
+}
@@ -0,0 +1,36 @@
+/*
+ * G.711 u-law helpers shared by both firmwares
+ *
+ * Header-only so the per-sample calls inline into the audio loops.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define G711_ULAW_BIAS 0x84
+#define G711_ULAW_CLIP 32635
+
+// 8-bit u-law code to 16-bit linear PCM
+static inline int16_t g711UlawToLinear(uint8_t ulaw) {
+  ulaw = ~ulaw;
+  int32_t t = ((ulaw & 0x0F) << 3) + G711_ULAW_BIAS;
+  t <<= (ulaw & 0x70) >> 4;
+  return (int16_t)((ulaw & 0x80) ? (G711_ULAW_BIAS - t) : (t - G711_ULAW_BIAS));
+}
+
+// 16-bit linear PCM to 8-bit u-law code
+static inline uint8_t g711LinearToUlaw(int16_t pcm) {
+  int32_t x = pcm;
+  uint8_t mask = 0xFF;
+  if (x < 0) {
+    x = -x;
+    mask = 0x7F;
+  }
+  if (x > G711_ULAW_CLIP) x = G711_ULAW_CLIP;
+  x += G711_ULAW_BIAS;
+  int seg = 7;
+  for (int32_t probe = 0x4000; seg > 0 && !(x & probe); probe >>= 1) seg--;
+  uint8_t code = (uint8_t)((seg << 4) | ((x >> (seg + 3)) & 0x0F));
+  return code ^ mask;
+}
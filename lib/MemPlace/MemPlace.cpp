@@ -0,0 +1,153 @@
+/*
+ * Memory placement policy - see MemPlace.h
+ */
+
+#include "MemPlace.h"
+
+#include <esp_heap_caps.h>
+#include <soc/soc.h>
+
+#define MEM_CAPS_FAST (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+#define MEM_CAPS_BULK (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+
+struct MemPlaceEntry {
+  const char* name;
+  const void* ptr;
+  uint32_t bytes;
+  uint8_t region;     // MemRegion asked for
+  bool allocated;     // memPlaceAlloc (vs a registered static)
+};
+
+static MemPlaceEntry entries[MEM_PLACE_MAX_ENTRIES];
+static int entryCount = 0;
+
+static void record(MemRegion region, const void* ptr, size_t bytes, const char* name, bool allocated) {
+  if (entryCount >= MEM_PLACE_MAX_ENTRIES) return;
+  entries[entryCount++] = { name, ptr, (uint32_t)bytes, (uint8_t)region, allocated };
+}
+
+bool memPlaceIsExternal(const void* ptr) {
+  uintptr_t p = (uintptr_t)ptr;
+  return p >= SOC_EXTRAM_DATA_LOW && p < SOC_EXTRAM_DATA_HIGH;
+}
+
+bool memPlaceHasPsram() {
+  return heap_caps_get_total_size(MALLOC_CAP_SPIRAM) > 0;
+}
+
+void* memPlaceAlloc(MemRegion region, size_t bytes, const char* name) {
+  void* p = nullptr;
+  if (region == MEM_BULK) p = heap_caps_calloc(1, bytes, MEM_CAPS_BULK);
+  if (!p) p = heap_caps_calloc(1, bytes, MEM_CAPS_FAST);
+  if (p) {
+    record(region, p, bytes, name, true);
+  } else {
+    Serial.printf("❌ memPlace: no room for %s (%u bytes)\n", name, (unsigned)bytes);
+  }
+  return p;
+}
+
+void memPlaceRegister(MemRegion region, const void* ptr, size_t bytes, const char* name) {
+  record(region, ptr, bytes, name, false);
+}
+
+void memPlacePrintMap() {
+  Serial.println("=== MEMORY MAP ===");
+  Serial.printf("Internal: %u KB total, %u KB free, %u KB min free, largest block %u KB\n",
+                (unsigned)(heap_caps_get_total_size(MEM_CAPS_FAST) / 1024),
+                (unsigned)(heap_caps_get_free_size(MEM_CAPS_FAST) / 1024),
+                (unsigned)(heap_caps_get_minimum_free_size(MEM_CAPS_FAST) / 1024),
+                (unsigned)(heap_caps_get_largest_free_block(MEM_CAPS_FAST) / 1024));
+  if (memPlaceHasPsram()) {
+    Serial.printf("PSRAM:    %u KB total, %u KB free, largest block %u KB\n",
+                  (unsigned)(heap_caps_get_total_size(MEM_CAPS_BULK) / 1024),
+                  (unsigned)(heap_caps_get_free_size(MEM_CAPS_BULK) / 1024),
+                  (unsigned)(heap_caps_get_largest_free_block(MEM_CAPS_BULK) / 1024));
+  } else {
+    Serial.println("PSRAM:    not available (bulk buffers fall back to internal)");
+  }
+  uint32_t internalBytes = 0;
+  uint32_t psramBytes = 0;
+  for (int i = 0; i < entryCount; i++) {
+    const MemPlaceEntry& e = entries[i];
+    bool external = memPlaceIsExternal(e.ptr);
+    if (external) psramBytes += e.bytes; else internalBytes += e.bytes;
+    Serial.printf("  %-14s %6lu B  %-6s %-4s -> %-8s %p%s\n", e.name, (unsigned long)e.bytes,
+                  e.allocated ? "alloc" : "static", e.region == MEM_BULK ? "bulk" : "fast",
+                  external ? "PSRAM" : "internal", e.ptr,
+                  e.region == MEM_BULK && !external ? " (fallback)" : "");
+  }
+  Serial.printf("Placed: %lu B internal, %lu B PSRAM\n", (unsigned long)internalBytes, (unsigned long)psramBytes);
+}
+
+// Access cost per region: sequential 32-bit write and read (cycles/KB),
+// dependent random reads (cycles/access) and a 512 B slot memcpy, the
+// unit of work of the notify and BLE ingest rings. The PSRAM buffer is
+// larger than the data cache so random reads see real PSRAM latency.
+#define MEM_BENCH_FAST_BYTES (32 * 1024)
+#define MEM_BENCH_BULK_BYTES (256 * 1024)
+#define MEM_BENCH_PASSES 4
+static volatile uint32_t benchSink;  // keeps the reads from being optimised out
+
+static void benchRegion(const char* label, uint8_t* buf, size_t bytes) {
+  volatile uint32_t* words = (volatile uint32_t*)buf;
+  size_t count = bytes / 4;
+  uint32_t sink = 0;
+
+  uint32_t start = ESP.getCycleCount();
+  for (int pass = 0; pass < MEM_BENCH_PASSES; pass++) {
+    for (size_t i = 0; i < count; i++) words[i] = (uint32_t)i;
+  }
+  uint32_t writeCycles = ESP.getCycleCount() - start;
+
+  start = ESP.getCycleCount();
+  for (int pass = 0; pass < MEM_BENCH_PASSES; pass++) {
+    for (size_t i = 0; i < count; i++) sink += words[i];
+  }
+  uint32_t readCycles = ESP.getCycleCount() - start;
+
+  // Each index depends on the previous load (LCG over the buffer)
+  const int randomReads = 16384;
+  uint32_t index = 1;
+  start = ESP.getCycleCount();
+  for (int i = 0; i < randomReads; i++) {
+    index = (index * 1664525u + 1013904223u + words[index % count]) % count;
+  }
+  uint32_t randomCycles = ESP.getCycleCount() - start;
+  sink += index;
+
+  const int copies = 256;
+  size_t slots = bytes / 512;
+  uint8_t out[512];
+  start = ESP.getCycleCount();
+  for (int i = 0; i < copies; i++) {
+    memcpy(out, buf + (size_t)((i * 7) % slots) * 512, sizeof(out));
+    sink += out[i & 511];
+  }
+  uint32_t copyCycles = ESP.getCycleCount() - start;
+
+  uint32_t kb = (uint32_t)(bytes / 1024) * MEM_BENCH_PASSES;
+  benchSink = sink;
+  Serial.printf("  %-8s %4u KB: write %5lu cyc/KB, read %5lu cyc/KB, random read %3lu cyc, 512B copy %5lu cyc\n",
+                label, (unsigned)(bytes / 1024), (unsigned long)(writeCycles / kb),
+                (unsigned long)(readCycles / kb), (unsigned long)(randomCycles / randomReads),
+                (unsigned long)(copyCycles / copies));
+}
+
+void memPlaceBench() {
+  Serial.printf("=== MEMORY ACCESS BENCH (%lu MHz) ===\n", (unsigned long)ESP.getCpuFreqMHz());
+  uint8_t* fast = (uint8_t*)heap_caps_malloc(MEM_BENCH_FAST_BYTES, MEM_CAPS_FAST);
+  if (fast) {
+    benchRegion("internal", fast, MEM_BENCH_FAST_BYTES);
+    heap_caps_free(fast);
+  } else {
+    Serial.println("  internal: not enough free memory for the bench buffer");
+  }
+  uint8_t* bulk = memPlaceHasPsram() ? (uint8_t*)heap_caps_malloc(MEM_BENCH_BULK_BYTES, MEM_CAPS_BULK) : nullptr;
+  if (bulk) {
+    benchRegion("psram", bulk, MEM_BENCH_BULK_BYTES);
+    heap_caps_free(bulk);
+  } else {
+    Serial.println("  psram: not available");
+  }
+}
@@ -0,0 +1,54 @@
+/*
+ * Memory placement policy for large buffers (both firmwares)
+ *
+ * Two regions:
+ *   MEM_FAST - internal SRAM. Small rings and scratch buffers the audio
+ *              path touches every cycle (memmove, reassembly), and anything
+ *              used while the flash cache is off.
+ *   MEM_BULK - OPI PSRAM when present, else internal SRAM. Large jitter and
+ *              history buffers that are written once and read once per
+ *              packet, where the cache hides most of the PSRAM latency.
+ *
+ * Statics use the matching attribute (MEM_FAST_ATTR / MEM_BULK_ATTR). The
+ * Arduino SDK usually does not allow .bss in PSRAM, so MEM_BULK_ATTR
+ * then expands to nothing. Large bulk buffers are therefore pointers
+ * filled by memPlaceAlloc() in setup. That way nothing is allocated on the
+ * streaming path and the steady state stays allocation-free (alloc_check).
+ *
+ * Every placed buffer is recorded. mem_map (also printed at boot) shows
+ * where each one actually landed, and bench_mem measures the access cost
+ * of each region.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <esp_attr.h>
+#include <sdkconfig.h>
+
+#define MEM_PLACE_MAX_ENTRIES 16
+
+enum MemRegion { MEM_FAST, MEM_BULK };
+
+// Internal .bss is already in DRAM on the S3. DRAM_ATTR would move a zeroed
+// buffer into initialised .dram1 data (flash image and boot copy), so the
+// attribute only marks the choice.
+#define MEM_FAST_ATTR
+#if defined(CONFIG_SPIRAM_ALLOW_BSS_SEG_EXTERNAL_MEMORY) && defined(EXT_RAM_BSS_ATTR)
+#define MEM_BULK_ATTR EXT_RAM_BSS_ATTR
+#else
+#define MEM_BULK_ATTR
+#endif
+
+// Zeroed buffer in the region (bulk falls back to internal); nullptr if
+// neither has room. Boot-time only: never call from the streaming path.
+void* memPlaceAlloc(MemRegion region, size_t bytes, const char* name);
+
+// Record a static buffer so it shows in the memory map
+void memPlaceRegister(MemRegion region, const void* ptr, size_t bytes, const char* name);
+
+bool memPlaceIsExternal(const void* ptr);
+bool memPlaceHasPsram();
+
+void memPlacePrintMap();
+void memPlaceBench();
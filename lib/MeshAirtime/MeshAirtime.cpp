@@ -0,0 +1,73 @@
+/*
+ * ESP-NOW transmit accounting - see MeshAirtime.h
+ */
+
+#include "MeshAirtime.h"
+
+#include <string.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+struct AirtimeCounters {
+  uint32_t frames;
+  uint32_t bytes;
+  uint64_t airtimeUs;
+};
+
+// Plain counters: meshSend runs on several tasks and a lost increment
+// only skews a statistic
+static AirtimeCounters counters[AIRTIME_CLASS_COUNT];
+static uint32_t lastSendMs[AIRTIME_CLASS_COUNT];
+static bool sent[AIRTIME_CLASS_COUNT];
+static uint32_t windowStartMs;
+
+static const char* const kClassNames[AIRTIME_CLASS_COUNT] = { "audio", "control", "beacon" };
+
+void airtimeNoteSend(const uint8_t* mac, const uint8_t* data, size_t len, uint32_t nowMs) {
+  AirtimeClass c = airtimeClassify(data, len);
+  bool broadcast = mac[0] == 0xFF && mac[1] == 0xFF && mac[2] == 0xFF &&
+                   mac[3] == 0xFF && mac[4] == 0xFF && mac[5] == 0xFF;
+  counters[c].frames++;
+  counters[c].bytes += len;
+  counters[c].airtimeUs += airtimeFrameUs(len, broadcast);
+  lastSendMs[c] = nowMs;
+  sent[c] = true;
+}
+
+uint32_t airtimeIdleMs(AirtimeClass c, uint32_t nowMs) {
+  return sent[c] ? nowMs - lastSendMs[c] : UINT32_MAX;
+}
+
+uint32_t airtimeIdleMsAny(uint32_t nowMs) {
+  uint32_t idle = UINT32_MAX;
+  for (int c = 0; c < AIRTIME_CLASS_COUNT; c++) {
+    uint32_t i = airtimeIdleMs((AirtimeClass)c, nowMs);
+    if (i < idle) idle = i;
+  }
+  return idle;
+}
+
+void airtimeReset() {
+  memset(counters, 0, sizeof(counters));
+#ifdef ARDUINO
+  windowStartMs = millis();
+#endif
+}
+
+#ifdef ARDUINO
+void airtimePrintStats() {
+  uint32_t windowMs = millis() - windowStartMs;
+  if (windowMs == 0) windowMs = 1;
+  Serial.printf("=== AIRTIME (TX estimate at 1 Mbps, %lu ms window) ===\n", (unsigned long)windowMs);
+  uint64_t totalUs = 0;
+  for (int c = 0; c < AIRTIME_CLASS_COUNT; c++) totalUs += counters[c].airtimeUs;
+  for (int c = 0; c < AIRTIME_CLASS_COUNT; c++) {
+    const AirtimeCounters& k = counters[c];
+    Serial.printf("  %-8s %8lu frames %9lu B %9lu us  %5.2f%% of air  %5.1f%% of TX\n", kClassNames[c],
+                  (unsigned long)k.frames, (unsigned long)k.bytes, (unsigned long)k.airtimeUs,
+                  k.airtimeUs / (windowMs * 10.0), totalUs ? k.airtimeUs * 100.0 / totalUs : 0.0);
+  }
+}
+#endif
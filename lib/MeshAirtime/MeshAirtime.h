@@ -0,0 +1,62 @@
+/*
+ * ESP-NOW transmit accounting by traffic class (both firmwares)
+ *
+ * Every meshSend notes its frame here. Frames are classed by their first
+ * bytes: 'W','M' is audio, 'M','B' a beacon, and anything else (JSON,
+ * resync) is control. Airtime is estimated for ESP-NOW's default 1 Mbps
+ * DSSS rate:
+ *
+ *   PLCP 192 us + (43 B of 802.11 header, FCS and vendor element + payload) * 8 us
+ *   + DIFS, and for unicast SIFS + ACK
+ *
+ * That ignores contention backoff and retries, so the numbers are a lower
+ * bound. They are still a fair way to compare classes. airtime_stats prints
+ * frames, bytes and estimated airtime per class since boot or airtime_reset.
+ *
+ * The last send time per class also drives heartbeat suppression: a peer
+ * that was sent audio recently needs no separate heartbeat.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MESH_PLCP_US            192  // long preamble + PLCP header at 1 Mbps
+#define MESH_FRAME_OVERHEAD     43   // MAC header 24 + FCS 4 + ESP-NOW vendor element 15
+#define MESH_US_PER_BYTE        8    // 1 Mbps
+#define MESH_DIFS_US            50
+#define MESH_ACK_US             (10 + MESH_PLCP_US + 14 * MESH_US_PER_BYTE)  // SIFS + ACK, unicast only
+
+enum AirtimeClass : uint8_t {
+  AIRTIME_AUDIO,
+  AIRTIME_CONTROL,
+  AIRTIME_BEACON,
+  AIRTIME_CLASS_COUNT,
+};
+
+static inline AirtimeClass airtimeClassify(const uint8_t* data, size_t len) {
+  if (len >= 2 && data[0] == 'W' && data[1] == 'M') return AIRTIME_AUDIO;
+  if (len >= 2 && data[0] == 'M' && data[1] == 'B') return AIRTIME_BEACON;
+  return AIRTIME_CONTROL;
+}
+
+static inline uint32_t airtimeFrameUs(size_t len, bool broadcast) {
+  uint32_t us = MESH_DIFS_US + MESH_PLCP_US + (uint32_t)(MESH_FRAME_OVERHEAD + len) * MESH_US_PER_BYTE;
+  return broadcast ? us : us + MESH_ACK_US;
+}
+
+// Called by meshSend for every frame handed to esp_now_send
+void airtimeNoteSend(const uint8_t* mac, const uint8_t* data, size_t len, uint32_t nowMs);
+
+// Milliseconds since the last frame of class c, or UINT32_MAX if none yet
+uint32_t airtimeIdleMs(AirtimeClass c, uint32_t nowMs);
+
+// Milliseconds since the last frame of any class, or UINT32_MAX
+uint32_t airtimeIdleMsAny(uint32_t nowMs);
+
+void airtimeReset();
+
+#ifdef ARDUINO
+void airtimePrintStats();  // airtime_stats
+#endif
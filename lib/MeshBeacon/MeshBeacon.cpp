@@ -0,0 +1,58 @@
+/*
+ * Coordinator discovery beacon - see MeshBeacon.h
+ */
+
+#include "MeshBeacon.h"
+
+#include <string.h>
+
+void beaconScanReset(BeaconScan& scan) {
+  memset(&scan, 0, sizeof(scan));
+}
+
+int beaconScanUpdate(BeaconScan& scan, const uint8_t* mac, const MeshBeacon& b, uint32_t nowMs) {
+  if (b.networkId != MESH_NETWORK_ID) {
+    scan.foreign++;
+    return -1;
+  }
+  scan.heard++;
+  int slot = -1;
+  for (int i = 0; i < scan.count; i++) {
+    if (memcmp(scan.candidates[i].mac, mac, 6) == 0) {
+      slot = i;
+      break;
+    }
+  }
+  if (slot < 0 && scan.count < MESH_BEACON_CANDIDATES) {
+    slot = scan.count++;
+  } else if (slot < 0) {
+    slot = 0;
+    for (int i = 1; i < scan.count; i++) {
+      if (nowMs - scan.candidates[i].heardMs > nowMs - scan.candidates[slot].heardMs) slot = i;
+    }
+  }
+  BeaconCandidate& c = scan.candidates[slot];
+  memcpy(c.mac, mac, 6);
+  c.beacon = b;
+  c.heardMs = nowMs;
+  return slot;
+}
+
+// a < b when a is the less loaded coordinator
+static bool lessLoaded(const BeaconCandidate& a, const BeaconCandidate& b) {
+  uint32_t loadA = (uint32_t)a.beacon.peers * b.beacon.capacity;
+  uint32_t loadB = (uint32_t)b.beacon.peers * a.beacon.capacity;
+  if (loadA != loadB) return loadA < loadB;
+  return memcmp(a.mac, b.mac, 6) < 0;
+}
+
+int beaconScanBest(const BeaconScan& scan, uint32_t nowMs, uint32_t maxAgeMs) {
+  int best = -1;
+  for (int i = 0; i < scan.count; i++) {
+    const BeaconCandidate& c = scan.candidates[i];
+    if (nowMs - c.heardMs > maxAgeMs) continue;
+    if (c.beacon.peers >= c.beacon.capacity) continue;
+    if (best < 0 || lessLoaded(c, scan.candidates[best])) best = i;
+  }
+  return best;
+}
@@ -0,0 +1,123 @@
+/*
+ * Coordinator discovery beacon shared by both firmwares
+ *
+ * The leading coordinator broadcasts an 18-byte beacon to FF:FF:FF:FF:FF:FF
+ * when it takes the lead and then every MESH_BEACON_INTERVAL_MS. Receivers
+ * need no peer entry for broadcasts:
+ *
+ *   'M','B', version, flags, networkId(le16), epoch(le32), seq(le16),
+ *   peers, capacity, intervalMs(le16), priority, leaseBeacons
+ *
+ * Every beacon renews the sender's leadership lease for leaseBeacons
+ * intervals. Standby coordinators (lib/MeshElection) and joined clients
+ * presume the leader gone once a lease passes without one.
+ *
+ * A client that is not joined sends mesh_join to the best coordinator it
+ * heard during the last interval (beaconScanBest) as soon as a beacon
+ * arrives, so it needs neither a list of coordinator MACs nor probe
+ * retries. A join that is not acked within MESH_JOIN_TIMEOUT_MS is retried
+ * on a later beacon. The epoch names a coordinator session. It is kept
+ * across restarts that restore the peer table from NVS (lib/MeshState) and
+ * is new otherwise. A joined client that sees a new epoch from its
+ * coordinator knows it is no longer in the peer table and rejoins.
+ *
+ * Parsing is header-only so it inlines into the ESP-NOW receive callback.
+ * The candidate table is portable C++, so it also builds for the host.
+ * join_sim.py models the time-to-join against the old probe loop.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define MESH_BEACON_SIZE        18
+#define MESH_BEACON_VERSION     2
+#define MESH_BEACON_INTERVAL_MS 50    // coordinator broadcast period, ~0.3 ms of airtime each
+#define MESH_JOIN_TIMEOUT_MS    150   // unacked mesh_join, retry on the next beacon
+#define MESH_BEACON_CANDIDATES  4     // coordinators remembered while scanning
+#define MESH_LEASE_BEACONS      5     // missed beacons before the leader is presumed gone
+
+#ifndef MESH_NETWORK_ID
+#define MESH_NETWORK_ID 0x4D31  // override with -DMESH_NETWORK_ID=<n> to run meshes side by side
+#endif
+
+// Beacon flags
+#define MESH_BEACON_FLAG_PHONE 0x01  // a phone is connected over BLE
+
+struct MeshBeacon {
+  uint8_t flags;
+  uint8_t peers;        // joined clients
+  uint8_t capacity;     // MAX_MESH_DEVICES
+  uint16_t networkId;
+  uint16_t seq;
+  uint16_t intervalMs;
+  uint32_t epoch;       // random per session, never 0
+  uint8_t priority;     // election rank of the sender, 0-15
+  uint8_t leaseBeacons; // lease length in beacon intervals
+};
+
+static inline uint32_t meshBeaconLeaseMs(const MeshBeacon& b) {
+  return (uint32_t)b.leaseBeacons * b.intervalMs;
+}
+
+static inline int meshBeaconEncode(const MeshBeacon& b, uint8_t* out) {
+  out[0] = 'M';
+  out[1] = 'B';
+  out[2] = MESH_BEACON_VERSION;
+  out[3] = b.flags;
+  out[4] = (uint8_t)b.networkId;
+  out[5] = (uint8_t)(b.networkId >> 8);
+  out[6] = (uint8_t)b.epoch;
+  out[7] = (uint8_t)(b.epoch >> 8);
+  out[8] = (uint8_t)(b.epoch >> 16);
+  out[9] = (uint8_t)(b.epoch >> 24);
+  out[10] = (uint8_t)b.seq;
+  out[11] = (uint8_t)(b.seq >> 8);
+  out[12] = b.peers;
+  out[13] = b.capacity;
+  out[14] = (uint8_t)b.intervalMs;
+  out[15] = (uint8_t)(b.intervalMs >> 8);
+  out[16] = b.priority;
+  out[17] = b.leaseBeacons;
+  return MESH_BEACON_SIZE;
+}
+
+// True if buf is a beacon this firmware understands (any network ID)
+static inline bool meshBeaconParse(const uint8_t* buf, int len, MeshBeacon& out) {
+  if (len != MESH_BEACON_SIZE || buf[0] != 'M' || buf[1] != 'B' || buf[2] != MESH_BEACON_VERSION) return false;
+  out.flags = buf[3];
+  out.networkId = (uint16_t)(buf[4] | (buf[5] << 8));
+  out.epoch = (uint32_t)buf[6] | ((uint32_t)buf[7] << 8) | ((uint32_t)buf[8] << 16) | ((uint32_t)buf[9] << 24);
+  out.seq = (uint16_t)(buf[10] | (buf[11] << 8));
+  out.peers = buf[12];
+  out.capacity = buf[13];
+  out.intervalMs = (uint16_t)(buf[14] | (buf[15] << 8));
+  out.priority = buf[16];
+  out.leaseBeacons = buf[17];
+  return true;
+}
+
+// Coordinators heard while scanning, one entry per MAC
+struct BeaconCandidate {
+  uint8_t mac[6];
+  MeshBeacon beacon;
+  uint32_t heardMs;
+};
+
+struct BeaconScan {
+  BeaconCandidate candidates[MESH_BEACON_CANDIDATES];
+  uint8_t count;
+  uint32_t heard;       // beacons accepted
+  uint32_t foreign;     // beacons from another network ID
+};
+
+void beaconScanReset(BeaconScan& scan);
+
+// Record a beacon from mac. Returns its candidate index, or -1 if it was
+// for another network. When the table is full the stalest entry is replaced.
+int beaconScanUpdate(BeaconScan& scan, const uint8_t* mac, const MeshBeacon& b, uint32_t nowMs);
+
+// Best coordinator with a free slot heard within maxAgeMs, or -1: the
+// lowest peers/capacity, then the lower MAC so every client breaks ties
+// the same way
+int beaconScanBest(const BeaconScan& scan, uint32_t nowMs, uint32_t maxAgeMs);
@@ -0,0 +1,151 @@
+/*
+ * Mesh channel selection - see MeshChannel.h
+ */
+
+#include "MeshChannel.h"
+
+#include <string.h>
+
+// Legacy (11b/g) rate codes as the radio reports them, in 100 kbps units
+static const uint16_t kLegacyRate[16] = {10, 20, 55, 110, 10, 20, 55, 110,
+                                         480, 240, 120, 60, 540, 360, 180, 90};
+// HT MCS 0-7 at 20 MHz, long guard interval, in 100 kbps units
+static const uint16_t kHtRate[8] = {65, 130, 195, 260, 390, 520, 585, 650};
+
+static float ewma(float avg, float sample, bool first) {
+  return first ? sample : avg + (sample - avg) * (CHAN_EWMA_PCT / 100.0f);
+}
+
+void chanPlanInit(ChannelPlan& p, uint16_t mask, uint8_t current, uint32_t nowMs) {
+  memset(&p, 0, sizeof(p));
+  p.mask = mask;
+  p.current = current;
+  p.lastSurveyed = current;
+  p.sinceMs = nowMs - CHAN_HOLD_MS;
+  for (int c = 0; c <= CHAN_MAX; c++) p.ch[c].noiseDbm = CHAN_NOISE_REF_DBM;
+}
+
+uint8_t chanNextSurvey(ChannelPlan& p) {
+  p.lastSurveyed = chanNextScan(p.mask, p.lastSurveyed);
+  return p.lastSurveyed;
+}
+
+uint32_t chanFrameUs(uint8_t sigMode, uint8_t rate, uint8_t mcs, uint16_t len) {
+  uint32_t preambleUs, rate100k;
+  if (sigMode == 0) {
+    rate100k = kLegacyRate[rate & 0x0F];
+    preambleUs = (rate & 0x0F) < 4 ? 192 : (rate & 0x0F) < 8 ? 96 : 20;  // DSSS long, short, OFDM
+  } else {
+    rate100k = kHtRate[mcs & 0x07] * (1 + (mcs >> 3));  // spatial streams
+    preambleUs = 36;
+  }
+  return preambleUs + ((uint32_t)len * 8 + 22) * 10 / rate100k;
+}
+
+void chanSampleFrame(ChannelSample& s, uint8_t sigMode, uint8_t rate, uint8_t mcs, uint16_t len, int8_t noiseFloor) {
+  s.busyUs += chanFrameUs(sigMode, rate, mcs, len);
+  if (s.frames < 0xFFFF) s.frames++;
+  if (noiseFloor < 0 && s.noiseCount < 0xFFFF) {
+    s.noiseSum += noiseFloor;
+    s.noiseCount++;
+  }
+}
+
+bool chanIsEspNow(const uint8_t* frame, int len) {
+  // Action frame, 24-byte header, category 127 (vendor specific), OUI 18:FE:34
+  return len >= 28 && (frame[0] & 0xFC) == 0xD0 && frame[24] == 127 &&
+         frame[25] == 0x18 && frame[26] == 0xFE && frame[27] == 0x34;
+}
+
+void chanRecordSurvey(ChannelPlan& p, uint8_t channel, const ChannelSample& s) {
+  if (!chanValid(p.mask, channel) || s.dwellUs == 0) return;
+  ChannelStats& c = p.ch[channel];
+  bool first = c.surveys == 0;
+  float busy = (float)s.busyUs / s.dwellUs;
+  if (busy > 1) busy = 1;
+  c.lastBusy = busy;
+  c.busy = ewma(c.busy, busy, first);
+  if (s.noiseCount) c.noiseDbm = ewma(c.noiseDbm, (float)s.noiseSum / s.noiseCount, first);
+  c.frames += s.frames;
+  if (c.surveys < 0xFFFF) c.surveys++;
+  p.surveys++;
+}
+
+void chanRecordSends(ChannelPlan& p, uint32_t sent, uint32_t failed) {
+  if (sent < CHAN_MIN_SENDS) return;
+  ChannelStats& c = p.ch[p.current];
+  c.fail = ewma(c.fail, (float)failed / sent, false);
+}
+
+float chanCost(const ChannelStats& s) {
+  float noise = s.noiseDbm - CHAN_NOISE_REF_DBM;
+  if (noise < 0) noise = 0;
+  return s.busy + noise / 10 * (CHAN_NOISE_WEIGHT_PCT / 100.0f);
+}
+
+uint8_t chanChoose(ChannelPlan& p, uint32_t nowMs) {
+  uint8_t best = 0;
+  const ChannelStats& cur = p.ch[p.current];
+  float curCost = chanCost(cur);
+  bool hurting = curCost >= CHAN_GOOD_PCT / 100.0f || cur.fail >= CHAN_FAIL_PCT / 100.0f;
+  if (cur.surveys >= CHAN_MIN_SURVEYS && hurting) {
+    float bestCost = curCost - CHAN_HYSTERESIS_PCT / 100.0f;
+    for (uint8_t c = 1; c <= CHAN_MAX; c++) {
+      if (c == p.current || !chanValid(p.mask, c) || p.ch[c].surveys < CHAN_MIN_SURVEYS) continue;
+      float cost = chanCost(p.ch[c]);
+      if (cost <= bestCost) {
+        best = c;
+        bestCost = cost;
+      }
+    }
+  }
+  // The same channel has to win CHAN_CONFIRM decisions in a row
+  if (best == 0 || best != p.candidate) {
+    p.candidate = best;
+    p.streak = best ? 1 : 0;
+  } else if (p.streak < 0xFF) {
+    p.streak++;
+  }
+  if (best == 0 || p.streak < CHAN_CONFIRM || nowMs - p.sinceMs < CHAN_HOLD_MS) return 0;
+  return best;
+}
+
+void chanMoved(ChannelPlan& p, uint8_t channel, uint32_t nowMs) {
+  p.current = channel;
+  p.sinceMs = nowMs;
+  p.candidate = 0;
+  p.streak = 0;
+  p.moves++;
+}
+
+uint8_t chanNextScan(uint16_t mask, uint8_t channel) {
+  for (int i = 1; i <= CHAN_MAX; i++) {
+    uint8_t c = (uint8_t)((channel + i - 1) % CHAN_MAX + 1);
+    if (chanValid(mask, c)) return c;
+  }
+  return channel;
+}
+
+void chanTputReset(ChanThroughput& t) {
+  memset(&t, 0, sizeof(t));
+}
+
+void chanTputTick(ChanThroughput& t, uint32_t bytes, uint32_t ok, uint32_t failed) {
+  t.bytes[t.next] = bytes;
+  t.ok[t.next] = ok;
+  t.failed[t.next] = failed;
+  t.next = (uint8_t)((t.next + 1) % CHAN_TPUT_SECONDS);
+  if (t.filled < CHAN_TPUT_SECONDS) t.filled++;
+}
+
+void chanTputSummary(const ChanThroughput& t, uint32_t& bytesPerSec, uint32_t& deliveryPct) {
+  uint64_t bytes = 0, ok = 0, failed = 0;
+  for (int i = 0; i < t.filled; i++) {
+    bytes += t.bytes[i];
+    ok += t.ok[i];
+    failed += t.failed[i];
+  }
+  uint64_t sent = ok + failed;
+  deliveryPct = sent ? (uint32_t)(ok * 100 / sent) : 0;
+  bytesPerSec = t.filled && sent ? (uint32_t)(bytes * ok / sent / t.filled) : 0;
+}
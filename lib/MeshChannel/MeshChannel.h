@@ -0,0 +1,208 @@
+/*
+ * Interference-aware mesh channel selection (coordinator) and the channel
+ * switch announcement shared by both firmwares
+ *
+ * Once per CHAN_SURVEY_PERIOD_MS the coordinator samples one channel of
+ * MESH_CHANNEL_MASK in turn: it leaves the mesh channel for CHAN_DWELL_MS in
+ * promiscuous mode, adds up the estimated airtime of every frame it hears
+ * that is not ESP-NOW, and averages the noise floor the radio reports. The
+ * mesh channel is sampled the same way without leaving it. Per channel it
+ * keeps smoothed
+ *
+ *   busy   share of the dwell someone else was on the air
+ *   noise  noise floor in dBm
+ *
+ * and scores cost = busy + CHAN_NOISE_WEIGHT_PCT% per 10 dB of noise above
+ * CHAN_NOISE_REF_DBM. On the mesh channel it also smooths fail, the share of
+ * our unicasts that failed after the driver's retries. fail is not part of
+ * the cost because it is only known for the current channel, which would
+ * then always look worse than the rest. Instead it marks the current channel
+ * as hurting even when the survey looks clean, e.g. interference near the
+ * clients that the coordinator does not hear.
+ *
+ * The coordinator moves when a channel costs at least CHAN_HYSTERESIS_PCT%
+ * less than the current one, the current one costs CHAN_GOOD_PCT% or more
+ * or loses CHAN_FAIL_PCT% of its unicasts, and it has held the current one
+ * for CHAN_HOLD_MS. The same channel has to come out best CHAN_CONFIRM
+ * surveys in a row, because one short dwell on bursty Wi-Fi is a noisy
+ * sample.
+ *
+ * A move is announced by a broadcast after every beacon for
+ * CHAN_SWITCH_COUNTDOWN_MS:
+ *
+ *   'M','C', version, channel, epoch(le32), msUntilSwitch(le16)
+ *
+ * Every node that heard one switches at the same moment and the coordinator
+ * beacons on the new channel at once, so the session (epoch, peer table,
+ * membership log) carries over. A client that missed all of them loses the
+ * lease, scans the candidate channels for MESH_CHANNEL_SCAN_MS each and
+ * resyncs with one frame once it hears the beacon. A standby coordinator
+ * that loses the lease listens on each other candidate for
+ * CHAN_STANDBY_LISTEN_MS before it may claim leadership, so it does not
+ * split the mesh by claiming on a channel the leader has left. The client's
+ * first listen on the mesh channel outlasts the lease plus that search, so
+ * after a failover it is still there when the new leader's first beacons go
+ * out (failover_sim.py).
+ *
+ * Before a dwell off the mesh channel the coordinator stops sending and
+ * waits up to CHAN_DRAIN_MS for frames already queued in the driver, which
+ * would otherwise go out on the survey channel and count as failed sends.
+ *
+ * Portable C++ with no locking. channel_sim.py builds it on the host and
+ * runs it against a simulated channel model.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifndef MESH_CHANNEL_MASK
+#define MESH_CHANNEL_MASK ((1u << 1) | (1u << 6) | (1u << 11))  // override with -DMESH_CHANNEL_MASK=<bits>
+#endif
+
+#define CHAN_MAX                  13
+#define CHAN_TICK_MS              5      // housekeeping timer: dwell end, switch moment
+#define CHAN_SURVEY_PERIOD_MS     1000   // one channel sampled per period
+#define CHAN_DWELL_MS             12     // off the mesh channel, ~1% of the time
+#define CHAN_MIN_SENDS            20     // unicasts in a period for a fail sample
+#define CHAN_NOISE_REF_DBM        (-95)
+#define CHAN_SWITCH_COUNTDOWN_MS  500    // ~10 announcements at the beacon interval
+#define MESH_CHANNEL_SCAN_MS      800    // client: listen this long per channel when lost, see below
+#define CHAN_STANDBY_LISTEN_MS    150    // coordinator standby: per other channel before claiming
+#define CHAN_DRAIN_MS             10     // most a survey waits for queued sends to complete
+#define CHAN_TPUT_SECONDS         5      // throughput window before and after a move
+
+// Selection tuning; channel_sim.py -D<NAME>=<n> tries other values
+#ifndef CHAN_MIN_SURVEYS
+#define CHAN_MIN_SURVEYS       3      // before a channel can be chosen
+#endif
+#ifndef CHAN_EWMA_PCT
+#define CHAN_EWMA_PCT          15     // weight of a new sample
+#endif
+#ifndef CHAN_NOISE_WEIGHT_PCT
+#define CHAN_NOISE_WEIGHT_PCT  10     // cost per 10 dB above the reference
+#endif
+#ifndef CHAN_GOOD_PCT
+#define CHAN_GOOD_PCT          10     // a channel this cheap is left alone
+#endif
+#ifndef CHAN_FAIL_PCT
+#define CHAN_FAIL_PCT          5      // unicast loss that makes the current channel worth leaving
+#endif
+#ifndef CHAN_HYSTERESIS_PCT
+#define CHAN_HYSTERESIS_PCT    25
+#endif
+#ifndef CHAN_CONFIRM
+#define CHAN_CONFIRM           5      // decisions in a row a channel must win
+#endif
+#ifndef CHAN_HOLD_MS
+#define CHAN_HOLD_MS           60000  // least time between moves
+#endif
+
+#define MESH_CHANNEL_SWITCH_SIZE    10
+#define MESH_CHANNEL_SWITCH_VERSION 1
+
+static inline bool chanValid(uint16_t mask, uint8_t channel) {
+  return channel >= 1 && channel <= CHAN_MAX && (mask & (1u << channel));
+}
+
+// One dwell on a channel
+struct ChannelSample {
+  uint32_t dwellUs;
+  uint32_t busyUs;
+  uint16_t frames;
+  uint16_t noiseCount;
+  int32_t noiseSum;
+};
+
+struct ChannelStats {
+  uint16_t surveys;
+  float busy;            // 0..1
+  float noiseDbm;
+  float fail;            // 0..1, while the mesh runs on it
+  float lastBusy;        // latest sample, unsmoothed
+  uint32_t frames;       // foreign frames heard
+};
+
+struct ChannelPlan {
+  uint16_t mask;
+  uint8_t current;
+  uint8_t lastSurveyed;
+  uint8_t candidate;     // channel that won the last decisions
+  uint8_t streak;        // decisions in a row it won
+  uint32_t sinceMs;      // on current since
+  ChannelStats ch[CHAN_MAX + 1];
+  uint32_t surveys;
+  uint32_t moves;
+};
+
+// Start on current. The hold time does not apply to the first move.
+void chanPlanInit(ChannelPlan& p, uint16_t mask, uint8_t current, uint32_t nowMs);
+
+// Next channel of the mask to sample, the current one included
+uint8_t chanNextSurvey(ChannelPlan& p);
+
+// Add one received frame (802.11 PHY fields as promiscuous mode reports them:
+// sig_mode, legacy rate code, HT MCS, length with FCS, noise floor)
+void chanSampleFrame(ChannelSample& s, uint8_t sigMode, uint8_t rate, uint8_t mcs, uint16_t len, int8_t noiseFloor);
+
+// Estimated airtime of one frame in microseconds
+uint32_t chanFrameUs(uint8_t sigMode, uint8_t rate, uint8_t mcs, uint16_t len);
+
+// True for an ESP-NOW frame (vendor action frame, Espressif OUI): ours or
+// another mesh, not interference
+bool chanIsEspNow(const uint8_t* frame, int len);
+
+void chanRecordSurvey(ChannelPlan& p, uint8_t channel, const ChannelSample& s);
+
+// Unicasts on the current channel during one survey period
+void chanRecordSends(ChannelPlan& p, uint32_t sent, uint32_t failed);
+
+float chanCost(const ChannelStats& s);
+
+// Once per survey: a channel worth moving to, or 0 to stay
+uint8_t chanChoose(ChannelPlan& p, uint32_t nowMs);
+
+void chanMoved(ChannelPlan& p, uint8_t channel, uint32_t nowMs);
+
+// Client scan order when the coordinator is lost: the next channel of the mask
+uint8_t chanNextScan(uint16_t mask, uint8_t channel);
+
+// Unicast throughput, one slot per second
+struct ChanThroughput {
+  uint32_t bytes[CHAN_TPUT_SECONDS];
+  uint32_t ok[CHAN_TPUT_SECONDS];
+  uint32_t failed[CHAN_TPUT_SECONDS];
+  uint8_t next;
+  uint8_t filled;
+};
+
+void chanTputReset(ChanThroughput& t);
+void chanTputTick(ChanThroughput& t, uint32_t bytes, uint32_t ok, uint32_t failed);
+
+// Over the filled seconds: delivered bytes per second (bytes scaled by the
+// share acked) and delivery in percent
+void chanTputSummary(const ChanThroughput& t, uint32_t& bytesPerSec, uint32_t& deliveryPct);
+
+static inline int chanSwitchEncode(uint8_t channel, uint32_t epoch, uint16_t msUntil, uint8_t* out) {
+  out[0] = 'M';
+  out[1] = 'C';
+  out[2] = MESH_CHANNEL_SWITCH_VERSION;
+  out[3] = channel;
+  out[4] = (uint8_t)epoch;
+  out[5] = (uint8_t)(epoch >> 8);
+  out[6] = (uint8_t)(epoch >> 16);
+  out[7] = (uint8_t)(epoch >> 24);
+  out[8] = (uint8_t)msUntil;
+  out[9] = (uint8_t)(msUntil >> 8);
+  return MESH_CHANNEL_SWITCH_SIZE;
+}
+
+static inline bool chanSwitchParse(const uint8_t* buf, int len, uint8_t& channel, uint32_t& epoch, uint16_t& msUntil) {
+  if (len != MESH_CHANNEL_SWITCH_SIZE || buf[0] != 'M' || buf[1] != 'C' || buf[2] != MESH_CHANNEL_SWITCH_VERSION) {
+    return false;
+  }
+  channel = buf[3];
+  epoch = (uint32_t)buf[4] | ((uint32_t)buf[5] << 8) | ((uint32_t)buf[6] << 16) | ((uint32_t)buf[7] << 24);
+  msUntil = (uint16_t)(buf[8] | (buf[9] << 8));
+  return true;
+}
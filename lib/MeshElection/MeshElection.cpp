@@ -0,0 +1,62 @@
+/*
+ * Coordinator election - see MeshElection.h
+ */
+
+#include "MeshElection.h"
+
+#include <string.h>
+
+bool electionOutranks(uint8_t priorityA, const uint8_t* macA, uint8_t priorityB, const uint8_t* macB) {
+  if (priorityA != priorityB) return priorityA > priorityB;
+  return memcmp(macA, macB, 6) < 0;
+}
+
+uint32_t electionBackoffMs(uint8_t priority, const uint8_t* mac) {
+  if (priority > MESH_PRIORITY_MAX) priority = MESH_PRIORITY_MAX;
+  return (uint32_t)(MESH_PRIORITY_MAX - priority) * MESH_ELECTION_SLOT_MS +
+         (uint32_t)(mac[5] & 7) * MESH_ELECTION_SUBSLOT_MS;
+}
+
+void electionInit(MeshElection& e, uint8_t priority, const uint8_t* mac, uint32_t leaseMs, uint32_t nowMs) {
+  memset(&e, 0, sizeof(e));
+  e.role = ELECTION_STANDBY;
+  e.priority = priority > MESH_PRIORITY_MAX ? MESH_PRIORITY_MAX : priority;
+  memcpy(e.mac, mac, 6);
+  e.leaseUntilMs = nowMs + leaseMs;
+  e.claimAtMs = e.leaseUntilMs + electionBackoffMs(e.priority, mac);
+}
+
+ElectionEvent electionOnBeacon(MeshElection& e, const uint8_t* mac, uint8_t priority,
+                               uint32_t leaseMs, uint32_t nowMs) {
+  ElectionEvent event = ELECTION_NONE;
+  if (e.role == ELECTION_LEADER) {
+    // The other leader steps down when it hears us
+    if (!electionOutranks(priority, mac, e.priority, e.mac)) return ELECTION_NONE;
+    e.role = ELECTION_STANDBY;
+    e.stepDowns++;
+    event = ELECTION_STEPPED_DOWN;
+  }
+  if (!e.leaderKnown || memcmp(e.leaderMac, mac, 6) != 0) {
+    e.leaderChanges++;
+    if (event == ELECTION_NONE) event = ELECTION_LEADER_CHANGED;
+  }
+  e.leaderKnown = true;
+  e.leaderPriority = priority;
+  memcpy(e.leaderMac, mac, 6);
+  e.leaseUntilMs = nowMs + leaseMs;
+  e.claimAtMs = e.leaseUntilMs + electionBackoffMs(e.priority, e.mac);
+  return event;
+}
+
+ElectionEvent electionTick(MeshElection& e, uint32_t nowMs) {
+  if (e.role == ELECTION_LEADER || (int32_t)(nowMs - e.claimAtMs) < 0) return ELECTION_NONE;
+  e.role = ELECTION_LEADER;
+  e.leaderKnown = false;
+  e.wins++;
+  return ELECTION_BECAME_LEADER;
+}
+
+void electionDeferClaim(MeshElection& e, uint32_t nowMs) {
+  if (e.role == ELECTION_LEADER) return;
+  e.claimAtMs = nowMs + electionBackoffMs(e.priority, e.mac);
+}
@@ -0,0 +1,92 @@
+/*
+ * Coordinator election between nodes running the coordinator firmware
+ *
+ * Any number of coordinator-firmware nodes can share a mesh, and exactly one
+ * of them leads at a time. Only the leader beacons (lib/MeshBeacon), accepts
+ * joins and relays audio. The other nodes are standbys: they listen to the
+ * leader's beacons and keep their own BLE service for a local phone.
+ *
+ * Leadership is a lease renewed by every beacon. Each beacon carries the
+ * leader's priority and its lease length in beacon intervals. A standby that
+ * hears nothing from the leader for one lease waits a backoff and then
+ * claims leadership by sending a beacon at once. The backoff is shorter for
+ * higher priority and, at equal priority, for a lower MAC. The best-ranked
+ * standby therefore claims first, and the others hear its beacon before
+ * their own backoff runs out.
+ *
+ * Two leaders can still appear when claims cross in flight or when two
+ * partitions merge. A leader that hears a beacon from a higher-ranked leader
+ * (higher priority, then lower MAC) steps down. Its clients lose the lease
+ * and rejoin the winner. A standby never preempts a live leader of lower
+ * rank, so leadership only moves when the leader goes away.
+ *
+ * A node boots as a standby and listens for one lease plus its backoff
+ * before it claims, so a rebooted node joins an existing leader rather than
+ * splitting the mesh. The leader may have moved the mesh to another channel
+ * meanwhile, so after a lost lease the coordinator first listens on the
+ * other candidate channels and then restarts the backoff with
+ * electionDeferClaim. failover_sim.py models the time until every client
+ * has rerouted after the leader dies.
+ *
+ * Portable C++ with no locking. Callers serialise onBeacon and tick.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define MESH_PRIORITY_MAX        15
+#define MESH_ELECTION_TICK_MS    5     // housekeeping timer that checks the lease
+#define MESH_ELECTION_SUBSLOT_MS 10    // MAC tie-break step, > tick + frame latency
+#define MESH_ELECTION_SLOT_MS    80    // one priority step, 8 MAC subslots
+
+#ifndef MESH_COORD_PRIORITY
+#define MESH_COORD_PRIORITY 15  // lower it on backups with -DMESH_COORD_PRIORITY=<0-14>
+#endif
+
+enum ElectionRole : uint8_t {
+  ELECTION_STANDBY,
+  ELECTION_LEADER,
+};
+
+enum ElectionEvent : uint8_t {
+  ELECTION_NONE,
+  ELECTION_BECAME_LEADER,   // send a beacon now and start serving clients
+  ELECTION_STEPPED_DOWN,    // drop the peer table, clients move to the winner
+  ELECTION_LEADER_CHANGED,  // a standby follows a different leader
+};
+
+struct MeshElection {
+  ElectionRole role;
+  uint8_t priority;
+  uint8_t mac[6];
+  bool leaderKnown;
+  uint8_t leaderPriority;
+  uint8_t leaderMac[6];
+  uint32_t leaseUntilMs;    // standby: the leader's lease runs out
+  uint32_t claimAtMs;       // standby: claim leadership at this time
+  uint32_t wins;
+  uint32_t stepDowns;
+  uint32_t leaderChanges;
+};
+
+// True if (priorityA, macA) outranks (priorityB, macB)
+bool electionOutranks(uint8_t priorityA, const uint8_t* macA, uint8_t priorityB, const uint8_t* macB);
+
+// Wait after a lease runs out before claiming
+uint32_t electionBackoffMs(uint8_t priority, const uint8_t* mac);
+
+// Start as a standby that claims after one lease plus its backoff
+void electionInit(MeshElection& e, uint8_t priority, const uint8_t* mac, uint32_t leaseMs, uint32_t nowMs);
+
+// A beacon from another node of this network
+ElectionEvent electionOnBeacon(MeshElection& e, const uint8_t* mac, uint8_t priority,
+                               uint32_t leaseMs, uint32_t nowMs);
+
+// Call every MESH_ELECTION_TICK_MS
+ElectionEvent electionTick(MeshElection& e, uint32_t nowMs);
+
+// Standby: no leader was found elsewhere either, claim after the backoff
+// from now. Standbys that lost the same lease search for the same time, so
+// their ranking still holds.
+void electionDeferClaim(MeshElection& e, uint32_t nowMs);
@@ -0,0 +1,224 @@
+/*
+ * Versioned mesh membership log - see MeshMembers.h
+ */
+
+#include "MeshMembers.h"
+
+#include <string.h>
+
+#define MEMBER_ENTRY_FIXED 8  // mac, flags, nameLen
+
+static void writeHeader(uint8_t* out, uint8_t kind, uint8_t arg, uint32_t epoch, uint16_t version) {
+  out[0] = 'M';
+  out[1] = kind;
+  out[2] = MESH_MEMBERS_WIRE_VERSION;
+  out[3] = arg;
+  out[4] = (uint8_t)epoch;
+  out[5] = (uint8_t)(epoch >> 8);
+  out[6] = (uint8_t)(epoch >> 16);
+  out[7] = (uint8_t)(epoch >> 24);
+  out[8] = (uint8_t)version;
+  out[9] = (uint8_t)(version >> 8);
+}
+
+static uint32_t readEpoch(const uint8_t* buf) {
+  return (uint32_t)buf[4] | ((uint32_t)buf[5] << 8) | ((uint32_t)buf[6] << 16) | ((uint32_t)buf[7] << 24);
+}
+
+static uint16_t readVersion(const uint8_t* buf) {
+  return (uint16_t)(buf[8] | (buf[9] << 8));
+}
+
+static size_t nameLength(const char* name) {
+  size_t n = name ? strlen(name) : 0;
+  return n > MESH_MEMBER_NAME_MAX ? MESH_MEMBER_NAME_MAX : n;
+}
+
+static void copyName(char* dst, const char* src, size_t n) {
+  if (n) memcpy(dst, src, n);
+  dst[n] = '\0';
+}
+
+// mac, flags, nameLen, name; returns bytes written or 0 if it does not fit
+static int writeEntry(uint8_t* out, int room, const uint8_t* mac, uint8_t flags, const char* name) {
+  size_t n = nameLength(name);
+  if (room < (int)(MEMBER_ENTRY_FIXED + n)) return 0;
+  memcpy(out, mac, 6);
+  out[6] = flags;
+  out[7] = (uint8_t)n;
+  if (n) memcpy(out + MEMBER_ENTRY_FIXED, name, n);
+  return (int)(MEMBER_ENTRY_FIXED + n);
+}
+
+// Returns bytes consumed or 0 if the entry is cut short
+static int readEntry(const uint8_t* buf, int room, MemberEntry& e) {
+  if (room < MEMBER_ENTRY_FIXED) return 0;
+  size_t n = buf[7];
+  if (n > MESH_MEMBER_NAME_MAX || room < (int)(MEMBER_ENTRY_FIXED + n)) return 0;
+  memcpy(e.mac, buf, 6);
+  e.flags = buf[6];
+  copyName(e.name, (const char*)buf + MEMBER_ENTRY_FIXED, n);
+  return (int)(MEMBER_ENTRY_FIXED + n);
+}
+
+void membersReset(MemberList& l, uint32_t epoch, uint16_t version, bool complete) {
+  uint32_t deltas = l.deltasApplied, snapshots = l.snapshotsApplied, gaps = l.gaps;
+  memset(&l, 0, sizeof(l));
+  l.epoch = epoch;
+  l.version = version;
+  l.complete = complete;
+  l.deltasApplied = deltas;
+  l.snapshotsApplied = snapshots;
+  l.gaps = gaps;
+}
+
+int membersFind(const MemberList& l, const uint8_t* mac) {
+  for (int i = 0; i < l.count; i++) {
+    if (memcmp(l.entries[i].mac, mac, 6) == 0) return i;
+  }
+  return -1;
+}
+
+bool membersApplyOp(MemberList& l, uint8_t op, const uint8_t* mac, uint8_t flags, const char* name) {
+  int i = membersFind(l, mac);
+  size_t n = nameLength(name);
+  switch (op) {
+    case MEMBER_OP_ADD:
+      if (i >= 0 || l.count >= MESH_MEMBERS_MAX) return false;
+      i = l.count++;
+      memcpy(l.entries[i].mac, mac, 6);
+      l.entries[i].flags = flags;
+      copyName(l.entries[i].name, name, n);
+      return true;
+    case MEMBER_OP_REMOVE:
+      if (i < 0) return false;
+      memmove(&l.entries[i], &l.entries[i + 1], (l.count - i - 1) * sizeof(MemberEntry));
+      l.count--;
+      return true;
+    case MEMBER_OP_UPDATE: {
+      if (i < 0) return false;
+      char truncated[MESH_MEMBER_NAME_MAX + 1];
+      copyName(truncated, name, n);
+      if (l.entries[i].flags == flags && strcmp(l.entries[i].name, truncated) == 0) return false;
+      l.entries[i].flags = flags;
+      memcpy(l.entries[i].name, truncated, sizeof(truncated));
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+void membersDeltaBegin(MembersDelta& d) {
+  d.len = MESH_MEMBERS_HEADER_SIZE;
+  d.ops = 0;
+}
+
+bool membersDeltaAdd(MembersDelta& d, uint8_t op, const uint8_t* mac, uint8_t flags, const char* name) {
+  int room = MESH_MEMBERS_FRAME_MAX - d.len - 1;
+  if (room < MEMBER_ENTRY_FIXED) return false;
+  int n = writeEntry(d.buf + d.len + 1, room, mac, flags, op == MEMBER_OP_REMOVE ? "" : name);
+  if (n == 0) return false;
+  d.buf[d.len] = op;
+  d.len += 1 + n;
+  d.ops++;
+  return true;
+}
+
+int membersDeltaFinish(MembersDelta& d, uint32_t epoch, uint16_t version) {
+  writeHeader(d.buf, 'D', d.ops, epoch, version);
+  return d.len;
+}
+
+int membersEncodeSnapshot(const MemberList& l, int first, uint8_t* out, int outSize, int* next) {
+  int len = MESH_MEMBERS_HEADER_SIZE + 2;
+  int i = first;
+  for (; i < l.count; i++) {
+    const MemberEntry& e = l.entries[i];
+    int n = writeEntry(out + len, outSize - len, e.mac, e.flags, e.name);
+    if (n == 0) break;
+    len += n;
+  }
+  writeHeader(out, 'S', (uint8_t)(i - first), l.epoch, l.version);
+  out[MESH_MEMBERS_HEADER_SIZE] = l.count;
+  out[MESH_MEMBERS_HEADER_SIZE + 1] = (uint8_t)first;
+  *next = i;
+  return len;
+}
+
+int membersEncodeRequest(uint32_t epoch, uint16_t version, uint8_t* out) {
+  writeHeader(out, 'Q', 0, epoch, version);
+  return MESH_MEMBERS_HEADER_SIZE;
+}
+
+bool membersParseRequest(const uint8_t* buf, int len, uint32_t& epoch, uint16_t& version) {
+  if (len != MESH_MEMBERS_HEADER_SIZE || !membersIsFrame(buf, len) || buf[1] != 'Q') return false;
+  epoch = readEpoch(buf);
+  version = readVersion(buf);
+  return true;
+}
+
+static MembersResult handleDelta(MemberList& l, const uint8_t* buf, int len) {
+  uint8_t ops = buf[3];
+  uint16_t version = readVersion(buf);
+  if (l.complete && version == l.version) return MEMBERS_IGNORED;  // duplicate
+  if (!l.complete || (uint16_t)(version - ops) != l.version) {
+    l.gaps++;
+    return MEMBERS_GAP;
+  }
+  int pos = MESH_MEMBERS_HEADER_SIZE;
+  for (int k = 0; k < ops; k++) {
+    MemberEntry e;
+    int n = pos < len ? readEntry(buf + pos + 1, len - pos - 1, e) : 0;
+    if (n == 0 || !membersApplyOp(l, buf[pos], e.mac, e.flags, e.name)) {
+      // Malformed or does not fit our list: it has diverged
+      l.complete = false;
+      l.gaps++;
+      return MEMBERS_GAP;
+    }
+    pos += 1 + n;
+  }
+  l.version = version;
+  l.deltasApplied++;
+  return MEMBERS_APPLIED;
+}
+
+static MembersResult handleSnapshot(MemberList& l, MemberSnapshot& snap, const uint8_t* buf, int len) {
+  if (len < MESH_MEMBERS_HEADER_SIZE + 2) return MEMBERS_IGNORED;
+  uint16_t version = readVersion(buf);
+  uint8_t entries = buf[3];
+  uint8_t total = buf[MESH_MEMBERS_HEADER_SIZE];
+  uint8_t first = buf[MESH_MEMBERS_HEADER_SIZE + 1];
+  if (l.complete && version == l.version) return MEMBERS_IGNORED;
+  if (total > MESH_MEMBERS_MAX || first + entries > total) return MEMBERS_IGNORED;
+  if (snap.epoch != l.epoch || snap.version != version || snap.total != total) {
+    snap.epoch = l.epoch;
+    snap.version = version;
+    snap.total = total;
+    snap.have = 0;
+  }
+  int pos = MESH_MEMBERS_HEADER_SIZE + 2;
+  for (int k = 0; k < entries; k++) {
+    int n = readEntry(buf + pos, len - pos, snap.entries[first + k]);
+    if (n == 0) return MEMBERS_IGNORED;
+    snap.have |= 1ull << (first + k);
+    pos += n;
+  }
+  uint64_t all = total == 64 ? ~0ull : (1ull << total) - 1;
+  if (snap.have != all) return MEMBERS_PARTIAL;
+  l.count = total;
+  memcpy(l.entries, snap.entries, total * sizeof(MemberEntry));
+  l.version = version;
+  l.complete = true;
+  l.snapshotsApplied++;
+  snap.have = 0;
+  snap.total = 0;
+  return MEMBERS_APPLIED;
+}
+
+MembersResult membersHandleFrame(MemberList& l, MemberSnapshot& snap, const uint8_t* buf, int len) {
+  if (!membersIsFrame(buf, len) || readEpoch(buf) != l.epoch) return MEMBERS_IGNORED;
+  if (buf[1] == 'D') return handleDelta(l, buf, len);
+  if (buf[1] == 'S') return handleSnapshot(l, snap, buf, len);
+  return MEMBERS_IGNORED;
+}
@@ -0,0 +1,133 @@
+/*
+ * Versioned mesh membership log shared by both firmwares
+ *
+ * The coordinator keeps a MemberList mirror of its peer table under a
+ * 16-bit version. Each add, remove or flag change bumps the version by one.
+ * Every change is broadcast to FF:FF:FF:FF:FF:FF as one delta frame:
+ *
+ *   'M','D', wire version, op count, epoch(le32), version(le16),
+ *   then per op: op, mac[6], flags, nameLen, name (adds and updates only)
+ *
+ * version is the list version after the ops. A client applies a delta only
+ * on top of version - count. Any other version means it missed a change, so
+ * it sends a 10-byte snapshot request with the version it has:
+ *
+ *   'M','Q', wire version, 0, epoch(le32), version(le16)
+ *
+ * The coordinator answers with unicast snapshot chunks, as many entries as
+ * fit in one ESP-NOW frame each:
+ *
+ *   'M','S', wire version, entries in this chunk, epoch(le32), version(le16),
+ *   total, first index, then per entry: mac[6], flags, nameLen, name
+ *
+ * A delta with one op is at most 42 bytes, so a change costs one frame
+ * whatever the mesh size. A 64-member snapshot with 20-character names takes
+ * 8 frames and is only sent to a client that fell behind. The epoch ties
+ * the log to a coordinator session (lib/MeshBeacon). A new session starts
+ * from a random version, so a client left over from an earlier session
+ * almost surely sees a gap rather than applying a delta to the wrong list.
+ *
+ * Names longer than MESH_MEMBER_NAME_MAX are truncated. Portable C++ with no
+ * locking, so it also builds for the host.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MESH_MEMBERS_MAX          64
+#define MESH_MEMBERS_WIRE_VERSION 1
+#define MESH_MEMBERS_HEADER_SIZE  10
+#define MESH_MEMBER_NAME_MAX      23
+#define MESH_MEMBERS_FRAME_MAX    250   // ESP_NOW_MAX_DATA_LEN
+#define MESH_MEMBERS_REQUEST_MS   250   // least gap between a client's snapshot requests
+
+// Member flags
+#define MEMBER_FLAG_ACTIVE      0x01  // ready for audio
+#define MEMBER_FLAG_COORDINATOR 0x02
+
+enum MemberOp : uint8_t {
+  MEMBER_OP_ADD = 1,
+  MEMBER_OP_REMOVE = 2,
+  MEMBER_OP_UPDATE = 3,  // flags or name changed
+};
+
+enum MembersResult : uint8_t {
+  MEMBERS_IGNORED,   // not a membership frame, another session, or a duplicate
+  MEMBERS_APPLIED,   // the list moved to a new version
+  MEMBERS_PARTIAL,   // snapshot chunk stored, more to come
+  MEMBERS_GAP,       // missed a change: request a snapshot
+};
+
+struct MemberEntry {
+  uint8_t mac[6];
+  uint8_t flags;
+  char name[MESH_MEMBER_NAME_MAX + 1];
+};
+
+struct MemberList {
+  uint32_t epoch;
+  uint16_t version;
+  bool complete;          // client: holds a full list for (epoch, version)
+  uint8_t count;
+  MemberEntry entries[MESH_MEMBERS_MAX];
+  uint32_t deltasApplied;
+  uint32_t snapshotsApplied;
+  uint32_t gaps;
+};
+
+// Client: snapshot chunks being assembled into a full list
+struct MemberSnapshot {
+  uint32_t epoch;
+  uint16_t version;
+  uint8_t total;
+  uint64_t have;          // bit i: entry i received
+  MemberEntry entries[MESH_MEMBERS_MAX];
+};
+
+// Empty list for a session. complete is set on the coordinator, whose log
+// is the reference, and cleared on a client until its first snapshot.
+void membersReset(MemberList& l, uint32_t epoch, uint16_t version, bool complete);
+
+int membersFind(const MemberList& l, const uint8_t* mac);
+
+// Apply one op to the list without touching the version. Returns false if
+// it changes nothing (remove of an unknown MAC, update to the same value,
+// add to a full list).
+bool membersApplyOp(MemberList& l, uint8_t op, const uint8_t* mac, uint8_t flags, const char* name);
+
+static inline bool membersIsFrame(const uint8_t* buf, int len) {
+  return len >= MESH_MEMBERS_HEADER_SIZE && buf[0] == 'M' && buf[2] == MESH_MEMBERS_WIRE_VERSION &&
+         (buf[1] == 'D' || buf[1] == 'S' || buf[1] == 'Q');
+}
+
+// Delta frame builder (coordinator). Add ops while they fit, then finish
+// and send; version is the list version after the ops.
+struct MembersDelta {
+  uint8_t buf[MESH_MEMBERS_FRAME_MAX];
+  int len;
+  uint8_t ops;
+};
+
+void membersDeltaBegin(MembersDelta& d);
+bool membersDeltaAdd(MembersDelta& d, uint8_t op, const uint8_t* mac, uint8_t flags, const char* name);
+int membersDeltaFinish(MembersDelta& d, uint32_t epoch, uint16_t version);
+
+// Snapshot chunk holding entries from first on. *next is the first entry
+// that did not fit (l.count when done). Returns the frame length.
+int membersEncodeSnapshot(const MemberList& l, int first, uint8_t* out, int outSize, int* next);
+
+int membersEncodeRequest(uint32_t epoch, uint16_t version, uint8_t* out);
+bool membersParseRequest(const uint8_t* buf, int len, uint32_t& epoch, uint16_t& version);
+
+// Client: apply a delta or snapshot chunk from the coordinator of session
+// l.epoch. Frames of other sessions are ignored. Chunks are gathered in
+// snap until every entry of one version has arrived.
+MembersResult membersHandleFrame(MemberList& l, MemberSnapshot& snap, const uint8_t* buf, int len);
+
+static inline uint8_t membersActiveCount(const MemberList& l) {
+  uint8_t n = 0;
+  for (int i = 0; i < l.count; i++) n += l.entries[i].flags & MEMBER_FLAG_ACTIVE;
+  return n;
+}
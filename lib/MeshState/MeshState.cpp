@@ -0,0 +1,113 @@
+/*
+ * Mesh membership persisted across reboots - see MeshState.h
+ */
+
+#include "MeshState.h"
+
+#include <string.h>
+#include <type_traits>
+
+#ifdef ARDUINO
+#include <Preferences.h>
+#endif
+
+static_assert(std::is_trivially_copyable<MeshCoordState>::value, "MeshCoordState is stored as a blob");
+
+// The layout version is part of each key, so after a MESH_STATE_VERSION bump
+// the old blobs are simply not found
+#define MESH_STATE_STR2(x) #x
+#define MESH_STATE_STR(x) MESH_STATE_STR2(x)
+#define MESH_STATE_CLIENT_KEY "client" MESH_STATE_STR(MESH_STATE_VERSION)
+#define MESH_STATE_COORD_KEY  "coord" MESH_STATE_STR(MESH_STATE_VERSION)
+#define MESH_STATE_CHANNEL_KEY "chan" MESH_STATE_STR(MESH_STATE_VERSION)
+
+#ifdef ARDUINO
+static size_t nvsRead(const char* key, void* buf, size_t len) {
+  Preferences prefs;
+  if (!prefs.begin("meshstate", true)) return 0;
+  size_t n = prefs.getBytesLength(key) == len ? prefs.getBytes(key, buf, len) : 0;
+  prefs.end();
+  return n;
+}
+
+static bool nvsWrite(const char* key, const void* buf, size_t len) {
+  Preferences prefs;
+  if (!prefs.begin("meshstate", false)) return false;
+  bool ok = prefs.putBytes(key, buf, len) == len;
+  prefs.end();
+  return ok;
+}
+
+static void nvsErase(const char* key) {
+  Preferences prefs;
+  if (!prefs.begin("meshstate", false)) return;
+  prefs.remove(key);
+  prefs.end();
+}
+
+static const MeshStateStore kNvsStore = { nvsRead, nvsWrite, nvsErase };
+static const MeshStateStore* store = &kNvsStore;
+#else
+static const MeshStateStore* store = nullptr;
+#endif
+
+void meshStateInit(const MeshStateStore* s) {
+#ifdef ARDUINO
+  store = s ? s : &kNvsStore;
+#else
+  store = s;
+#endif
+}
+
+static bool loadBlob(const char* key, void* out, size_t len) {
+  return store && store->read(key, out, len) == len;
+}
+
+static bool saveBlob(const char* key, const void* in, size_t len) {
+  return store && store->write(key, in, len);
+}
+
+bool meshStateLoadClient(MeshClientState& out) {
+  return loadBlob(MESH_STATE_CLIENT_KEY, &out, sizeof(out)) && out.epoch != 0;
+}
+
+bool meshStateSaveClient(const MeshClientState& state) {
+  return saveBlob(MESH_STATE_CLIENT_KEY, &state, sizeof(state));
+}
+
+// A stored name must start inside the pool and end with its NUL there
+static bool poolStringValid(const PeerNamePool& pool, uint16_t ref) {
+  return ref < pool.used && memchr(pool.bytes + ref, '\0', pool.used - ref) != nullptr;
+}
+
+bool meshStateLoadCoord(MeshCoordState& out) {
+  if (!loadBlob(MESH_STATE_COORD_KEY, &out, sizeof(out))) return false;
+  // Never trust a stored count or pool offset to index the table
+  if (out.epoch == 0 || out.peers.count > PEER_TABLE_MAX || out.peers.names.used > PEER_POOL_BYTES) return false;
+  for (int i = 0; i < out.peers.count; i++) {
+    if (!poolStringValid(out.peers.names, out.peers.nameRef[i]) ||
+        !poolStringValid(out.peers.names, out.peers.typeRef[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool meshStateSaveCoord(const MeshCoordState& state) {
+  return saveBlob(MESH_STATE_COORD_KEY, &state, sizeof(state));
+}
+
+bool meshStateLoadChannel(uint8_t& channel) {
+  return loadBlob(MESH_STATE_CHANNEL_KEY, &channel, sizeof(channel)) && channel != 0;
+}
+
+bool meshStateSaveChannel(uint8_t channel) {
+  return saveBlob(MESH_STATE_CHANNEL_KEY, &channel, sizeof(channel));
+}
+
+void meshStateClear() {
+  if (!store) return;
+  store->erase(MESH_STATE_CLIENT_KEY);
+  store->erase(MESH_STATE_COORD_KEY);
+  store->erase(MESH_STATE_CHANNEL_KEY);
+}
@@ -0,0 +1,102 @@
+/*
+ * Mesh membership persisted across reboots (both firmwares)
+ *
+ * Both sides keep their membership in NVS, so a reboot does not have to
+ * repeat the join handshake:
+ *   - the client stores its coordinator's MAC, channel and session epoch
+ *   - the coordinator stores its channel, epoch and peer table
+ *   - a standby coordinator stores only the channel, which it boots on
+ *
+ * A coordinator that restores its table also keeps its epoch. Its beacons
+ * (lib/MeshBeacon) therefore still match what the clients joined, and
+ * they carry on without noticing the restart. A rebooted client adds the
+ * stored coordinator as a peer and sends one 8-byte resync frame:
+ *
+ *   'M','R', version, flags, epoch(le32)
+ *
+ * The coordinator acks it when the client is in its table under the same
+ * epoch. Without an ack within MESH_JOIN_TIMEOUT_MS, or when a beacon shows
+ * a different epoch, the client falls back to the full beacon join.
+ *
+ * Saves go through a MeshStateStore (NVS by default; test/test_mesh_state
+ * plugs in an in-memory stand-in). A blob is only read back at its exact size and under a key that
+ * carries MESH_STATE_VERSION, so a layout change reads as "nothing
+ * stored".
+ *
+ * An NVS write turns the flash cache off on both cores for its duration,
+ * whichever task issues it, so every audio task not running from IRAM
+ * stalls with it. Callers therefore save from a housekeeping timer (the
+ * ESP-NOW callback never waits on flash) and at most once per
+ * MESH_STATE_MIN_SAVE_MS (meshStateSaveDue), which bounds both how often
+ * audio stalls and the flash wear. A change inside that window is saved
+ * when it ends.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <PeerTable.h>
+
+#define MESH_STATE_VERSION 2  // bump when a stored struct or the resync frame changes
+#define MESH_STATE_MIN_SAVE_MS 5000
+#define MESH_RESYNC_SIZE   8
+#define MESH_RESYNC_FLAG_ACK 0x01  // coordinator -> client
+
+struct MeshClientState {
+  uint8_t coordinatorMac[6];
+  uint8_t channel;
+  uint32_t epoch;
+};
+
+struct MeshCoordState {
+  uint8_t channel;
+  uint32_t epoch;
+  PeerTable peers;      // lastSeen is meaningless after a reboot, reset it on restore
+};
+
+// Key/value blob storage. read copies and returns len only when the stored
+// blob is exactly len bytes, and returns 0 otherwise.
+struct MeshStateStore {
+  size_t (*read)(const char* key, void* buf, size_t len);
+  bool (*write)(const char* key, const void* buf, size_t len);
+  void (*erase)(const char* key);
+};
+
+// nullptr selects NVS (namespace "meshstate"); host builds must pass a store
+void meshStateInit(const MeshStateStore* store);
+
+bool meshStateLoadClient(MeshClientState& out);
+bool meshStateSaveClient(const MeshClientState& state);
+bool meshStateLoadCoord(MeshCoordState& out);
+bool meshStateSaveCoord(const MeshCoordState& state);
+// Standby: the channel the mesh runs on, without a session
+bool meshStateLoadChannel(uint8_t& channel);
+bool meshStateSaveChannel(uint8_t channel);
+void meshStateClear();  // mesh_forget
+
+// Rate limit for the persist timers: lastSaveMs is the caller's time of its
+// last save, 0 before the first one
+static inline bool meshStateSaveDue(uint32_t lastSaveMs, uint32_t nowMs) {
+  return lastSaveMs == 0 || nowMs - lastSaveMs >= MESH_STATE_MIN_SAVE_MS;
+}
+
+static inline int meshResyncEncode(uint8_t flags, uint32_t epoch, uint8_t* out) {
+  out[0] = 'M';
+  out[1] = 'R';
+  out[2] = MESH_STATE_VERSION;
+  out[3] = flags;
+  out[4] = (uint8_t)epoch;
+  out[5] = (uint8_t)(epoch >> 8);
+  out[6] = (uint8_t)(epoch >> 16);
+  out[7] = (uint8_t)(epoch >> 24);
+  return MESH_RESYNC_SIZE;
+}
+
+static inline bool meshResyncParse(const uint8_t* buf, int len, uint8_t& flags, uint32_t& epoch) {
+  if (len != MESH_RESYNC_SIZE || buf[0] != 'M' || buf[1] != 'R' || buf[2] != MESH_STATE_VERSION) return false;
+  flags = buf[3];
+  epoch = (uint32_t)buf[4] | ((uint32_t)buf[5] << 8) | ((uint32_t)buf[6] << 16) | ((uint32_t)buf[7] << 24);
+  return true;
+}
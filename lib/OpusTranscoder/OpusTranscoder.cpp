@@ -0,0 +1,125 @@
+/*
+ * Opus transcoder - see OpusTranscoder.h
+ */
+
+#include "OpusTranscoder.h"
+
+#include <opus.h>
+#include <string.h>
+
+static bool validFrameMs(uint8_t ms) {
+  return ms == 10 || ms == 20 || ms == 40 || ms == 60;
+}
+
+void transcodeDefaultProfile(TranscodeProfile& profile) {
+  profile.enabled = false;
+  profile.bitrate = 12000;
+  profile.frameMs = 40;
+  profile.complexity = 2;
+}
+
+bool transcodeProfileValid(const TranscodeProfile& profile) {
+  if (!validFrameMs(profile.frameMs) || profile.complexity > 10) return false;
+  if (profile.bitrate < 6000 || profile.bitrate > 64000) return false;
+  return profile.bitrate * profile.frameMs / 8000 <= OPUS_TRANSCODE_MAX_PACKET;
+}
+
+bool opusTranscoderInit(OpusTranscoder& t, uint32_t sampleRate, const TranscodeProfile& profile) {
+  memset(&t, 0, sizeof(t));
+  t.sampleRate = sampleRate;
+
+  int err = OPUS_OK;
+  t.decoder = opus_decoder_create((opus_int32)sampleRate, 1, &err);
+  if (err != OPUS_OK || !t.decoder) {
+    t.decoder = nullptr;
+    return false;
+  }
+  t.encoder = opus_encoder_create((opus_int32)sampleRate, 1, OPUS_APPLICATION_VOIP, &err);
+  if (err != OPUS_OK || !t.encoder) {
+    opusTranscoderDestroy(t);
+    return false;
+  }
+  opus_encoder_ctl(t.encoder, OPUS_SET_SIGNAL(OPUS_SIGNAL_VOICE));
+  opus_encoder_ctl(t.encoder, OPUS_SET_DTX(1));
+  opus_encoder_ctl(t.encoder, OPUS_SET_VBR(1));
+
+  if (!opusTranscoderConfigure(t, profile)) {
+    opusTranscoderDestroy(t);
+    return false;
+  }
+  return true;
+}
+
+void opusTranscoderDestroy(OpusTranscoder& t) {
+  if (t.decoder) opus_decoder_destroy(t.decoder);
+  if (t.encoder) opus_encoder_destroy(t.encoder);
+  t.decoder = nullptr;
+  t.encoder = nullptr;
+}
+
+bool opusTranscoderConfigure(OpusTranscoder& t, const TranscodeProfile& profile) {
+  if (!t.encoder || !transcodeProfileValid(profile)) return false;
+
+  if (opus_encoder_ctl(t.encoder, OPUS_SET_BITRATE((opus_int32)profile.bitrate)) != OPUS_OK) return false;
+  if (opus_encoder_ctl(t.encoder, OPUS_SET_COMPLEXITY(profile.complexity)) != OPUS_OK) return false;
+
+  int frameSamples = (int)(t.sampleRate / 1000) * profile.frameMs;
+  if (frameSamples != t.frameSamples) {
+    // A new frame size starts on a clean boundary
+    t.pcmCount = 0;
+    t.frameSamples = frameSamples;
+  }
+  t.profile = profile;
+  return true;
+}
+
+int opusTranscoderDecode(OpusTranscoder& t, const uint8_t* packet, int len, int16_t** newSamples) {
+  if (!t.decoder || !packet || len <= 0) return -1;
+
+  // Keep room for the largest possible packet
+  if (t.pcmCount > OPUS_TRANSCODE_MAX_PCM - OPUS_TRANSCODE_MAX_FRAME) t.pcmCount = 0;
+
+  int16_t* dst = t.pcm + t.pcmCount;
+  int samples = opus_decode(t.decoder, packet, (opus_int32)len, dst, OPUS_TRANSCODE_MAX_FRAME, 0);
+  t.packetsIn++;
+  t.bytesIn += (uint32_t)len;
+  if (samples < 0) {
+    t.decodeErrors++;
+    return -1;
+  }
+  t.pcmCount += samples;
+  if (newSamples) *newSamples = dst;
+  return samples;
+}
+
+int opusTranscoderDrain(OpusTranscoder& t, TranscodeEmitFn emit, void* ctx) {
+  if (!t.encoder || t.frameSamples <= 0) return 0;
+
+  uint8_t packet[OPUS_TRANSCODE_MAX_PACKET];
+  int emitted = 0;
+  int offset = 0;
+  while (t.pcmCount - offset >= t.frameSamples) {
+    int bytes = opus_encode(t.encoder, t.pcm + offset, t.frameSamples, packet, sizeof(packet));
+    offset += t.frameSamples;
+    if (bytes < 0) {
+      t.encodeErrors++;
+      continue;
+    }
+    // With DTX a 1-2 byte packet means silence; it is still sent to keep timing
+    t.packetsOut++;
+    t.bytesOut += (uint32_t)bytes;
+    if (emit) emit(packet, bytes, ctx);
+    emitted++;
+  }
+  if (offset > 0) {
+    t.pcmCount -= offset;
+    if (t.pcmCount > 0) memmove(t.pcm, t.pcm + offset, t.pcmCount * sizeof(int16_t));
+  }
+  return emitted;
+}
+
+void opusTranscoderFlush(OpusTranscoder& t) {
+  t.pcmCount = 0;
+  if (t.decoder) opus_decoder_ctl(t.decoder, OPUS_RESET_STATE);
+  if (t.encoder) opus_encoder_ctl(t.encoder, OPUS_RESET_STATE);
+}
@@ -0,0 +1,71 @@
+/*
+ * Opus -> PCM -> Opus transcoder for re-encoding mesh streams
+ *
+ * Decodes incoming Opus packets into a PCM staging buffer and re-encodes
+ * them at the profile's bitrate and frame size. Input and output frame
+ * sizes are independent (e.g. 20 ms in, 40 ms out), so one input packet
+ * can produce zero, one or several output packets.
+ *
+ * Built on arduino-libopus. Not part of the native test env, which has no
+ * libopus; bench_transcode measures it on the device.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+struct OpusDecoder;
+struct OpusEncoder;
+
+#define OPUS_TRANSCODE_MAX_FRAME   1920   // 120 ms at 16 kHz, largest Opus packet
+#define OPUS_TRANSCODE_MAX_PCM     (2 * OPUS_TRANSCODE_MAX_FRAME)
+#define OPUS_TRANSCODE_MAX_PACKET  234    // ESP-NOW 250 minus the WM v2 header
+
+struct TranscodeProfile {
+  bool enabled;
+  uint32_t bitrate;     // bits per second
+  uint8_t frameMs;      // 10, 20, 40 or 60
+  uint8_t complexity;   // 0..10, keep low on the S3
+};
+
+struct OpusTranscoder {
+  OpusDecoder* decoder;
+  OpusEncoder* encoder;
+  uint32_t sampleRate;
+  TranscodeProfile profile;
+  int frameSamples;                        // output frame size
+  int pcmCount;                            // staged samples
+  int16_t pcm[OPUS_TRANSCODE_MAX_PCM];
+  // Counters
+  volatile uint32_t packetsIn;
+  volatile uint32_t packetsOut;
+  volatile uint32_t bytesIn;
+  volatile uint32_t bytesOut;
+  volatile uint32_t decodeErrors;
+  volatile uint32_t encodeErrors;
+};
+
+typedef void (*TranscodeEmitFn)(const uint8_t* packet, int len, void* ctx);
+
+void transcodeDefaultProfile(TranscodeProfile& profile);
+
+// Frame size, bitrate and complexity in range, and a frame at the full
+// bitrate fits OPUS_TRANSCODE_MAX_PACKET (64 kbps at 60 ms would need 480 B)
+bool transcodeProfileValid(const TranscodeProfile& profile);
+
+// Create decoder/encoder (allocates libopus state once); false on failure
+bool opusTranscoderInit(OpusTranscoder& t, uint32_t sampleRate, const TranscodeProfile& profile);
+void opusTranscoderDestroy(OpusTranscoder& t);
+
+// Change bitrate/frame size/complexity without recreating codec state
+bool opusTranscoderConfigure(OpusTranscoder& t, const TranscodeProfile& profile);
+
+// Decode one packet and append it to the staging buffer.
+// Returns the number of new samples (written at *newSamples) or -1 on error.
+int opusTranscoderDecode(OpusTranscoder& t, const uint8_t* packet, int len, int16_t** newSamples);
+
+// Encode every complete output frame in the staging buffer; returns packets emitted
+int opusTranscoderDrain(OpusTranscoder& t, TranscodeEmitFn emit, void* ctx);
+
+// Drop staged PCM (stream restart)
+void opusTranscoderFlush(OpusTranscoder& t);
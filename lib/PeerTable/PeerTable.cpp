@@ -0,0 +1,104 @@
+/*
+ * Struct-of-arrays mesh peer table - see PeerTable.h
+ */
+
+#include "PeerTable.h"
+
+#include <type_traits>
+
+static_assert(std::is_trivially_copyable<PeerTable>::value, "PeerTable must copy without allocating");
+static_assert(PEER_TABLE_MAX <= 32, "activeMask holds one bit per peer");
+
+static void poolInit(PeerNamePool& pool) {
+  pool.bytes[0] = '\0';
+  pool.used = 1;
+}
+
+// Offset of s in the pool, appending it if needed; 0 ("") when it does not fit
+static uint16_t poolIntern(PeerNamePool& pool, const char* s) {
+  if (!s || !*s) return 0;
+  size_t len = strnlen(s, PEER_NAME_MAX);
+  for (uint16_t off = 1; off < pool.used; off += (uint16_t)strlen(pool.bytes + off) + 1) {
+    if (strncmp(pool.bytes + off, s, len) == 0 && pool.bytes[off + len] == '\0') return off;
+  }
+  if (pool.used + len + 1 > PEER_POOL_BYTES) return 0;
+  uint16_t off = pool.used;
+  memcpy(pool.bytes + off, s, len);
+  pool.bytes[off + len] = '\0';
+  pool.used = (uint16_t)(off + len + 1);
+  return off;
+}
+
+// Rebuild the pool with only the strings live peers still reference
+static void poolCompact(PeerTable& t) {
+  PeerNamePool fresh;
+  poolInit(fresh);
+  for (int i = 0; i < t.count; i++) {
+    t.nameRef[i] = poolIntern(fresh, t.names.bytes + t.nameRef[i]);
+    t.typeRef[i] = poolIntern(fresh, t.names.bytes + t.typeRef[i]);
+  }
+  memcpy(&t.names, &fresh, sizeof(fresh));
+}
+
+static uint16_t tableIntern(PeerTable& t, const char* s) {
+  uint16_t off = poolIntern(t.names, s);
+  if (off == 0 && s && *s) {
+    poolCompact(t);
+    off = poolIntern(t.names, s);
+  }
+  return off;
+}
+
+void peerTableInit(PeerTable& t) {
+  memset(&t, 0, sizeof(t));
+  poolInit(t.names);
+}
+
+int peerTableFind(const PeerTable& t, const uint8_t* mac) {
+  for (int i = 0; i < t.count; i++) {
+    if (memcmp(t.macs[i], mac, 6) == 0) return i;
+  }
+  return -1;
+}
+
+int peerTableAdd(PeerTable& t, const uint8_t* mac, const char* name, const char* type,
+                 uint32_t nowMs, uint8_t capacity) {
+  if (capacity > PEER_TABLE_MAX) capacity = PEER_TABLE_MAX;
+  if (t.count >= capacity) return -1;
+  int i = t.count;
+  memcpy(t.macs[i], mac, 6);
+  t.lastSeen[i] = nowMs;
+  t.audioQuality[i] = 100;
+  peerTableSetActive(t, i, false);  // not active until ready
+  t.coordinatorMask &= ~(1u << i);
+  peerTableSetGroups(t, i, 0x01);  // group 0
+  t.count++;  // counted before interning so a compaction keeps nothing stale
+  t.nameRef[i] = 0;
+  t.typeRef[i] = 0;
+  t.nameRef[i] = tableIntern(t, name);
+  t.typeRef[i] = tableIntern(t, type);
+  return i;
+}
+
+// Drop bit index and shift the higher bits down by one
+static inline uint32_t maskRemove(uint32_t mask, int index) {
+  uint32_t low = mask & ((1u << index) - 1);
+  uint32_t high = index < 31 ? (mask >> (index + 1)) << index : 0;
+  return low | high;
+}
+
+void peerTableRemove(PeerTable& t, int index) {
+  if (index < 0 || index >= t.count) return;
+  int tail = t.count - index - 1;
+  if (tail > 0) {
+    memmove(t.macs[index], t.macs[index + 1], tail * sizeof(t.macs[0]));
+    memmove(&t.lastSeen[index], &t.lastSeen[index + 1], tail * sizeof(t.lastSeen[0]));
+    memmove(&t.nameRef[index], &t.nameRef[index + 1], tail * sizeof(t.nameRef[0]));
+    memmove(&t.typeRef[index], &t.typeRef[index + 1], tail * sizeof(t.typeRef[0]));
+    memmove(&t.audioQuality[index], &t.audioQuality[index + 1], tail * sizeof(t.audioQuality[0]));
+  }
+  t.activeMask = maskRemove(t.activeMask, index);
+  t.coordinatorMask = maskRemove(t.coordinatorMask, index);
+  for (int g = 0; g < PEER_TABLE_GROUPS; g++) t.groupMask[g] = maskRemove(t.groupMask[g], index);
+  t.count--;
+}
@@ -0,0 +1,117 @@
+/*
+ * Struct-of-arrays mesh peer table (coordinator)
+ *
+ * The fields every send loop touches sit at the front:
+ *   - the peer count
+ *   - one active bit per peer
+ *   - one bitmask per talk group (lib/TalkGroup), same bit positions
+ *   - the packed MACs
+ * A fan-out walk therefore reads one cache line and no pointers. The
+ * housekeeping fields (lastSeen) come next. Names and types are kept out
+ * of line in a cold table as 16-bit offsets into a fixed pool. The pool
+ * interns strings, so the many peers named "ESP32_B_Client" share one
+ * copy.
+ *
+ * A new peer listens to group 0 only.
+ *
+ * The table is plain data: assigning or shifting entries is memcpy and
+ * never allocates. When the pool fills up, the live names are compacted
+ * into a fresh pool, so churn with the same or new names cannot leak.
+ * Names longer than PEER_NAME_MAX are truncated, and a name that still
+ * does not fit after compaction is stored as "".
+ *
+ * Not thread-safe. The coordinator guards it with meshTableMutex and
+ * gives the audio senders a FanoutSet snapshot instead. Portable C++, so
+ * it also builds for the host.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#define PEER_TABLE_MAX  32   // width of the active bitmask
+#define PEER_POOL_BYTES 1024 // PEER_TABLE_MAX distinct ~24-char names plus shared types
+#define PEER_NAME_MAX   31   // characters kept per interned string
+#define PEER_TABLE_GROUPS 4  // talk group masks
+
+struct PeerNamePool {
+  uint16_t used;                 // offset 0 is the empty string
+  char bytes[PEER_POOL_BYTES];
+};
+
+struct PeerTable {
+  // Hot: fan-out
+  uint8_t count;
+  uint32_t activeMask;           // bit i: peer i is ready for audio
+  uint32_t groupMask[PEER_TABLE_GROUPS];  // bit i: peer i listens to the group
+  uint8_t macs[PEER_TABLE_MAX][6];
+  // Warm: housekeeping
+  uint32_t lastSeen[PEER_TABLE_MAX];  // millis()
+  // Cold: status reports and logs
+  uint32_t coordinatorMask;
+  uint16_t nameRef[PEER_TABLE_MAX];
+  uint16_t typeRef[PEER_TABLE_MAX];
+  uint8_t audioQuality[PEER_TABLE_MAX];
+  PeerNamePool names;
+};
+
+void peerTableInit(PeerTable& t);
+
+// Index of mac, or -1
+int peerTableFind(const PeerTable& t, const uint8_t* mac);
+
+// Append an inactive peer; returns its index, or -1 when capacity is reached
+int peerTableAdd(PeerTable& t, const uint8_t* mac, const char* name, const char* type,
+                 uint32_t nowMs, uint8_t capacity = PEER_TABLE_MAX);
+
+// Remove index and shift the later peers down, keeping their order
+void peerTableRemove(PeerTable& t, int index);
+
+static inline bool peerTableIsActive(const PeerTable& t, int i) {
+  return (t.activeMask >> i) & 1u;
+}
+
+static inline void peerTableSetActive(PeerTable& t, int i, bool active) {
+  if (active) t.activeMask |= 1u << i;
+  else t.activeMask &= ~(1u << i);
+}
+
+// Groups peer i listens to, one bit per group
+static inline uint8_t peerTableGroups(const PeerTable& t, int i) {
+  uint8_t groups = 0;
+  for (int g = 0; g < PEER_TABLE_GROUPS; g++) groups |= ((t.groupMask[g] >> i) & 1u) << g;
+  return groups;
+}
+
+static inline void peerTableSetGroups(PeerTable& t, int i, uint8_t groups) {
+  for (int g = 0; g < PEER_TABLE_GROUPS; g++) {
+    if ((groups >> g) & 1u) t.groupMask[g] |= 1u << i;
+    else t.groupMask[g] &= ~(1u << i);
+  }
+}
+
+// Fan-out of one group: its listeners that are ready for audio
+static inline uint32_t peerTableGroupActive(const PeerTable& t, int group) {
+  return t.groupMask[group] & t.activeMask;
+}
+
+static inline uint8_t peerTableActiveCount(const PeerTable& t) {
+  return (uint8_t)__builtin_popcount(t.activeMask);
+}
+
+static inline const char* peerTableName(const PeerTable& t, int i) {
+  return t.names.bytes + t.nameRef[i];
+}
+
+static inline const char* peerTableType(const PeerTable& t, int i) {
+  return t.names.bytes + t.typeRef[i];
+}
+
+// Active peers in table order:
+//   for (uint32_t bits = t.activeMask; bits; bits &= bits - 1) { int i = __builtin_ctz(bits); ... }
+
+// Bytes used in the name pool (for stats)
+static inline uint16_t peerTablePoolUsed(const PeerTable& t) {
+  return t.names.used;
+}
@@ -0,0 +1,136 @@
+/*
+ * Fixed-point polyphase sample-rate converter - see Resampler.h
+ */
+
+#include "Resampler.h"
+
+#include <math.h>
+#include <string.h>
+
+static bool ratioFor(uint32_t inRate, uint32_t outRate, uint8_t& up, uint8_t& down) {
+  static const uint32_t kRates[] = { 8000, 16000, 48000 };
+  bool inOk = false, outOk = false;
+  for (uint32_t rate : kRates) {
+    if (rate == inRate) inOk = true;
+    if (rate == outRate) outOk = true;
+  }
+  if (!inOk || !outOk) return false;
+
+  uint32_t a = inRate, b = outRate;
+  while (b != 0) {
+    uint32_t t = a % b;
+    a = b;
+    b = t;
+  }
+  up = (uint8_t)(outRate / a);
+  down = (uint8_t)(inRate / a);
+  return up <= RESAMPLER_MAX_FACTOR && down <= RESAMPLER_MAX_FACTOR;
+}
+
+bool resamplerInit(Resampler& rs, uint32_t inRate, uint32_t outRate) {
+  memset(&rs, 0, sizeof(rs));
+  uint8_t up, down;
+  if (!ratioFor(inRate, outRate, up, down)) return false;
+
+  rs.inRate = inRate;
+  rs.outRate = outRate;
+  rs.up = up;
+  rs.down = down;
+
+  int factor = up > down ? up : down;
+  int protoLen = RESAMPLER_TAPS * factor;
+  rs.branchTaps = (uint8_t)(protoLen / up);
+
+  // Windowed sinc at 90% of the lower Nyquist, gain L so each branch has unity DC gain
+  double cutoff = 0.45 / factor;  // cycles per upsampled sample
+  double center = (protoLen - 1) / 2.0;
+  double proto[RESAMPLER_MAX_PROTO];
+  for (int i = 0; i < protoLen; i++) {
+    double x = i - center;
+    double sinc = (x == 0.0) ? 2.0 * cutoff : sin(2.0 * M_PI * cutoff * x) / (M_PI * x);
+    double window = 0.42 - 0.5 * cos(2.0 * M_PI * (i + 0.5) / protoLen)
+                    + 0.08 * cos(4.0 * M_PI * (i + 0.5) / protoLen);
+    proto[i] = sinc * window * up;
+  }
+
+  // Split into branches and normalise each to exactly unity DC gain in Q15
+  int taps = rs.branchTaps;
+  for (int p = 0; p < up; p++) {
+    double sum = 0.0;
+    for (int m = 0; m < taps; m++) sum += proto[m * up + p];
+    int32_t qsum = 0;
+    int16_t* branch = rs.coeffs + p * taps;
+    for (int m = 0; m < taps; m++) {
+      int32_t q = (int32_t)lround(proto[m * up + p] / sum * 32768.0);
+      if (q > 32767) q = 32767;
+      if (q < -32768) q = -32768;
+      branch[taps - 1 - m] = (int16_t)q;  // reversed: oldest sample first
+      qsum += q;
+    }
+    branch[taps - 1 - taps / 2] += (int16_t)(32768 - qsum);  // fold rounding into the centre tap
+  }
+
+  resamplerReset(rs);
+  return true;
+}
+
+void resamplerReset(Resampler& rs) {
+  memset(rs.history, 0, sizeof(rs.history));
+  rs.writeIndex = 0;
+  rs.phase = 0;
+}
+
+int resamplerMaxOutput(const Resampler& rs, int inCount) {
+  if (rs.down == 0 || inCount <= 0) return 0;
+  return (inCount * rs.up + rs.down - 1) / rs.down + 1;
+}
+
+int resamplerDelay(const Resampler& rs) {
+  if (rs.down == 0) return 0;
+  int protoLen = rs.branchTaps * rs.up;
+  return (protoLen - 1) / 2 / rs.down;
+}
+
+static inline int16_t dotQ15(const int16_t* x, const int16_t* h, int taps) {
+  int32_t acc0 = 0, acc1 = 0;
+  int i = 0;
+  for (; i + 2 <= taps; i += 2) {
+    acc0 += (int32_t)x[i] * h[i];
+    acc1 += (int32_t)x[i + 1] * h[i + 1];
+  }
+  if (i < taps) acc0 += (int32_t)x[i] * h[i];
+  int32_t acc = (acc0 + acc1 + (1 << 14)) >> 15;
+  if (acc > 32767) acc = 32767;
+  if (acc < -32768) acc = -32768;
+  return (int16_t)acc;
+}
+
+int resamplerProcess(Resampler& rs, const int16_t* in, int inCount, int16_t* out, int outMax) {
+  if (rs.down == 0 || !in || !out || inCount <= 0) return 0;
+
+  const int taps = rs.branchTaps;
+  const int up = rs.up;
+  const int down = rs.down;
+  int w = rs.writeIndex;
+  int phase = rs.phase;
+  int produced = 0;
+
+  for (int n = 0; n < inCount; n++) {
+    // Mirror the sample so history[w + 1 .. w + taps] is always contiguous
+    rs.history[w] = in[n];
+    rs.history[w + taps] = in[n];
+    const int16_t* window = rs.history + w + 1;
+    if (++w == taps) w = 0;
+
+    // Emit every output whose upsampled position falls on this input
+    while (phase < up) {
+      if (produced < outMax) out[produced++] = dotQ15(window, rs.coeffs + phase * taps, taps);
+      phase += down;
+    }
+    phase -= up;
+  }
+
+  rs.writeIndex = (uint8_t)w;
+  rs.phase = (uint8_t)phase;
+  return produced;
+}
@@ -0,0 +1,47 @@
+/*
+ * Fixed-point polyphase sample-rate converter (8 / 16 / 48 kHz)
+ *
+ * Converts int16 mono PCM by a rational factor L/M with L, M in {1, 2, 3, 6}.
+ * The prototype low-pass is a Blackman-windowed sinc designed once at init
+ * and stored as Q15 polyphase branches, so the per-sample cost is one
+ * RESAMPLER_TAPS-long multiply-accumulate per output sample (upsampling) or
+ * per input sample (downsampling).
+ *
+ * State is kept between calls, so blocks of any size can be fed in a stream.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define RESAMPLER_TAPS       16   // prototype length per unit of max(L, M)
+#define RESAMPLER_MAX_FACTOR 6    // 8 kHz <-> 48 kHz
+#define RESAMPLER_MAX_PROTO  (RESAMPLER_TAPS * RESAMPLER_MAX_FACTOR)
+
+struct Resampler {
+  uint32_t inRate;
+  uint32_t outRate;
+  uint8_t up;           // L
+  uint8_t down;         // M
+  uint8_t branchTaps;   // taps per polyphase branch (prototype / L)
+  uint8_t writeIndex;   // delay line position
+  uint8_t phase;        // next output position on the upsampled grid
+  int16_t coeffs[RESAMPLER_MAX_PROTO];        // [phase][tap], taps reversed
+  int16_t history[2 * RESAMPLER_MAX_PROTO];   // mirrored delay line
+};
+
+// Configure for inRate -> outRate; returns false for unsupported pairs
+bool resamplerInit(Resampler& rs, uint32_t inRate, uint32_t outRate);
+
+// Clear the delay line (e.g. at the start of a new talk spurt)
+void resamplerReset(Resampler& rs);
+
+// Upper bound of outputs produced for inCount inputs
+int resamplerMaxOutput(const Resampler& rs, int inCount);
+
+// Convert a block; returns the number of samples written to out.
+// out must hold resamplerMaxOutput(inCount) samples, extras are dropped.
+int resamplerProcess(Resampler& rs, const int16_t* in, int inCount, int16_t* out, int outMax);
+
+// Group delay of the filter in output samples (for alignment in tests)
+int resamplerDelay(const Resampler& rs);
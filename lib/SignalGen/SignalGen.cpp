@@ -0,0 +1,183 @@
+/*
+ * Test-signal generator - see SignalGen.h
+ */
+
+#include "SignalGen.h"
+
+#include <BufferConfig.h>
+#include <math.h>
+#include <string.h>
+
+static int16_t sineTable[SIGGEN_SINE_TABLE_SIZE + 1];  // +1 guard for interpolation
+static int16_t pinkTable[SIGGEN_PINK_TABLE_SIZE];
+static bool tablesReady = false;
+static_assert(sizeof(sineTable) == kBufferPools[BUF_POOL_SIGGEN_SINE].slotBytes, "update SIGGEN_SINE in BufferConfig.h");
+static_assert(sizeof(pinkTable) == kBufferPools[BUF_POOL_SIGGEN_PINK].slotBytes, "update SIGGEN_PINK in BufferConfig.h");
+
+// Paul Kellet's pink filter over an LCG. Deterministic, so buildTables
+// replays it per pass instead of keeping a float copy of the table.
+struct PinkFilter {
+  float b0, b1, b2, b3, b4, b5, b6;
+  uint32_t seed;
+};
+
+static float pinkNext(PinkFilter& f) {
+  f.seed = f.seed * 1664525u + 1013904223u;
+  float white = (int32_t)f.seed / 2147483648.0f;
+  f.b0 = 0.99886f * f.b0 + white * 0.0555179f;
+  f.b1 = 0.99332f * f.b1 + white * 0.0750759f;
+  f.b2 = 0.96900f * f.b2 + white * 0.1538520f;
+  f.b3 = 0.86650f * f.b3 + white * 0.3104856f;
+  f.b4 = 0.55000f * f.b4 + white * 0.5329522f;
+  f.b5 = -0.7616f * f.b5 - white * 0.0168980f;
+  float out = f.b0 + f.b1 + f.b2 + f.b3 + f.b4 + f.b5 + f.b6 + white * 0.5362f;
+  f.b6 = white * 0.115926f;
+  return out;
+}
+
+// Filter state after warming up for one table length
+static void pinkStart(PinkFilter& f) {
+  memset(&f, 0, sizeof(f));
+  f.seed = 0x1234567u;
+  for (int i = 0; i < SIGGEN_PINK_TABLE_SIZE; i++) pinkNext(f);
+}
+
+static void buildTables() {
+  for (int i = 0; i <= SIGGEN_SINE_TABLE_SIZE; i++) {
+    sineTable[i] = (int16_t)lround(sin(2.0 * M_PI * i / SIGGEN_SINE_TABLE_SIZE) * 32767.0);
+  }
+
+  // Three passes over the same noise: mean, peak, then the scaled table
+  PinkFilter f;
+  double mean = 0.0;
+  pinkStart(f);
+  for (int i = 0; i < SIGGEN_PINK_TABLE_SIZE; i++) mean += pinkNext(f);
+  mean /= SIGGEN_PINK_TABLE_SIZE;
+  float peak = 0.0f;
+  pinkStart(f);
+  for (int i = 0; i < SIGGEN_PINK_TABLE_SIZE; i++) {
+    float x = pinkNext(f) - (float)mean;
+    if (fabsf(x) > peak) peak = fabsf(x);
+  }
+  pinkStart(f);
+  for (int i = 0; i < SIGGEN_PINK_TABLE_SIZE; i++) {
+    pinkTable[i] = (int16_t)lroundf((pinkNext(f) - (float)mean) / peak * 32767.0f);
+  }
+  tablesReady = true;
+}
+
+static inline uint32_t incrementFor(float freqHz, uint32_t sampleRate) {
+  return (uint32_t)(freqHz * 4294967296.0 / sampleRate);
+}
+
+void sigGenDefaultConfig(SigGenConfig& cfg) {
+  cfg.type = SIGGEN_SINE;
+  cfg.freqHz = 1000;
+  cfg.freqEndHz = 3000;
+  cfg.periodMs = 2000;
+  cfg.impulsesPerSec = 4;
+  cfg.level = 16384;
+}
+
+bool sigGenInit(SigGen& gen, const SigGenConfig& cfg, uint32_t sampleRate) {
+  if (!tablesReady) buildTables();
+  memset(&gen, 0, sizeof(gen));
+  if (sampleRate == 0) return false;
+  uint32_t nyquist = sampleRate / 2;
+
+  switch (cfg.type) {
+    case SIGGEN_OFF:
+    case SIGGEN_PINK:
+      break;
+    case SIGGEN_SINE:
+      if (cfg.freqHz == 0 || cfg.freqHz >= nyquist) return false;
+      gen.phaseInc = incrementFor(cfg.freqHz, sampleRate);
+      break;
+    case SIGGEN_SWEEP:
+      if (cfg.freqHz == 0 || cfg.freqHz >= nyquist) return false;
+      if (cfg.freqEndHz == 0 || cfg.freqEndHz >= nyquist) return false;
+      if (cfg.periodMs == 0) return false;
+      gen.sweepLen = (uint32_t)((uint64_t)sampleRate * cfg.periodMs / 1000);
+      if (gen.sweepLen == 0) return false;
+      gen.sweepStartInc = (float)incrementFor(cfg.freqHz, sampleRate);
+      gen.sweepInc = gen.sweepStartInc;
+      gen.sweepRatio = powf((float)cfg.freqEndHz / cfg.freqHz, 1.0f / gen.sweepLen);
+      break;
+    case SIGGEN_IMPULSE:
+      if (cfg.impulsesPerSec == 0 || cfg.impulsesPerSec > sampleRate) return false;
+      gen.impulsePeriod = sampleRate / cfg.impulsesPerSec;
+      break;
+    default:
+      return false;
+  }
+  gen.cfg = cfg;
+  gen.sampleRate = sampleRate;
+  return true;
+}
+
+static inline int16_t sineAt(uint32_t phase) {
+  uint32_t index = phase >> (32 - SIGGEN_SINE_TABLE_BITS);
+  int32_t frac = (phase >> (32 - SIGGEN_SINE_TABLE_BITS - 15)) & 0x7FFF;
+  int32_t a = sineTable[index];
+  int32_t b = sineTable[index + 1];
+  return (int16_t)(a + (((b - a) * frac) >> 15));
+}
+
+static inline int16_t scale(int32_t sample, int32_t level) {
+  return (int16_t)((sample * level) >> 15);
+}
+
+void sigGenRender(SigGen& gen, int16_t* out, int count) {
+  const int32_t level = gen.cfg.level;
+  switch (gen.cfg.type) {
+    case SIGGEN_SINE:
+      for (int i = 0; i < count; i++) {
+        out[i] = scale(sineAt(gen.phase), level);
+        gen.phase += gen.phaseInc;
+      }
+      break;
+    case SIGGEN_SWEEP:
+      for (int i = 0; i < count; i++) {
+        out[i] = scale(sineAt(gen.phase), level);
+        gen.phase += (uint32_t)gen.sweepInc;
+        gen.sweepInc *= gen.sweepRatio;
+        if (++gen.sweepPos >= gen.sweepLen) {
+          gen.sweepPos = 0;
+          gen.sweepInc = gen.sweepStartInc;
+        }
+      }
+      break;
+    case SIGGEN_PINK:
+      for (int i = 0; i < count; i++) {
+        out[i] = scale(pinkTable[gen.noisePos], level);
+        gen.noisePos = (gen.noisePos + 1) & (SIGGEN_PINK_TABLE_SIZE - 1);
+      }
+      break;
+    case SIGGEN_IMPULSE:
+      for (int i = 0; i < count; i++) {
+        if (gen.impulseCountdown == 0) {
+          out[i] = (int16_t)level;
+          gen.impulseCountdown = gen.impulsePeriod;
+        } else {
+          out[i] = 0;
+        }
+        gen.impulseCountdown--;
+      }
+      break;
+    default:
+      memset(out, 0, count * sizeof(int16_t));
+      break;
+  }
+  gen.samples += count;
+}
+
+const char* sigGenTypeName(uint8_t type) {
+  switch (type) {
+    case SIGGEN_OFF: return "off";
+    case SIGGEN_SINE: return "sine";
+    case SIGGEN_SWEEP: return "sweep";
+    case SIGGEN_PINK: return "pink";
+    case SIGGEN_IMPULSE: return "impulse";
+    default: return "?";
+  }
+}
@@ -0,0 +1,64 @@
+/*
+ * Test-signal generator: sine, log sweep, pink noise and impulse train
+ *
+ * Sine and sweep read a shared Q15 sine wavetable through a 32-bit phase
+ * accumulator with linear interpolation; pink noise loops a precomputed
+ * table (so the spectrum is identical every run). Both tables are built on
+ * the first sigGenInit() and shared by every generator, so call it from one
+ * task first. Rendering is integer except the sweep's per-sample increment.
+ *
+ * Output is PCM16 at whatever rate the generator was initialised with; the
+ * caller frames and encodes it like any other audio source.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define SIGGEN_SINE_TABLE_BITS 10
+#define SIGGEN_SINE_TABLE_SIZE (1 << SIGGEN_SINE_TABLE_BITS)
+#define SIGGEN_PINK_TABLE_SIZE 4096  // loops every 0.5 s at 8 kHz
+
+enum SigGenType {
+  SIGGEN_OFF,
+  SIGGEN_SINE,     // freqHz
+  SIGGEN_SWEEP,    // freqHz -> freqEndHz, logarithmic, repeats every periodMs
+  SIGGEN_PINK,     // -3 dB/octave noise
+  SIGGEN_IMPULSE,  // one full-level sample, impulsesPerSec times a second
+};
+
+struct SigGenConfig {
+  uint8_t type;             // SigGenType
+  uint16_t freqHz;
+  uint16_t freqEndHz;
+  uint16_t periodMs;
+  uint16_t impulsesPerSec;
+  int16_t level;            // peak amplitude, 32767 = 0 dBFS
+};
+
+struct SigGen {
+  SigGenConfig cfg;
+  uint32_t sampleRate;
+  uint32_t phase;           // Q32 fraction of a cycle
+  uint32_t phaseInc;
+  float sweepInc;           // current increment while sweeping
+  float sweepStartInc;
+  float sweepRatio;         // per-sample increment multiplier
+  uint32_t sweepPos;
+  uint32_t sweepLen;        // samples per sweep
+  uint32_t noisePos;
+  uint32_t impulsePeriod;   // samples between impulses
+  uint32_t impulseCountdown;
+  uint32_t samples;         // rendered since init
+};
+
+// 1 kHz sine at -6 dBFS, 2 s sweeps 100 Hz..3 kHz, 4 impulses/s
+void sigGenDefaultConfig(SigGenConfig& cfg);
+
+// False if the configuration cannot be rendered at sampleRate (frequency at
+// or above Nyquist, zero period, ...)
+bool sigGenInit(SigGen& gen, const SigGenConfig& cfg, uint32_t sampleRate);
+
+void sigGenRender(SigGen& gen, int16_t* out, int count);
+
+const char* sigGenTypeName(uint8_t type);
@@ -0,0 +1,100 @@
+/*
+ * Talk groups: control frames and membership masks (both firmwares)
+ *
+ * A site can run MAX_TALK_GROUPS separate conversations over one mesh. Each
+ * client node listens to a set of groups, kept by the coordinator as one
+ * bit per peer in PeerTable.groupMask[group]. Audio goes out to
+ * groupMask[g] & activeMask only (published per group in the FanoutSet
+ * snapshot), so a node hears nothing of the groups it is not in. A frame
+ * names its group in the WM header (WM_FLAG_GROUP); without it, it is for
+ * the talk group Phone A picked. A new peer listens to group 0, so a mesh
+ * whose phones never send a group frame behaves as before.
+ *
+ * Phones change groups with a WM frame of type WM_TYPE_GROUP on the audio
+ * characteristic:
+ *
+ *   WM v1 header, payload op, value
+ *     TG_OP_JOIN   value = group    listen to it as well
+ *     TG_OP_LEAVE  value = group
+ *     TG_OP_SET    value = mask     listen to exactly these groups
+ *     TG_OP_TALK   value = group    Phone A: group of untagged frames
+ *
+ * and get back payload TG_OP_STATE, listen mask, talk group once the change
+ * is applied. A client passes JOIN/LEAVE/SET to its coordinator as
+ *
+ *   'M','G', version, op, value, 0
+ *
+ * and the coordinator answers with the same frame, op TG_OP_STATE and the
+ * mask it now holds for that peer. The coordinator is the authority: it
+ * keeps the masks in its peer table (saved with the mesh session), and a
+ * client repeats the last confirmed mask after a full join only.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <WmFrame.h>
+
+#define MAX_TALK_GROUPS     4
+#define TG_ALL_MASK         ((1u << MAX_TALK_GROUPS) - 1)
+#define TG_DEFAULT_MASK     0x01  // new peers listen to group 0
+
+#define TG_OP_JOIN          1
+#define TG_OP_LEAVE         2
+#define TG_OP_SET           3
+#define TG_OP_TALK          4
+#define TG_OP_STATE         0x80
+
+#define TG_MESH_SIZE        6
+#define TG_MESH_VERSION     1
+#define TG_PHONE_STATE_SIZE (WM_HEADER_V1_SIZE + 3)
+#define TG_RETRY_MS         500   // client: resend a request nobody confirmed
+#define TG_RETRIES          5
+
+// New listen mask after op, or -1 if op or value is invalid (TALK leaves
+// the mask alone)
+static inline int tgApply(uint8_t mask, uint8_t op, uint8_t value) {
+  switch (op) {
+    case TG_OP_JOIN:  return value < MAX_TALK_GROUPS ? (mask | (1u << value)) : -1;
+    case TG_OP_LEAVE: return value < MAX_TALK_GROUPS ? (mask & ~(1u << value)) : -1;
+    case TG_OP_SET:   return (value & ~TG_ALL_MASK) ? -1 : value;
+    case TG_OP_TALK:  return value < MAX_TALK_GROUPS ? mask : -1;
+    default:          return -1;
+  }
+}
+
+static inline int tgMeshEncode(uint8_t op, uint8_t value, uint8_t extra, uint8_t* out) {
+  out[0] = 'M';
+  out[1] = 'G';
+  out[2] = TG_MESH_VERSION;
+  out[3] = op;
+  out[4] = value;
+  out[5] = extra;
+  return TG_MESH_SIZE;
+}
+
+static inline bool tgMeshParse(const uint8_t* buf, int len, uint8_t& op, uint8_t& value, uint8_t& extra) {
+  if (len != TG_MESH_SIZE || buf[0] != 'M' || buf[1] != 'G' || buf[2] != TG_MESH_VERSION) return false;
+  op = buf[3];
+  value = buf[4];
+  extra = buf[5];
+  return true;
+}
+
+// Phone side: a complete WM frame (header already parsed) of type
+// WM_TYPE_GROUP
+static inline bool tgPhoneParse(const uint8_t* frame, const WmHeader& h, uint8_t& op, uint8_t& value) {
+  if (h.type != WM_TYPE_GROUP || h.payloadLen < 2) return false;
+  op = frame[h.headerLen];
+  value = frame[h.headerLen + 1];
+  return true;
+}
+
+static inline int tgPhoneEncodeState(uint8_t listenMask, uint8_t talkGroup, uint8_t* out) {
+  int len = wmWriteHeaderV1(out, WM_TYPE_GROUP, 0, 3);
+  out[len++] = TG_OP_STATE;
+  out[len++] = listenMask;
+  out[len++] = talkGroup;
+  return len;
+}
@@ -0,0 +1,152 @@
+/*
+ * Declarative task layout - see TaskLayout.h
+ */
+
+#include "TaskLayout.h"
+
+#include <Preferences.h>
+
+static const char* kStageNames[TASK_STAGE_COUNT] = {
+  "ingest", "ble_ingest", "send", "transcode", "notify", "housekeeping", "generator", "log"
+};
+
+// Wi-Fi and BLE controller tasks live on core 0 at high priority; the
+// Arduino loop task is core 1, priority 1.
+#define ANY TASK_ANY_CORE
+//                    ingest          ble_ingest      send            transcode        notify          housekeeping    generator       log
+const TaskLayout kTaskLayouts[] = {
+  { "baseline",    { { 1, 2, 8192 }, { 1, 2, 4096 }, { 1, 1, 4096 }, { 1, 1, 16384 }, { 1, 1, 4096 }, { 1, 1, 6144 }, { 1, 1, 4096 }, { 1, 1, 3072 } } },
+  { "radio_split", { { 0, 3, 8192 }, { 0, 3, 4096 }, { 1, 3, 4096 }, { 1, 1, 16384 }, { 1, 3, 4096 }, { 0, 1, 6144 }, { 1, 2, 4096 }, { 0, 1, 3072 } } },
+  { "audio_first", { { 1, 4, 8192 }, { 1, 4, 4096 }, { 1, 5, 4096 }, { 0, 2, 16384 }, { 1, 5, 4096 }, { 0, 1, 6144 }, { 1, 4, 4096 }, { 0, 1, 3072 } } },
+  { "floating",    { { ANY, 3, 8192 }, { ANY, 3, 4096 }, { ANY, 3, 4096 }, { ANY, 1, 16384 }, { ANY, 3, 4096 }, { ANY, 1, 6144 }, { ANY, 2, 4096 }, { ANY, 1, 3072 } } },
+};
+#undef ANY
+const int kTaskLayoutCount = sizeof(kTaskLayouts) / sizeof(kTaskLayouts[0]);
+
+TaskStageStats taskStageStats[TASK_STAGE_COUNT];
+
+static int activeLayout = TASK_LAYOUT_DEFAULT;
+
+// Saved benchmark summary, one NVS blob per layout
+struct TaskStageSummary {
+  uint32_t items;
+  uint32_t avgLatencyUs;
+  uint32_t maxLatencyUs;
+  uint16_t cpuPermille;
+};
+
+struct TaskLayoutResult {
+  uint32_t windowMs;
+  TaskStageSummary stages[TASK_STAGE_COUNT];
+};
+
+int taskLayoutLoad() {
+  Preferences prefs;
+  int index = TASK_LAYOUT_DEFAULT;
+  if (prefs.begin("tasklayout", true)) {
+    index = prefs.getInt("index", TASK_LAYOUT_DEFAULT);
+    prefs.end();
+  }
+  if (index < 0 || index >= kTaskLayoutCount) index = TASK_LAYOUT_DEFAULT;
+  activeLayout = index;
+  return activeLayout;
+}
+
+int taskLayoutActiveIndex() {
+  return activeLayout;
+}
+
+const TaskLayout& taskLayoutActive() {
+  return kTaskLayouts[activeLayout];
+}
+
+bool taskLayoutSelect(int index) {
+  if (index < 0 || index >= kTaskLayoutCount) return false;
+  Preferences prefs;
+  if (!prefs.begin("tasklayout", false)) return false;
+  prefs.putInt("index", index);
+  prefs.end();
+  return true;
+}
+
+BaseType_t taskLayoutSpawn(TaskStage stage, TaskFunction_t fn, const char* name, TaskHandle_t* handle) {
+  const TaskPlacement& p = taskLayoutActive().stages[stage];
+  BaseType_t core = p.core == TASK_ANY_CORE ? tskNO_AFFINITY : p.core;
+  BaseType_t ok = xTaskCreatePinnedToCore(fn, name, p.stackBytes, NULL, p.priority, handle, core);
+  Serial.printf("🧵 %-12s %-14s core %s prio %u stack %u %s\n", kStageNames[stage], name,
+                p.core == TASK_ANY_CORE ? "any" : (p.core == 0 ? "0" : "1"),
+                p.priority, p.stackBytes, ok == pdPASS ? "" : "FAILED");
+  return ok;
+}
+
+void taskStageReset() {
+  for (int i = 0; i < TASK_STAGE_COUNT; i++) {
+    taskStageStats[i].items = 0;
+    taskStageStats[i].latencySumUs = 0;
+    taskStageStats[i].latencyMaxUs = 0;
+    taskStageStats[i].busyUs = 0;
+  }
+}
+
+void taskLayoutPrintStats(uint32_t windowUs, bool save) {
+  TaskLayoutResult result;
+  memset(&result, 0, sizeof(result));
+  result.windowMs = windowUs / 1000;
+
+  Serial.printf("=== TASK LAYOUT %d \"%s\" (%.1f s window) ===\n",
+                activeLayout, taskLayoutActive().name, windowUs / 1e6f);
+  for (int i = 0; i < TASK_STAGE_COUNT; i++) {
+    const TaskStageStats& s = taskStageStats[i];
+    TaskStageSummary& out = result.stages[i];
+    out.items = s.items;
+    out.avgLatencyUs = s.items ? s.latencySumUs / s.items : 0;
+    out.maxLatencyUs = s.latencyMaxUs;
+    out.cpuPermille = windowUs ? (uint16_t)((uint64_t)s.busyUs * 1000 / windowUs) : 0;
+    if (s.items == 0 && s.busyUs == 0) continue;
+    Serial.printf("  %-12s items=%lu latency avg=%lu us max=%lu us cpu=%.1f%%\n", kStageNames[i],
+                  (unsigned long)out.items, (unsigned long)out.avgLatencyUs,
+                  (unsigned long)out.maxLatencyUs, out.cpuPermille / 10.0f);
+  }
+
+  if (!save) return;
+  Preferences prefs;
+  if (prefs.begin("tasklayout", false)) {
+    char key[8];
+    snprintf(key, sizeof(key), "r%d", activeLayout);
+    prefs.putBytes(key, &result, sizeof(result));
+    prefs.end();
+    Serial.printf("Saved as result for layout %d\n", activeLayout);
+  }
+}
+
+void taskLayoutPrintResults() {
+  Preferences prefs;
+  bool open = prefs.begin("tasklayout", true);
+  Serial.println("=== TASK LAYOUTS (latency avg/max us, cpu %) ===");
+  for (int l = 0; l < kTaskLayoutCount; l++) {
+    const TaskLayout& layout = kTaskLayouts[l];
+    Serial.printf("%c%d %-12s", l == activeLayout ? '*' : ' ', l, layout.name);
+    for (int i = 0; i < TASK_STAGE_COUNT; i++) {
+      const TaskPlacement& p = layout.stages[i];
+      Serial.printf(" %s:%c/p%u", kStageNames[i], p.core == TASK_ANY_CORE ? '*' : (char)('0' + p.core), p.priority);
+    }
+    Serial.println();
+
+    TaskLayoutResult result;
+    char key[8];
+    snprintf(key, sizeof(key), "r%d", l);
+    if (!open || prefs.getBytes(key, &result, sizeof(result)) != sizeof(result)) {
+      Serial.println("     (no benchmark saved)");
+      continue;
+    }
+    Serial.printf("     %lu ms:", (unsigned long)result.windowMs);
+    for (int i = 0; i < TASK_STAGE_COUNT; i++) {
+      const TaskStageSummary& s = result.stages[i];
+      if (s.items == 0 && s.cpuPermille == 0) continue;
+      Serial.printf(" %s %lu/%lu %.1f%%", kStageNames[i], (unsigned long)s.avgLatencyUs,
+                    (unsigned long)s.maxLatencyUs, s.cpuPermille / 10.0f);
+    }
+    Serial.println();
+  }
+  if (open) prefs.end();
+}
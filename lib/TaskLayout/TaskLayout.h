@@ -0,0 +1,97 @@
+/*
+ * Declarative task layout shared by both firmwares
+ *
+ * Every pipeline stage that owns a FreeRTOS task is created through
+ * taskLayoutSpawn(), which takes core, priority and stack size from the
+ * active row of kTaskLayouts. A firmware only spawns the stages it has
+ * (the client has no ingest or transcode tasks, for example).
+ *
+ * The active layout is stored in NVS. FreeRTOS cannot re-pin a running
+ * task, so taskLayoutSelect() is followed by a restart.
+ *
+ * Stages report queue latency (enqueue stamp to dequeue, or wake-up
+ * lateness for periodic stages) and busy time. bench_layout prints them
+ * per stage and saves a summary per layout so layouts can be compared.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+#define TASK_ANY_CORE -1
+
+#ifndef TASK_LAYOUT_DEFAULT
+#define TASK_LAYOUT_DEFAULT 0  // row used when NVS holds no choice
+#endif
+
+enum TaskStage {
+  TASK_STAGE_INGEST,        // ESP-NOW RX dispatch (coordinator)
+  TASK_STAGE_BLE_INGEST,    // BLE write reassembly and forward (coordinator)
+  TASK_STAGE_SEND,          // mesh audio sender (coordinator)
+  TASK_STAGE_TRANSCODE,     // Opus re-encode (coordinator)
+  TASK_STAGE_NOTIFY,        // BLE notify flush (client)
+  TASK_STAGE_HOUSEKEEPING,  // heartbeats, cleanup, statistics
+  TASK_STAGE_GENERATOR,     // test-signal source (coordinator)
+  TASK_STAGE_LOG,           // deferred log drain
+  TASK_STAGE_COUNT
+};
+
+struct TaskPlacement {
+  int8_t core;          // 0, 1 or TASK_ANY_CORE
+  uint8_t priority;
+  uint16_t stackBytes;
+};
+
+struct TaskLayout {
+  const char* name;
+  TaskPlacement stages[TASK_STAGE_COUNT];
+};
+
+// Per-stage counters, written by the stage task only
+struct TaskStageStats {
+  volatile uint32_t items;
+  volatile uint32_t latencySumUs;
+  volatile uint32_t latencyMaxUs;
+  volatile uint32_t busyUs;
+};
+
+extern const TaskLayout kTaskLayouts[];
+extern const int kTaskLayoutCount;
+extern TaskStageStats taskStageStats[TASK_STAGE_COUNT];
+
+// Read the persisted choice (call once in setup before spawning)
+int taskLayoutLoad();
+int taskLayoutActiveIndex();
+const TaskLayout& taskLayoutActive();
+
+// Persist a new layout; takes effect after ESP.restart()
+bool taskLayoutSelect(int index);
+
+BaseType_t taskLayoutSpawn(TaskStage stage, TaskFunction_t fn, const char* name, TaskHandle_t* handle);
+
+// Timestamps are microseconds from esp_timer, valid across cores
+static inline uint32_t taskStageNowUs() {
+  return (uint32_t)esp_timer_get_time();
+}
+
+static inline void taskStageRecordLatency(TaskStage stage, uint32_t queuedUs) {
+  TaskStageStats& s = taskStageStats[stage];
+  uint32_t latency = taskStageNowUs() - queuedUs;
+  s.items++;
+  s.latencySumUs += latency;
+  if (latency > s.latencyMaxUs) s.latencyMaxUs = latency;
+}
+
+// Busy time includes any time the stage was preempted
+static inline void taskStageAddBusy(TaskStage stage, uint32_t startUs) {
+  taskStageStats[stage].busyUs += taskStageNowUs() - startUs;
+}
+
+void taskStageReset();
+
+// Print per-stage stats for a window, optionally saving them for the active layout
+void taskLayoutPrintStats(uint32_t windowUs, bool save);
+
+// Print the layout table and every saved benchmark summary
+void taskLayoutPrintResults();
@@ -0,0 +1,212 @@
+/*
+ * Hierarchical timer wheel - see TimerWheel.h
+ */
+
+#include "TimerWheel.h"
+
+#include <string.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+#define LEVEL_MASK (TIMER_WHEEL_SLOTS - 1)
+#define IN_FLIGHT  -2  // detached while its slot is being fired
+
+static inline uint64_t expiryTick(const WheelTimer& t) {
+  return (t.deadlineUs + TIMER_WHEEL_TICK_US - 1) / TIMER_WHEEL_TICK_US;
+}
+
+// Put an armed, unfiled timer into the slot for its deadline
+static void fileTimer(TimerWheel& wheel, int id) {
+  WheelTimer& t = wheel.timers[id];
+  uint64_t expiry = expiryTick(t);
+  if (expiry < wheel.tick) expiry = wheel.tick;
+  uint64_t delta = expiry - wheel.tick;
+
+  int level;
+  uint64_t slotTick = expiry;
+  if (delta < TIMER_WHEEL_SLOTS) {
+    level = 0;
+  } else if (delta < (1u << (2 * TIMER_WHEEL_SLOT_BITS))) {
+    level = 1;
+  } else {
+    level = 2;
+    // Beyond the wheel: park in the last top-level slot and re-file from there
+    uint64_t horizon = wheel.tick + (1u << (3 * TIMER_WHEEL_SLOT_BITS)) - 1;
+    if (slotTick > horizon) slotTick = horizon;
+  }
+  uint8_t slot = (slotTick >> (level * TIMER_WHEEL_SLOT_BITS)) & LEVEL_MASK;
+  t.level = (int8_t)level;
+  t.slot = slot;
+  t.next = wheel.slots[level][slot];
+  wheel.slots[level][slot] = (int8_t)id;
+}
+
+static void unfileTimer(TimerWheel& wheel, int id) {
+  WheelTimer& t = wheel.timers[id];
+  if (t.level < 0) return;
+  int8_t* link = &wheel.slots[t.level][t.slot];
+  while (*link != -1) {
+    if (*link == id) {
+      *link = t.next;
+      break;
+    }
+    link = &wheel.timers[*link].next;
+  }
+  t.level = -1;
+}
+
+void timerWheelInit(TimerWheel& wheel, TimerClock nowUs) {
+  memset(&wheel, 0, sizeof(wheel));
+  memset(wheel.slots, -1, sizeof(wheel.slots));
+  wheel.nowUs = nowUs;
+  wheel.tick = nowUs() / TIMER_WHEEL_TICK_US;
+  for (int i = 0; i < TIMER_WHEEL_MAX_TIMERS; i++) wheel.timers[i].level = -1;
+}
+
+int timerWheelAdd(TimerWheel& wheel, const char* name, TimerCallback fn, void* arg,
+                  uint32_t firstUs, uint32_t periodUs) {
+  for (int id = 0; id < TIMER_WHEEL_MAX_TIMERS; id++) {
+    WheelTimer& t = wheel.timers[id];
+    if (t.used) continue;
+    memset(&t, 0, sizeof(t));
+    t.used = true;
+    t.name = name;
+    t.fn = fn;
+    t.arg = arg;
+    t.periodUs = periodUs;
+    t.level = -1;
+    timerWheelArm(wheel, id, firstUs);
+    return id;
+  }
+  return -1;
+}
+
+void timerWheelArm(TimerWheel& wheel, int id, uint32_t delayUs) {
+  if (id < 0 || id >= TIMER_WHEEL_MAX_TIMERS || !wheel.timers[id].used) return;
+  WheelTimer& t = wheel.timers[id];
+  unfileTimer(wheel, id);
+  // Deadlines sit on tick boundaries so an on-time wake-up fires with no lateness
+  t.deadlineUs = (wheel.nowUs() + delayUs + TIMER_WHEEL_TICK_US - 1) / TIMER_WHEEL_TICK_US * TIMER_WHEEL_TICK_US;
+  t.armed = true;
+  if (t.level == IN_FLIGHT) {
+    t.rearmed = true;  // filed after its callback returns
+  } else {
+    fileTimer(wheel, id);
+  }
+}
+
+void timerWheelCancel(TimerWheel& wheel, int id) {
+  if (id < 0 || id >= TIMER_WHEEL_MAX_TIMERS) return;
+  unfileTimer(wheel, id);
+  wheel.timers[id].armed = false;
+}
+
+// Move every timer in a coarse slot down to the level its deadline now needs
+static void cascade(TimerWheel& wheel, int level, uint8_t slot) {
+  int8_t id = wheel.slots[level][slot];
+  wheel.slots[level][slot] = -1;
+  while (id != -1) {
+    int8_t next = wheel.timers[id].next;
+    wheel.timers[id].level = -1;
+    fileTimer(wheel, id);
+    wheel.cascades++;
+    id = next;
+  }
+}
+
+static void fire(TimerWheel& wheel, WheelTimer& t) {
+  uint64_t now = wheel.nowUs();
+  uint32_t lateness = now > t.deadlineUs ? (uint32_t)(now - t.deadlineUs) : 0;
+  t.fires++;
+  t.latenessSumUs += lateness;
+  if (lateness > t.latenessMaxUs) t.latenessMaxUs = lateness;
+
+  t.rearmed = false;
+  t.fn(t.arg);
+  uint64_t end = wheel.nowUs();
+  if (end - now > t.runMaxUs) t.runMaxUs = (uint32_t)(end - now);
+
+  if (!t.armed || t.rearmed) return;  // callback cancelled or re-armed it
+  if (t.periodUs == 0) {
+    t.armed = false;
+    return;
+  }
+  t.deadlineUs += t.periodUs;
+  while (t.deadlineUs <= end) {
+    t.deadlineUs += t.periodUs;
+    t.missed++;
+  }
+}
+
+static void processTick(TimerWheel& wheel, uint64_t tick) {
+  wheel.tick = tick;
+  if ((tick & LEVEL_MASK) == 0) {
+    if ((tick & ((1u << (2 * TIMER_WHEEL_SLOT_BITS)) - 1)) == 0) {
+      cascade(wheel, 2, (tick >> (2 * TIMER_WHEEL_SLOT_BITS)) & LEVEL_MASK);
+    }
+    cascade(wheel, 1, (tick >> TIMER_WHEEL_SLOT_BITS) & LEVEL_MASK);
+  }
+
+  // Detach the due slot so callbacks can add, arm or cancel freely
+  uint8_t slot = tick & LEVEL_MASK;
+  int8_t id = wheel.slots[0][slot];
+  wheel.slots[0][slot] = -1;
+  for (int8_t i = id; i != -1; i = wheel.timers[i].next) wheel.timers[i].level = IN_FLIGHT;
+  wheel.tick = tick + 1;
+
+  while (id != -1) {
+    WheelTimer& t = wheel.timers[id];
+    int8_t next = t.next;
+    if (t.armed && expiryTick(t) <= tick) fire(wheel, t);
+    t.level = -1;
+    if (t.armed) fileTimer(wheel, id);
+    id = next;
+  }
+}
+
+uint32_t timerWheelRunDue(TimerWheel& wheel) {
+  uint64_t nowTick = wheel.nowUs() / TIMER_WHEEL_TICK_US;
+  while (wheel.tick <= nowTick) processTick(wheel, wheel.tick);
+  return timerWheelNextDelayUs(wheel);
+}
+
+uint32_t timerWheelNextDelayUs(const TimerWheel& wheel) {
+  uint64_t now = wheel.nowUs();
+  uint64_t best = now + TIMER_WHEEL_IDLE_US;
+  for (int id = 0; id < TIMER_WHEEL_MAX_TIMERS; id++) {
+    const WheelTimer& t = wheel.timers[id];
+    if (!t.used || !t.armed) continue;
+    uint64_t due = expiryTick(t) * TIMER_WHEEL_TICK_US;  // when RunDue will actually fire it
+    if (due < best) best = due;
+  }
+  return best > now ? (uint32_t)(best - now) : 0;
+}
+
+void timerWheelResetStats(TimerWheel& wheel) {
+  for (int id = 0; id < TIMER_WHEEL_MAX_TIMERS; id++) {
+    WheelTimer& t = wheel.timers[id];
+    t.fires = 0;
+    t.missed = 0;
+    t.latenessMaxUs = 0;
+    t.latenessSumUs = 0;
+    t.runMaxUs = 0;
+  }
+  wheel.cascades = 0;
+}
+
+#ifdef ARDUINO
+void timerWheelPrintStats(const TimerWheel& wheel, const char* title) {
+  Serial.printf("=== %s TIMERS (lateness avg/max us, run max us) ===\n", title);
+  for (int id = 0; id < TIMER_WHEEL_MAX_TIMERS; id++) {
+    const WheelTimer& t = wheel.timers[id];
+    if (!t.used) continue;
+    Serial.printf("  %-14s every %6lu ms fires=%lu late=%lu/%lu missed=%lu run=%lu%s\n", t.name,
+                  (unsigned long)(t.periodUs / 1000), (unsigned long)t.fires,
+                  (unsigned long)(t.fires ? t.latenessSumUs / t.fires : 0), (unsigned long)t.latenessMaxUs,
+                  (unsigned long)t.missed, (unsigned long)t.runMaxUs, t.armed ? "" : " (idle)");
+  }
+  Serial.printf("Cascades: %lu\n", (unsigned long)wheel.cascades);
+}
+#endif
@@ -0,0 +1,83 @@
+/*
+ * Hierarchical timer wheel for periodic housekeeping (both firmwares)
+ *
+ * Three levels of 64 slots at 1 ms, 64 ms and 4.096 s granularity cover
+ * deadlines up to ~4.4 minutes; anything later parks in the top level and
+ * is re-filed when its slot comes round. Insert and expiry are O(1); the
+ * owning task asks timerWheelRunDue() to fire everything that is due and
+ * sleeps for the returned time, so it wakes exactly at the next deadline
+ * instead of polling.
+ *
+ * Periodic timers are re-armed from their previous deadline, not from the
+ * time they ran, so lateness never accumulates; whole periods that were
+ * missed are skipped and counted. Per-timer lateness (fire time minus
+ * deadline) and callback run time are kept for the console.
+ *
+ * The clock is a function pointer (esp_timer on target), so the wheel runs
+ * unchanged against a virtual clock on the host. Not thread-safe: add and
+ * cancel timers before the driving task starts or from its callbacks.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define TIMER_WHEEL_LEVELS     3
+#define TIMER_WHEEL_SLOT_BITS  6
+#define TIMER_WHEEL_SLOTS      (1 << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_TICK_US    1000
+#define TIMER_WHEEL_MAX_TIMERS 16
+#define TIMER_WHEEL_IDLE_US    1000000  // sleep when nothing is armed
+
+typedef void (*TimerCallback)(void* arg);
+typedef uint64_t (*TimerClock)();
+
+struct WheelTimer {
+  const char* name;
+  TimerCallback fn;
+  void* arg;
+  uint64_t deadlineUs;
+  uint32_t periodUs;        // 0 = one-shot
+  int8_t next;              // next timer in the same slot, -1 = end
+  int8_t level;             // -1 = not filed
+  uint8_t slot;
+  bool used;
+  bool armed;
+  bool rearmed;             // armed again from inside its own callback
+  // Counters
+  uint32_t fires;
+  uint32_t missed;          // whole periods skipped after a late fire
+  uint32_t latenessMaxUs;
+  uint64_t latenessSumUs;
+  uint32_t runMaxUs;
+};
+
+struct TimerWheel {
+  TimerClock nowUs;
+  uint64_t tick;            // every tick before this one has been processed
+  int8_t slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+  WheelTimer timers[TIMER_WHEEL_MAX_TIMERS];
+  uint32_t cascades;        // timers re-filed to a finer level
+};
+
+void timerWheelInit(TimerWheel& wheel, TimerClock nowUs);
+
+// Create a timer; first deadline firstUs from now. Returns its id or -1.
+int timerWheelAdd(TimerWheel& wheel, const char* name, TimerCallback fn, void* arg,
+                  uint32_t firstUs, uint32_t periodUs);
+
+// Re-arm an existing timer delayUs from now (period unchanged)
+void timerWheelArm(TimerWheel& wheel, int id, uint32_t delayUs);
+void timerWheelCancel(TimerWheel& wheel, int id);
+
+// Fire every timer due by now; returns microseconds until the next deadline
+uint32_t timerWheelRunDue(TimerWheel& wheel);
+
+// Microseconds until the earliest armed deadline, TIMER_WHEEL_IDLE_US if none
+uint32_t timerWheelNextDelayUs(const TimerWheel& wheel);
+
+void timerWheelResetStats(TimerWheel& wheel);
+
+#ifdef ARDUINO
+void timerWheelPrintStats(const TimerWheel& wheel, const char* title);
+#endif
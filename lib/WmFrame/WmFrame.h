@@ -0,0 +1,272 @@
+/*
+ * WM audio frame header shared by both firmwares (see OpusFrameFormat.kt)
+ *
+ * v1 (7 bytes):  'W','M', type, seq(le16), len(le16), payload
+ * v2 (16 bytes): 'W','M', type|0x80, seq(le16), len(le16),
+ *                extLen, flags, streamId, seqHigh(le16), timestamp(le32), payload
+ *
+ * v2 keeps the v1 prefix so old reassemblers still find the payload length
+ * at [5..6]. extLen counts the bytes after itself (8, plus the optional
+ * fields below); parsers skip any extension they do not understand.
+ * The sequence is 32 bits (low half at [3..4], high half at [10..11]) and
+ * the timestamp counts 48 kHz ticks of media time, as RTP does for Opus,
+ * whatever the payload rate.
+ *
+ * Optional fields follow the timestamp in this order, each present only
+ * when its flag is set:
+ *
+ *   WM_FLAG_MEMBERSHIP  members, membersVersion  (2 bytes)
+ *   WM_FLAG_GROUP       talk group               (1 byte)
+ *
+ * Membership: the coordinator adds it to an audio frame after a membership
+ * change and about once a second. membersVersion is the low byte of the
+ * membership log version (lib/MeshMembers), so a client that missed a
+ * delta notices while audio flows and asks for a snapshot.
+ *
+ * Talk group (lib/TalkGroup): the group a frame is addressed to. The
+ * coordinator sends it only to the peers listening to that group. A frame
+ * without it is for the sender's current talk group (group 0 by default).
+ *
+ * WmReassembler rebuilds frames from a byte stream cut at arbitrary points
+ * (the phone's BLE writes) in a buffer the caller owns.
+ *
+ * Header-only so parsing inlines into the ESP-NOW receive callback.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#define WM_HEADER_V1_SIZE  7
+#define WM_HEADER_V2_SIZE  16
+#define WM_V2_EXT_SIZE     (WM_HEADER_V2_SIZE - WM_HEADER_V1_SIZE - 1)
+#define WM_MEMBERSHIP_SIZE 2
+#define WM_GROUP_SIZE      1
+#define WM_HEADER_V2_MAX_SIZE (WM_HEADER_V2_SIZE + WM_MEMBERSHIP_SIZE + WM_GROUP_SIZE)
+#define WM_TYPE_V2_BIT     0x80
+#define WM_TYPE_MASK       0x7F
+#define WM_TIMESTAMP_HZ    48000
+
+// Frame types
+#define WM_TYPE_OPUS    1  // Opus payload, forwarded unchanged
+#define WM_TYPE_ULAW_NB 2  // u-law at 8 kHz, client upsamples before BLE notify
+#define WM_TYPE_FLOW    3  // coordinator -> phone flow control, payload 1 = pause, 0 = resume
+#define WM_TYPE_GROUP   4  // talk group control between a phone and its ESP32 (lib/TalkGroup)
+
+// v2 flags
+#define WM_FLAG_MARKER     0x01  // first frame of a talk spurt
+#define WM_FLAG_TRANSCODED 0x02  // re-encoded by the coordinator
+#define WM_FLAG_MEMBERSHIP 0x04  // members + membersVersion follow the timestamp
+#define WM_FLAG_GROUP      0x08  // talk group follows (after the membership, if any)
+
+struct WmHeader {
+  uint8_t version;      // 1 or 2
+  uint8_t type;         // WM_TYPE_*, version bit stripped
+  uint8_t flags;        // v2 only
+  uint8_t streamId;     // v2 only, 0 = unknown
+  uint16_t headerLen;   // bytes before the payload
+  uint16_t payloadLen;
+  uint32_t sequence;    // v1: 16-bit value, extend with wmExtendSequence()
+  uint32_t timestamp;   // v2 only, WM_TIMESTAMP_HZ ticks
+  uint8_t members;      // WM_FLAG_MEMBERSHIP only: active mesh peers
+  uint8_t membersVersion; // WM_FLAG_MEMBERSHIP only: low byte of the membership log version
+  uint8_t group;        // WM_FLAG_GROUP only: talk group
+};
+
+// Parse a header at buf. Returns the header length, 0 if more bytes are
+// needed, or -1 if buf does not start with a valid WM header.
+static inline int wmParseHeader(const uint8_t* buf, int available, WmHeader& out) {
+  if (available < 2) return 0;
+  if (buf[0] != 'W' || buf[1] != 'M') return -1;
+  if (available < WM_HEADER_V1_SIZE) return 0;
+  uint8_t rawType = buf[2];
+  out.type = rawType & WM_TYPE_MASK;
+  out.sequence = (uint32_t)buf[3] | ((uint32_t)buf[4] << 8);
+  out.payloadLen = (uint16_t)(buf[5] | (buf[6] << 8));
+  if (!(rawType & WM_TYPE_V2_BIT)) {
+    out.version = 1;
+    out.flags = 0;
+    out.streamId = 0;
+    out.timestamp = 0;
+    out.members = 0;
+    out.membersVersion = 0;
+    out.group = 0;
+    out.headerLen = WM_HEADER_V1_SIZE;
+    return WM_HEADER_V1_SIZE;
+  }
+  if (available < WM_HEADER_V1_SIZE + 1) return 0;
+  uint8_t extLen = buf[7];
+  if (extLen < WM_V2_EXT_SIZE) return -1;
+  int headerLen = WM_HEADER_V1_SIZE + 1 + extLen;
+  if (available < headerLen) return 0;
+  out.version = 2;
+  out.flags = buf[8];
+  out.streamId = buf[9];
+  out.sequence |= ((uint32_t)buf[10] << 16) | ((uint32_t)buf[11] << 24);
+  out.timestamp = (uint32_t)buf[12] | ((uint32_t)buf[13] << 8) |
+                  ((uint32_t)buf[14] << 16) | ((uint32_t)buf[15] << 24);
+  int field = WM_HEADER_V2_SIZE;
+  if ((out.flags & WM_FLAG_MEMBERSHIP) && field + WM_MEMBERSHIP_SIZE <= headerLen) {
+    out.members = buf[field];
+    out.membersVersion = buf[field + 1];
+    field += WM_MEMBERSHIP_SIZE;
+  } else {
+    out.flags &= ~WM_FLAG_MEMBERSHIP;
+    out.members = 0;
+    out.membersVersion = 0;
+  }
+  if ((out.flags & WM_FLAG_GROUP) && field + WM_GROUP_SIZE <= headerLen) {
+    out.group = buf[field];
+  } else {
+    out.flags &= ~WM_FLAG_GROUP;
+    out.group = 0;
+  }
+  out.headerLen = (uint16_t)headerLen;
+  return headerLen;
+}
+
+// Total frame length (header + payload) for reassembly, same return codes
+static inline int wmFrameLength(const uint8_t* buf, int available, int maxPayload) {
+  WmHeader h;
+  int headerLen = wmParseHeader(buf, available, h);
+  if (headerLen <= 0) return headerLen;
+  if (h.payloadLen < 1 || h.payloadLen > maxPayload) return -1;
+  return headerLen + h.payloadLen;
+}
+
+static inline int wmWriteHeaderV1(uint8_t* buf, uint8_t type, uint16_t sequence, uint16_t payloadLen) {
+  buf[0] = 'W';
+  buf[1] = 'M';
+  buf[2] = type & WM_TYPE_MASK;
+  buf[3] = sequence & 0xFF;
+  buf[4] = (sequence >> 8) & 0xFF;
+  buf[5] = payloadLen & 0xFF;
+  buf[6] = (payloadLen >> 8) & 0xFF;
+  return WM_HEADER_V1_SIZE;
+}
+
+// Writes WM_HEADER_V2_SIZE bytes plus the optional fields h.flags asks for
+// (at most WM_HEADER_V2_MAX_SIZE)
+static inline int wmWriteHeaderV2(uint8_t* buf, const WmHeader& h) {
+  wmWriteHeaderV1(buf, h.type, (uint16_t)h.sequence, h.payloadLen);
+  buf[2] |= WM_TYPE_V2_BIT;
+  buf[7] = WM_V2_EXT_SIZE;
+  buf[8] = h.flags;
+  buf[9] = h.streamId;
+  buf[10] = (h.sequence >> 16) & 0xFF;
+  buf[11] = (h.sequence >> 24) & 0xFF;
+  buf[12] = h.timestamp & 0xFF;
+  buf[13] = (h.timestamp >> 8) & 0xFF;
+  buf[14] = (h.timestamp >> 16) & 0xFF;
+  buf[15] = (h.timestamp >> 24) & 0xFF;
+  int len = WM_HEADER_V2_SIZE;
+  if (h.flags & WM_FLAG_MEMBERSHIP) {
+    buf[len++] = h.members;
+    buf[len++] = h.membersVersion;
+  }
+  if (h.flags & WM_FLAG_GROUP) buf[len++] = h.group;
+  buf[7] = (uint8_t)(len - WM_HEADER_V1_SIZE - 1);
+  return len;
+}
+
+// Copy a complete v2 frame into out with the membership extension added.
+// Returns the new length, or 0 if in is v1, already carries a membership or
+// an extension this header does not know, or if out is too small.
+static inline int wmAddMembership(const uint8_t* in, int len, uint8_t members, uint8_t membersVersion,
+                                  uint8_t* out, int outSize) {
+  if (len < WM_HEADER_V2_SIZE || in[0] != 'W' || in[1] != 'M' || !(in[2] & WM_TYPE_V2_BIT) ||
+      (in[8] & WM_FLAG_MEMBERSHIP) || len + WM_MEMBERSHIP_SIZE > outSize) {
+    return 0;
+  }
+  int known = WM_V2_EXT_SIZE + ((in[8] & WM_FLAG_GROUP) ? WM_GROUP_SIZE : 0);
+  if (in[7] != known) return 0;
+  memcpy(out, in, WM_HEADER_V2_SIZE);
+  out[7] = (uint8_t)(known + WM_MEMBERSHIP_SIZE);
+  out[8] |= WM_FLAG_MEMBERSHIP;
+  out[16] = members;
+  out[17] = membersVersion;
+  memcpy(out + WM_HEADER_V2_SIZE + WM_MEMBERSHIP_SIZE, in + WM_HEADER_V2_SIZE, len - WM_HEADER_V2_SIZE);
+  return len + WM_MEMBERSHIP_SIZE;
+}
+
+// Unwrap a 16-bit v1 sequence against the last extended one (RFC 3550 style)
+static inline uint32_t wmExtendSequence(uint32_t last, uint16_t seq16) {
+  int16_t delta = (int16_t)(seq16 - (uint16_t)last);
+  return last + (int32_t)delta;
+}
+
+// Reassembly of WM frames from a byte stream; buf is owned by the caller
+struct WmReassembler {
+  uint8_t* buf;
+  int size;
+  int index;  // bytes held
+};
+
+typedef void (*WmFrameSink)(const uint8_t* frame, int len, void* ctx);
+
+static inline void wmReassemblerInit(WmReassembler& rx, uint8_t* buf, int size) {
+  rx.buf = buf;
+  rx.size = size;
+  rx.index = 0;
+}
+
+// Append a chunk and pass every complete frame to sink (in place, valid for
+// the call only). Bytes before a 'WM' magic are skipped, a trailing 'W' is
+// kept in case the 'M' starts the next chunk, and a malformed header
+// realigns to the next magic. Returns the highest fill level reached.
+static inline int wmReassemblerFeed(WmReassembler& rx, const uint8_t* data, int len, int maxPayload,
+                                    WmFrameSink sink, void* ctx) {
+  int highWater = rx.index;
+  if (len <= 0 || !data) return highWater;
+  int offset = 0;
+  while (offset < len) {
+    // If buffer empty, try to align to WM magic
+    if (rx.index == 0) {
+      int start = -1;
+      for (int i = offset; i + 1 < len; i++) {
+        if (data[i] == 'W' && data[i+1] == 'M') { start = i; break; }
+      }
+      if (start < 0) {
+        if (data[len - 1] != 'W') return highWater; // no header in this chunk
+        start = len - 1;  // the magic may straddle two writes
+      }
+      offset = start;
+    }
+    // Copy as much as fits
+    int space = rx.size - rx.index;
+    if (space <= 0) { rx.index = 0; return highWater; }
+    int copyLen = (len - offset) < space ? (len - offset) : space;
+    memcpy(rx.buf + rx.index, data + offset, copyLen);
+    rx.index += copyLen;
+    if (rx.index > highWater) highWater = rx.index;
+    offset += copyLen;
+
+    // Pass on every complete frame now in the buffer
+    while (rx.index >= WM_HEADER_V1_SIZE) {
+      int expected = wmFrameLength(rx.buf, rx.index, maxPayload);
+      if (expected > 0 && rx.index >= expected) {
+        sink(rx.buf, expected, ctx);
+        // Shift remaining bytes
+        int remain = rx.index - expected;
+        if (remain > 0) memmove(rx.buf, rx.buf + expected, remain);
+        rx.index = remain;
+      } else if (expected < 0) {
+        // Malformed or wrong magic: realign to the next 'WM' in the buffer
+        int realign = -1;
+        for (int i = 1; i < rx.index; i++) {
+          if (rx.buf[i] == 'W' && (i + 1 == rx.index || rx.buf[i+1] == 'M')) { realign = i; break; }
+        }
+        if (realign >= 0) {
+          rx.index -= realign;
+          memmove(rx.buf, rx.buf + realign, rx.index);
+        } else {
+          rx.index = 0;
+        }
+      } else {
+        break;  // need more bytes
+      }
+    }
+  }
+  return highWater;
+}
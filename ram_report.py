@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+"""
+Print the static RAM budget of both firmwares
+
+Compiles a tiny host program against lib/BufferConfig/BufferConfig.h and
+prints every buffer pool (slots, slot size, region) and how much of each
+budget in BUFFER_BUDGETS is used, so the numbers always come from the
+header the firmware is built with. With --elf it also lists the largest
+.bss/.data symbols of a firmware image (needs nm, or pass --nm for the
+xtensa toolchain one).
+
+The budgets themselves are static_asserts in BufferConfig.h; this script
+only reports. Used as a PlatformIO post script (extra_scripts =
+post:ram_report.py) it runs after every link and passes the buffer
+overrides among the build's -D flags, e.g. -DBLE_IN_QUEUE_DEPTH=64.
+
+Examples:
+  ./ram_report.py
+  ./ram_report.py -DBLE_IN_QUEUE_DEPTH=64
+  ./ram_report.py --elf .pio/build/esp32-s3-devkitc-1/firmware.elf --nm xtensa-esp32s3-elf-nm
+"""
+
+import argparse
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+from pathlib import Path
+
+REPO_ROOT = Path(__file__).resolve().parent if "__file__" in globals() else None
+HEADER_DIR = Path("lib") / "BufferConfig"
+
+REPORT_SOURCE = r"""
+#include <stdio.h>
+#include "BufferConfig.h"
+
+static const char* fwName(uint8_t fw) {
+  return fw == BUF_FW_COORD ? "coord" : fw == BUF_FW_CLIENT ? "client" : "both";
+}
+
+int main() {
+  printf("%-15s %-6s %-5s %-8s %5s %6s %8s\n", "pool", "fw", "sub", "region", "slots", "slot B", "total B");
+  for (int i = 0; i < BUF_POOL_COUNT; i++) {
+    const BufferPoolInfo& p = kBufferPools[i];
+    printf("%-15s %-6s %-5s %-8s %5u %6u %8u\n", p.name, fwName(p.firmware), kBufferSubsystemNames[p.subsystem],
+           p.region == BUF_PSRAM ? "psram" : "internal", (unsigned)p.slots, (unsigned)p.slotBytes,
+           (unsigned)(p.slots * p.slotBytes));
+  }
+  printf("\n%-6s %-8s %-5s %8s %8s %5s\n", "fw", "region", "sub", "used B", "limit B", "use");
+  for (const BufferBudget& b : kBufferBudgets) {
+    uint32_t used = bufferBytesUsed(b.firmware, b.region, b.subsystem);
+    printf("%-6s %-8s %-5s %8u %8u %4u%%\n", fwName(b.firmware), b.region == BUF_PSRAM ? "psram" : "internal",
+           kBufferSubsystemNames[b.subsystem], (unsigned)used, (unsigned)b.limit, (unsigned)(used * 100 / b.limit));
+  }
+  return 0;
+}
+"""
+
+
+def budget_report(repo: Path, defines, cxx: str) -> bool:
+    """Compile and run the pool/budget table; False if the host build fails"""
+    if not shutil.which(cxx):
+        print(f"ram_report: {cxx} not found, skipping the budget table")
+        return False
+    with tempfile.TemporaryDirectory() as tmp:
+        src = Path(tmp) / "ram_report.cpp"
+        exe = Path(tmp) / "ram_report"
+        src.write_text(REPORT_SOURCE)
+        cmd = [cxx, "-std=c++17", "-O0", f"-I{repo / HEADER_DIR}", *defines, str(src), "-o", str(exe)]
+        build = subprocess.run(cmd, capture_output=True, text=True)
+        if build.returncode != 0:
+            # A budget static_assert fires here as well as in the firmware
+            print(build.stderr, file=sys.stderr)
+            return False
+        print("=== BUFFER POOLS (lib/BufferConfig) ===")
+        print(subprocess.run([str(exe)], capture_output=True, text=True, check=True).stdout, end="")
+    return True
+
+
+def elf_report(elf: Path, nm: str, top: int):
+    """Largest RAM symbols: b/B (.bss) and d/D (.data) from nm --size-sort"""
+    out = subprocess.run([nm, "--size-sort", "-S", "-C", str(elf)], capture_output=True, text=True)
+    if out.returncode != 0:
+        print(f"ram_report: {nm} failed: {out.stderr.strip()}")
+        return
+    symbols = []
+    for line in out.stdout.splitlines():
+        parts = line.split(None, 3)
+        if len(parts) == 4 and parts[2] in "bBdD":
+            symbols.append((int(parts[1], 16), parts[2].lower(), parts[3]))
+    symbols.sort(reverse=True)
+    bss = sum(size for size, kind, _ in symbols if kind == "b")
+    data = sum(size for size, kind, _ in symbols if kind == "d")
+    print(f"=== {elf.name}: .bss {bss} B, .data {data} B, top {top} ===")
+    for size, kind, name in symbols[:top]:
+        print(f"  {size:7d} {'.bss ' if kind == 'b' else '.data'} {name}")
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--elf", type=Path, help="firmware.elf to list the largest RAM symbols of")
+    parser.add_argument("--nm", default="nm", help="nm binary for --elf (default: nm)")
+    parser.add_argument("--cxx", default=os.environ.get("CXX", "c++"), help="host C++ compiler")
+    parser.add_argument("--top", type=int, default=20, help="symbols to list with --elf")
+    args, rest = parser.parse_known_args()
+    defines = [a for a in rest if a.startswith("-D")]  # the flags the firmware is built with
+    if len(defines) != len(rest):
+        parser.error(f"unrecognized arguments: {' '.join(a for a in rest if not a.startswith('-D'))}")
+
+    ok = budget_report(REPO_ROOT, defines, args.cxx)
+    if args.elf:
+        elf_report(args.elf, args.nm, args.top)
+    return 0 if ok else 1
+
+
+def pio_post_script(env):
+    """Runs as extra_scripts = post:...; reports after each firmware link"""
+    repo = Path(env.subst("$PROJECT_DIR")).resolve()
+    while not (repo / HEADER_DIR).is_dir() and repo.parent != repo:
+        repo = repo.parent  # the client project lives one level down
+    nm = env.subst("$CC").replace("gcc", "nm")
+    defines = [f"-D{d}" if isinstance(d, str) else f"-D{d[0]}={d[1]}" for d in env.get("CPPDEFINES", [])
+               if (d if isinstance(d, str) else d[0]).startswith("BLE_IN_QUEUE_DEPTH")]
+
+    def report(target, source, env):
+        budget_report(repo, defines, "c++")
+        elf_report(Path(str(target[0])), nm, 10)
+
+    env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", report)
+
+
+try:
+    Import("env")  # noqa: F821 - defined when PlatformIO runs this file
+except NameError:
+    sys.exit(main())
+else:
+    pio_post_script(env)  # noqa: F821
@@ -24,6 +24,31 @@
 #include <esp_now.h>
 #include <ArduinoJson.h>
 #include <Adafruit_NeoPixel.h>
+#include <AudioMeter.h>
+#include <AutoGain.h>
+#include <OpusTranscoder.h>
+#include <WmFrame.h>
+#include <TaskLayout.h>
+#include <FanoutSet.h>
+#include <PeerTable.h>
+#include <SignalGen.h>
+#include <TimerWheel.h>
+#include <DeferredLog.h>
+#include <AllocTrack.h>
+#include <DeadlineMonitor.h>
+#include <MemPlace.h>
+#include <BufferConfig.h>
+#include <MeshBeacon.h>
+#include <MeshElection.h>
+#include <MeshAirtime.h>
+#include <MeshMembers.h>
+#include <FailureDetector.h>
+#include <MeshChannel.h>
+#include <MeshState.h>
+#include <TalkGroup.h>
+#include <opus.h>
+#include <G711.h>
+#include <Resampler.h>
 
 // BLE UUIDs matching the Android app
 #define SERVICE_UUID        "4fafc201-1fb5-459e-8fcc-c5c9c331914b"
@@ -33,8 +58,7 @@
 // Device name that Android app looks for
 #define DEVICE_NAME "ESP32S3_Audio_Server"
 
-// Audio buffer size (320 bytes as expected by Android app)
-#define AUDIO_BUFFER_SIZE 1024  // Increased to handle multiple chunks safely
+// Buffer sizes and RAM budgets live in lib/BufferConfig (pool_stats, ram_report.py)
 
 // Pin definitions for ESP32-S3-DevKitC-1
 #define STATUS_LED_PIN 48    // GPIO48 - RGB LED (built-in)
@@ -42,26 +66,42 @@
 #define NUM_LEDS 1           // Number of RGB LEDs
 
 // Mesh Network Configuration for 4 Devices
-#define MESH_CHANNEL 1
+#define MESH_CHANNEL 1  // boot channel until the mesh moves (lib/MeshChannel)
 #define MAX_MESH_DEVICES 4
 #define MESH_BROADCAST_INTERVAL 5000  // 5 seconds
 #define MESH_HEARTBEAT_INTERVAL 5000  // 5 seconds (increased for stability)
 #define DEVICE_TIMEOUT 30000          // 30 seconds (increased for stability)
 
-// Mesh device management
-struct MeshDevice {
-  uint8_t mac[6];
-  String deviceName;
-  String deviceType;
-  unsigned long lastSeen;
-  bool isActive;
-  bool isCoordinator;
-  int audioQuality;
+// Mesh device management: packed MACs and an active bitmask up front,
+// names interned in a cold pool (lib/PeerTable)
+static PeerTable meshPeers;
+static_assert(MAX_MESH_DEVICES <= PEER_TABLE_MAX, "mesh table too small");
+
+// The control path (dispatch, housekeeping, console) changes meshPeers
+// under meshTableMutex and republishes meshFanout; the audio senders only
+// read meshFanout, so they never wait on the control path.
+static_assert(MAX_MESH_DEVICES <= FANOUT_MAX_PEERS, "fan-out snapshot too small for the mesh table");
+static SemaphoreHandle_t meshTableMutex = NULL;  // recursive: relay/heartbeat remove while iterating
+static FanoutSet meshFanout;
+static volatile bool meshFanoutDirty = false;  // publish stalled, retried by HousekeepingTask
+
+// Talk groups (lib/TalkGroup): who listens to what lives in meshPeers.groupMask
+// and is published per group in meshFanout. Audio from Phone A goes to the
+// group in its WM header, or to phoneTalkGroup when it has none.
+static_assert(MAX_TALK_GROUPS <= PEER_TABLE_GROUPS && MAX_TALK_GROUPS <= FANOUT_MAX_GROUPS,
+              "talk group masks too small");
+static volatile uint8_t phoneTalkGroup = 0;  // TG_OP_TALK from Phone A, or talk:<g>
+static volatile uint32_t groupFrames[MAX_TALK_GROUPS];  // audio frames sent per group
+static volatile uint32_t groupSends[MAX_TALK_GROUPS];   // unicasts those frames took
+static volatile uint32_t groupUnroutable = 0;           // frames naming a group that does not exist
+static volatile uint32_t groupChanges = 0;              // listen masks changed by control frames
+static volatile uint32_t lastFullFanoutMs = 0;          // audio last reached every active peer
+
+struct MeshTableLock {
+  MeshTableLock() { xSemaphoreTakeRecursive(meshTableMutex, portMAX_DELAY); }
+  ~MeshTableLock() { xSemaphoreGiveRecursive(meshTableMutex); }
 };
-
-MeshDevice meshDevices[MAX_MESH_DEVICES];
-int meshDeviceCount = 0;
-bool isMeshCoordinator = true;
+volatile bool isMeshCoordinator = false;  // leader of the election (lib/MeshElection)
 
 // Mesh network state
 bool meshNetworkActive = false;
@@ -87,7 +127,7 @@ bool oldDeviceConnected = false;
 Adafruit_NeoPixel pixels(NUM_LEDS, STATUS_LED_PIN, NEO_GRB + NEO_KHZ800);
 
 // Audio buffer
-uint8_t audioBuffer[AUDIO_BUFFER_SIZE];
+uint8_t audioBuffer[kAudioBufferBytes];
 size_t audioBufferSize = 0;
 
 // Statistics
@@ -95,98 +135,339 @@ unsigned long packetsReceived = 0;
 unsigned long bytesReceived = 0;
 unsigned long lastStatsTime = 0;
 
+// Level meters (read with the meter_stats command)
+AudioMeter meterMeshOut;  // chunks fanned out by sendAudioChunks
+AudioMeter meterGenerator;  // GeneratorTask output
+
 // Forward declarations
 void setStatusLED(uint8_t r, uint8_t g, uint8_t b);
 void blinkStatusLED(uint8_t r, uint8_t g, uint8_t b, int times);
 void processAudioData(uint8_t* data, size_t length);
-void analyzeAudioData(uint8_t* data, size_t length);
 void setupESPNOWMesh();
 void OnDataRecv(const uint8_t *mac, const uint8_t *data, int len);
-bool addDeviceToMesh(const uint8_t* mac, const String& deviceName, const String& deviceType);
+static void handleMeshMessage(const uint8_t *mac, const uint8_t *data, int len);
+static void followChannelSwitch(const uint8_t* mac, uint8_t channel, uint16_t msUntil);
+void printMeshRxStats();
+bool addDeviceToMesh(const uint8_t* mac, const char* deviceName, const char* deviceType);
 bool removeDeviceFromMesh(const uint8_t* mac);
 void updateDeviceHeartbeat(const uint8_t* mac);
 void cleanupInactiveDevices();
 void updateMeshStatusLED();
+static void publishMeshFanout();
+static void publishMemberDeltas();
 void relayAudioToMesh(const uint8_t* sourceMac, const uint8_t* data, int len);
-void sendMeshAck(const uint8_t* mac, const String& status);
+void sendMeshAck(const uint8_t* mac, const char* status);
 void sendAudioAck(const uint8_t* mac);
 void sendMeshHeartbeat();
-void broadcastMeshStatus();
+void sendMeshBeacon();
 void handleTestCommand(const String& command);
 void sendTestAck(const uint8_t* mac, int testId, const String& status);
 // New: WM frame ingest/forward helpers
 static void ingestBleWmFrames(const uint8_t* data, int len);
 static void forwardWmToMesh(const uint8_t* frame, int frameLen);
+static void sendWmToMesh(const uint8_t* frame, int frameLen, uint8_t group);
+static void handlePhoneGroupControl(uint8_t op, uint8_t value);
 void startAudioStream();
 void stopAudioStream();
-void addAudioData(const uint8_t* data, int length);
 void sendAudioChunks();
 int compressAudioData(const uint8_t* input, int inputLength, uint8_t* output);
-void calculateAudioStats(const uint8_t* data, int length, uint16_t& minVal, uint16_t& maxVal, uint32_t& avgVal);
+void printMeterStats();
+void benchMeter();
+void benchResampler();
+void benchAgc();
+void benchWmHeader();
+void benchFanout();
+void benchPeers();
+void benchGroups(int payloadBytes);
+void benchMembers();
+void fanoutStress(uint32_t seconds);
+void printFanoutStats();
+void benchTranscode();
+void printTranscodeStats();
 // Forward decls for BLE write queue helpers
-struct IncomingBleItem;
 static inline bool bleInPushFromISR(const uint8_t* buf, uint16_t len);
-static inline bool bleInPop(IncomingBleItem &out);
-void sendBeepOnce();
-volatile bool pendingBeep = false;
+void printBleInStats();
+void generatorCommand(const String& command);
+void generatorBeep();
+void printGeneratorStats();
+void layoutBenchTask(void *pvParameters);
+static volatile uint32_t layoutBenchSeconds = 0;  // non-zero while bench_layout runs
+void allocCheckTask(void *pvParameters);
+static volatile uint32_t allocCheckSeconds = 0;  // non-zero while alloc_check runs
+static TimerWheel housekeepingWheel;  // driven by HousekeepingTask
 
 // FreeRTOS task handle for the audio sender
 TaskHandle_t AudioSenderTaskHandle = NULL;
 
+#define AUDIO_SENDER_PERIOD_MS 6
+#define LOOP_PERIOD_MS 10
+static int senderDeadline = -1;  // DeadlineMonitor indices, registered in setup
+static int loopDeadline = -1;
+
 // Dedicated task for sending audio data over BLE
 void AudioSenderTask(void *pvParameters) {
-  const TickType_t xFrequency = pdMS_TO_TICKS(6); // Roughly 6.25ms
+  allocTrackSetSubsystem(ALLOC_SUB_AUDIO);
+  const TickType_t xFrequency = pdMS_TO_TICKS(AUDIO_SENDER_PERIOD_MS); // Roughly 6.25ms
   TickType_t xLastWakeTime = xTaskGetTickCount();
+  uint32_t dueUs = taskStageNowUs();
 
   for (;;) {
     // Wait for the next cycle.
     vTaskDelayUntil(&xLastWakeTime, xFrequency);
+    dueUs += xFrequency * portTICK_PERIOD_MS * 1000;
+    taskStageRecordLatency(TASK_STAGE_SEND, dueUs);  // wake-up lateness
 
-    if (isAudioStreaming && (deviceConnected || meshDeviceCount > 0)) {
+    deadlineBegin(senderDeadline);
+    if (isAudioStreaming && (deviceConnected || meshPeers.count > 0)) {
+      uint32_t start = taskStageNowUs();
       sendAudioChunks();
+      taskStageAddBusy(TASK_STAGE_SEND, start);
     }
+    deadlineEnd(senderDeadline);
+  }
+}
+
+static char ownMacStr[18];  // "AA:BB:CC:DD:EE:FF", set once in setupESPNOWMesh
+
+// Discovery beacon (lib/MeshBeacon): clients join on the first one they hear
+static const uint8_t kBroadcastMac[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+static uint32_t meshEpoch = 0;  // session: restored from NVS or new, set on each election win
+static uint16_t beaconSeq = 0;
+static uint32_t beaconsSent = 0;
+static uint32_t beaconFailures = 0;
+static volatile uint32_t beaconsHeard = 0;  // from other coordinators
+
+// Membership saved to NVS (lib/MeshState) by the housekeeping persist timer.
+// meshStatePending and meshStateScratch are shared by the housekeeping task
+// (becomeMeshLeader, the persist timer) and MeshDispatchTask
+// (handleLeaderBeacon) under MeshTableLock; after boot only the
+// housekeeping task writes the scratch.
+static volatile bool meshStateDirty = false;
+static MeshCoordState meshStateScratch;  // ~1.5 KB, off the task stacks
+static bool meshSessionRestored = false;
+static uint32_t meshStateSaves = 0;
+static uint32_t resyncAccepted = 0;
+static uint32_t resyncRejected = 0;
+static bool meshStatePending = false;  // loaded at boot into meshStateScratch, applied on the first win
+
+// Coordinator election (lib/MeshElection). MeshDispatchTask feeds it beacons
+// from other coordinators and the housekeeping election timer ticks it.
+static MeshElection election;
+static portMUX_TYPE electionMux = portMUX_INITIALIZER_UNLOCKED;
+static unsigned long leaderSinceMs = 0;
+
+// Channel selection (lib/MeshChannel). The housekeeping channel timer owns
+// the plan and runs the surveys; the promiscuous callback (Wi-Fi task) adds
+// frames to channelSample under channelMux. A move is announced by the
+// beacon timer and applied by the channel timer on leader and standbys alike.
+static volatile uint8_t meshChannel = MESH_CHANNEL;  // boot default, moves with the mesh
+static ChannelPlan channelPlan;
+static ChannelSample channelSample;
+static portMUX_TYPE channelMux = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t surveyChannel = 0;           // being sampled, 0 = none
+static uint64_t surveyStartUs = 0;
+static uint32_t surveyPausedMs = 0;         // senders paused, radio still on the mesh channel
+static uint32_t nextSurveyMs = 0;
+// A dwell elsewhere first pauses meshSend, then waits for the driver's
+// queue to drain, so no frame goes out on the survey channel and fails
+static bool meshOffChannel = false;         // meshSend drops frames, not counted as failures
+static bool surveyAway = false;             // radio on the survey channel
+static int32_t meshTxInFlight = 0;          // sent, send callback not yet run
+static uint32_t offChannelDrops = 0;
+static uint32_t surveyLostSends = 0;        // completed away despite the drain, ignored
+// Standby: after the lease runs out, listen on the other candidates before
+// the election may claim (see standbySearch)
+static uint8_t standbyHomeChannel = 0;      // searching, 0 = not
+static uint8_t standbyChannelsLeft = 0;
+static uint32_t standbyListenUntilMs = 0;
+static uint32_t standbySearchLease = 0;     // leaseUntilMs the search started from
+static uint32_t standbySearchedLease = 0;   // lease already searched
+static uint32_t standbySearches = 0;
+static uint32_t standbyFoundElsewhere = 0;
+static volatile uint8_t switchChannel = 0;  // announced move, 0 = none
+static volatile uint32_t switchAtMs = 0;
+static uint32_t switchAnnouncements = 0;
+// Unicasts of the current second, rolled into channelTput by the channel timer
+static uint32_t chanTxBytes = 0;
+static uint32_t chanTxOk = 0;
+static uint32_t chanTxFailed = 0;
+static ChanThroughput channelTput;
+struct ChannelMoveReport {
+  uint8_t from, to;
+  uint32_t atMs;
+  uint32_t beforeBps, beforePct;
+  uint32_t afterBps, afterPct;
+  bool done;                                // after-window measured
+};
+static ChannelMoveReport lastChannelMove;
+
+// Membership log (lib/MeshMembers): a mirror of meshPeers, guarded by the
+// table lock. Each change is broadcast as one delta frame, and a client
+// that misses one asks for a snapshot.
+static MemberList memberLog;
+static uint32_t memberDeltasSent = 0;
+static uint32_t memberDeltaBytes = 0;
+static uint32_t memberSnapshotsSent = 0;
+static uint32_t memberSnapshotFrames = 0;
+
+// Failure detector (lib/FailureDetector): arrivals come from MeshDispatchTask
+// and from the Wi-Fi task's send callback, so it sits behind a spinlock.
+// The fan-out skips suspected peers; the peer_health timer re-evaluates,
+// probes and republishes.
+static FailureDetector peerHealth;
+static portMUX_TYPE peerHealthMux = portMUX_INITIALIZER_UNLOCKED;
+static bool peerHealthRecovered = false;  // a suspected peer was heard, republish the fan-out
+static uint8_t peerProbeSeq = 0;
+
+static void peerHealthTrack(const uint8_t* mac) {
+  portENTER_CRITICAL(&peerHealthMux);
+  fdTrack(peerHealth, mac, millis());
+  portEXIT_CRITICAL(&peerHealthMux);
+}
+
+static void peerHealthForget(const uint8_t* mac) {
+  portENTER_CRITICAL(&peerHealthMux);
+  fdForget(peerHealth, mac);
+  portEXIT_CRITICAL(&peerHealthMux);
+}
+
+static void peerHealthHeard(const uint8_t* mac) {
+  portENTER_CRITICAL(&peerHealthMux);
+  if (fdHeard(peerHealth, mac, millis())) peerHealthRecovered = true;
+  portEXIT_CRITICAL(&peerHealthMux);
+}
+
+static bool peerSuspected(const uint8_t* mac) {
+  portENTER_CRITICAL(&peerHealthMux);
+  bool suspected = fdIsSuspected(peerHealth, mac);
+  portEXIT_CRITICAL(&peerHealthMux);
+  return suspected;
+}
+
+// Liveness rides on traffic: any frame from a peer refreshes its lastSeen,
+// heartbeats are skipped while audio flows, and audio frames carry the
+// membership version in a WM extension (lib/WmFrame)
+#define MESH_MEMBERS_PIGGYBACK_MS 1000  // refresh period while nothing changes
+static uint8_t membersSentVersion = 0;   // senders race benignly: worst case an extra extension
+static uint32_t membersSentMs = 0;
+static uint32_t membersPiggybacked = 0;
+static uint32_t heartbeatsSent = 0;
+static uint32_t heartbeatsSuppressed = 0;
+
+// Every ESP-NOW send goes through here so allocations inside the Wi-Fi
+// stack are charged to "radio", not to the caller's subsystem, and airtime
+// is accounted per traffic class (lib/MeshAirtime)
+static inline esp_err_t meshSend(const uint8_t* mac, const uint8_t* data, size_t len) {
+  // Counted in flight before the pause check, so a survey that saw no
+  // frames in flight after pausing cannot race a sender past the check
+  __atomic_add_fetch(&meshTxInFlight, 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&meshOffChannel, __ATOMIC_SEQ_CST)) {  // nobody to hear it on the survey channel
+    __atomic_sub_fetch(&meshTxInFlight, 1, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&offChannelDrops, 1, __ATOMIC_RELAXED);
+    return ESP_ERR_INVALID_STATE;
+  }
+  AllocScope radio(ALLOC_SUB_RADIO);
+  esp_err_t result = esp_now_send(mac, data, len);
+  if (result == ESP_OK) {
+    airtimeNoteSend(mac, data, len, millis());
+    if (memcmp(mac, kBroadcastMac, 6) != 0) __atomic_add_fetch(&chanTxBytes, len, __ATOMIC_RELAXED);
+  } else {
+    __atomic_sub_fetch(&meshTxInFlight, 1, __ATOMIC_SEQ_CST);
+  }
+  return result;
+}
+
+// Low byte of the log version, as carried in the WM extension. Read
+// without the table lock by the audio senders.
+static inline uint8_t memberLogVersion8() {
+  return (uint8_t)__atomic_load_n(&memberLog.version, __ATOMIC_RELAXED);
+}
+
+// True when this audio frame should carry the membership extension
+static inline bool membershipDue(uint8_t version, uint32_t now) {
+  return version != membersSentVersion || now - membersSentMs >= MESH_MEMBERS_PIGGYBACK_MS;
+}
+
+static inline void membershipSent(uint8_t version, uint32_t now) {
+  membersSentVersion = version;
+  membersSentMs = now;
+  membersPiggybacked++;
+}
+
+// Any frame from a joined peer proves it is alive
+static void notePeerFrame(const uint8_t* mac) {
+  peerHealthHeard(mac);
+  MeshTableLock lock;
+  int i = peerTableFind(meshPeers, mac);
+  if (i >= 0) meshPeers.lastSeen[i] = millis();
+}
+
+// Wi-Fi task: the MAC-layer outcome of every unicast. An ack is an arrival
+// for the failure detector; a failure (after the driver's retries) counts
+// towards suspicion and towards the channel's failure rate. Broadcasts are
+// not tracked, nor is a frame that completed on a survey channel.
+static void OnDataSent(const uint8_t* mac, esp_now_send_status_t status) {
+  __atomic_sub_fetch(&meshTxInFlight, 1, __ATOMIC_SEQ_CST);
+  if (memcmp(mac, kBroadcastMac, 6) == 0) return;
+  if (__atomic_load_n(&surveyAway, __ATOMIC_RELAXED)) {
+    __atomic_add_fetch(&surveyLostSends, 1, __ATOMIC_RELAXED);
+    return;
   }
+  __atomic_add_fetch(status == ESP_NOW_SEND_SUCCESS ? &chanTxOk : &chanTxFailed, 1, __ATOMIC_RELAXED);
+  portENTER_CRITICAL(&peerHealthMux);
+  if (status == ESP_NOW_SEND_SUCCESS) {
+    if (fdHeard(peerHealth, mac, millis())) peerHealthRecovered = true;
+  } else {
+    fdSendFailed(peerHealth, mac);
+  }
+  portEXIT_CRITICAL(&peerHealthMux);
+}
+
+// Wi-Fi task, only while a channel survey has promiscuous mode on. Frames
+// from ESP-NOW nodes are not interference.
+static void surveyRxCallback(void* buf, wifi_promiscuous_pkt_type_t type) {
+  const wifi_promiscuous_pkt_t* pkt = (const wifi_promiscuous_pkt_t*)buf;
+  const wifi_pkt_rx_ctrl_t& rx = pkt->rx_ctrl;
+  if (chanIsEspNow(pkt->payload, rx.sig_len)) return;
+  portENTER_CRITICAL(&channelMux);
+  chanSampleFrame(channelSample, rx.sig_mode, rx.rate, rx.mcs, rx.sig_len, rx.noise_floor);
+  portEXIT_CRITICAL(&channelMux);
 }
 
 // Core Mesh Management Functions
-bool addDeviceToMesh(const uint8_t* mac, const String& deviceName, const String& deviceType) {
+bool addDeviceToMesh(const uint8_t* mac, const char* deviceName, const char* deviceType) {
+  MeshTableLock lock;
   // Check if device already exists
-  for (int i = 0; i < meshDeviceCount; i++) {
-    if (memcmp(meshDevices[i].mac, mac, 6) == 0) {
-      // Update existing device
-      meshDevices[i].lastSeen = millis();
-      // Don't mark as active until ready confirmation
-      Serial.printf("Updated existing device: %s\n", deviceName.c_str());
-      return true;
-    }
+  int existing = peerTableFind(meshPeers, mac);
+  if (existing >= 0) {
+    // Update existing device
+    meshPeers.lastSeen[existing] = millis();
+    // Don't mark as active until ready confirmation
+    Serial.printf("Updated existing device: %s\n", deviceName);
+    return true;
   }
   
   // Add new device if we have space
-  if (meshDeviceCount < MAX_MESH_DEVICES) {
-    memcpy(meshDevices[meshDeviceCount].mac, mac, 6);
-    meshDevices[meshDeviceCount].deviceName = deviceName;
-    meshDevices[meshDeviceCount].deviceType = deviceType;
-    meshDevices[meshDeviceCount].lastSeen = millis();
-    meshDevices[meshDeviceCount].isActive = false;  // Not active until ready
-    meshDevices[meshDeviceCount].isCoordinator = false;
-    meshDevices[meshDeviceCount].audioQuality = 100;
-    
+  if (meshPeers.count < MAX_MESH_DEVICES) {
     // Add as ESP-NOW peer with proper configuration
     esp_now_peer_info_t peerInfo;
     memset(&peerInfo, 0, sizeof(peerInfo));
     memcpy(peerInfo.peer_addr, mac, 6);
-    peerInfo.channel = MESH_CHANNEL;  // Use the same channel
+    peerInfo.channel = 0;            // the radio's current channel, which follows channel moves
     peerInfo.encrypt = false;         // No encryption for now
     peerInfo.ifidx = WIFI_IF_STA;    // Use WiFi STA interface
     
     esp_err_t result = esp_now_add_peer(&peerInfo);
     if (result == ESP_OK) {
-      Serial.printf("Added new device to mesh: %s (Total: %d)\n", deviceName.c_str(), meshDeviceCount + 1);
-      meshDeviceCount++;
+      peerTableAdd(meshPeers, mac, deviceName, deviceType, millis(), MAX_MESH_DEVICES);  // inactive until ready
+      peerHealthTrack(mac);
+      publishMemberDeltas();
+      meshStateDirty = true;
+      Serial.printf("Added new device to mesh: %s (Total: %d)\n", deviceName, meshPeers.count);
       updateMeshStatusLED(); // Update LED status when device added
       return true;
     } else {
-      Serial.printf("Failed to add peer %s: %d\n", deviceName.c_str(), result);
+      Serial.printf("Failed to add peer %s: %d\n", deviceName, result);
       return false;
     }
   }
@@ -196,34 +477,35 @@ bool addDeviceToMesh(const uint8_t* mac, const String& deviceName, const String&
 }
 
 bool removeDeviceFromMesh(const uint8_t* mac) {
-  for (int i = 0; i < meshDeviceCount; i++) {
-    if (memcmp(meshDevices[i].mac, mac, 6) == 0) {
-      // Remove ESP-NOW peer
-      esp_now_del_peer(mac);
-      
-      // Shift remaining devices
-      for (int j = i; j < meshDeviceCount - 1; j++) {
-        meshDevices[j] = meshDevices[j + 1];
-      }
-      meshDeviceCount--;
-      
-      Serial.printf("Removed device from mesh: %s (Total: %d)\n", 
-                   meshDevices[i].deviceName.c_str(), meshDeviceCount);
-      updateMeshStatusLED(); // Update LED status when device removed
-      return true;
-    }
-  }
-  return false;
+  MeshTableLock lock;
+  int i = peerTableFind(meshPeers, mac);
+  if (i < 0) return false;
+
+  // Remove ESP-NOW peer (mac may point into the table, so before the shift)
+  esp_now_del_peer(mac);
+  Serial.printf("Removed device from mesh: %s (Total: %d)\n",
+               peerTableName(meshPeers, i), meshPeers.count - 1);
+
+  peerHealthForget(mac);
+
+  // Shift remaining devices (plain data, no String copies)
+  peerTableRemove(meshPeers, i);
+  publishMeshFanout();
+  meshStateDirty = true;
+  updateMeshStatusLED(); // Update LED status when device removed
+  return true;
 }
 
 void updateDeviceHeartbeat(const uint8_t* mac) {
-  for (int i = 0; i < meshDeviceCount; i++) {
-    if (memcmp(meshDevices[i].mac, mac, 6) == 0) {
-      meshDevices[i].lastSeen = millis();
-      meshDevices[i].isActive = true;
-            break;
-    }
-}
+  MeshTableLock lock;
+  int i = peerTableFind(meshPeers, mac);
+  if (i < 0) return;
+  meshPeers.lastSeen[i] = millis();
+  if (!peerTableIsActive(meshPeers, i)) {
+    peerTableSetActive(meshPeers, i, true);
+    publishMeshFanout();
+    meshStateDirty = true;
+  }
 }
 
 void cleanupInactiveDevices() {
@@ -234,38 +516,140 @@ void cleanupInactiveDevices() {
     return;
   }
   
-  for (int i = 0; i < meshDeviceCount; i++) {
+  MeshTableLock lock;
+  for (int i = 0; i < meshPeers.count; i++) {
     // Safety check: ensure device index is valid
     if (i >= MAX_MESH_DEVICES) {
       Serial.println("cleanupInactiveDevices: Device index out of bounds");
             break;
     }
     
-    if (meshDevices[i].isActive && 
-        (currentTime - meshDevices[i].lastSeen) > DEVICE_TIMEOUT) {
+    if (peerTableIsActive(meshPeers, i) && 
+        (currentTime - meshPeers.lastSeen[i]) > DEVICE_TIMEOUT) {
       
       Serial.printf("Device %s timed out, removing from mesh\n", 
-                   meshDevices[i].deviceName.c_str());
+                   peerTableName(meshPeers, i));
       
       // Remove the device safely
-      if (removeDeviceFromMesh(meshDevices[i].mac)) {
+      if (removeDeviceFromMesh(meshPeers.macs[i])) {
         i--; // Adjust index after removal
             } else {
         Serial.printf("Failed to remove timed out device %s\n", 
-                     meshDevices[i].deviceName.c_str());
+                     peerTableName(meshPeers, i));
       }
     }
   }
 }
 
+static uint8_t memberFlags(int i) {
+  uint8_t flags = peerTableIsActive(meshPeers, i) ? MEMBER_FLAG_ACTIVE : 0;
+  if ((meshPeers.coordinatorMask >> i) & 1u) flags |= MEMBER_FLAG_COORDINATOR;
+  return flags;
+}
+
+static void sendMemberDelta(MembersDelta& delta) {
+  int len = membersDeltaFinish(delta, memberLog.epoch, memberLog.version);
+  if (meshSend(kBroadcastMac, delta.buf, len) == ESP_OK) {
+    memberDeltasSent++;
+    memberDeltaBytes += len;
+  }
+  DLOG(MESH, INFO, MEMBERSHIP, memberLog.count, memberLog.version);
+  membersDeltaBegin(delta);
+}
+
+// Queue op on the log and the delta frame, flushing a full frame first
+static void appendMemberOp(MembersDelta& delta, uint8_t op, const uint8_t* mac, uint8_t flags, const char* name) {
+  if (!membersApplyOp(memberLog, op, mac, flags, name)) return;
+  if (!membersDeltaAdd(delta, op, mac, flags, name)) {
+    sendMemberDelta(delta);
+    membersDeltaAdd(delta, op, mac, flags, name);
+  }
+  __atomic_store_n(&memberLog.version, (uint16_t)(memberLog.version + 1), __ATOMIC_RELAXED);
+}
+
+// Bring the membership log in line with meshPeers and broadcast what
+// changed: usually one op, in one frame (caller holds the table lock)
+static void publishMemberDeltas() {
+  if (!isMeshCoordinator) return;
+  MembersDelta delta;
+  membersDeltaBegin(delta);
+  for (int k = memberLog.count - 1; k >= 0; k--) {
+    if (peerTableFind(meshPeers, memberLog.entries[k].mac) < 0) {
+      uint8_t mac[6];
+      memcpy(mac, memberLog.entries[k].mac, 6);
+      appendMemberOp(delta, MEMBER_OP_REMOVE, mac, 0, "");
+    }
+  }
+  for (int i = 0; i < meshPeers.count; i++) {
+    int k = membersFind(memberLog, meshPeers.macs[i]);
+    appendMemberOp(delta, k < 0 ? MEMBER_OP_ADD : MEMBER_OP_UPDATE, meshPeers.macs[i], memberFlags(i),
+                   peerTableName(meshPeers, i));
+  }
+  if (delta.ops) sendMemberDelta(delta);
+}
+
+// A client missed a delta: unicast the whole log in as few frames as fit
+static void sendMemberSnapshot(const uint8_t* mac) {
+  MeshTableLock lock;
+  if (peerTableFind(meshPeers, mac) < 0) return;  // not our peer, so no unicast
+  uint8_t frame[ESP_NOW_MAX_DATA_LEN];
+  int next = 0;
+  do {
+    int len = membersEncodeSnapshot(memberLog, next, frame, sizeof(frame), &next);
+    if (meshSend(mac, frame, len) != ESP_OK) return;
+    memberSnapshotFrames++;
+  } while (next < memberLog.count);
+  memberSnapshotsSent++;
+}
+
+// Rebuild the senders' view and the membership log from meshPeers (caller
+// holds the table lock)
+static void publishMeshFanout() {
+  publishMemberDeltas();
+  FanoutSnapshot* snap = fanoutBeginWrite(meshFanout);
+  if (!snap) {
+    meshFanoutDirty = true;
+    return;
+  }
+  for (uint32_t bits = meshPeers.activeMask; bits; bits &= bits - 1) {
+    int i = __builtin_ctz(bits);
+    if (peerSuspected(meshPeers.macs[i])) continue;  // probed by the peer_health timer instead
+    // Group fan-out: the group masks intersected with the active ones
+    for (int g = 0; g < MAX_TALK_GROUPS; g++) {
+      if ((meshPeers.groupMask[g] >> i) & 1u) snap->groups[g] |= 1u << snap->count;
+    }
+    FanoutPeer& peer = snap->peers[snap->count++];
+    memcpy(peer.mac, meshPeers.macs[i], 6);
+    snprintf(peer.name, sizeof(peer.name), "%s", peerTableName(meshPeers, i));
+  }
+  fanoutPublish(meshFanout);
+  meshFanoutDirty = false;
+}
+
+void printFanoutStats() {
+  const FanoutSnapshot* snap = fanoutAcquire(meshFanout);
+  Serial.printf("=== FAN-OUT SET v%lu (%u peers) ===\n", (unsigned long)snap->version, snap->count);
+  for (int i = 0; i < snap->count; i++) {
+    const uint8_t* m = snap->peers[i].mac;
+    uint8_t groups = 0;
+    for (int g = 0; g < MAX_TALK_GROUPS; g++) groups |= ((snap->groups[g] >> i) & 1u) << g;
+    Serial.printf("  %s %02X:%02X:%02X:%02X:%02X:%02X groups 0x%X\n", snap->peers[i].name,
+                  m[0], m[1], m[2], m[3], m[4], m[5], groups);
+  }
+  fanoutRelease(meshFanout, snap);
+  Serial.printf("Publishes: %lu, stalls: %lu, reader retries: %lu\n",
+                (unsigned long)meshFanout.publishes, (unsigned long)meshFanout.publishStalls,
+                (unsigned long)meshFanout.readerRetries);
+}
+
 void updateMeshStatusLED() {
-  if (meshDeviceCount == 0) {
+  if (meshPeers.count == 0) {
     setStatusLED(255, 0, 0); // Red - no devices
-  } else if (meshDeviceCount == 1) {
+  } else if (meshPeers.count == 1) {
     setStatusLED(255, 165, 0); // Orange - 1 device
-  } else if (meshDeviceCount == 2) {
+  } else if (meshPeers.count == 2) {
     setStatusLED(255, 255, 0); // Yellow - 2 devices
-  } else if (meshDeviceCount == 3) {
+  } else if (meshPeers.count == 3) {
     setStatusLED(0, 255, 0); // Green - 3 devices
   } else {
     setStatusLED(0, 0, 255); // Blue - 4 devices (full)
@@ -274,52 +658,50 @@ void updateMeshStatusLED() {
 
 void processAudioData(uint8_t* data, size_t length) {
   // DEPRECATED: This function is no longer used
-  // Audio now flows through: BLE → addAudioData() → sendAudioChunks() → P: format
+  // Audio now flows through: BLE → BleIngestTask → ingestBleWmFrames() → forwardWmToMesh()
   Serial.println("⚠️ processAudioData() called - this should not happen with new audio flow");
 }
 
-void analyzeAudioData(uint8_t* data, size_t length) {
-    uint32_t sum = 0;
-    uint8_t min_val = 255;
-    uint8_t max_val = 0;
-    
-    for (size_t i = 0; i < length; i++) {
-        sum += data[i];
-        if (data[i] < min_val) min_val = data[i];
-        if (data[i] > max_val) max_val = data[i];
-    }
-    
-    uint8_t avg_val = sum / length;
-    
-  Serial.printf("Audio stats - Min: %d, Max: %d, Avg: %d\n", min_val, max_val, avg_val);
+static void printMeter(const AudioMeter& meter) {
+  float rmsDb = meter.lastRms > 0 ? 20.0f * log10f(meter.lastRms / 32768.0f) : -99.0f;
+  float peakDb = meter.maxPeak > 0 ? 20.0f * log10f(meter.maxPeak / 32768.0f) : -99.0f;
+  Serial.printf("  %-10s blocks=%lu samples=%lu peak=%u rms=%u (%.1f dBFS) max=%.1f dBFS clipped=%lu\n",
+                meter.name, (unsigned long)meter.blocks, (unsigned long)meter.samples,
+                meter.lastPeak, meter.lastRms, rmsDb, peakDb, (unsigned long)meter.clipped);
+}
+
+void printMeterStats() {
+  Serial.printf("=== AUDIO METERS (%s kernel) ===\n", audioMeterUsesVectorUnit() ? "PIE" : "portable");
+  printMeter(meterMeshOut);
+  printMeter(meterGenerator);
 }
 
 void printStatistics() {
   Serial.println("=== MESH NETWORK STATISTICS ===");
   Serial.printf("Connection status: %s\n", deviceConnected ? "Connected" : "Disconnected");
-  Serial.printf("Mesh devices: %d/%d\n", meshDeviceCount, MAX_MESH_DEVICES);
+  Serial.printf("Mesh devices: %d/%d\n", meshPeers.count, MAX_MESH_DEVICES);
   Serial.printf("Mesh network: %s\n", meshNetworkActive ? "Active" : "Inactive");
   Serial.printf("Audio streaming: %s\n", isAudioStreaming ? "Yes" : "No");
   Serial.printf("Free heap: %d bytes\n", ESP.getFreeHeap());
   
-  if (meshDeviceCount > 0) {
+  MeshTableLock lock;
+  if (meshPeers.count > 0) {
     Serial.println("--- Connected Devices ---");
-    for (int i = 0; i < meshDeviceCount; i++) {
-      if (meshDevices[i].isActive) {
+    for (int i = 0; i < meshPeers.count; i++) {
+      if (peerTableIsActive(meshPeers, i)) {
+        const uint8_t* m = meshPeers.macs[i];
         char macStr[18];
-        sprintf(macStr, "%02X:%02X:%02X:%02X:%02X:%02X",
-                meshDevices[i].mac[0], meshDevices[i].mac[1], meshDevices[i].mac[2],
-                meshDevices[i].mac[3], meshDevices[i].mac[4], meshDevices[i].mac[5]);
+        sprintf(macStr, "%02X:%02X:%02X:%02X:%02X:%02X", m[0], m[1], m[2], m[3], m[4], m[5]);
         
         Serial.printf("  %d. %s (%s) - MAC: %s\n", 
                      i + 1, 
-                     meshDevices[i].deviceName.c_str(),
-                     meshDevices[i].deviceType.c_str(),
+                     peerTableName(meshPeers, i),
+                     peerTableType(meshPeers, i),
                      macStr);
         
-        unsigned long timeSinceLastSeen = millis() - meshDevices[i].lastSeen;
+        unsigned long timeSinceLastSeen = millis() - meshPeers.lastSeen[i];
         Serial.printf("      Last seen: %lu ms ago, Quality: %d%%\n", 
-                     timeSinceLastSeen, meshDevices[i].audioQuality);
+                     timeSinceLastSeen, meshPeers.audioQuality[i]);
       }
     }
   }
@@ -338,19 +720,165 @@ void sendKeepAlive() {
 }
 
 // ESP-NOW Mesh Functions
+// Session saved before the restart. It stays in meshStateScratch until this
+// node wins its first election, and is dropped if another leader is heard.
+// The mesh may have moved off MESH_CHANNEL before the restart: boot on the
+// saved channel so the clients are still in earshot. A standby saved only
+// the channel.
+static bool loadMeshState() {
+  uint8_t channel;
+  if (!meshStateLoadCoord(meshStateScratch)) {
+    if (meshStateLoadChannel(channel) && chanValid(MESH_CHANNEL_MASK, channel)) meshChannel = channel;
+    return false;
+  }
+  if (!chanValid(MESH_CHANNEL_MASK, meshStateScratch.channel)) return false;
+  meshChannel = meshStateScratch.channel;
+  return meshStateScratch.peers.count <= MAX_MESH_DEVICES;
+}
+
+// Peers saved by the persist timer come back active under the saved epoch,
+// so joined clients (whose beacons still match) carry on without rejoining.
+// A client that is gone times out through cleanupInactiveDevices as usual.
+static void restoreMeshState() {
+  MeshTableLock lock;
+  meshPeers = meshStateScratch.peers;
+  unsigned long now = millis();
+  for (int i = meshPeers.count - 1; i >= 0; i--) {
+    esp_now_peer_info_t peerInfo;
+    memset(&peerInfo, 0, sizeof(peerInfo));
+    memcpy(peerInfo.peer_addr, meshPeers.macs[i], 6);
+    peerInfo.channel = 0;  // current channel
+    peerInfo.encrypt = false;
+    peerInfo.ifidx = WIFI_IF_STA;
+    if (esp_now_add_peer(&peerInfo) != ESP_OK) {
+      peerTableRemove(meshPeers, i);
+      continue;
+    }
+    meshPeers.lastSeen[i] = now;
+    peerHealthTrack(meshPeers.macs[i]);
+  }
+  meshEpoch = meshStateScratch.epoch;
+  publishMeshFanout();
+  Serial.printf("Restored mesh session %08lX with %d devices from NVS\n",
+                (unsigned long)meshEpoch, meshPeers.count);
+}
+
+static void newMeshEpoch() {
+  do {
+    meshEpoch = esp_random();
+  } while (meshEpoch == 0);
+  meshStateDirty = true;
+}
+
+// Phone A reaches the intercom through the leader only. A standby has no
+// peers and drops mesh traffic, so it neither advertises the audio service
+// nor keeps a phone connected, and the phone finds the leader instead. A
+// node whose ESP-NOW failed to start serves its phone alone, as before.
+static volatile bool bleServing = false;
+
+static void setBleServing(bool serve) {
+  bleServing = serve;
+  if (!pServer) return;  // BLE not up yet: setup advertises if still serving
+  if (serve) {
+    BLEDevice::startAdvertising();
+  } else {
+    BLEDevice::getAdvertising()->stop();
+    if (deviceConnected) pServer->disconnect(pServer->getConnId());
+  }
+}
+
+// Won the election: resume the saved session if no other leader was heard
+// since boot, else start a new one, and announce it with a beacon at once
+static void becomeMeshLeader() {
+  {
+    MeshTableLock lock;
+    meshSessionRestored = meshStatePending;
+    if (meshStatePending) {
+      restoreMeshState();
+    } else {
+      newMeshEpoch();
+    }
+    meshStatePending = false;
+  }
+  leaderSinceMs = millis();
+  chanPlanInit(channelPlan, MESH_CHANNEL_MASK, meshChannel, leaderSinceMs);
+  isMeshCoordinator = true;
+  {
+    // A random first version, so clients of an earlier session see a gap
+    MeshTableLock lock;
+    membersReset(memberLog, meshEpoch, (uint16_t)esp_random(), true);
+    publishMemberDeltas();
+  }
+  sendMeshBeacon();
+  Serial.printf("👑 Leading the mesh (priority %u, session %08lX)\n",
+                election.priority, (unsigned long)meshEpoch);
+  setBleServing(true);
+  updateMeshStatusLED();
+}
+
+// A higher-ranked leader is up. Our clients stop hearing our beacons, lose
+// the lease and rejoin it, so the table is simply dropped.
+static void stepDownMesh(const uint8_t* leaderMac) {
+  isMeshCoordinator = false;
+  switchChannel = 0;  // a move we announced is the new leader's call now
+  {
+    MeshTableLock lock;
+    for (int i = 0; i < meshPeers.count; i++) esp_now_del_peer(meshPeers.macs[i]);
+    peerTableInit(meshPeers);
+    portENTER_CRITICAL(&peerHealthMux);
+    fdReset(peerHealth);
+    portEXIT_CRITICAL(&peerHealthMux);
+    publishMeshFanout();
+  }
+  meshSessionRestored = false;
+  meshStateDirty = true;  // the persist timer erases the saved session
+  Serial.printf("Stepping down for leader %02X:%02X:%02X:%02X:%02X:%02X, phone service off\n",
+                leaderMac[0], leaderMac[1], leaderMac[2], leaderMac[3], leaderMac[4], leaderMac[5]);
+  setBleServing(false);
+  updateMeshStatusLED();
+}
+
+// Beacon from another coordinator of this network
+static void handleLeaderBeacon(const uint8_t* mac, const MeshBeacon& beacon) {
+  portENTER_CRITICAL(&electionMux);
+  ElectionEvent event = electionOnBeacon(election, mac, beacon.priority, meshBeaconLeaseMs(beacon), millis());
+  portEXIT_CRITICAL(&electionMux);
+  if (event == ELECTION_STEPPED_DOWN) {
+    stepDownMesh(mac);
+  } else if (event == ELECTION_LEADER_CHANGED) {
+    MeshTableLock lock;
+    if (meshStatePending) {
+      meshStatePending = false;  // our clients belong to that leader now
+      meshStateDirty = true;
+    }
+    Serial.printf("Standby for leader %02X:%02X:%02X:%02X:%02X:%02X (priority %u)\n",
+                  mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], beacon.priority);
+  }
+}
+
 void setupESPNOWMesh() {
   Serial.println("Setting up Multi-Device ESP-NOW Mesh Network...");
   
   // Completely disable WiFi AP mode - only use STA for ESP-NOW
   WiFi.mode(WIFI_STA);
+  uint8_t ownMac[6];
+  WiFi.macAddress(ownMac);
+  electionInit(election, MESH_COORD_PRIORITY, ownMac, MESH_LEASE_BEACONS * MESH_BEACON_INTERVAL_MS, millis());
+  snprintf(ownMacStr, sizeof(ownMacStr), "%02X:%02X:%02X:%02X:%02X:%02X",
+           ownMac[0], ownMac[1], ownMac[2], ownMac[3], ownMac[4], ownMac[5]);
   // Enable WiFi modem sleep for BLE/WiFi coexistence
   esp_wifi_set_ps(WIFI_PS_MIN_MODEM);
   WiFi.disconnect();
   delay(100);
   
+  // Keep the session saved before the restart for the first election win.
+  // Every node boots as a standby and listens for one lease plus its
+  // backoff, so a restarted node follows a leader that took over meanwhile.
+  meshStatePending = loadMeshState();
+
   // Set WiFi channel to match mesh channel for ESP-NOW compatibility
-  WiFi.channel(MESH_CHANNEL);
-  Serial.printf("WiFi channel set to %d for ESP-NOW compatibility\n", MESH_CHANNEL);
+  WiFi.channel(meshChannel);
+  Serial.printf("WiFi channel set to %d for ESP-NOW compatibility\n", meshChannel);
   
   // Initialize ESP-NOW
   if (esp_now_init() != ESP_OK) {
@@ -361,45 +889,244 @@ void setupESPNOWMesh() {
   // Set ESP-NOW role to controller
   esp_now_set_pmk((uint8_t *)"ESP32_Mesh_Key_12345");
   
-  // Register callback
-  esp_now_register_recv_cb(OnDataRecv);
-  
-  // Initialize mesh device array
-  for (int i = 0; i < MAX_MESH_DEVICES; i++) {
-    meshDevices[i].isActive = false;
-    meshDevices[i].lastSeen = 0;
+  // Initialize mesh device table
+  {
+    MeshTableLock lock;
+    peerTableInit(meshPeers);
+  }
+
+  // Broadcast peer for discovery beacons
+  esp_now_peer_info_t broadcastPeer;
+  memset(&broadcastPeer, 0, sizeof(broadcastPeer));
+  memcpy(broadcastPeer.peer_addr, kBroadcastMac, 6);
+  broadcastPeer.channel = 0;  // current channel
+  broadcastPeer.encrypt = false;
+  broadcastPeer.ifidx = WIFI_IF_STA;
+  if (esp_now_add_peer(&broadcastPeer) != ESP_OK) {
+    Serial.println("Failed to add broadcast peer, clients cannot discover this coordinator");
   }
+  esp_now_register_recv_cb(OnDataRecv);
+  esp_now_register_send_cb(OnDataSent);
+
+  // Channel surveys listen to everything for a few ms at a time
+  wifi_promiscuous_filter_t filter = {.filter_mask = WIFI_PROMIS_FILTER_MASK_MGMT | WIFI_PROMIS_FILTER_MASK_DATA};
+  esp_wifi_set_promiscuous_filter(&filter);
+  esp_wifi_set_promiscuous_rx_cb(surveyRxCallback);
+  chanPlanInit(channelPlan, MESH_CHANNEL_MASK, meshChannel, millis());
   
   meshNetworkActive = true;
   
   Serial.println("Multi-Device ESP-NOW Mesh initialized successfully");
-  Serial.println("Waiting for devices to join...");
+  Serial.printf("Listening for a leader (priority %u, claim in %lu ms)...\n", election.priority,
+                (unsigned long)(election.claimAtMs - millis()));
   
   // Show mesh ready with purple LED
   setStatusLED(255, 0, 255);
   delay(500);
 }
 
+// ESP-NOW RX pool: OnDataRecv runs in the Wi-Fi driver task, so it only
+// copies the packet here and wakes MeshDispatchTask, which does the parsing,
+// logging and any esp_now_send. Producers (the Wi-Fi task, bench_layout)
+// serialise on a spinlock; MeshDispatchTask is the only consumer.
+#define MESH_RX_HIST_BUCKETS 10  // 0.25 us .. >= 64 us, powers of two
+
+struct MeshRxSlot {
+  uint8_t mac[6];
+  uint16_t length;
+  uint32_t queuedUs;
+  uint8_t data[kMeshRxSlotBytes];
+  bool bench;  // bench_layout packet: MeshDispatchTask hands it to the bench handler
+};
+static_assert(kMeshRxSlotBytes == ESP_NOW_MAX_DATA_LEN, "mesh RX slot must hold an ESP-NOW packet");
+static_assert(sizeof(MeshRxSlot) == kBufferPools[BUF_POOL_MESH_RX_POOL].slotBytes, "update MESH_RX_POOL in BufferConfig.h");
+
+static MeshRxSlot meshRxPool[kMeshRxPoolSlots] MEM_FAST_ATTR;
+static volatile uint16_t meshRxHead = 0;
+static volatile uint16_t meshRxTail = 0;
+static volatile uint32_t meshRxDrops = 0;
+static volatile uint32_t meshRxDispatched = 0;
+static volatile uint32_t meshRxHist[MESH_RX_HIST_BUCKETS];
+static volatile uint32_t meshRxMaxCycles = 0;
+static volatile uint32_t layoutBenchPackets = 0;
+static portMUX_TYPE meshRxMux = portMUX_INITIALIZER_UNLOCKED;
+TaskHandle_t MeshDispatchTaskHandle = NULL;
+
+static void meshRxEnqueue(const uint8_t *mac, const uint8_t *data, int len, bool bench) {
+  bool queued = false;
+  portENTER_CRITICAL(&meshRxMux);
+  uint16_t nextHead = (meshRxHead + 1) & kMeshRxPoolMask;
+  if (len <= 0 || len > ESP_NOW_MAX_DATA_LEN || nextHead == __atomic_load_n(&meshRxTail, __ATOMIC_ACQUIRE)) {
+    meshRxDrops++;
+  } else {
+    MeshRxSlot &slot = meshRxPool[meshRxHead];
+    memcpy(slot.mac, mac, 6);
+    slot.length = (uint16_t)len;
+    memcpy(slot.data, data, len);
+    slot.bench = bench;
+    slot.queuedUs = taskStageNowUs();
+    __atomic_store_n(&meshRxHead, nextHead, __ATOMIC_RELEASE);
+    bufferNoteLevel(BUF_POOL_MESH_RX_POOL, (nextHead - meshRxTail) & kMeshRxPoolMask);
+    queued = true;
+  }
+  portEXIT_CRITICAL(&meshRxMux);
+  if (queued && MeshDispatchTaskHandle) xTaskNotifyGive(MeshDispatchTaskHandle);
+}
+
 void OnDataRecv(const uint8_t *mac, const uint8_t *data, int len) {
-  Serial.println("=== MESH DATA RECEIVED ===");
-  Serial.printf("From MAC: %02X:%02X:%02X:%02X:%02X:%02X\n", 
-                mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-  Serial.printf("Data length: %d\n", len);
+  uint32_t start = ESP.getCycleCount();
+  meshRxEnqueue(mac, data, len, false);
+
+  // Duration histogram in quarter-microsecond units, log2 buckets
+  uint32_t cycles = ESP.getCycleCount() - start;
+  uint32_t quarterUs = cycles / (ESP.getCpuFreqMHz() / 4);
+  int bucket = quarterUs == 0 ? 0 : 32 - __builtin_clz(quarterUs);
+  if (bucket >= MESH_RX_HIST_BUCKETS) bucket = MESH_RX_HIST_BUCKETS - 1;
+  meshRxHist[bucket]++;
+  if (cycles > meshRxMaxCycles) meshRxMaxCycles = cycles;
+}
+
+// Stand-in for handleMeshMessage during bench_layout: the same JSON parse,
+// but no peer table, counters or logs of the live mesh are touched
+static void handleLayoutBenchPacket(const uint8_t *data, int len) {
+  StaticJsonDocument<256> doc;
+  if (!deserializeJson(doc, data, len) && doc["type"] == "layout_bench") {
+    layoutBenchPackets++;
+  }
+}
+
+// Control, audio and relay handling for everything OnDataRecv queued
+void MeshDispatchTask(void *pvParameters) {
+  allocTrackSetSubsystem(ALLOC_SUB_MESH);
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    uint16_t tail = meshRxTail;
+    while (tail != __atomic_load_n(&meshRxHead, __ATOMIC_ACQUIRE)) {
+      MeshRxSlot &slot = meshRxPool[tail];
+      taskStageRecordLatency(TASK_STAGE_INGEST, slot.queuedUs);
+      uint32_t start = taskStageNowUs();
+      if (slot.bench) {
+        handleLayoutBenchPacket(slot.data, slot.length);
+      } else {
+        handleMeshMessage(slot.mac, slot.data, slot.length);
+      }
+      taskStageAddBusy(TASK_STAGE_INGEST, start);
+      meshRxDispatched++;
+      tail = (tail + 1) & kMeshRxPoolMask;
+      __atomic_store_n(&meshRxTail, tail, __ATOMIC_RELEASE);
+    }
+  }
+}
+
+void printMeshRxStats() {
+  static const char* labels[MESH_RX_HIST_BUCKETS] = {
+    "<0.25us", "<0.5us", "<1us", "<2us", "<4us", "<8us", "<16us", "<32us", "<64us", ">=64us"
+  };
+  Serial.printf("=== MESH RX (dispatched %lu, pool drops %lu, max %.2f us) ===\n",
+                (unsigned long)meshRxDispatched, (unsigned long)meshRxDrops,
+                (float)meshRxMaxCycles / ESP.getCpuFreqMHz());
+  for (int b = 0; b < MESH_RX_HIST_BUCKETS; b++) {
+    if (meshRxHist[b]) Serial.printf("  %-8s %lu\n", labels[b], (unsigned long)meshRxHist[b]);
+  }
+}
+
+// A rebooted client resuming its saved session. Unknown clients and old
+// epochs get no reply; the client then joins through a beacon.
+static void handleResync(const uint8_t* mac, uint32_t epoch) {
+  MeshTableLock lock;
+  int i = peerTableFind(meshPeers, mac);
+  if (i < 0 || epoch != meshEpoch) {
+    resyncRejected++;
+    return;
+  }
+  meshPeers.lastSeen[i] = millis();
+  if (!peerTableIsActive(meshPeers, i)) {
+    peerTableSetActive(meshPeers, i, true);
+    publishMeshFanout();
+    meshStateDirty = true;
+  }
+  uint8_t frame[MESH_RESYNC_SIZE];
+  meshResyncEncode(MESH_RESYNC_FLAG_ACK, meshEpoch, frame);
+  meshSend(mac, frame, sizeof(frame));
+  // A rebooted client no longer knows its groups; the table still does
+  uint8_t state[TG_MESH_SIZE];
+  meshSend(mac, state, tgMeshEncode(TG_OP_STATE, peerTableGroups(meshPeers, i), 0, state));
+  resyncAccepted++;
+  Serial.printf("Device %s resynced\n", peerTableName(meshPeers, i));
+}
+
+// JOIN/LEAVE/SET from a client on behalf of its phone; the answer is the
+// mask the table now holds, also when nothing changed
+static void handleGroupRequest(const uint8_t* mac, uint8_t op, uint8_t value) {
+  MeshTableLock lock;
+  int i = peerTableFind(meshPeers, mac);
+  if (i < 0) return;  // not joined: the client repeats its mask after joining
+  uint8_t groups = peerTableGroups(meshPeers, i);
+  int next = tgApply(groups, op, value);
+  if (next >= 0 && next != groups) {
+    groups = (uint8_t)next;
+    peerTableSetGroups(meshPeers, i, groups);
+    groupChanges++;
+    publishMeshFanout();
+    meshStateDirty = true;
+    Serial.printf("🗣️ %s listens to talk groups 0x%X\n", peerTableName(meshPeers, i), groups);
+  }
+  uint8_t frame[TG_MESH_SIZE];
+  meshSend(mac, frame, tgMeshEncode(TG_OP_STATE, groups, 0, frame));
+}
+
+static void handleMeshMessage(const uint8_t *mac, const uint8_t *data, int len) {
+  DLOG(MESH, DEBUG, MESH_RX, (uint32_t)(mac[0] << 16 | mac[1] << 8 | mac[2]),
+       (uint32_t)(mac[3] << 16 | mac[4] << 8 | mac[5]), len);
+
+  MeshBeacon beacon;
+  if (meshBeaconParse(data, len, beacon)) {
+    beaconsHeard++;  // another coordinator in range
+    if (beacon.networkId == MESH_NETWORK_ID) handleLeaderBeacon(mac, beacon);
+    return;
+  }
+  uint8_t switchTo;
+  uint32_t switchEpoch;
+  uint16_t switchInMs;
+  if (chanSwitchParse(data, len, switchTo, switchEpoch, switchInMs)) {
+    if (!isMeshCoordinator) followChannelSwitch(mac, switchTo, switchInMs);
+    return;
+  }
+  if (!isMeshCoordinator) return;  // a standby serves no mesh clients
+  notePeerFrame(mac);
+  uint8_t resyncFlags;
+  uint32_t resyncEpoch;
+  if (meshResyncParse(data, len, resyncFlags, resyncEpoch)) {
+    if (!(resyncFlags & MESH_RESYNC_FLAG_ACK)) handleResync(mac, resyncEpoch);
+    return;
+  }
+  uint32_t membersEpoch;
+  uint16_t membersVersion;
+  if (membersParseRequest(data, len, membersEpoch, membersVersion)) {
+    if (membersEpoch == meshEpoch) sendMemberSnapshot(mac);
+    return;
+  }
+  uint8_t groupOp, groupValue, groupExtra;
+  if (tgMeshParse(data, len, groupOp, groupValue, groupExtra)) {
+    if (groupOp != TG_OP_STATE) handleGroupRequest(mac, groupOp, groupValue);
+    return;
+  }
   
-  // Parse the received data
-  DynamicJsonDocument doc(1024);
+  // Parse into a document reused across messages (only MeshDispatchTask
+  // gets here), so steady-state heartbeats never touch the heap
+  static StaticJsonDocument<1024> doc;
   DeserializationError error = deserializeJson(doc, data, len);
   
   if (!error) {
-    String messageType = doc["type"];
+    const char* messageType = doc["type"] | "";
     
-    if (messageType == "mesh_join") {
+    if (strcmp(messageType, "mesh_join") == 0) {
       // New device requesting to join mesh network
-      String deviceName = doc["device_name"];
-      String deviceType = doc["device_type"];
+      const char* deviceName = doc["device_name"] | "";
+      const char* deviceType = doc["device_type"] | "";
       
       Serial.println("New device requesting to join mesh network!");
-      Serial.printf("Device: %s (%s)\n", deviceName.c_str(), deviceType.c_str());
+      Serial.printf("Device: %s (%s)\n", deviceName, deviceType);
       
       // Add device to mesh
       if (addDeviceToMesh(mac, deviceName, deviceType)) {
@@ -412,27 +1139,24 @@ void OnDataRecv(const uint8_t *mac, const uint8_t *data, int len) {
         sendMeshAck(mac, "failed");
       }
       
-    } else if (messageType == "mesh_ready") {
+    } else if (strcmp(messageType, "mesh_ready") == 0) {
       // Device confirms it's ready for communication
-      String deviceName = doc["source"];
-      Serial.printf("Device %s confirmed ready for communication\n", deviceName.c_str());
+      const char* deviceName = doc["source"] | "?";
+      Serial.printf("Device %s confirmed ready for communication\n", deviceName);
       
       // Mark device as ready for communication
-      for (int i = 0; i < meshDeviceCount; i++) {
-        if (memcmp(meshDevices[i].mac, mac, 6) == 0) {
-          meshDevices[i].lastSeen = millis();
-          meshDevices[i].isActive = true;
-          Serial.printf("Device %s marked as ready\n", deviceName.c_str());
-          break;
-        }
+      MeshTableLock lock;
+      int i = peerTableFind(meshPeers, mac);
+      if (i >= 0) {
+        meshPeers.lastSeen[i] = millis();
+        peerTableSetActive(meshPeers, i, true);
+        publishMeshFanout();
+        meshStateDirty = true;
+        Serial.printf("Device %s marked as ready\n", deviceName);
       }
       
-    } else if (messageType == "audio_data") {
-      Serial.println("Audio data received from mesh device!");
-      
-      // Get source device info
-      String sourceDevice = doc["source"];
-      Serial.printf("Audio from: %s\n", sourceDevice.c_str());
+    } else if (strcmp(messageType, "audio_data") == 0) {
+      DLOG(AUDIO, DEBUG, AUDIO_DATA_RX, (uint32_t)(mac[4] << 8 | mac[5]), len);
       
       // Forward audio to all other mesh devices (mesh relay)
       relayAudioToMesh(mac, data, len);
@@ -440,18 +1164,18 @@ void OnDataRecv(const uint8_t *mac, const uint8_t *data, int len) {
       // Send acknowledgment back to source
       sendAudioAck(mac);
       
-    } else if (messageType == "mesh_heartbeat") {
+    } else if (strcmp(messageType, "mesh_heartbeat") == 0) {
       // Update device last seen time
       updateDeviceHeartbeat(mac);
       
-    } else if (messageType == "mesh_leave") {
+    } else if (strcmp(messageType, "mesh_leave") == 0) {
       Serial.println("Device leaving mesh network");
       removeDeviceFromMesh(mac);
       updateMeshStatusLED();
       
-    } else if (messageType == "audio_ack") {
+    } else if (strcmp(messageType, "audio_ack") == 0) {
       // Audio was received by destination
-      Serial.println("Audio acknowledgment received");
+      DLOG(AUDIO, DEBUG, AUDIO_ACK_RX, (uint32_t)(mac[4] << 8 | mac[5]));
     }
   } else {
     Serial.println("Failed to parse mesh JSON message");
@@ -475,14 +1199,15 @@ void sendMeshBroadcast() {
     serializeJson(doc, jsonString);
     
     // Send heartbeat to all mesh devices
-    for (int i = 0; i < meshDeviceCount; i++) {
-      if (meshDevices[i].isActive) {
-        esp_err_t result = esp_now_send(meshDevices[i].mac, 
+    MeshTableLock lock;
+    for (int i = 0; i < meshPeers.count; i++) {
+      if (peerTableIsActive(meshPeers, i)) {
+        esp_err_t result = meshSend(meshPeers.macs[i], 
                                        (uint8_t*)jsonString.c_str(), 
                                        jsonString.length());
         if (result != ESP_OK) {
           Serial.printf("Failed to send heartbeat to %s: %d\n", 
-                       meshDevices[i].deviceName.c_str(), result);
+                       peerTableName(meshPeers, i), result);
         }
       }
     }
@@ -499,247 +1224,412 @@ void relayAudioToMesh(const uint8_t* sourceMac, const uint8_t* data, int len) {
     return;
   }
   
-  // Don't relay back to the source device
-  for (int i = 0; i < meshDeviceCount; i++) {
+  // Same message for every peer: header fields plus a hex preview of the
+  // first 64 bytes, built on the stack
+  char dataHex[2 * 64 + 1];
+  int previewLength = min(len, 64);
+  for (int j = 0; j < previewLength; j++) sprintf(dataHex + 2 * j, "%02X", data[j]);
+  dataHex[2 * previewLength] = '\0';
+  
+  StaticJsonDocument<256> doc;
+  doc["type"] = "audio_data";
+  doc["source"] = "ESP32_A_Server";
+  doc["timestamp"] = millis();
+  doc["data_length"] = len;
+  doc["data_preview"] = (const char*)dataHex;  // stored by pointer, not copied
+  
+  char message[ESP_NOW_MAX_DATA_LEN + 1];
+  size_t messageLen = serializeJson(doc, message, sizeof(message));
+  
+  // Don't relay back to the source device, and only to peers that share a
+  // talk group with it
+  MeshTableLock lock;
+  int source = sourceMac ? peerTableFind(meshPeers, sourceMac) : -1;
+  uint8_t sourceGroups = source >= 0 ? peerTableGroups(meshPeers, source) : TG_ALL_MASK;
+  for (int i = 0; i < meshPeers.count; i++) {
     // Safety check: ensure device is valid
     if (i >= MAX_MESH_DEVICES) {
       Serial.println("relayAudioToMesh: Device index out of bounds");
       break;
     }
     
-    if (meshDevices[i].isActive && 
-        (sourceMac == nullptr || memcmp(meshDevices[i].mac, sourceMac, 6) != 0)) {
-      
-      // Verify the peer is still valid before sending
-      esp_now_peer_info_t peerInfo;
-      if (esp_now_get_peer(meshDevices[i].mac, &peerInfo) == ESP_OK) {
-        
-        // Create audio relay message
-        DynamicJsonDocument doc(1024);
-        doc["type"] = "audio_data";
-        doc["source"] = "ESP32_A_Server";
-        doc["timestamp"] = millis();
-        doc["data_length"] = len;
-        
-        // Convert binary data to hex for JSON (with bounds checking)
-        String dataHex = "";
-        int previewLength = min(len, 64); // Limit to first 64 bytes
-        for (int j = 0; j < previewLength; j++) {
-          char hex[3];
-          sprintf(hex, "%02X", data[j]);
-          dataHex += hex;
-        }
-        doc["data_preview"] = dataHex;
-        
-        String jsonString;
-        serializeJson(doc, jsonString);
+    if (peerTableIsActive(meshPeers, i) && (peerTableGroups(meshPeers, i) & sourceGroups) &&
+        (sourceMac == nullptr || memcmp(meshPeers.macs[i], sourceMac, 6) != 0)) {
+      // A removed peer fails with ESP_ERR_ESPNOW_NOT_FOUND (handled below)
+      esp_err_t result = meshSend(meshPeers.macs[i], (uint8_t*)message, messageLen);
+      if (result == ESP_OK) {
+        DLOG(AUDIO, DEBUG, AUDIO_RELAYED, (uint32_t)(meshPeers.macs[i][4] << 8 | meshPeers.macs[i][5]));
+      } else {
+        DLOG(AUDIO, WARN, AUDIO_RELAY_FAILED, (uint32_t)(meshPeers.macs[i][4] << 8 | meshPeers.macs[i][5]), result);
         
-        // Send to this mesh device
-        esp_err_t result = esp_now_send(meshDevices[i].mac, 
-                                       (uint8_t*)jsonString.c_str(), 
-                                       jsonString.length());
-        if (result == ESP_OK) {
-          Serial.printf("Audio relayed to %s\n", meshDevices[i].deviceName.c_str());
-        } else {
-          Serial.printf("Failed to relay audio to %s: %d\n", 
-                       meshDevices[i].deviceName.c_str(), result);
-          
-          // If sending fails, mark device as potentially disconnected
-          if (result == ESP_ERR_ESPNOW_ARG || result == ESP_ERR_ESPNOW_NOT_FOUND) {
-            Serial.printf("Peer validation failed for %s, removing from mesh\n", 
-                         meshDevices[i].deviceName.c_str());
-            removeDeviceFromMesh(meshDevices[i].mac);
-            i--; // Adjust index after removal
-          }
+        // If sending fails, mark device as potentially disconnected
+        if (result == ESP_ERR_ESPNOW_ARG || result == ESP_ERR_ESPNOW_NOT_FOUND) {
+          Serial.printf("Peer validation failed for %s, removing from mesh\n", 
+                       peerTableName(meshPeers, i));
+          removeDeviceFromMesh(meshPeers.macs[i]);
+          i--; // Adjust index after removal
         }
-      } else {
-        Serial.printf("Peer validation failed for %s, removing from mesh\n", 
-                     meshDevices[i].deviceName.c_str());
-        removeDeviceFromMesh(meshDevices[i].mac);
-        i--; // Adjust index after removal
       }
     }
   }
 }
 
-void sendMeshAck(const uint8_t* mac, const String& status) {
-  DynamicJsonDocument ackDoc(256);
+void sendMeshAck(const uint8_t* mac, const char* status) {
+  StaticJsonDocument<256> ackDoc;
   ackDoc["type"] = "mesh_ack";
   ackDoc["source"] = "ESP32_A_Server";
   ackDoc["status"] = status;
   ackDoc["timestamp"] = millis();
-  ackDoc["mesh_device_count"] = meshDeviceCount;
+  ackDoc["mesh_device_count"] = meshPeers.count;
   
-  String ackString;
-  serializeJson(ackDoc, ackString);
+  char ackString[ESP_NOW_MAX_DATA_LEN + 1];
+  size_t ackLen = serializeJson(ackDoc, ackString, sizeof(ackString));
   
-  esp_err_t result = esp_now_send(mac, (uint8_t*)ackString.c_str(), ackString.length());
+  esp_err_t result = meshSend(mac, (uint8_t*)ackString, ackLen);
   if (result == ESP_OK) {
-    Serial.printf("Mesh ACK sent to device: %s\n", status.c_str());
+    DLOG(MESH, DEBUG, MESH_ACK_SENT, (uint32_t)(mac[4] << 8 | mac[5]), meshPeers.count);
   } else {
-    Serial.printf("Failed to send mesh ACK: %d\n", result);
+    DLOG(MESH, WARN, MESH_ACK_FAILED, (uint32_t)(mac[4] << 8 | mac[5]), result);
   }
 }
 
 void sendAudioAck(const uint8_t* mac) {
-  DynamicJsonDocument ackDoc(256);
+  StaticJsonDocument<256> ackDoc;
   ackDoc["type"] = "audio_ack";
   ackDoc["source"] = "ESP32_A_Server";
   ackDoc["status"] = "received";
   ackDoc["timestamp"] = millis();
   
-  String ackString;
-  serializeJson(ackDoc, ackString);
+  char ackString[ESP_NOW_MAX_DATA_LEN + 1];
+  size_t ackLen = serializeJson(ackDoc, ackString, sizeof(ackString));
   
-  esp_err_t result = esp_now_send(mac, (uint8_t*)ackString.c_str(), ackString.length());
+  esp_err_t result = meshSend(mac, (uint8_t*)ackString, ackLen);
   if (result == ESP_OK) {
-    Serial.println("Audio ACK sent");
+    DLOG(AUDIO, DEBUG, AUDIO_ACK_SENT, (uint32_t)(mac[4] << 8 | mac[5]));
   } else {
-    Serial.printf("Failed to send audio ACK: %d\n", result);
+    DLOG(AUDIO, WARN, AUDIO_ACK_FAILED, (uint32_t)(mac[4] << 8 | mac[5]), result);
   }
 }
 
-void sendMeshHeartbeat() {
-  if (meshDeviceCount == 0) return;
-  
-  // Create minimal heartbeat message
-  DynamicJsonDocument heartbeatDoc(128);  // Reduced from 256
-  heartbeatDoc["type"] = "mesh_heartbeat";
-  heartbeatDoc["source"] = "ESP32_A_Server";
-  heartbeatDoc["timestamp"] = millis();
-  heartbeatDoc["devices"] = meshDeviceCount;
-  heartbeatDoc["mac"] = WiFi.macAddress();
-  
-  String heartbeatString;
-  serializeJson(heartbeatDoc, heartbeatString);
-  
-  Serial.printf("Sending heartbeat to %d mesh devices (size: %d bytes)\n", meshDeviceCount, heartbeatString.length());
-  
-  // Send heartbeat to all mesh devices with proper validation
-  for (int i = 0; i < meshDeviceCount; i++) {
-    if (meshDevices[i].isActive) {
-      Serial.printf("Attempting to send heartbeat to %s (MAC: %02X:%02X:%02X:%02X:%02X:%02X)\n",
-                   meshDevices[i].deviceName.c_str(),
-                   meshDevices[i].mac[0], meshDevices[i].mac[1], meshDevices[i].mac[2],
-                   meshDevices[i].mac[3], meshDevices[i].mac[4], meshDevices[i].mac[5]);
-      
-      // Verify the peer is still valid before sending
-      esp_now_peer_info_t peerInfo;
-      esp_err_t peerResult = esp_now_get_peer(meshDevices[i].mac, &peerInfo);
-      if (peerResult == ESP_OK) {
-        Serial.printf("Peer validation successful for %s\n", meshDevices[i].deviceName.c_str());
-        
-        // Ensure message size is within limits
-        if (heartbeatString.length() > 250) {
-          Serial.printf("⚠️  Heartbeat message too large (%d bytes), truncating\n", heartbeatString.length());
-          heartbeatString = heartbeatString.substring(0, 250);
-        }
-        
-        esp_err_t result = esp_now_send(meshDevices[i].mac, 
-                                       (uint8_t*)heartbeatString.c_str(), 
-                                       heartbeatString.length());
-        if (result == ESP_OK) {
-          Serial.printf("Heartbeat sent successfully to %s\n", meshDevices[i].deviceName.c_str());
-        } else {
-          Serial.printf("Failed to send heartbeat to %s: %d (0x%04X)\n", 
-                       meshDevices[i].deviceName.c_str(), result, result);
-          
-          // If sending fails, mark device as potentially disconnected
-          if (result == ESP_ERR_ESPNOW_ARG || result == ESP_ERR_ESPNOW_NOT_FOUND) {
-            Serial.printf("Peer validation failed for %s, removing from mesh\n", 
-                         meshDevices[i].deviceName.c_str());
-            removeDeviceFromMesh(meshDevices[i].mac);
-            i--; // Adjust index after removal
-          }
-        }
-      } else {
-        Serial.printf("Peer validation failed for %s: %d (0x%04X), removing from mesh\n", 
-                     meshDevices[i].deviceName.c_str(), peerResult, peerResult);
-        removeDeviceFromMesh(meshDevices[i].mac);
-        i--; // Adjust index after removal
-      }
+// Broadcast one beacon; HousekeepingTask calls it every MESH_BEACON_INTERVAL_MS
+// while this node leads
+void sendMeshBeacon() {
+  MeshBeacon beacon;
+  beacon.flags = deviceConnected ? MESH_BEACON_FLAG_PHONE : 0;
+  beacon.peers = meshPeers.count;
+  beacon.capacity = MAX_MESH_DEVICES;
+  beacon.networkId = MESH_NETWORK_ID;
+  beacon.seq = beaconSeq++;
+  beacon.intervalMs = MESH_BEACON_INTERVAL_MS;
+  beacon.epoch = meshEpoch;
+  beacon.priority = election.priority;
+  beacon.leaseBeacons = MESH_LEASE_BEACONS;
+  uint8_t frame[MESH_BEACON_SIZE];
+  meshBeaconEncode(beacon, frame);
+  if (meshSend(kBroadcastMac, frame, sizeof(frame)) == ESP_OK) {
+    beaconsSent++;
+  } else {
+    beaconFailures++;
+  }
+}
+
+static void printBeaconStats() {
+  Serial.printf("=== BEACON (network 0x%04X, epoch %08lX, every %d ms) ===\n",
+                MESH_NETWORK_ID, (unsigned long)meshEpoch, MESH_BEACON_INTERVAL_MS);
+  portENTER_CRITICAL(&electionMux);
+  MeshElection e = election;
+  portEXIT_CRITICAL(&electionMux);
+  if (e.role == ELECTION_LEADER) {
+    Serial.printf("  role leader for %lu ms, priority %u, lease %d ms\n",
+                  millis() - leaderSinceMs, e.priority, MESH_LEASE_BEACONS * MESH_BEACON_INTERVAL_MS);
+  } else if (e.leaderKnown) {
+    Serial.printf("  role standby, priority %u, leader %02X:%02X:%02X:%02X:%02X:%02X (priority %u), lease left %ld ms\n",
+                  e.priority, e.leaderMac[0], e.leaderMac[1], e.leaderMac[2], e.leaderMac[3],
+                  e.leaderMac[4], e.leaderMac[5], e.leaderPriority, (long)(e.leaseUntilMs - millis()));
+  } else {
+    Serial.printf("  role standby, priority %u, no leader heard, claim in %ld ms\n",
+                  e.priority, (long)(e.claimAtMs - millis()));
+  }
+  Serial.printf("  elections won %lu, stepped down %lu, leader changes %lu\n",
+                (unsigned long)e.wins, (unsigned long)e.stepDowns, (unsigned long)e.leaderChanges);
+  Serial.printf("  sent %lu, failed %lu, heard from other coordinators %lu, peers %u/%d\n",
+                (unsigned long)beaconsSent, (unsigned long)beaconFailures,
+                (unsigned long)beaconsHeard, meshPeers.count, MAX_MESH_DEVICES);
+  Serial.printf("  session %s, NVS saves %lu, resyncs accepted %lu, rejected %lu\n",
+                meshSessionRestored ? "restored" : "new", (unsigned long)meshStateSaves,
+                (unsigned long)resyncAccepted, (unsigned long)resyncRejected);
+}
+
+// Channel switch announcement, broadcast after every beacon until the move
+static void sendChannelSwitch() {
+  uint8_t to = switchChannel;
+  int32_t inMs = (int32_t)(switchAtMs - millis());
+  if (!to || inMs < 0) return;
+  uint8_t frame[MESH_CHANNEL_SWITCH_SIZE];
+  chanSwitchEncode(to, meshEpoch, (uint16_t)inMs, frame);
+  if (meshSend(kBroadcastMac, frame, sizeof(frame)) == ESP_OK) switchAnnouncements++;
+}
+
+// Leader: move the whole mesh to channel in CHAN_SWITCH_COUNTDOWN_MS
+static bool announceChannelSwitch(uint8_t channel) {
+  if (!isMeshCoordinator || switchChannel || channel == meshChannel || !chanValid(MESH_CHANNEL_MASK, channel)) {
+    return false;
+  }
+  switchAtMs = millis() + CHAN_SWITCH_COUNTDOWN_MS;
+  switchChannel = channel;
+  sendChannelSwitch();
+  Serial.printf("📶 Moving the mesh from channel %u to %u in %d ms (cost %.2f -> %.2f)\n", meshChannel, channel,
+                CHAN_SWITCH_COUNTDOWN_MS, chanCost(channelPlan.ch[meshChannel]), chanCost(channelPlan.ch[channel]));
+  return true;
+}
+
+// Standby: the leader moves the mesh, go along at the same moment
+static void followChannelSwitch(const uint8_t* mac, uint8_t channel, uint16_t msUntil) {
+  portENTER_CRITICAL(&electionMux);
+  bool fromLeader = election.leaderKnown && memcmp(election.leaderMac, mac, 6) == 0;
+  portEXIT_CRITICAL(&electionMux);
+  if (!fromLeader || !chanValid(MESH_CHANNEL_MASK, channel)) return;
+  switchAtMs = millis() + msUntil;
+  switchChannel = channel;
+}
+
+// Channel timer: retune at the announced moment. The leader beacons at once
+// so clients renew the lease on the new channel, and starts measuring the
+// throughput after the move.
+static void applyChannelSwitch(uint32_t now) {
+  uint8_t from = meshChannel, to = switchChannel;
+  switchChannel = 0;
+  esp_wifi_set_channel(to, WIFI_SECOND_CHAN_NONE);
+  meshChannel = to;
+  chanMoved(channelPlan, to, now);
+  Serial.printf("📶 Mesh moved from channel %u to %u\n", from, to);
+  meshStateDirty = true;  // a standby saves the channel too
+  if (!isMeshCoordinator) return;
+  sendMeshBeacon();
+  lastChannelMove.from = from;
+  lastChannelMove.to = to;
+  lastChannelMove.atMs = now;
+  lastChannelMove.done = false;
+  chanTputSummary(channelTput, lastChannelMove.beforeBps, lastChannelMove.beforePct);
+  chanTputReset(channelTput);
+}
+
+// The dwell starts once nothing is left in flight (at most CHAN_DRAIN_MS
+// after the pause), so queued frames still go out on the mesh channel
+static void tuneChannelSurvey() {
+  portENTER_CRITICAL(&channelMux);
+  memset(&channelSample, 0, sizeof(channelSample));
+  portEXIT_CRITICAL(&channelMux);
+  if (surveyChannel != meshChannel) {
+    __atomic_store_n(&surveyAway, true, __ATOMIC_RELAXED);
+    esp_wifi_set_channel(surveyChannel, WIFI_SECOND_CHAN_NONE);
+  }
+  esp_wifi_set_promiscuous(true);
+  surveyPausedMs = 0;
+  surveyStartUs = esp_timer_get_time();
+}
+
+static void startChannelSurvey(uint32_t now) {
+  surveyChannel = chanNextSurvey(channelPlan);
+  if (surveyChannel == meshChannel) {
+    tuneChannelSurvey();  // sampled in place, nothing to pause
+    return;
+  }
+  __atomic_store_n(&meshOffChannel, true, __ATOMIC_SEQ_CST);
+  surveyPausedMs = now;
+  if (__atomic_load_n(&meshTxInFlight, __ATOMIC_SEQ_CST) <= 0) tuneChannelSurvey();
+}
+
+static void endChannelSurvey(uint32_t now) {
+  esp_wifi_set_promiscuous(false);
+  if (surveyChannel != meshChannel) {
+    esp_wifi_set_channel(meshChannel, WIFI_SECOND_CHAN_NONE);
+    __atomic_store_n(&surveyAway, false, __ATOMIC_RELAXED);
+    __atomic_store_n(&meshOffChannel, false, __ATOMIC_SEQ_CST);
+  }
+  portENTER_CRITICAL(&channelMux);
+  ChannelSample sample = channelSample;
+  portEXIT_CRITICAL(&channelMux);
+  sample.dwellUs = (uint32_t)(esp_timer_get_time() - surveyStartUs);
+  chanRecordSurvey(channelPlan, surveyChannel, sample);
+  surveyChannel = 0;
+  uint8_t target = chanChoose(channelPlan, now);
+  if (target) announceChannelSwitch(target);
+}
+
+// Once per survey period: this second's unicasts feed the failure rate and
+// the throughput window, which completes the report of the last move
+static void rollChannelSecond(uint32_t now) {
+  uint32_t bytes = __atomic_exchange_n(&chanTxBytes, 0, __ATOMIC_RELAXED);
+  uint32_t ok = __atomic_exchange_n(&chanTxOk, 0, __ATOMIC_RELAXED);
+  uint32_t failed = __atomic_exchange_n(&chanTxFailed, 0, __ATOMIC_RELAXED);
+  chanRecordSends(channelPlan, ok + failed, failed);
+  chanTputTick(channelTput, bytes, ok, failed);
+  ChannelMoveReport& m = lastChannelMove;
+  if (m.to && !m.done && now - m.atMs >= CHAN_TPUT_SECONDS * 1000UL) {
+    chanTputSummary(channelTput, m.afterBps, m.afterPct);
+    m.done = true;
+    Serial.printf("📶 Channel %u -> %u: %lu B/s delivered (%lu%%) before, %lu B/s (%lu%%) after\n", m.from, m.to,
+                  (unsigned long)m.beforeBps, (unsigned long)m.beforePct,
+                  (unsigned long)m.afterBps, (unsigned long)m.afterPct);
+  }
+}
+
+static void printChannelStats() {
+  ChannelPlan plan = channelPlan;  // housekeeping task's copy, a torn read only skews one line
+  ChannelMoveReport m = lastChannelMove;
+  uint8_t pending = switchChannel;
+  Serial.printf("=== CHANNEL (mesh on %u, candidates 0x%04X, surveys %lu, moves %lu) ===\n", meshChannel,
+                MESH_CHANNEL_MASK, (unsigned long)plan.surveys, (unsigned long)plan.moves);
+  for (uint8_t c = 1; c <= CHAN_MAX; c++) {
+    if (!chanValid(plan.mask, c)) continue;
+    const ChannelStats& st = plan.ch[c];
+    Serial.printf("  %2u: busy %5.1f%% (last %5.1f%%), noise %6.1f dBm, fail %5.1f%%, cost %.2f, %lu frames in %u surveys%s\n",
+                  c, st.busy * 100, st.lastBusy * 100, st.noiseDbm, st.fail * 100, chanCost(st),
+                  (unsigned long)st.frames, st.surveys, c == meshChannel ? "  <- mesh" : "");
+  }
+  if (pending) {
+    Serial.printf("  moving to %u in %ld ms\n", pending, (long)(switchAtMs - millis()));
+  }
+  if (m.to) {
+    Serial.printf("  last move %u -> %u %lu s ago: %lu B/s delivered (%lu%%) before", m.from, m.to,
+                  (unsigned long)((millis() - m.atMs) / 1000), (unsigned long)m.beforeBps, (unsigned long)m.beforePct);
+    if (m.done) {
+      Serial.printf(", %lu B/s (%lu%%) after\n", (unsigned long)m.afterBps, (unsigned long)m.afterPct);
+    } else {
+      Serial.println(", measuring after");
     }
   }
+  Serial.printf("  announcements %lu, frames dropped while surveying %lu, completed away %lu\n",
+                (unsigned long)switchAnnouncements, (unsigned long)offChannelDrops, (unsigned long)surveyLostSends);
+  Serial.printf("  standby searches %lu, leader found on another channel %lu\n",
+                (unsigned long)standbySearches, (unsigned long)standbyFoundElsewhere);
 }
 
-void broadcastMeshStatus() {
-  if (meshDeviceCount == 0) return;
-  
-  // Create a minimal status message to stay within ESP-NOW limits
-  DynamicJsonDocument statusDoc(256);  // Reduced from 512
-  statusDoc["type"] = "mesh_status";
-  statusDoc["source"] = "ESP32_A_Server";
-  statusDoc["timestamp"] = millis();
-  statusDoc["total_devices"] = meshDeviceCount;
-  statusDoc["mesh_healthy"] = true;
-  
-  // Only include essential device info to keep message small
-  if (meshDeviceCount > 0) {
-    JsonArray devicesArray = statusDoc.createNestedArray("devices");
-    for (int i = 0; i < meshDeviceCount && i < 2; i++) {  // Limit to 2 devices
-      if (meshDevices[i].isActive) {
-        JsonObject device = devicesArray.createNestedObject();
-        // Use short MAC format to save space
-        char macStr[13];  // Reduced from 18
-        sprintf(macStr, "%02X%02X%02X%02X%02X%02X",
-                meshDevices[i].mac[0], meshDevices[i].mac[1], meshDevices[i].mac[2],
-                meshDevices[i].mac[3], meshDevices[i].mac[4], meshDevices[i].mac[5]);
-        device["m"] = macStr;  // Short key
-        device["n"] = meshDevices[i].deviceName;  // Short key
-        device["t"] = meshDevices[i].deviceType;  // Short key
-        device["s"] = (meshDevices[i].lastSeen / 1000);  // Seconds, not milliseconds
-        device["q"] = meshDevices[i].audioQuality;  // Short key
+static void printMemberLog() {
+  MeshTableLock lock;
+  Serial.printf("=== MEMBERSHIP LOG (session %08lX, v%u, %u members) ===\n",
+                (unsigned long)memberLog.epoch, memberLog.version, memberLog.count);
+  for (int i = 0; i < memberLog.count; i++) {
+    const MemberEntry& e = memberLog.entries[i];
+    Serial.printf("  %02X:%02X:%02X:%02X:%02X:%02X %-23s %s\n", e.mac[0], e.mac[1], e.mac[2],
+                  e.mac[3], e.mac[4], e.mac[5], e.name, (e.flags & MEMBER_FLAG_ACTIVE) ? "active" : "joining");
+  }
+  Serial.printf("  deltas %lu (%lu B), snapshots %lu (%lu frames)\n",
+                (unsigned long)memberDeltasSent, (unsigned long)memberDeltaBytes,
+                (unsigned long)memberSnapshotsSent, (unsigned long)memberSnapshotFrames);
+}
+
+static void printPeerHealth() {
+  uint32_t now = millis();
+  Serial.printf("=== PEER HEALTH (phi >= %d and %d failed sends suspects) ===\n", FD_PHI_SUSPECT, FD_MIN_FAILURES);
+  for (int i = 0; i < FD_MAX_PEERS; i++) {
+    FdPeer p;
+    portENTER_CRITICAL(&peerHealthMux);
+    p = peerHealth.peers[i];
+    portEXIT_CRITICAL(&peerHealthMux);
+    if (!p.used) continue;
+    Serial.printf("  %02X:%02X:%02X:%02X:%02X:%02X phi %5.1f, last heard %lu ms ago, mean gap %lu ms (%u samples), "
+                  "%u failed, %s, suspected %lu times\n",
+                  p.mac[0], p.mac[1], p.mac[2], p.mac[3], p.mac[4], p.mac[5], fdPhi(p, now),
+                  (unsigned long)(now - p.lastMs), (unsigned long)(p.samples ? p.sum / p.samples : 0), p.samples,
+                  p.failStreak, p.suspected ? "SUSPECTED" : "ok", (unsigned long)p.suspicions);
+  }
+  portENTER_CRITICAL(&peerHealthMux);
+  uint32_t arrivals = peerHealth.arrivals, failures = peerHealth.failures, suspicions = peerHealth.suspicions;
+  uint32_t recoveries = peerHealth.recoveries, probes = peerHealth.probes, detectMs = peerHealth.lastDetectMs;
+  portEXIT_CRITICAL(&peerHealthMux);
+  Serial.printf("  arrivals %lu, failed sends %lu, suspicions %lu (last after %lu ms of silence), recoveries %lu, probes %lu\n",
+                (unsigned long)arrivals, (unsigned long)failures, (unsigned long)suspicions,
+                (unsigned long)detectMs, (unsigned long)recoveries, (unsigned long)probes);
+}
+
+static void printTalkGroups() {
+  Serial.printf("=== TALK GROUPS (Phone A talks to group %u) ===\n", phoneTalkGroup);
+  {
+    MeshTableLock lock;
+    for (int g = 0; g < MAX_TALK_GROUPS; g++) {
+      uint32_t fanout = peerTableGroupActive(meshPeers, g);
+      Serial.printf("  group %d: %d listeners, %d active, %lu frames, %lu unicasts\n", g,
+                    __builtin_popcount(meshPeers.groupMask[g]), __builtin_popcount(fanout),
+                    (unsigned long)groupFrames[g], (unsigned long)groupSends[g]);
+      for (uint32_t bits = meshPeers.groupMask[g]; bits; bits &= bits - 1) {
+        int i = __builtin_ctz(bits);
+        Serial.printf("    [%d] %s%s\n", i, peerTableName(meshPeers, i), (fanout >> i) & 1u ? "" : " (inactive)");
       }
     }
   }
+  Serial.printf("  listen mask changes %lu, frames for an unknown group %lu\n",
+                (unsigned long)groupChanges, (unsigned long)groupUnroutable);
+}
+
+// group:<peer>:<mask> - what a SET from that peer's phone would do
+static void setPeerGroups(int index, int mask) {
+  MeshTableLock lock;
+  if (index < 0 || index >= meshPeers.count || tgApply(0, TG_OP_SET, (uint8_t)mask) < 0) {
+    Serial.printf("Usage: group:<peer 0-%d>:<mask 0x0-0x%X>\n", meshPeers.count - 1, TG_ALL_MASK);
+    return;
+  }
+  peerTableSetGroups(meshPeers, index, (uint8_t)mask);
+  groupChanges++;
+  publishMeshFanout();
+  meshStateDirty = true;
+  uint8_t frame[TG_MESH_SIZE];
+  meshSend(meshPeers.macs[index], frame, tgMeshEncode(TG_OP_STATE, (uint8_t)mask, 0, frame));
+  Serial.printf("🗣️ %s listens to talk groups 0x%X\n", peerTableName(meshPeers, index), mask);
+}
+
+static void printAirtimeStats() {
+  airtimePrintStats();
+  Serial.printf("  heartbeats sent %lu, suppressed %lu\n",
+                (unsigned long)heartbeatsSent, (unsigned long)heartbeatsSuppressed);
+  Serial.printf("  membership deltas %lu (%lu B), snapshots %lu (%lu frames), version piggybacked on %lu audio frames\n",
+                (unsigned long)memberDeltasSent, (unsigned long)memberDeltaBytes,
+                (unsigned long)memberSnapshotsSent, (unsigned long)memberSnapshotFrames,
+                (unsigned long)membersPiggybacked);
+}
+
+void sendMeshHeartbeat() {
+  if (meshPeers.count == 0) return;
   
-  String statusString;
-  serializeJson(statusDoc, statusString);
-  
-  Serial.printf("📡 Status message size: %d bytes\n", statusString.length());
+  // Create minimal heartbeat message
+  StaticJsonDocument<128> heartbeatDoc;
+  heartbeatDoc["type"] = "mesh_heartbeat";
+  heartbeatDoc["source"] = "ESP32_A_Server";
+  heartbeatDoc["timestamp"] = millis();
+  heartbeatDoc["devices"] = meshPeers.count;
+  heartbeatDoc["mv"] = memberLog.version;  // a client behind on the log asks for a snapshot
+  heartbeatDoc["mac"] = (const char*)ownMacStr;
   
-  // Broadcast to all mesh devices with proper error handling
-  for (int i = 0; i < meshDeviceCount; i++) {
-    if (meshDevices[i].isActive) {
-      Serial.printf("Attempting to send status to %s (MAC: %02X:%02X:%02X:%02X:%02X:%02X)\n",
-                   meshDevices[i].deviceName.c_str(),
-                   meshDevices[i].mac[0], meshDevices[i].mac[1], meshDevices[i].mac[2],
-                   meshDevices[i].mac[3], meshDevices[i].mac[4], meshDevices[i].mac[5]);
-      
-      // Verify the peer is still valid before sending
-      esp_now_peer_info_t peerInfo;
-      esp_err_t peerResult = esp_now_get_peer(meshDevices[i].mac, &peerInfo);
-      if (peerResult == ESP_OK) {
-        Serial.printf("Peer validation successful for %s\n", meshDevices[i].deviceName.c_str());
-        
-        // Check message size before sending
-        if (statusString.length() > 250) {
-          Serial.printf("⚠️  Status message too large (%d bytes), truncating\n", statusString.length());
-          statusString = statusString.substring(0, 250);
-        }
+  // Serialized into an ESP-NOW sized buffer, which also caps it at 250 bytes
+  if (measureJson(heartbeatDoc) > ESP_NOW_MAX_DATA_LEN) {
+    Serial.printf("⚠️  Heartbeat message too large (%d bytes), truncating\n", (int)measureJson(heartbeatDoc));
+  }
+  char heartbeatString[ESP_NOW_MAX_DATA_LEN + 1];
+  size_t heartbeatLen = serializeJson(heartbeatDoc, heartbeatString, sizeof(heartbeatString));
+  
+  DLOG(MESH, DEBUG, HEARTBEAT_SEND, meshPeers.count, heartbeatLen);
+  
+  // Send heartbeat to all mesh devices; a peer removed underneath us shows
+  // up as ESP_ERR_ESPNOW_NOT_FOUND, so no esp_now_get_peer round trip first
+  MeshTableLock lock;
+  for (int i = 0; i < meshPeers.count; i++) {
+    if (peerTableIsActive(meshPeers, i)) {
+      esp_err_t result = meshSend(meshPeers.macs[i], (uint8_t*)heartbeatString, heartbeatLen);
+      if (result == ESP_OK) {
+        heartbeatsSent++;
+        DLOG(MESH, DEBUG, HEARTBEAT_SENT, (uint32_t)(meshPeers.macs[i][4] << 8 | meshPeers.macs[i][5]));
+      } else {
+        Serial.printf("Failed to send heartbeat to %s: %d (0x%04X)\n", 
+                     peerTableName(meshPeers, i), result, result);
         
-        esp_err_t result = esp_now_send(meshDevices[i].mac, 
-                                       (uint8_t*)statusString.c_str(), 
-                                       statusString.length());
-        if (result == ESP_OK) {
-          Serial.printf("Status sent successfully to %s\n", meshDevices[i].deviceName.c_str());
-        } else {
-          Serial.printf("Failed to send status to %s: %d (0x%04X)\n", 
-                       meshDevices[i].deviceName.c_str(), result, result);
-          
-          // If sending fails, mark device as potentially disconnected
-          if (result == ESP_ERR_ESPNOW_ARG || result == ESP_ERR_ESPNOW_NOT_FOUND) {
-            Serial.printf("Peer validation failed for %s, removing from mesh\n", 
-                         meshDevices[i].deviceName.c_str());
-            removeDeviceFromMesh(meshDevices[i].mac);
-            i--; // Adjust index after removal
-          }
+        // If sending fails, mark device as potentially disconnected
+        if (result == ESP_ERR_ESPNOW_ARG || result == ESP_ERR_ESPNOW_NOT_FOUND) {
+          Serial.printf("Peer validation failed for %s, removing from mesh\n", 
+                       peerTableName(meshPeers, i));
+          removeDeviceFromMesh(meshPeers.macs[i]);
+          i--; // Adjust index after removal
         }
-      } else {
-        Serial.printf("Peer validation failed for %s: %d (0x%04X), removing from mesh\n", 
-                     meshDevices[i].deviceName.c_str(), peerResult, peerResult);
-        removeDeviceFromMesh(meshDevices[i].mac);
-        i--; // Adjust index after removal
       }
     }
   }
@@ -767,6 +1657,221 @@ void blinkStatusLED(uint8_t r, uint8_t g, uint8_t b, int times) {
 #define AUDIO_CHANNELS 1  // Match Android: Mono
 #define AUDIO_COMPRESSION_RATIO 1  // No compression - raw PCM
 
+// Stream IDs stamped on WM v2 frames generated here; the apps pick 3..255
+#define COORDINATOR_STREAM_ID 1
+#define GENERATOR_STREAM_ID   2
+
+// Mesh audio rate: 8 kHz halves airtime on constrained links (mesh_rate command)
+static uint32_t meshSampleRate = AUDIO_SAMPLE_RATE;
+static volatile uint32_t pendingMeshSampleRate = 0;  // applied by the sender task
+static Resampler meshDownsampler;
+
+// Level normalisation on decoded u-law before it reaches the mesh (agc command)
+static Agc meshAgc;
+static volatile bool agcEnabled = true;
+static volatile bool agcResetPending = false;  // applied by the sender task
+
+// Optional Opus re-encode of Phone A's stream at a mesh-appropriate bitrate,
+// with one profile per talk group (lib/TalkGroup)
+
+struct TranscodeItem {
+  uint8_t group;
+  uint8_t streamId;
+  uint16_t length;
+  uint32_t queuedUs;
+  uint8_t data[kTranscodeSlotBytes];
+};
+static_assert(sizeof(TranscodeItem) == kBufferPools[BUF_POOL_TRANSCODE_QUEUE].slotBytes, "update TRANSCODE_QUEUE in BufferConfig.h");
+
+struct TranscodeStage {
+  OpusTranscoder codec;
+  Agc agc;
+  uint8_t group;           // talk group the re-encoded frames go to
+  uint8_t streamId;        // source stream, kept on the re-encoded frames
+  uint32_t sequence;
+  uint32_t timestamp;      // WM_TIMESTAMP_HZ ticks
+  uint32_t busyCycles;     // decode + AGC + encode, current window
+  uint32_t windowStart;    // cycle count at window start
+  uint32_t audioSamples;   // decoded samples, current window
+  float lastLoadPct;       // share of one core over the last window
+  float lastRtf;           // processing time / audio time
+};
+
+// The console writes the profiles, BleIngestTask and TranscodeTask read them:
+// always copy in and out under transcodeMux. A stage is published once its
+// codec is initialised and only then do frames of its group go to the queue.
+static TranscodeProfile transcodeProfiles[MAX_TALK_GROUPS];
+static portMUX_TYPE transcodeMux = portMUX_INITIALIZER_UNLOCKED;
+static TranscodeStage* transcodeStages[MAX_TALK_GROUPS];  // allocated on first enable
+static volatile bool transcodeConfigPending[MAX_TALK_GROUPS];
+static TranscodeItem transcodeQueue[kTranscodeQueueSlots];
+static volatile uint16_t transcodeHead = 0;
+static volatile uint16_t transcodeTail = 0;
+static volatile uint32_t transcodeDrops = 0;
+TaskHandle_t TranscodeTaskHandle = NULL;
+
+static TranscodeProfile transcodeProfile(uint8_t group) {
+  portENTER_CRITICAL(&transcodeMux);
+  TranscodeProfile p = transcodeProfiles[group];
+  portEXIT_CRITICAL(&transcodeMux);
+  return p;
+}
+
+static void transcodeSetProfile(uint8_t group, const TranscodeProfile& p) {
+  portENTER_CRITICAL(&transcodeMux);
+  transcodeProfiles[group] = p;
+  portEXIT_CRITICAL(&transcodeMux);
+}
+
+// Frames of this group are re-encoded: profile on and its stage ready
+static bool transcodeActive(uint8_t group) {
+  return transcodeProfile(group).enabled && __atomic_load_n(&transcodeStages[group], __ATOMIC_ACQUIRE);
+}
+
+// False if the frame was not queued; the caller then sends it unchanged
+static bool transcodePush(uint8_t group, uint8_t streamId, const uint8_t* packet, uint16_t len) {
+  if (len > sizeof(transcodeQueue[0].data) || !TranscodeTaskHandle) return false;
+  uint16_t nextHead = (transcodeHead + 1) & kTranscodeQueueMask;
+  if (nextHead == __atomic_load_n(&transcodeTail, __ATOMIC_ACQUIRE)) {
+    transcodeDrops++;
+    return false;
+  }
+  TranscodeItem &slot = transcodeQueue[transcodeHead];
+  slot.group = group;
+  slot.streamId = streamId;
+  slot.length = len;
+  memcpy(slot.data, packet, len);
+  slot.queuedUs = taskStageNowUs();
+  __atomic_store_n(&transcodeHead, nextHead, __ATOMIC_RELEASE);
+  bufferNoteLevel(BUF_POOL_TRANSCODE_QUEUE, (nextHead - transcodeTail) & kTranscodeQueueMask);
+  xTaskNotifyGive(TranscodeTaskHandle);
+  return true;
+}
+
+static void transcodeEmit(const uint8_t* packet, int len, void* ctx) {
+  TranscodeStage* stage = (TranscodeStage*)ctx;
+  uint8_t frame[WM_HEADER_V2_MAX_SIZE + OPUS_TRANSCODE_MAX_PACKET];
+  WmHeader header;
+  header.type = WM_TYPE_OPUS;
+  header.flags = WM_FLAG_TRANSCODED | (stage->group ? WM_FLAG_GROUP : 0);
+  header.group = stage->group;
+  header.streamId = stage->streamId;
+  header.sequence = stage->sequence++;
+  header.timestamp = stage->timestamp;
+  header.payloadLen = (uint16_t)len;
+  int headerLen = wmWriteHeaderV2(frame, header);
+  memcpy(frame + headerLen, packet, len);
+  stage->timestamp += stage->codec.profile.frameMs * (WM_TIMESTAMP_HZ / 1000);
+  sendWmToMesh(frame, headerLen + len, stage->group);
+}
+
+static_assert(kTranscodeStages == MAX_TALK_GROUPS, "one transcode stage per talk group");
+static_assert(sizeof(TranscodeStage) <= kTranscodeStageBytes, "update kTranscodeStageBytes in BufferConfig.h");
+
+static TranscodeStage* transcodeStageFor(uint8_t group) {
+  if (group >= MAX_TALK_GROUPS) return nullptr;
+  TranscodeStage* stage = transcodeStages[group];
+  if (!stage) {
+    if ((uint32_t)opus_encoder_get_size(1) > kOpusEncoderBytes || (uint32_t)opus_decoder_get_size(1) > kOpusDecoderBytes) {
+      Serial.printf("⚠️ libopus state (enc %d B, dec %d B) is over its BufferConfig budget\n",
+                    opus_encoder_get_size(1), opus_decoder_get_size(1));
+    }
+    stage = (TranscodeStage*)calloc(1, sizeof(TranscodeStage));
+    if (!stage) return nullptr;
+    if (!opusTranscoderInit(stage->codec, AUDIO_SAMPLE_RATE, transcodeProfile(group))) {
+      free(stage);
+      return nullptr;
+    }
+    AgcConfig agcConfig;
+    agcDefaultConfig(agcConfig);
+    agcInit(stage->agc, agcConfig);
+    stage->group = group;
+    stage->windowStart = ESP.getCycleCount();
+    __atomic_store_n(&transcodeStages[group], stage, __ATOMIC_RELEASE);
+    uint32_t stages = 0;
+    for (int g = 0; g < MAX_TALK_GROUPS; g++) stages += transcodeStages[g] != nullptr;
+    bufferNoteLevel(BUF_POOL_TRANSCODE_STAGE, stages);
+    bufferNoteLevel(BUF_POOL_OPUS_ENCODER, stages);
+    bufferNoteLevel(BUF_POOL_OPUS_DECODER, stages);
+  }
+  return stage;
+}
+
+// Dedicated task: decode -> AGC -> re-encode, then fan out
+void TranscodeTask(void *pvParameters) {
+  allocTrackSetSubsystem(ALLOC_SUB_AUDIO);
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    for (uint8_t g = 0; g < MAX_TALK_GROUPS; g++) {
+      if (!transcodeConfigPending[g]) continue;
+      transcodeConfigPending[g] = false;
+      TranscodeProfile p = transcodeProfile(g);
+      if (!p.enabled) continue;
+      TranscodeStage* stage = transcodeStageFor(g);
+      if (!stage || !opusTranscoderConfigure(stage->codec, p)) {
+        // Leave the group on the raw path rather than swallow its frames
+        p.enabled = false;
+        transcodeSetProfile(g, p);
+        Serial.printf("❌ Transcode setup failed for group %d, sending it unchanged\n", g);
+      }
+    }
+
+    uint16_t tail = transcodeTail;
+    while (tail != __atomic_load_n(&transcodeHead, __ATOMIC_ACQUIRE)) {
+      TranscodeItem &item = transcodeQueue[tail];
+      taskStageRecordLatency(TASK_STAGE_TRANSCODE, item.queuedUs);
+      uint32_t startUs = taskStageNowUs();
+      TranscodeStage* stage = transcodeStageFor(item.group);
+      if (stage) {
+        stage->streamId = item.streamId;
+        uint32_t start = ESP.getCycleCount();
+        int16_t* pcm = nullptr;
+        int samples = opusTranscoderDecode(stage->codec, item.data, item.length, &pcm);
+        if (samples > 0) {
+          if (agcEnabled) agcProcess(stage->agc, pcm, samples);
+          stage->audioSamples += samples;
+        }
+        opusTranscoderDrain(stage->codec, transcodeEmit, stage);
+        uint32_t now = ESP.getCycleCount();
+        stage->busyCycles += now - start;
+
+        // Roll the load window once a second of wall time has passed
+        uint32_t elapsed = now - stage->windowStart;
+        if (elapsed >= ESP.getCpuFreqMHz() * 1000000UL) {
+          stage->lastLoadPct = 100.0f * (float)stage->busyCycles / (float)elapsed;
+          float audioCycles = (float)stage->audioSamples / AUDIO_SAMPLE_RATE * ESP.getCpuFreqMHz() * 1e6f;
+          stage->lastRtf = audioCycles > 0 ? (float)stage->busyCycles / audioCycles : 0.0f;
+          stage->busyCycles = 0;
+          stage->audioSamples = 0;
+          stage->windowStart = now;
+        }
+      }
+      taskStageAddBusy(TASK_STAGE_TRANSCODE, startUs);
+      tail = (tail + 1) & kTranscodeQueueMask;
+      __atomic_store_n(&transcodeTail, tail, __ATOMIC_RELEASE);
+    }
+  }
+}
+
+void printTranscodeStats() {
+  Serial.printf("=== TRANSCODE (queue drops %lu) ===\n", (unsigned long)transcodeDrops);
+  for (int g = 0; g < MAX_TALK_GROUPS; g++) {
+    TranscodeProfile p = transcodeProfile(g);
+    TranscodeStage* stage = transcodeStages[g];
+    Serial.printf("  group %d: %s %lu bps, %d ms, complexity %d\n", g, p.enabled ? "ON " : "off",
+                  (unsigned long)p.bitrate, p.frameMs, p.complexity);
+    if (stage) {
+      const OpusTranscoder &c = stage->codec;
+      Serial.printf("    in %lu pkts/%lu B, out %lu pkts/%lu B, errors dec %lu enc %lu\n",
+                    (unsigned long)c.packetsIn, (unsigned long)c.bytesIn,
+                    (unsigned long)c.packetsOut, (unsigned long)c.bytesOut,
+                    (unsigned long)c.decodeErrors, (unsigned long)c.encodeErrors);
+      Serial.printf("    CPU %.1f%% of one core, real-time factor %.3f\n", stage->lastLoadPct, stage->lastRtf);
+    }
+  }
+}
+
 // Dynamic startup framing: send 100B frames for ~500ms after BLE connect, then 200B
 static int currentChunkSize = AUDIO_CHUNK_SIZE; // 100 during startup, 200 steady-state
 static unsigned long startupFrameUntilMs = 0;
@@ -792,7 +1897,7 @@ class MyServerCallbacks: public BLEServerCallbacks {
       // Reset startup framing
       startupFramingActive = false;
       currentChunkSize = AUDIO_CHUNK_SIZE;
-      if (meshDeviceCount > 0) {
+      if (meshPeers.count > 0) {
         setStatusLED(0, 255, 255); // Cyan - mesh active, BLE disconnected
       } else {
         setStatusLED(255, 0, 0); // Red - no connections at all
@@ -801,326 +1906,1127 @@ class MyServerCallbacks: public BLEServerCallbacks {
 };
 
 // Callback class for characteristic events
-class MyCallbacks: public BLECharacteristicCallbacks {
+
+// Callback class for characteristic events
+class MyCharacteristicCallbacks: public BLECharacteristicCallbacks {
     void onWrite(BLECharacteristic *pCharacteristic) {
-      std::string rxValue = pCharacteristic->getValue();
-      
-      if (rxValue.length() > 0) {
-        // If this is a control request to emit a network beep, trigger it
-        if (rxValue.rfind("BEEP", 0) == 0) { pendingBeep = true; return; }
-        // Minimal work in BLE stack thread: enqueue and return
-        if (!isAudioStreaming) {
-          startAudioStream();
+        // Read the attribute in place: getValue() would copy it into a std::string
+        AllocScope scope(ALLOC_SUB_BLE);
+        const uint8_t* value = pCharacteristic->getData();
+        size_t len = pCharacteristic->getLength();
+
+        if (len > 0) {
+            if (len == 4 && memcmp(value, "BEEP", 4) == 0) {
+                generatorBeep();  // queues a 5 s tone back to this phone, returns at once
+            } else {
+                // Minimal work in the BLE stack task: copy into the ingest ring
+                bleInPushFromISR(value, (uint16_t)len);
+            }
         }
-        bleInPushFromISR((const uint8_t*)rxValue.data(), (uint16_t)rxValue.length());
+    }
+};
+
+// (definitions moved above MyServerCallbacks)
+
+// Audio streaming variables for ESP-NOW - RAW PCM
+int audioBufferIndex = 0;
+unsigned long lastAudioChunk = 0;
+uint32_t audioSequenceNumber = 0;
+uint32_t audioMediaTimestamp = 0;  // WM_TIMESTAMP_HZ ticks, continues across streams
+
+// Ring that defers BLE onWrite processing out of the BLE stack task.
+// Depth is a power of two (BufferConfig.h, or -DBLE_IN_QUEUE_DEPTH=<n>);
+// slots hold a full ATT write at the largest MTU. The ring (~16 KB)
+// absorbs write bursts and each slot is copied once, so it is placed in
+// PSRAM (MEM_BULK, allocated in setup).
+#define BLE_IN_XOFF_LEVEL (kBleInQueueSlots * 3 / 4)  // ask Phone A to pause
+#define BLE_IN_XON_LEVEL  (kBleInQueueSlots / 4)      // let it resume
+
+struct IncomingBleItem {
+  uint16_t length;
+  uint32_t queuedUs;
+  uint8_t data[kBleInSlotBytes];
+};
+static_assert(sizeof(IncomingBleItem) == kBufferPools[BUF_POOL_BLE_IN_QUEUE].slotBytes, "update BLE_IN_QUEUE in BufferConfig.h");
+static volatile uint16_t bleInHead = 0;
+static volatile uint16_t bleInTail = 0;
+static IncomingBleItem* bleInQueue = nullptr;  // kBleInQueueSlots slots
+TaskHandle_t BleIngestTaskHandle = NULL;
+
+// Ingest counters (ble_in_stats)
+static volatile uint32_t bleInWrites = 0;
+static volatile uint32_t bleInBytes = 0;
+static volatile uint32_t bleInDrops = 0;
+static volatile uint32_t bleInTruncated = 0;
+static volatile uint32_t bleInXoffSent = 0;
+static volatile uint32_t bleInXonSent = 0;
+static bool bleInPaused = false;  // ingest task only
+static unsigned long bleInXoffAtMs = 0;
+#define BLE_IN_XOFF_REFRESH_MS 200  // phone resumes on its own after 500 ms
+
+// Reassembly buffer for incoming WM frames from Phone A over BLE
+static uint8_t wmRxBuffer[kWmRxBufferBytes] MEM_FAST_ATTR;  // memmoved per frame
+static WmReassembler phoneWmRx = { wmRxBuffer, (int)sizeof(wmRxBuffer), 0 };
+
+static void forwardWmFrame(const uint8_t* frame, int len, void* ctx) {
+  forwardWmToMesh(frame, len);  // complete WM frame: forward over mesh unchanged
+}
+
+static void ingestBleWmFrames(const uint8_t* data, int len) {
+  int fill = wmReassemblerFeed(phoneWmRx, data, len, kWmMaxFrameBytes, forwardWmFrame, nullptr);
+  bufferNoteLevel(BUF_POOL_WM_RX_BUFFER, fill);
+}
+
+static void forwardWmToMesh(const uint8_t* frame, int frameLen) {
+  if (frameLen <= 0 || !frame) return;
+  WmHeader header;
+  bool parsed = wmParseHeader(frame, frameLen, header) > 0 && header.headerLen + header.payloadLen <= frameLen;
+  uint8_t op, value;
+  if (parsed && tgPhoneParse(frame, header, op, value)) {
+    handlePhoneGroupControl(op, value);
+    return;
+  }
+  if (!meshNetworkActive) return;
+  if (fanoutCount(meshFanout) == 0) return;
+  uint8_t group = parsed && (header.flags & WM_FLAG_GROUP) ? header.group : phoneTalkGroup;
+  if (group >= MAX_TALK_GROUPS) {
+    groupUnroutable++;
+    return;
+  }
+  // Opus frames of a group with a transcode profile are re-encoded off this thread
+  if (parsed && header.type == WM_TYPE_OPUS && transcodeActive(group)) {
+    if (transcodePush(group, header.streamId, frame + header.headerLen, header.payloadLen)) return;
+  }
+  sendWmToMesh(frame, frameLen, group);
+}
+
+// Per-group counters for one frame, and whether it reached every active
+// peer (heartbeats are only skipped while audio does)
+static void noteGroupFanout(const FanoutSnapshot* fanout, uint8_t group, uint32_t nowMs) {
+  uint8_t targets = fanout->groups[group];
+  groupFrames[group]++;
+  groupSends[group] += __builtin_popcount(targets);
+  if (targets == (uint8_t)((1u << fanout->count) - 1)) lastFullFanoutMs = nowMs;
+}
+
+static void sendWmToMesh(const uint8_t* frame, int frameLen, uint8_t group) {
+  const FanoutSnapshot* fanout = fanoutAcquire(meshFanout);
+  uint8_t withMembers[ESP_NOW_MAX_DATA_LEN];
+  uint32_t now = millis();
+  noteGroupFanout(fanout, group, now);
+  uint8_t targets = fanout->groups[group];
+  uint8_t membersVersion = memberLogVersion8();
+  if (targets && membershipDue(membersVersion, now)) {
+    int len = wmAddMembership(frame, frameLen, fanout->count, membersVersion,
+                              withMembers, sizeof(withMembers));
+    if (len > 0) {
+      frame = withMembers;
+      frameLen = len;
+      membershipSent(membersVersion, now);
+    }
+  }
+  for (uint32_t bits = targets; bits; bits &= bits - 1) {
+    int i = __builtin_ctz(bits);
+    esp_err_t result = meshSend(fanout->peers[i].mac, (const uint8_t*)frame, frameLen);
+    if (result != ESP_OK) {
+      DLOG(MESH, WARN, WM_SEND_FAILED, i, (uint32_t)(fanout->peers[i].mac[4] << 8 | fanout->peers[i].mac[5]), result);
+    }
+  }
+  fanoutRelease(meshFanout, fanout);
+}
+
+static inline bool bleInPushFromISR(const uint8_t* buf, uint16_t len) {
+  if (len > kBleInSlotBytes) {
+    len = kBleInSlotBytes;
+    bleInTruncated++;
+  }
+  if (!bleInQueue) return false;
+  uint16_t nextHead = (uint16_t)((bleInHead + 1) & kBleInQueueMask);
+  uint16_t tail = __atomic_load_n(&bleInTail, __ATOMIC_ACQUIRE);
+  if (nextHead == tail) {
+    bleInDrops++;
+    return false; // full
+  }
+  IncomingBleItem &slot = bleInQueue[bleInHead];
+  slot.length = len;
+  slot.queuedUs = taskStageNowUs();
+  memcpy(slot.data, buf, len);
+  __atomic_store_n(&bleInHead, nextHead, __ATOMIC_RELEASE);
+  bleInWrites++;
+  bleInBytes += len;
+  bufferNoteLevel(BUF_POOL_BLE_IN_QUEUE, (nextHead - tail) & kBleInQueueMask);
+  if (BleIngestTaskHandle) xTaskNotifyGive(BleIngestTaskHandle);
+  return true;
+}
+
+// Flow control to Phone A as a WM frame on the audio characteristic:
+// payload 1 = pause sending, 0 = resume
+static void sendBleFlowControl(bool pause) {
+  if (!deviceConnected || pAudioCharacteristic == nullptr) return;
+  uint8_t frame[WM_HEADER_V1_SIZE + 1];
+  int headerLen = wmWriteHeaderV1(frame, WM_TYPE_FLOW, 0, 1);
+  frame[headerLen] = pause ? 1 : 0;
+  AllocScope radio(ALLOC_SUB_RADIO);
+  pAudioCharacteristic->setValue(frame, sizeof(frame));
+  pAudioCharacteristic->notify();
+  if (pause) bleInXoffSent++; else bleInXonSent++;
+}
+
+// Talk group control from Phone A. It talks to one group and hears nothing
+// from the mesh, so its listen mask stays 0. Every request is answered with
+// the state on the audio characteristic.
+static void handlePhoneGroupControl(uint8_t op, uint8_t value) {
+  if (op == TG_OP_TALK && tgApply(0, op, value) >= 0) {
+    phoneTalkGroup = value;
+    Serial.printf("🗣️ Phone A talks to group %u\n", value);
+  } else {
+    Serial.printf("⚠️ Talk group op %u/%u from Phone A ignored\n", op, value);
+  }
+  if (!deviceConnected || pAudioCharacteristic == nullptr) return;
+  uint8_t frame[TG_PHONE_STATE_SIZE];
+  int len = tgPhoneEncodeState(0, phoneTalkGroup, frame);
+  AllocScope radio(ALLOC_SUB_RADIO);
+  pAudioCharacteristic->setValue(frame, len);
+  pAudioCharacteristic->notify();
+}
+
+// Blocks until onWrite queues data, then reassembles WM frames and forwards them
+void BleIngestTask(void *pvParameters) {
+  allocTrackSetSubsystem(ALLOC_SUB_BLE);
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    uint16_t tail = bleInTail;
+    uint16_t depth = (uint16_t)((__atomic_load_n(&bleInHead, __ATOMIC_ACQUIRE) - tail) & kBleInQueueMask);
+    if (depth >= BLE_IN_XOFF_LEVEL && (!bleInPaused || millis() - bleInXoffAtMs >= BLE_IN_XOFF_REFRESH_MS)) {
+      bleInPaused = true;
+      bleInXoffAtMs = millis();
+      sendBleFlowControl(true);
+    }
+
+    while (tail != __atomic_load_n(&bleInHead, __ATOMIC_ACQUIRE)) {
+      IncomingBleItem &slot = bleInQueue[tail];
+      taskStageRecordLatency(TASK_STAGE_BLE_INGEST, slot.queuedUs);
+      uint32_t start = taskStageNowUs();
+      ingestBleWmFrames(slot.data, slot.length);
+      taskStageAddBusy(TASK_STAGE_BLE_INGEST, start);
+      tail = (tail + 1) & kBleInQueueMask;
+      __atomic_store_n(&bleInTail, tail, __ATOMIC_RELEASE);
+
+      depth = (uint16_t)((__atomic_load_n(&bleInHead, __ATOMIC_ACQUIRE) - tail) & kBleInQueueMask);
+      if (bleInPaused && depth <= BLE_IN_XON_LEVEL) {
+        bleInPaused = false;
+        sendBleFlowControl(false);
       }
     }
+  }
+}
+
+void printBleInStats() {
+  Serial.printf("=== BLE INGEST (ring %d x %d B, xoff at %d, xon at %d) ===\n",
+                (int)kBleInQueueSlots, (int)kBleInSlotBytes, BLE_IN_XOFF_LEVEL, BLE_IN_XON_LEVEL);
+  Serial.printf("  writes=%lu bytes=%lu drops=%lu truncated=%lu high_water=%lu\n",
+                (unsigned long)bleInWrites, (unsigned long)bleInBytes, (unsigned long)bleInDrops,
+                (unsigned long)bleInTruncated, (unsigned long)bufferHighWater[BUF_POOL_BLE_IN_QUEUE]);
+  Serial.printf("  xoff=%lu xon=%lu paused=%s\n", (unsigned long)bleInXoffSent,
+                (unsigned long)bleInXonSent, bleInPaused ? "yes" : "no");
+}
+
+// Audio streaming functions
+void startAudioStream() {
+  if (!isAudioStreaming) {
+    isAudioStreaming = true;
+    audioSequenceNumber = 0;
+    audioBufferIndex = 0;
+    Serial.println("🎤 Audio streaming started");
+    setStatusLED(0, 255, 0); // Green for active streaming
+  }
+}
+
+void stopAudioStream() {
+  if (isAudioStreaming) {
+    isAudioStreaming = false;
     
-    void onRead(BLECharacteristic *pCharacteristic) {
-      Serial.println("Characteristic read request");
+    // Clear audio buffer when stopping
+    memset(audioBuffer, 0, kAudioBufferBytes);
+    audioBufferIndex = 0;
+    audioSequenceNumber = 0;
+    
+    Serial.println("🛑 Audio streaming stopped - buffer cleared");
+    updateMeshStatusLED(); // Use mesh status instead of hardcoded blue
+  }
+}
+
+// RAW PCM: No compression - direct data passthrough
+int compressAudioData(const uint8_t* input, int inputLength, uint8_t* output) {
+  if (inputLength <= 0 || input == nullptr || output == nullptr) return 0;
+  
+  // Direct copy - no compression
+  memcpy(output, input, inputLength);
+  return inputLength;
+}
+
+// Resampler accuracy (THD+N of a 1 kHz tone) and cost for every supported rate pair
+void benchResampler() {
+  static const uint32_t rates[] = { 8000, 16000, 48000 };
+  static Resampler rs;
+  static int16_t in[480];       // 10 ms at 48 kHz
+  static int16_t out[480 + 1];  // 10 ms at 8 kHz upsampled x6
+  const int blocks = 100;       // 1 s of audio
+  const float tone = 1000.0f;
+
+  Serial.println("⏱️ Resampler bench (1 kHz tone at -6 dBFS, 10 ms blocks, 1 s):");
+  for (uint32_t inRate : rates) {
+    for (uint32_t outRate : rates) {
+      if (inRate == outRate || !resamplerInit(rs, inRate, outRate)) continue;
+      int inCount = inRate / 100;
+      int skip = 4 * resamplerDelay(rs) + 16;  // let the filter settle
+      int outIndex = 0;
+      uint32_t cycles = 0;
+      int produced = 0;
+      // Least-squares fit of sin/cos at the tone; the residual is THD+N
+      double ss = 0, cc = 0, sc = 0, ys = 0, yc = 0, yy = 0;
+      for (int b = 0; b < blocks; b++) {
+        for (int i = 0; i < inCount; i++) {
+          in[i] = (int16_t)(16384.0f * sinf(2.0f * PI * tone * (float)(b * inCount + i) / inRate));
+        }
+        uint32_t start = ESP.getCycleCount();
+        int n = resamplerProcess(rs, in, inCount, out, sizeof(out) / sizeof(out[0]));
+        cycles += ESP.getCycleCount() - start;
+        produced += n;
+        for (int i = 0; i < n; i++, outIndex++) {
+          if (outIndex < skip) continue;
+          float phase = 2.0f * PI * tone * (float)(outIndex % outRate) / outRate;
+          double sn = sinf(phase), cs = cosf(phase), y = out[i];
+          ss += sn * sn; cc += cs * cs; sc += sn * cs;
+          ys += y * sn; yc += y * cs; yy += y * y;
+        }
+      }
+      double det = ss * cc - sc * sc;
+      double a = (ys * cc - yc * sc) / det;
+      double c = (yc * ss - ys * sc) / det;
+      double fitted = a * ys + c * yc;  // energy captured by the fundamental
+      double residual = yy - fitted;
+      float thdn = residual > 0 ? 10.0 * log10(residual / yy) : -120.0f;
+      Serial.printf("   %5lu -> %5lu Hz: THD+N %.1f dB, %.1f cycles/in, %.1f cycles/out\n",
+                    (unsigned long)inRate, (unsigned long)outRate, thdn,
+                    (float)cycles / (blocks * inCount), (float)cycles / produced);
     }
-};
+  }
+}
 
-// Callback class for characteristic events
-class MyCharacteristicCallbacks: public BLECharacteristicCallbacks {
-    void onWrite(BLECharacteristic *pCharacteristic) {
-        std::string value = pCharacteristic->getValue();
-        size_t len = value.length();
+// AGC gain tracking over level steps and cost per 10 ms block
+void benchAgc() {
+  static const float stepsDbfs[] = { -40.0f, -20.0f, -6.0f, -30.0f, -60.0f };
+  const int blockSamples = AUDIO_SAMPLE_RATE / 100;  // 10 ms
+  const int blocksPerStep = 100;                     // 1 s per level
+  static Agc agc;
+  static int16_t block[AUDIO_SAMPLE_RATE / 100];
+  AgcConfig cfg;
+  agcDefaultConfig(cfg);
+  agcInit(agc, cfg);
+
+  uint32_t totalCycles = 0, worstCycles = 0;
+  uint32_t n = 0;
+  Serial.printf("⏱️ AGC bench (target %.1f dBFS, 300 Hz tone, 10 ms blocks):\n",
+                20.0f * log10f(cfg.targetRms / 32768.0f));
+  for (float dbfs : stepsDbfs) {
+    float amp = 32767.0f * powf(10.0f, dbfs / 20.0f) * 1.41421f;  // RMS -> peak
+    if (amp > 32767.0f) amp = 32767.0f;
+    int settledBlocks = -1;
+    uint16_t outRms = 0;
+    for (int b = 0; b < blocksPerStep; b++) {
+      for (int i = 0; i < blockSamples; i++, n++) {
+        block[i] = (int16_t)(amp * sinf(2.0f * PI * 300.0f * (float)(n % AUDIO_SAMPLE_RATE) / AUDIO_SAMPLE_RATE));
+      }
+      uint32_t start = ESP.getCycleCount();
+      agcProcess(agc, block, blockSamples);
+      uint32_t cycles = ESP.getCycleCount() - start;
+      totalCycles += cycles;
+      if (cycles > worstCycles) worstCycles = cycles;
+
+      AudioMeterBlock level;
+      audioMeterMeasurePcm16(block, blockSamples, level);
+      outRms = audioMeterRms(level, blockSamples);
+      // Settled once within 1 dB of target
+      bool within = outRms > (cfg.targetRms * 891UL) / 1000 && outRms < (cfg.targetRms * 1122UL) / 1000;
+      if (within && settledBlocks < 0) settledBlocks = b;
+      if (!within) settledBlocks = -1;
+    }
+    float outDb = outRms > 0 ? 20.0f * log10f(outRms / 32768.0f) : -99.0f;
+    Serial.printf("   in %6.1f dBFS -> out %6.1f dBFS, gain %5.1f dB, gate %s, settled %s",
+                  dbfs, outDb, 20.0f * log10f(agc.lastOutGainQ12 / 4096.0f),
+                  agc.gateOpen ? "open" : "closed", settledBlocks >= 0 ? "after" : "no");
+    if (settledBlocks >= 0) Serial.printf(" %d ms", settledBlocks * 10);
+    Serial.println();
+  }
+  uint32_t blocks = (sizeof(stepsDbfs) / sizeof(stepsDbfs[0])) * blocksPerStep;
+  uint32_t budget = (uint32_t)(ESP.getCpuFreqMHz() * 10000UL);  // cycles in 10 ms
+  Serial.printf("   cost: %lu cycles/block avg, %lu worst (%.3f%% of one core)\n",
+                (unsigned long)(totalCycles / blocks), (unsigned long)worstCycles,
+                100.0f * (float)worstCycles / budget);
+}
+
+// Transcode cost on this core: encode a test signal at Phone A's settings,
+// then time decode + re-encode at each profile
+void benchTranscode() {
+  const int inFrame = AUDIO_SAMPLE_RATE / 50;  // 20 ms, as OpusCodec.kt
+  const int frames = 100;                     // 2 s of audio
+  static const TranscodeProfile profiles[] = {
+    { true, 16000, 20, 2 }, { true, 12000, 40, 2 }, { true, 8000, 60, 0 }, { true, 12000, 40, 5 },
+  };
+
+  int err = OPUS_OK;
+  OpusEncoder* source = opus_encoder_create(AUDIO_SAMPLE_RATE, 1, OPUS_APPLICATION_VOIP, &err);
+  OpusTranscoder* bench = (OpusTranscoder*)calloc(1, sizeof(OpusTranscoder));
+  uint8_t (*packets)[OPUS_TRANSCODE_MAX_PACKET] =
+      (uint8_t (*)[OPUS_TRANSCODE_MAX_PACKET])malloc(frames * OPUS_TRANSCODE_MAX_PACKET);
+  int* sizes = (int*)malloc(frames * sizeof(int));
+  int16_t* pcm = (int16_t*)malloc(inFrame * sizeof(int16_t));
+  if (err != OPUS_OK || !source || !bench || !packets || !sizes || !pcm) {
+    Serial.println("❌ Transcode bench: out of memory");
+    if (source) opus_encoder_destroy(source);
+    free(bench); free(packets); free(sizes); free(pcm);
+    return;
+  }
+  opus_encoder_ctl(source, OPUS_SET_BITRATE(24000));
+
+  // Voice-like input: 200 Hz fundamental with harmonics and a slow level swing
+  for (int f = 0; f < frames; f++) {
+    for (int i = 0; i < inFrame; i++) {
+      float t = (float)(f * inFrame + i) / AUDIO_SAMPLE_RATE;
+      float env = 0.5f + 0.5f * sinf(2.0f * PI * 3.0f * t);
+      float x = sinf(2.0f * PI * 200.0f * t) + 0.5f * sinf(2.0f * PI * 400.0f * t) + 0.25f * sinf(2.0f * PI * 800.0f * t);
+      pcm[i] = (int16_t)(8000.0f * env * x);
+    }
+    sizes[f] = opus_encode(source, pcm, inFrame, packets[f], OPUS_TRANSCODE_MAX_PACKET);
+  }
+  opus_encoder_destroy(source);
+
+  float audioSeconds = (float)frames * inFrame / AUDIO_SAMPLE_RATE;
+  float coreCycles = audioSeconds * ESP.getCpuFreqMHz() * 1e6f;
+  Serial.printf("⏱️ Transcode bench (%d x 20 ms Opus @ 24 kbps in):\n", frames);
+  for (const TranscodeProfile &p : profiles) {
+    if (!opusTranscoderInit(*bench, AUDIO_SAMPLE_RATE, p)) {
+      Serial.println("❌ Transcoder init failed");
+      break;
+    }
+    uint32_t cycles = 0;
+    for (int f = 0; f < frames; f++) {
+      if (sizes[f] <= 0) continue;
+      uint32_t start = ESP.getCycleCount();
+      opusTranscoderDecode(*bench, packets[f], sizes[f], nullptr);
+      opusTranscoderDrain(*bench, nullptr, nullptr);
+      cycles += ESP.getCycleCount() - start;
+    }
+    Serial.printf("   %5lu bps %2d ms cx%d: %lu B out, RTF %.3f (%.1f%% of one core)\n",
+                  (unsigned long)p.bitrate, p.frameMs, p.complexity, (unsigned long)bench->bytesOut,
+                  cycles / coreCycles, 100.0f * cycles / coreCycles);
+    opusTranscoderDestroy(*bench);
+  }
+  free(bench); free(packets); free(sizes); free(pcm);
+}
+
+// libopus needs more stack than loop() has, so the bench runs in its own task;
+// one at a time, each run holds ~60 KB of task stack and buffers
+static volatile bool transcodeBenchRunning = false;
+
+static void benchTranscodeTask(void *pvParameters) {
+  benchTranscode();
+  transcodeBenchRunning = false;
+  vTaskDelete(NULL);
+}
+
+// Previous per-byte min/max/avg loop, kept as the bench_meter baseline
+static uint32_t legacyByteStats(const uint8_t* data, int length) {
+  uint32_t sum = 0;
+  uint8_t minVal = 255;
+  uint8_t maxVal = 0;
+  for (int i = 0; i < length; i++) {
+    sum += data[i];
+    if (data[i] < minVal) minVal = data[i];
+    if (data[i] > maxVal) maxVal = data[i];
+  }
+  return (sum / length) ^ ((uint32_t)minVal << 8) ^ ((uint32_t)maxVal << 16);
+}
+
+// Compare the meter kernels with the old scalar loop on one 200-sample frame
+void benchMeter() {
+  const int iterations = 1000;
+  static int16_t pcm[AUDIO_CHUNK_SIZE] __attribute__((aligned(16)));
+  static uint8_t ulaw[AUDIO_CHUNK_SIZE];
+  for (int i = 0; i < AUDIO_CHUNK_SIZE; i++) {
+    pcm[i] = (int16_t)(sin(2 * PI * 1000.0 * i / AUDIO_SAMPLE_RATE) * 16384.0);
+    ulaw[i] = g711LinearToUlaw(pcm[i]);
+  }
+
+  volatile uint32_t sink = 0;
+  AudioMeterBlock block;
+
+  uint32_t start = ESP.getCycleCount();
+  for (int i = 0; i < iterations; i++) sink += legacyByteStats(ulaw, AUDIO_CHUNK_SIZE);
+  uint32_t legacyCycles = ESP.getCycleCount() - start;
+
+  start = ESP.getCycleCount();
+  for (int i = 0; i < iterations; i++) {
+    audioMeterMeasureUlaw(ulaw, AUDIO_CHUNK_SIZE, block);
+    sink += block.peak;
+  }
+  uint32_t ulawCycles = ESP.getCycleCount() - start;
+
+  start = ESP.getCycleCount();
+  for (int i = 0; i < iterations; i++) {
+    audioMeterMeasurePcm16(pcm, AUDIO_CHUNK_SIZE, block);
+    sink += block.peak;
+  }
+  uint32_t pcmCycles = ESP.getCycleCount() - start;
+
+  Serial.printf("⏱️ Meter bench (%d samples/frame, %d frames, %s kernel):\n",
+                AUDIO_CHUNK_SIZE, iterations, audioMeterUsesVectorUnit() ? "PIE" : "portable");
+  Serial.printf("   legacy min/max/avg (u8): %lu cycles/frame\n", (unsigned long)(legacyCycles / iterations));
+  Serial.printf("   meter u-law:             %lu cycles/frame\n", (unsigned long)(ulawCycles / iterations));
+  Serial.printf("   meter pcm16:             %lu cycles/frame\n", (unsigned long)(pcmCycles / iterations));
+  (void)sink;
+}
+
+// WM header parse cost: v1 vs v2 over a ring of frames so nothing is hoisted
+void benchWmHeader() {
+  const int iterations = 20000;
+  const int ringSize = 16;
+  static uint8_t v1Frames[ringSize][WM_HEADER_V1_SIZE];
+  static uint8_t v2Frames[ringSize][WM_HEADER_V2_SIZE];
+  for (int i = 0; i < ringSize; i++) {
+    wmWriteHeaderV1(v1Frames[i], WM_TYPE_OPUS, (uint16_t)(0xFFF8 + i), 40);
+    WmHeader h = { 2, WM_TYPE_OPUS, 0, COORDINATOR_STREAM_ID, WM_HEADER_V2_SIZE, 40,
+                   0x0000FFF8u + i, (uint32_t)i * 960 };
+    wmWriteHeaderV2(v2Frames[i], h);
+  }
+
+  volatile uint32_t sink = 0;
+  WmHeader parsed;
+  uint32_t extended = 0;
+
+  uint32_t start = ESP.getCycleCount();
+  for (int i = 0; i < iterations; i++) {
+    wmParseHeader(v1Frames[i & (ringSize - 1)], WM_HEADER_V1_SIZE, parsed);
+    extended = wmExtendSequence(extended, (uint16_t)parsed.sequence);
+    sink += parsed.payloadLen;
+  }
+  uint32_t v1Cycles = ESP.getCycleCount() - start;
+
+  start = ESP.getCycleCount();
+  for (int i = 0; i < iterations; i++) {
+    wmParseHeader(v2Frames[i & (ringSize - 1)], WM_HEADER_V2_SIZE, parsed);
+    sink += parsed.payloadLen + parsed.timestamp;
+  }
+  uint32_t v2Cycles = ESP.getCycleCount() - start;
+
+  float nsPerCycle = 1000.0f / ESP.getCpuFreqMHz();
+  Serial.printf("⏱️ WM header bench (%d parses each):\n", iterations);
+  Serial.printf("   v1 + seq extend: %.1f cycles, %.1f ns\n",
+                (float)v1Cycles / iterations, nsPerCycle * v1Cycles / iterations);
+  Serial.printf("   v2:              %.1f cycles, %.1f ns\n",
+                (float)v2Cycles / iterations, nsPerCycle * v2Cycles / iterations);
+  Serial.printf("   last extended seq: %lu\n", (unsigned long)extended);
+  (void)sink;
+}
 
-        if (len > 0) {
-            if (len == 4 && value == "BEEP") {
-                Serial.println("Received 'BEEP' command, triggering test tone.");
-                sendBeepOnce();
-            } else {
-                Serial.printf("AUDIO RECV: len=%d, data=", len);
-                for (int i=0; i<min((size_t)8, len); i++) {
-                    Serial.printf("%02X ", (uint8_t)value[i]);
-                }
-                Serial.println();
-                
-                // Ingest BLE bytes as WM frames and forward to mesh unchanged
-                ingestBleWmFrames((const uint8_t*)value.data(), (int)len);
-            }
-        }
+// Sender-side cost of one fan-out walk: mesh table under the mutex vs the
+// lock-free snapshot, plus the control-path publish
+void benchFanout() {
+  const int iterations = 20000;
+  volatile uint32_t sink = 0;
+
+  uint32_t start = ESP.getCycleCount();
+  for (int n = 0; n < iterations; n++) {
+    MeshTableLock lock;
+    for (int i = 0; i < meshPeers.count; i++) {
+      if (peerTableIsActive(meshPeers, i)) sink += meshPeers.macs[i][5];
     }
-};
+  }
+  uint32_t lockedCycles = ESP.getCycleCount() - start;
 
-// (definitions moved above MyServerCallbacks)
+  start = ESP.getCycleCount();
+  for (int n = 0; n < iterations; n++) {
+    const FanoutSnapshot* fanout = fanoutAcquire(meshFanout);
+    for (int i = 0; i < fanout->count; i++) sink += fanout->peers[i].mac[5];
+    fanoutRelease(meshFanout, fanout);
+  }
+  uint32_t snapshotCycles = ESP.getCycleCount() - start;
 
-// Audio streaming variables for ESP-NOW - RAW PCM
-int audioBufferIndex = 0;
-unsigned long lastAudioChunk = 0;
-int audioSequenceNumber = 0;
+  const int publishes = 1000;
+  start = ESP.getCycleCount();
+  for (int n = 0; n < publishes; n++) {
+    MeshTableLock lock;
+    publishMeshFanout();
+  }
+  uint32_t publishCycles = ESP.getCycleCount() - start;
+
+  float nsPerCycle = 1000.0f / ESP.getCpuFreqMHz();
+  Serial.printf("⏱️ Fan-out bench (%d walks, %u peers):\n", iterations, fanoutCount(meshFanout));
+  Serial.printf("   mutex + table: %.1f cycles, %.1f ns\n",
+                (float)lockedCycles / iterations, nsPerCycle * lockedCycles / iterations);
+  Serial.printf("   snapshot:      %.1f cycles, %.1f ns\n",
+                (float)snapshotCycles / iterations, nsPerCycle * snapshotCycles / iterations);
+  Serial.printf("   publish:       %.1f cycles, %.1f ns\n",
+                (float)publishCycles / publishes, nsPerCycle * publishCycles / publishes);
+  (void)sink;
+}
 
-// Queue to defer BLE onWrite processing out of BLE stack task
-struct IncomingBleItem {
-  uint16_t length;
-  uint8_t data[256];
+// Fan-out walk and remove/re-add at 20 peers: the old array of structs
+// with two Strings per device vs the PeerTable layout. Private tables, so
+// the live mesh is untouched.
+struct LegacyMeshDevice {
+  uint8_t mac[6];
+  String deviceName;
+  String deviceType;
+  unsigned long lastSeen;
+  bool isActive;
+  bool isCoordinator;
+  int audioQuality;
 };
-static volatile uint16_t bleInHead = 0;
-static volatile uint16_t bleInTail = 0;
-static IncomingBleItem bleInQueue[16];
 
-// Reassembly buffer for incoming WM frames from Phone A over BLE
-static uint8_t wmRxBuffer[4096];
-static int wmRxIndex = 0;
-static const int WM_MAX_FRAME = 4000; // payload cap
+void benchPeers() {
+  const int peers = 20;
+  const int iterations = 20000;
+  const int churns = 1000;
+  volatile uint32_t sink = 0;
+  static LegacyMeshDevice legacy[peers];
+  static PeerTable table;
+  char name[24];
+
+  peerTableInit(table);
+  for (int i = 0; i < peers; i++) {
+    uint8_t mac[6] = { 0x02, 0, 0, 0, 0, (uint8_t)i };
+    snprintf(name, sizeof(name), "ESP32_B_Client_%02d", i);
+    memcpy(legacy[i].mac, mac, 6);
+    legacy[i].deviceName = name;
+    legacy[i].deviceType = "client";
+    legacy[i].isActive = (i & 3) != 3;
+    peerTableAdd(table, mac, name, "client", 0);
+    peerTableSetActive(table, i, (i & 3) != 3);
+  }
 
-static inline int wmExpectedFrameLen(const uint8_t* buf, int available) {
-  if (available < 7) return -1;
-  if (buf[0] != 'W' || buf[1] != 'M') return -2;
-  // type at [2], seq at [3..4]
-  int len = (buf[5] & 0xFF) | ((buf[6] & 0xFF) << 8);
-  if (len < 1 || len > WM_MAX_FRAME) return -3;
-  return 7 + len;
-}
+  uint32_t start = ESP.getCycleCount();
+  for (int n = 0; n < iterations; n++) {
+    for (int i = 0; i < peers; i++) {
+      if (legacy[i].isActive) sink += legacy[i].mac[5];
+    }
+  }
+  uint32_t legacyWalk = ESP.getCycleCount() - start;
 
-static void ingestBleWmFrames(const uint8_t* data, int len) {
-  if (len <= 0 || !data) return;
-  int offset = 0;
-  while (offset < len) {
-    // If buffer empty, try to align to WM magic
-    if (wmRxIndex == 0) {
-      int start = -1;
-      for (int i = offset; i + 1 < len; i++) {
-        if (data[i] == 'W' && data[i+1] == 'M') { start = i; break; }
-      }
-      if (start < 0) return; // no header in this chunk
-      offset = start;
-    }
-    // Copy as much as fits
-    int space = (int)sizeof(wmRxBuffer) - wmRxIndex;
-    if (space <= 0) { wmRxIndex = 0; return; }
-    int copyLen = (len - offset) < space ? (len - offset) : space;
-    memcpy(wmRxBuffer + wmRxIndex, data + offset, copyLen);
-    wmRxIndex += copyLen;
-    offset += copyLen;
-
-    // If we have at least a header, check if full frame is present
-    if (wmRxIndex >= 7) {
-      int expected = wmExpectedFrameLen(wmRxBuffer, wmRxIndex);
-      if (expected > 0 && wmRxIndex >= expected) {
-        // We have a complete WM frame: forward over mesh unchanged
-        forwardWmToMesh(wmRxBuffer, expected);
-        // Shift remaining bytes
-        int remain = wmRxIndex - expected;
-        if (remain > 0) memmove(wmRxBuffer, wmRxBuffer + expected, remain);
-        wmRxIndex = remain;
-      } else if (expected < 0) {
-        // Malformed or wrong magic: reset and try to realign within buffer
-        // Attempt to find next 'WM' inside current buffer
-        int realign = -1;
-        for (int i = 1; i + 1 < wmRxIndex; i++) {
-          if (wmRxBuffer[i] == 'W' && wmRxBuffer[i+1] == 'M') { realign = i; break; }
-        }
-        if (realign >= 0) {
-          int newLen = wmRxIndex - realign;
-          memmove(wmRxBuffer, wmRxBuffer + realign, newLen);
-          wmRxIndex = newLen;
-        } else {
-          wmRxIndex = 0;
-        }
-      }
+  start = ESP.getCycleCount();
+  for (int n = 0; n < iterations; n++) {
+    for (uint32_t bits = table.activeMask; bits; bits &= bits - 1) {
+      sink += table.macs[__builtin_ctz(bits)][5];
     }
   }
+  uint32_t tableWalk = ESP.getCycleCount() - start;
+
+#if ALLOC_TRACK_ENABLED
+  uint32_t allocsBefore = allocCounters[allocTrackSubsystem()].count;
+#endif
+  // Remove the first peer (shifting the other 19) and append it again
+  start = ESP.getCycleCount();
+  for (int n = 0; n < churns; n++) {
+    LegacyMeshDevice first = legacy[0];
+    for (int j = 0; j < peers - 1; j++) legacy[j] = legacy[j + 1];
+    legacy[peers - 1] = first;
+  }
+  uint32_t legacyChurn = ESP.getCycleCount() - start;
+#if ALLOC_TRACK_ENABLED
+  uint32_t legacyAllocs = allocCounters[allocTrackSubsystem()].count - allocsBefore;
+  allocsBefore = allocCounters[allocTrackSubsystem()].count;
+#endif
+
+  start = ESP.getCycleCount();
+  for (int n = 0; n < churns; n++) {
+    uint8_t mac[6];
+    memcpy(mac, table.macs[0], 6);
+    snprintf(name, sizeof(name), "%s", peerTableName(table, 0));
+    bool active = peerTableIsActive(table, 0);
+    peerTableRemove(table, 0);
+    int i = peerTableAdd(table, mac, name, "client", 0);
+    peerTableSetActive(table, i, active);
+  }
+  uint32_t tableChurn = ESP.getCycleCount() - start;
+#if ALLOC_TRACK_ENABLED
+  uint32_t tableAllocs = allocCounters[allocTrackSubsystem()].count - allocsBefore;
+#endif
+
+  float nsPerCycle = 1000.0f / ESP.getCpuFreqMHz();
+  Serial.printf("⏱️ Peer table bench (%d peers, %u active, %u B per table + %u B name pool):\n",
+                peers, peerTableActiveCount(table), (unsigned)(sizeof(PeerTable) - sizeof(PeerNamePool)),
+                (unsigned)peerTablePoolUsed(table));
+  Serial.printf("   walk, structs + Strings: %.1f cycles, %.1f ns\n",
+                (float)legacyWalk / iterations, nsPerCycle * legacyWalk / iterations);
+  Serial.printf("   walk, MACs + bitmask:    %.1f cycles, %.1f ns\n",
+                (float)tableWalk / iterations, nsPerCycle * tableWalk / iterations);
+  Serial.printf("   remove + re-add, structs: %.1f cycles\n", (float)legacyChurn / churns);
+  Serial.printf("   remove + re-add, table:   %.1f cycles\n", (float)tableChurn / churns);
+#if ALLOC_TRACK_ENABLED
+  Serial.printf("   allocations during churn: structs %lu, table %lu\n",
+                (unsigned long)legacyAllocs, (unsigned long)tableAllocs);
+#endif
+  (void)sink;
 }
 
-static void forwardWmToMesh(const uint8_t* frame, int frameLen) {
-  if (!meshNetworkActive || frameLen <= 0 || !frame) return;
-  if (meshDeviceCount <= 0) return;
-  for (int i = 0; i < meshDeviceCount; i++) {
-    if (!meshDevices[i].isActive) continue;
-    esp_err_t result = esp_now_send(meshDevices[i].mac, (const uint8_t*)frame, frameLen);
-    if (result != ESP_OK) {
-      Serial.printf("Failed to forward WM to %s: %d\n", meshDevices[i].deviceName.c_str(), result);
+// Cost of one audio frame at 20 peers in 4 talk groups (peer i in group
+// i % 4, every fifth peer inactive): flooding every active peer vs the
+// group's share. Routing is header parse + mask + walk; airtime uses the
+// MeshAirtime estimate per unicast. Private table, nothing is sent.
+void benchGroups(int payloadBytes) {
+  const int peers = 20;
+  const int iterations = 20000;
+  const int framesPerSecond = 50;  // 20 ms frames
+  volatile uint32_t sink = 0;
+  static PeerTable table;
+  char name[24];
+
+  peerTableInit(table);
+  for (int i = 0; i < peers; i++) {
+    uint8_t mac[6] = { 0x02, 0, 0, 0, 0, (uint8_t)i };
+    snprintf(name, sizeof(name), "ESP32_B_Client_%02d", i);
+    peerTableAdd(table, mac, name, "client", 0);
+    peerTableSetActive(table, i, i % 5 != 4);
+    peerTableSetGroups(table, i, (uint8_t)(1u << (i % MAX_TALK_GROUPS)));
+  }
+
+  uint8_t frames[MAX_TALK_GROUPS][WM_HEADER_V2_MAX_SIZE];
+  for (int g = 0; g < MAX_TALK_GROUPS; g++) {
+    WmHeader h = { 2, WM_TYPE_OPUS, WM_FLAG_GROUP, COORDINATOR_STREAM_ID, 0, (uint16_t)payloadBytes,
+                   0, 0, 0, 0, (uint8_t)g };
+    wmWriteHeaderV2(frames[g], h);
+  }
+
+  uint32_t floodUnicasts = 0, groupUnicasts = 0;
+  uint32_t start = ESP.getCycleCount();
+  for (int n = 0; n < iterations; n++) {
+    WmHeader parsed;
+    wmParseHeader(frames[n % MAX_TALK_GROUPS], WM_HEADER_V2_MAX_SIZE, parsed);
+    for (uint32_t bits = table.activeMask; bits; bits &= bits - 1) {
+      sink += table.macs[__builtin_ctz(bits)][5];
+      floodUnicasts++;
     }
   }
+  uint32_t floodCycles = ESP.getCycleCount() - start;
+
+  start = ESP.getCycleCount();
+  for (int n = 0; n < iterations; n++) {
+    WmHeader parsed;
+    wmParseHeader(frames[n % MAX_TALK_GROUPS], WM_HEADER_V2_MAX_SIZE, parsed);
+    uint8_t group = (parsed.flags & WM_FLAG_GROUP) ? parsed.group : 0;
+    for (uint32_t bits = peerTableGroupActive(table, group); bits; bits &= bits - 1) {
+      sink += table.macs[__builtin_ctz(bits)][5];
+      groupUnicasts++;
+    }
+  }
+  uint32_t groupCycles = ESP.getCycleCount() - start;
+
+  // Untagged frames when flooding, one header byte more with a group
+  uint32_t floodFrameUs = airtimeFrameUs(WM_HEADER_V2_SIZE + payloadBytes, false);
+  uint32_t groupFrameUs = airtimeFrameUs(WM_HEADER_V2_SIZE + WM_GROUP_SIZE + payloadBytes, false);
+  float floodPerFrame = (float)floodUnicasts / iterations;
+  float groupPerFrame = (float)groupUnicasts / iterations;
+  // Every group talking at once
+  float floodLoad = floodPerFrame * floodFrameUs * MAX_TALK_GROUPS * framesPerSecond / 10000.0f;
+  float groupLoad = groupPerFrame * groupFrameUs * MAX_TALK_GROUPS * framesPerSecond / 10000.0f;
+
+  float nsPerCycle = 1000.0f / ESP.getCpuFreqMHz();
+  Serial.printf("⏱️ Talk group bench (%d peers, %u active, %d groups, %d B payload):\n",
+                peers, peerTableActiveCount(table), MAX_TALK_GROUPS, payloadBytes);
+  Serial.printf("   routing, flood: %.1f cycles, %.1f ns per frame, %.1f unicasts\n",
+                (float)floodCycles / iterations, nsPerCycle * floodCycles / iterations, floodPerFrame);
+  Serial.printf("   routing, group: %.1f cycles, %.1f ns per frame, %.1f unicasts\n",
+                (float)groupCycles / iterations, nsPerCycle * groupCycles / iterations, groupPerFrame);
+  Serial.printf("   airtime per frame: flood %lu us, group %lu us (%lu / %lu us per unicast)\n",
+                (unsigned long)(floodPerFrame * floodFrameUs), (unsigned long)(groupPerFrame * groupFrameUs),
+                (unsigned long)floodFrameUs, (unsigned long)groupFrameUs);
+  Serial.printf("   %d groups talking at %d frames/s: flood %.0f%%, group %.0f%% of the channel\n",
+                MAX_TALK_GROUPS, framesPerSecond, floodLoad, groupLoad);
+  (void)sink;
 }
 
-static inline bool bleInPushFromISR(const uint8_t* buf, uint16_t len) {
-  if (len > 256) len = 256;
-  uint16_t nextHead = (uint16_t)((bleInHead + 1) & 0x0F);
-  if (nextHead == bleInTail) return false; // full
-  IncomingBleItem &slot = bleInQueue[bleInHead & 0x0F];
-  slot.length = len;
-  memcpy(slot.data, buf, len);
-  __atomic_store_n(&bleInHead, nextHead, __ATOMIC_RELEASE);
-  return true;
-}
+// Bytes and airtime to tell the clients about one membership change: a
+// delta broadcast vs the old mesh_status JSON, which carried every device
+// and went to each peer in turn. Builds private lists, so nothing is sent.
+void benchMembers() {
+  static const int sizes[] = { 4, 8, 16, 32, 64 };
+  static MemberList list;
+  const char* name = "ESP32S3_Audio_Client";  // what the client firmware announces
+  Serial.println("⏱️ Membership bench, bytes per change (client names and types as announced):");
+  Serial.println("   peers | delta B  us  | mesh_status B frames  x peers B    us   | snapshot frames B");
+  for (int s = 0; s < (int)(sizeof(sizes) / sizeof(sizes[0])); s++) {
+    int n = sizes[s];
+    membersReset(list, 0x12345678, 0, true);
+    DynamicJsonDocument doc(JSON_OBJECT_SIZE(6) + JSON_ARRAY_SIZE(n) + n * (JSON_OBJECT_SIZE(5) + 16));  // + copied MAC
+    doc["type"] = "mesh_status";
+    doc["source"] = "ESP32_A_Server";
+    doc["timestamp"] = millis();
+    doc["total_devices"] = n;
+    doc["mesh_healthy"] = true;
+    JsonArray devices = doc.createNestedArray("devices");
+    for (int i = 0; i < n; i++) {
+      uint8_t mac[6] = { 0x02, 0, 0, 0, 0, (uint8_t)i };
+      membersApplyOp(list, MEMBER_OP_ADD, mac, MEMBER_FLAG_ACTIVE, name);
+      char macStr[13];
+      snprintf(macStr, sizeof(macStr), "%02X%02X%02X%02X%02X%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+      JsonObject device = devices.createNestedObject();
+      device["m"] = macStr;
+      device["n"] = name;
+      device["t"] = "ESP32_Audio_Client";
+      device["s"] = millis() / 1000;
+      device["q"] = 100;
+    }
+    size_t statusBytes = measureJson(doc);
+    int statusFrames = (int)((statusBytes + ESP_NOW_MAX_DATA_LEN - 1) / ESP_NOW_MAX_DATA_LEN);
+    uint32_t statusUs = 0;
+    for (int f = 0; f < statusFrames; f++) {
+      size_t len = f < statusFrames - 1 ? ESP_NOW_MAX_DATA_LEN : statusBytes - f * ESP_NOW_MAX_DATA_LEN;
+      statusUs += airtimeFrameUs(len, false);
+    }
 
-static inline bool bleInPop(IncomingBleItem &out) {
-  uint16_t tail = __atomic_load_n(&bleInTail, __ATOMIC_ACQUIRE);
-  uint16_t head = __atomic_load_n(&bleInHead, __ATOMIC_ACQUIRE);
-  if (tail == head) return false; // empty
-  IncomingBleItem &slot = bleInQueue[tail & 0x0F];
-  out.length = slot.length;
-  memcpy(out.data, slot.data, slot.length);
-  __atomic_store_n(&bleInTail, (uint16_t)((tail + 1) & 0x0F), __ATOMIC_RELEASE);
-  return true;
+    MembersDelta delta;
+    membersDeltaBegin(delta);
+    membersDeltaAdd(delta, MEMBER_OP_ADD, list.entries[n - 1].mac, MEMBER_FLAG_ACTIVE, list.entries[n - 1].name);
+    int deltaBytes = membersDeltaFinish(delta, list.epoch, list.version);
+
+    uint8_t frame[ESP_NOW_MAX_DATA_LEN];
+    int next = 0, snapshotFrames = 0, snapshotBytes = 0;
+    do {
+      snapshotBytes += membersEncodeSnapshot(list, next, frame, sizeof(frame), &next);
+      snapshotFrames++;
+    } while (next < list.count);
+
+    Serial.printf("   %5d | %7d %4lu | %13u %6d %8lu %6lu | %15d %d\n", n, deltaBytes,
+                  (unsigned long)airtimeFrameUs(deltaBytes, true), (unsigned)statusBytes, statusFrames,
+                  (unsigned long)statusBytes * n, (unsigned long)statusUs * n, snapshotFrames, snapshotBytes);
+  }
+  Serial.println("   mesh_status was capped at 2 devices and cut at 250 B, so clients never saw the full list.");
 }
 
-// Audio streaming functions
-void startAudioStream() {
-  if (!isAudioStreaming) {
-    isAudioStreaming = true;
-    audioSequenceNumber = 0;
-    audioBufferIndex = 0;
-    Serial.println("🎤 Audio streaming started");
-    setStatusLED(0, 255, 0); // Green for active streaming
+// Fan-out stress: one writer publishes as fast as it can while a reader on
+// each core checks every snapshot it pins is complete and never goes back
+// in version. Runs on a private set so the live mesh is untouched.
+static FanoutSet fanoutStressSet;
+static volatile bool fanoutStressRunning = false;
+static volatile uint32_t fanoutStressReads = 0;
+static volatile uint32_t fanoutStressErrors = 0;
+
+static void fanoutStressFill(FanoutSnapshot* snap, uint32_t version) {
+  snap->count = version % (FANOUT_MAX_PEERS + 1);
+  for (int i = 0; i < snap->count; i++) {
+    memset(snap->peers[i].mac, (uint8_t)(version + i), 6);
+    snprintf(snap->peers[i].name, sizeof(snap->peers[i].name), "v%lu", (unsigned long)version);
   }
 }
 
-void stopAudioStream() {
-  if (isAudioStreaming) {
-    isAudioStreaming = false;
-    
-    // Clear audio buffer when stopping
-    memset(audioBuffer, 0, AUDIO_BUFFER_SIZE);
-    audioBufferIndex = 0;
-    audioSequenceNumber = 0;
-    
-    Serial.println("🛑 Audio streaming stopped - buffer cleared");
-    updateMeshStatusLED(); // Use mesh status instead of hardcoded blue
+static void fanoutStressWriter(void *pvParameters) {
+  for (uint32_t n = 0; fanoutStressRunning; n++) {
+    FanoutSnapshot* snap = fanoutBeginWrite(fanoutStressSet);
+    if (snap) {
+      fanoutStressFill(snap, fanoutStressSet.version + 1);
+      fanoutPublish(fanoutStressSet);
+    }
+    if ((n & 255) == 255) vTaskDelay(1);  // let the idle task feed the watchdog
   }
+  vTaskDelete(NULL);
 }
 
-void addAudioData(const uint8_t* data, int length) {
-  if (!isAudioStreaming) return;
-  
-  // Safety check: prevent buffer overflow
-  if (length <= 0 || data == nullptr) {
-    Serial.println("❌ Invalid audio data parameters");
-    return;
-  }
-  
-  // Check if we have enough space for new data
-  if (audioBufferIndex + length > AUDIO_BUFFER_SIZE) {
-    Serial.printf("⚠️ Buffer overflow prevented! Current: %d, Adding: %d, Max: %d\n", 
-                  audioBufferIndex, length, AUDIO_BUFFER_SIZE);
-    
-    // Force send chunks to make space
-    if (audioBufferIndex >= AUDIO_CHUNK_SIZE) {
-      sendAudioChunks();
-    }
-    
-    // If still no space, drop oldest data (FIFO behavior)
-    if (audioBufferIndex + length > AUDIO_BUFFER_SIZE) {
-      int overflow = (audioBufferIndex + length) - AUDIO_BUFFER_SIZE;
-      Serial.printf("🔄 Dropping %d oldest bytes to prevent overflow\n", overflow);
-      
-      // Shift buffer left by overflow amount
-      memmove(audioBuffer, audioBuffer + overflow, audioBufferIndex - overflow);
-      audioBufferIndex -= overflow;
+static void fanoutStressReader(void *pvParameters) {
+  uint32_t last = 0;
+  char expected[FANOUT_NAME_LEN];
+  for (uint32_t n = 0; fanoutStressRunning; n++) {
+    const FanoutSnapshot* snap = fanoutAcquire(fanoutStressSet);
+    uint32_t version = snap->version;
+    bool ok = version >= last && snap->count == version % (FANOUT_MAX_PEERS + 1);
+    snprintf(expected, sizeof(expected), "v%lu", (unsigned long)version);
+    for (int i = 0; ok && i < snap->count; i++) {
+      for (int b = 0; b < 6; b++) ok = ok && snap->peers[i].mac[b] == (uint8_t)(version + i);
+      ok = ok && strcmp(snap->peers[i].name, expected) == 0;
     }
+    fanoutRelease(fanoutStressSet, snap);
+    last = version;
+    if (!ok) __atomic_add_fetch(&fanoutStressErrors, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&fanoutStressReads, 1, __ATOMIC_RELAXED);
+    if ((n & 255) == 255) vTaskDelay(1);
   }
-  
-  // Add data to buffer safely
-  memcpy(audioBuffer + audioBufferIndex, data, length);
-  audioBufferIndex += length;
-  
-  Serial.printf("📥 Audio data added: %d bytes, buffer now: %d/%d bytes\n", 
-                length, audioBufferIndex, AUDIO_BUFFER_SIZE);
-  
-  // If buffer has enough data for chunks, send them
-  if (audioBufferIndex >= AUDIO_CHUNK_SIZE) {
-    sendAudioChunks();
-  }
+  vTaskDelete(NULL);
 }
 
-// RAW PCM: No compression - direct data passthrough
-int compressAudioData(const uint8_t* input, int inputLength, uint8_t* output) {
-  if (inputLength <= 0 || input == nullptr || output == nullptr) return 0;
-  
-  // Direct copy - no compression
-  memcpy(output, input, inputLength);
-  return inputLength;
+void fanoutStress(uint32_t seconds) {
+  fanoutInit(fanoutStressSet);
+  fanoutStressReads = 0;
+  fanoutStressErrors = 0;
+  fanoutStressRunning = true;
+  xTaskCreatePinnedToCore(fanoutStressWriter, "fanoutW", 3072, NULL, 1, NULL, 0);
+  xTaskCreatePinnedToCore(fanoutStressReader, "fanoutR0", 3072, NULL, 1, NULL, 0);
+  xTaskCreatePinnedToCore(fanoutStressReader, "fanoutR1", 3072, NULL, 1, NULL, 1);
+  Serial.printf("🔁 Fan-out stress for %lu s...\n", (unsigned long)seconds);
+  vTaskDelay(pdMS_TO_TICKS(seconds * 1000));
+  fanoutStressRunning = false;
+  vTaskDelay(pdMS_TO_TICKS(50));
+  Serial.printf("%s Fan-out stress: %lu publishes, %lu reads, %lu errors, %lu stalls, %lu reader retries\n",
+                fanoutStressErrors ? "❌" : "✅",
+                (unsigned long)fanoutStressSet.publishes, (unsigned long)fanoutStressReads,
+                (unsigned long)fanoutStressErrors, (unsigned long)fanoutStressSet.publishStalls,
+                (unsigned long)fanoutStressSet.readerRetries);
 }
 
-// RAW PCM: Simplified audio statistics (minimal overhead)
-void calculateAudioStats(const uint8_t* data, int length, uint16_t& minVal, uint16_t& maxVal, uint32_t& avgVal) {
-  if (length <= 0 || data == nullptr) return;
-  
-  // Minimal stats for compatibility - set to neutral values
-  minVal = 128;
-  maxVal = 128;
-  avgVal = 128;
-}
-
-// u-law encoding function for an audio sample
-uint8_t linearToUlaw(int16_t pcm_val) {
-    int16_t mask;
-    int16_t seg;
-    uint8_t uval;
-    pcm_val = pcm_val >> 2;
-    if (pcm_val < 0) {
-        pcm_val = -pcm_val;
-        mask = 0x7F;
+// Test-signal generator stage. Renders one frame per tick next to live
+// traffic: 20 ms of 8 kHz u-law as WM frames on GENERATOR_STREAM_ID to the
+// mesh, or 10 ms of 16 kHz u-law notified to phone A (the old BEEP path).
+// Jobs are handed over in one slot: the console or the BLE callback claims
+// it (compare-exchange FREE -> FILLING), fills generatorPending and marks it
+// READY; the task takes it at the next frame boundary and frees the slot.
+#define GENERATOR_FRAME_SAMPLES 160
+#define GENERATOR_MESH_RATE     8000  // WM_TYPE_ULAW_NB is 8 kHz
+#define GENERATOR_MAX_HZ        20000
+#define GENERATOR_MAX_SECONDS   3600
+
+enum GeneratorSlot { GEN_SLOT_FREE, GEN_SLOT_FILLING, GEN_SLOT_READY };
+
+enum GeneratorSink { GEN_SINK_MESH, GEN_SINK_BLE };
+
+struct GeneratorJob {
+  SigGenConfig signal;
+  uint8_t sink;         // GeneratorSink
+  uint32_t durationMs;  // 0 = until gen:stop
+};
+
+static GeneratorJob generatorPending;
+static volatile uint8_t generatorJobPending = GEN_SLOT_FREE;  // GeneratorSlot
+static volatile bool generatorActive = false;
+static volatile uint32_t generatorFrames = 0;
+static volatile uint32_t generatorRejected = 0;
+static uint8_t generatorSink = GEN_SINK_MESH;  // console settings
+static int16_t generatorLevel = 16384;
+TaskHandle_t GeneratorTaskHandle = NULL;
+
+static bool generatorQueue(const GeneratorJob& job) {
+  uint8_t expected = GEN_SLOT_FREE;
+  if (!__atomic_compare_exchange_n(&generatorJobPending, &expected, (uint8_t)GEN_SLOT_FILLING, false,
+                                   __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+    return false;  // previous one not taken yet, or another producer is filling it
+  }
+  generatorPending = job;
+  __atomic_store_n(&generatorJobPending, (uint8_t)GEN_SLOT_READY, __ATOMIC_RELEASE);
+  if (GeneratorTaskHandle) xTaskNotifyGive(GeneratorTaskHandle);
+  return true;
+}
+
+void GeneratorTask(void *pvParameters) {
+  allocTrackSetSubsystem(ALLOC_SUB_AUDIO);
+  SigGen gen;
+  GeneratorJob job;
+  TickType_t period = 1;
+  TickType_t xLastWakeTime = xTaskGetTickCount();
+  uint32_t dueUs = 0;
+  unsigned long endMs = 0;
+  uint32_t sequence = 0;
+  uint32_t timestamp = 0;
+  bool marker = false;
+  int16_t pcm[GENERATOR_FRAME_SAMPLES];
+  uint8_t frame[WM_HEADER_V2_SIZE + GENERATOR_FRAME_SAMPLES];
+  uint8_t* ulaw = frame + WM_HEADER_V2_SIZE;
+
+  for (;;) {
+    if (generatorActive) {
+      vTaskDelayUntil(&xLastWakeTime, period);
+      dueUs += period * portTICK_PERIOD_MS * 1000;
+      taskStageRecordLatency(TASK_STAGE_GENERATOR, dueUs);  // wake-up lateness
     } else {
-        mask = 0xFF;
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
     }
-    if (pcm_val > 8158) pcm_val = 8158;
-    pcm_val += 133;
 
-    seg = 0;
-    while( pcm_val > ( (33<<(seg+1)) - 33 ) ){
-        seg++;
+    if (__atomic_load_n(&generatorJobPending, __ATOMIC_ACQUIRE) == GEN_SLOT_READY) {
+      job = generatorPending;
+      __atomic_store_n(&generatorJobPending, (uint8_t)GEN_SLOT_FREE, __ATOMIC_RELEASE);
+      uint32_t rate = job.sink == GEN_SINK_MESH ? GENERATOR_MESH_RATE : AUDIO_SAMPLE_RATE;
+      bool wasActive = generatorActive;
+      generatorActive = job.signal.type != SIGGEN_OFF && sigGenInit(gen, job.signal, rate);
+      if (generatorActive) {
+        period = pdMS_TO_TICKS(GENERATOR_FRAME_SAMPLES * 1000 / rate);
+        xLastWakeTime = xTaskGetTickCount();
+        dueUs = taskStageNowUs();
+        endMs = job.durationMs ? millis() + job.durationMs : 0;
+        marker = true;
+        Serial.printf("🎛️ Generator: %s to %s at %lu Hz\n", sigGenTypeName(job.signal.type),
+                      job.sink == GEN_SINK_MESH ? "mesh" : "BLE", (unsigned long)rate);
+      } else if (job.signal.type != SIGGEN_OFF) {
+        generatorRejected++;
+        Serial.printf("❌ Generator: %s not possible at %lu Hz\n", sigGenTypeName(job.signal.type), (unsigned long)rate);
+      } else if (wasActive) {
+        Serial.println("🎛️ Generator stopped");
+      }
+      continue;
+    }
+    if (!generatorActive) continue;
+    if (endMs && (long)(millis() - endMs) >= 0) {
+      generatorActive = false;
+      Serial.println("🎛️ Generator finished");
+      continue;
     }
 
-    uval = (uint8_t)(((seg << 4) | ((pcm_val - ( (33<<(seg)) - 33 )) >> (seg + 1))));
-    return (uval ^ mask);
+    uint32_t start = taskStageNowUs();
+    sigGenRender(gen, pcm, GENERATOR_FRAME_SAMPLES);
+    for (int i = 0; i < GENERATOR_FRAME_SAMPLES; i++) ulaw[i] = g711LinearToUlaw(pcm[i]);
+    audioMeterUpdateUlaw(meterGenerator, ulaw, GENERATOR_FRAME_SAMPLES);
+
+    if (job.sink == GEN_SINK_MESH) {
+      WmHeader header;
+      header.type = WM_TYPE_ULAW_NB;
+      header.flags = marker ? WM_FLAG_MARKER : 0;
+      header.streamId = GENERATOR_STREAM_ID;
+      header.sequence = sequence++;
+      header.timestamp = timestamp;
+      header.payloadLen = GENERATOR_FRAME_SAMPLES;
+      wmWriteHeaderV2(frame, header);
+      sendWmToMesh(frame, sizeof(frame), phoneTalkGroup);
+      timestamp += GENERATOR_FRAME_SAMPLES * (WM_TIMESTAMP_HZ / GENERATOR_MESH_RATE);
+    } else if (deviceConnected && pAudioCharacteristic != nullptr) {
+      AllocScope radio(ALLOC_SUB_RADIO);
+      pAudioCharacteristic->setValue(ulaw, GENERATOR_FRAME_SAMPLES);
+      pAudioCharacteristic->notify();
+    }
+    marker = false;
+    generatorFrames++;
+    taskStageAddBusy(TASK_STAGE_GENERATOR, start);
+  }
 }
 
+// BEEP from the phone and send_beep: 1 kHz, 5 s, back over BLE
+void generatorBeep() {
+  GeneratorJob job;
+  sigGenDefaultConfig(job.signal);
+  job.signal.type = SIGGEN_SINE;
+  job.sink = GEN_SINK_BLE;
+  job.durationMs = 5000;
+  if (!generatorQueue(job)) Serial.println("Generator busy, beep dropped");
+}
 
-void sendBeepOnce() {
-  Serial.println("--- Starting 5-second beep test (u-law compressed) ---");
-  const int loopCount = 400; // 400 loops * 12.5ms/loop = 5000ms = 5s
-  const int samplesPerLoop = 200;
-  static int16_t sineFrame[samplesPerLoop];
-  static bool sineInit = false;
-  if (!sineInit) {
-    for (int i = 0; i < samplesPerLoop; i++) {
-        // 1kHz sine wave at 16kHz sample rate
-        sineFrame[i] = (int16_t)(sin(2 * PI * 1000.0 * i / AUDIO_SAMPLE_RATE) * 16384.0);
-    }
-    sineInit = true;
+// gen:sine[:<hz>[:<s>]]  gen:sweep[:<from>:<to>[:<period_ms>[:<s>]]]
+// gen:pink[:<s>]  gen:impulse[:<per_s>[:<s>]]  gen:stop
+// gen_sink:<mesh|ble>  gen_level:<dBFS>
+void generatorCommand(const String& command) {
+  if (command.startsWith("gen_sink:")) {
+    String sink = command.substring(9);
+    if (sink == "mesh") generatorSink = GEN_SINK_MESH;
+    else if (sink == "ble") generatorSink = GEN_SINK_BLE;
+    else Serial.println("Usage: gen_sink:<mesh|ble>");
+    Serial.printf("Generator sink: %s\n", generatorSink == GEN_SINK_MESH ? "mesh" : "ble");
+    return;
+  }
+  if (command.startsWith("gen_level:")) {
+    float dbfs = command.substring(10).toFloat();
+    if (dbfs > 0.0f) dbfs = 0.0f;
+    generatorLevel = (int16_t)(32767.0f * powf(10.0f, dbfs / 20.0f));
+    Serial.printf("Generator level: %.1f dBFS (%d)\n", dbfs, generatorLevel);
+    return;
   }
 
-  const TickType_t xFrequency = pdMS_TO_TICKS(12); // Paced for ~12.5ms
-  TickType_t xLastWakeTime = xTaskGetTickCount();
+  // gen:<type>[:<arg>...]
+  String rest = command.substring(4);
+  int colon = rest.indexOf(':');
+  String type = colon < 0 ? rest : rest.substring(0, colon);
+  long args[4] = { 0, 0, 0, 0 };
+  int argCount = 0;
+  while (colon >= 0 && argCount < 4) {
+    int next = rest.indexOf(':', colon + 1);
+    args[argCount++] = (next < 0 ? rest.substring(colon + 1) : rest.substring(colon + 1, next)).toInt();
+    colon = next;
+  }
 
-  for (int f = 0; f < loopCount; f++) {
-    uint8_t ulawBuffer[samplesPerLoop];
-    for (int i = 0; i < samplesPerLoop; i++) {
-        ulawBuffer[i] = linearToUlaw(sineFrame[i]);
+  GeneratorJob job;
+  sigGenDefaultConfig(job.signal);
+  job.signal.level = generatorLevel;
+  job.sink = generatorSink;
+  job.durationMs = 10000;
+  long seconds = -1;
+  bool ok = true;
+  if (type == "stop") {
+    job.signal.type = SIGGEN_OFF;
+  } else if (type == "sine") {
+    job.signal.type = SIGGEN_SINE;
+    if (argCount > 0) ok = args[0] >= 1 && args[0] <= GENERATOR_MAX_HZ;
+    if (ok && argCount > 0) job.signal.freqHz = (uint16_t)args[0];
+    if (argCount > 1) seconds = args[1];
+  } else if (type == "sweep") {
+    job.signal.type = SIGGEN_SWEEP;
+    if (argCount > 1) {
+      ok = args[0] >= 1 && args[0] <= GENERATOR_MAX_HZ && args[1] >= 1 && args[1] <= GENERATOR_MAX_HZ;
+      if (ok) {
+        job.signal.freqHz = (uint16_t)args[0];
+        job.signal.freqEndHz = (uint16_t)args[1];
+      }
     }
-
-    if (deviceConnected && pAudioCharacteristic != nullptr) {
-      pAudioCharacteristic->setValue(ulawBuffer, samplesPerLoop);
-      pAudioCharacteristic->notify();
+    if (argCount > 2) {
+      ok = ok && args[2] >= 1 && args[2] <= 60000;
+      if (ok) job.signal.periodMs = (uint16_t)args[2];
     }
-    
-    vTaskDelayUntil(&xLastWakeTime, xFrequency);
+    if (argCount > 3) seconds = args[3];
+  } else if (type == "pink") {
+    job.signal.type = SIGGEN_PINK;
+    if (argCount > 0) seconds = args[0];
+  } else if (type == "impulse") {
+    job.signal.type = SIGGEN_IMPULSE;
+    if (argCount > 0) ok = args[0] >= 1 && args[0] <= 1000;
+    if (ok && argCount > 0) job.signal.impulsesPerSec = (uint16_t)args[0];
+    if (argCount > 1) seconds = args[1];
+  } else {
+    ok = false;
+  }
+  if (seconds != -1 && (seconds < 0 || seconds > GENERATOR_MAX_SECONDS)) ok = false;
+  if (!ok) {
+    Serial.printf("Usage: gen:sine[:<hz>[:<s>]] | gen:sweep[:<from>:<to>[:<period_ms>[:<s>]]] | gen:pink[:<s>]\n"
+                  "       | gen:impulse[:<per_s>[:<s>]] | gen:stop\n"
+                  "  hz 1..%d, period_ms 1..60000, per_s 1..1000, s 0..%d (0 = until gen:stop)\n",
+                  GENERATOR_MAX_HZ, GENERATOR_MAX_SECONDS);
+    return;
   }
-  Serial.println("--- Beep test finished ---");
+  if (seconds >= 0) job.durationMs = (uint32_t)seconds * 1000;
+  if (!generatorQueue(job)) Serial.println("Generator busy, try again");
+}
+
+void printGeneratorStats() {
+  Serial.printf("=== GENERATOR (%s, sink %s, level %d) ===\n", generatorActive ? "running" : "idle",
+                generatorSink == GEN_SINK_MESH ? "mesh" : "ble", generatorLevel);
+  Serial.printf("Frames: %lu, rejected jobs: %lu\n", (unsigned long)generatorFrames,
+                (unsigned long)generatorRejected);
+  printMeter(meterGenerator);
 }
 
 void sendAudioChunks() {
-  if (meshDeviceCount == 0 && !deviceConnected) {
+  if (meshPeers.count == 0 && !deviceConnected) {
     Serial.println("⚠️ No mesh or BLE devices connected, clearing audio buffer");
-    memset(audioBuffer, 0, AUDIO_BUFFER_SIZE);
+    memset(audioBuffer, 0, kAudioBufferBytes);
     audioBufferIndex = 0;
     return;
   }
   
   // Debug: Log buffer status
   if (audioBufferIndex > 0) {
-    Serial.printf("🔍 Audio buffer: %d bytes, mesh devices: %d\n", audioBufferIndex, meshDeviceCount);
+    DLOG(AUDIO, DEBUG, AUDIO_BUFFER, audioBufferIndex, meshPeers.count);
   }
   
   // Buffer health check
   // Reduced logging to avoid heap churn during high-rate streams
-  // Serial.printf("🔍 Buffer health: %d/%d bytes (%.1f%% full)\n", audioBufferIndex, AUDIO_BUFFER_SIZE, (float)audioBufferIndex / AUDIO_BUFFER_SIZE * 100.0);
+  // Serial.printf("🔍 Buffer health: %d/%d bytes (%.1f%% full)\n", audioBufferIndex, kAudioBufferBytes, (float)audioBufferIndex / kAudioBufferBytes * 100.0);
   
+  if (agcResetPending) {
+    agcResetPending = false;
+    agcReset(meshAgc);
+  }
+
+  // Apply a mesh rate change between chunks, never mid-chunk
+  uint32_t newRate = pendingMeshSampleRate;
+  if (newRate != 0) {
+    pendingMeshSampleRate = 0;
+    if (newRate == AUDIO_SAMPLE_RATE || resamplerInit(meshDownsampler, AUDIO_SAMPLE_RATE, newRate)) {
+      meshSampleRate = newRate;
+      Serial.printf("🎚️ Mesh audio rate now %lu Hz\n", (unsigned long)meshSampleRate);
+    }
+  }
+
   // If startup window elapsed and at boundary, switch to steady-state size
   if (startupFramingActive && millis() >= startupFrameUntilMs && (audioBufferIndex % currentChunkSize) == 0) {
     currentChunkSize = AUDIO_CHUNK_SIZE;
@@ -1135,22 +3041,56 @@ void sendAudioChunks() {
         uint8_t rawBuffer[200];
         int rawSize = compressAudioData(audioBuffer + startIndex, currentChunkSize, rawBuffer);
         
-        // Calculate audio statistics efficiently (optional)
-        uint16_t minVal, maxVal; uint32_t avgVal;
-        calculateAudioStats(audioBuffer + startIndex, currentChunkSize, minVal, maxVal, avgVal);
+        // Level metering (counters only, read via meter_stats)
+        audioMeterUpdateUlaw(meterMeshOut, audioBuffer + startIndex, currentChunkSize);
+        
+        // Decoded-PCM stages: AGC/noise gate, then optional 8 kHz narrowband
+        uint8_t frameType = WM_TYPE_OPUS;
+        bool narrowband = meshSampleRate != AUDIO_SAMPLE_RATE;
+        if (agcEnabled || narrowband) {
+          int16_t pcmIn[200];
+          for (int i = 0; i < rawSize; i++) pcmIn[i] = g711UlawToLinear(rawBuffer[i]);
+          if (agcEnabled) agcProcess(meshAgc, pcmIn, rawSize);
+          if (narrowband) {
+            int16_t pcmOut[200];
+            int outCount = resamplerProcess(meshDownsampler, pcmIn, rawSize, pcmOut, 200);
+            for (int i = 0; i < outCount; i++) rawBuffer[i] = g711LinearToUlaw(pcmOut[i]);
+            rawSize = outCount;
+            frameType = WM_TYPE_ULAW_NB;
+          } else {
+            for (int i = 0; i < rawSize; i++) rawBuffer[i] = g711LinearToUlaw(pcmIn[i]);
+          }
+        }
         
-        // Create WM frame with Opus payload (type=1)
+        // Create WM frame with Opus payload (type=1) or narrowband u-law (type=2)
         char messageBuffer[240];
         int messageLen = 0;
         
-        // WM frame header: 'W','M', type=1, seq(le16), len(le16)
-        messageBuffer[messageLen++] = 'W';
-        messageBuffer[messageLen++] = 'M';
-        messageBuffer[messageLen++] = 1; // type=1 for Opus
-        messageBuffer[messageLen++] = (audioSequenceNumber & 0xFF); // seq low byte
-        messageBuffer[messageLen++] = ((audioSequenceNumber >> 8) & 0xFF); // seq high byte
-        messageBuffer[messageLen++] = (rawSize & 0xFF); // len low byte
-        messageBuffer[messageLen++] = ((rawSize >> 8) & 0xFF); // len high byte
+        // WM v2 header: stream ID, 32-bit sequence and media timestamp,
+        // plus the membership when it changed or is due for a refresh and
+        // the talk group when it is not group 0
+        const FanoutSnapshot* fanout = fanoutAcquire(meshFanout);
+        uint32_t now = millis();
+        uint8_t group = phoneTalkGroup;
+        uint8_t targets = fanout->groups[group];
+        noteGroupFanout(fanout, group, now);
+        WmHeader header;
+        header.type = frameType;
+        header.flags = audioSequenceNumber == 0 ? WM_FLAG_MARKER : 0;
+        if (group != 0) header.flags |= WM_FLAG_GROUP;
+        header.group = group;
+        header.streamId = COORDINATOR_STREAM_ID;
+        header.sequence = audioSequenceNumber;
+        header.timestamp = audioMediaTimestamp;
+        header.payloadLen = (uint16_t)rawSize;
+        uint8_t membersVersion = memberLogVersion8();
+        if (targets && membershipDue(membersVersion, now)) {
+          header.flags |= WM_FLAG_MEMBERSHIP;
+          header.members = fanout->count;
+          header.membersVersion = membersVersion;
+          membershipSent(membersVersion, now);
+        }
+        messageLen = wmWriteHeaderV2((uint8_t*)messageBuffer, header);
         
         // Add Opus audio data
         int maxAudio = (int)sizeof(messageBuffer) - messageLen;
@@ -1161,6 +3101,7 @@ void sendAudioChunks() {
         }
         
         audioSequenceNumber++;
+        audioMediaTimestamp += (uint32_t)rawSize * (WM_TIMESTAMP_HZ / meshSampleRate);
         
         // Ensure message fits within ESP-NOW limits (<= 250 bytes)
         if (messageLen > 250) {
@@ -1168,30 +3109,27 @@ void sendAudioChunks() {
           messageLen = 250;
         }
         
-        // Send to all mesh devices
-        if (meshDeviceCount > 0) {
-          for (int i = 0; i < meshDeviceCount; i++) {
-            if (meshDevices[i].isActive) {
-              esp_err_t result = esp_now_send(meshDevices[i].mac, 
-                                             (uint8_t*)messageBuffer, 
-                                             messageLen);
-              if (result == ESP_OK) {
-                Serial.printf("✅ Audio sent to mesh device %s: %d bytes\n", 
-                             meshDevices[i].deviceName.c_str(), messageLen);
-              } else {
-                Serial.printf("❌ Failed to send audio to %s: %d\n", 
-                             meshDevices[i].deviceName.c_str(), result);
-              }
-            }
+        // Send to the talk group's peers in the current fan-out snapshot
+        for (uint32_t bits = targets; bits; bits &= bits - 1) {
+          int i = __builtin_ctz(bits);
+          esp_err_t result = meshSend(fanout->peers[i].mac, 
+                                         (uint8_t*)messageBuffer, 
+                                         messageLen);
+          uint32_t mac16 = fanout->peers[i].mac[4] << 8 | fanout->peers[i].mac[5];
+          if (result == ESP_OK) {
+            DLOG(AUDIO, DEBUG, AUDIO_SENT, i, mac16, messageLen);
+          } else {
+            DLOG(AUDIO, WARN, AUDIO_SEND_FAILED, i, mac16, result);
           }
         }
+        fanoutRelease(meshFanout, fanout);
         
         // Do not locally notify back to Phone A; mesh forward only
     
     lastAudioChunk = millis();
     // NOTE: A hardcoded delay was removed from here. The main loop's delay provides general pacing.
     // For high-throughput streaming, a more sophisticated pacing mechanism would be needed here,
-    // similar to the micros() loop in sendBeepOnce().
+    // similar to the vTaskDelayUntil() pacing in GeneratorTask.
   }
   
   // Clear sent data from buffer - OPTIMIZED VERSION
@@ -1202,10 +3140,10 @@ void sendAudioChunks() {
     audioBufferIndex = remainingData;
     
     // Clear the unused portion of buffer to prevent data leakage
-    memset(audioBuffer + remainingData, 0, AUDIO_BUFFER_SIZE - remainingData);
+    memset(audioBuffer + remainingData, 0, kAudioBufferBytes - remainingData);
   } else {
     // Clear entire buffer when no remaining data
-    memset(audioBuffer, 0, AUDIO_BUFFER_SIZE);
+    memset(audioBuffer, 0, kAudioBufferBytes);
     audioBufferIndex = 0;
   }
   
@@ -1217,17 +3155,17 @@ void handleTestCommand(const String& command) {
   if (command == "buffer_status") {
     // Show buffer status
     Serial.printf("📊 OPTIMIZED BUFFER STATUS:\n");
-    Serial.printf("   Buffer Size: %d bytes\n", AUDIO_BUFFER_SIZE);
+    Serial.printf("   Buffer Size: %d bytes\n", kAudioBufferBytes);
     Serial.printf("   Used: %d bytes\n", audioBufferIndex);
-    Serial.printf("   Free: %d bytes\n", AUDIO_BUFFER_SIZE - audioBufferIndex);
+    Serial.printf("   Free: %d bytes\n", kAudioBufferBytes - audioBufferIndex);
     Serial.printf("   Chunk Size: %d bytes\n", AUDIO_CHUNK_SIZE);
-    Serial.printf("   Max Chunks: %d\n", AUDIO_BUFFER_SIZE / AUDIO_CHUNK_SIZE);
+    Serial.printf("   Max Chunks: %d\n", kAudioBufferBytes / AUDIO_CHUNK_SIZE);
     Serial.printf("   Current Chunks: %d\n", audioBufferIndex / AUDIO_CHUNK_SIZE);
     Serial.printf("   Streaming: %s\n", isAudioStreaming ? "Yes" : "No");
     
     // Show audio quality parameters
     Serial.printf("   Audio Quality:\n");
-    Serial.printf("     Sample Rate: %d Hz\n", AUDIO_SAMPLE_RATE);
+    Serial.printf("     Sample Rate: %d Hz (mesh %lu Hz)\n", AUDIO_SAMPLE_RATE, (unsigned long)meshSampleRate);
     Serial.printf("     Bits per Sample: %d\n", AUDIO_BITS_PER_SAMPLE);
     Serial.printf("     Channels: %d\n", AUDIO_CHANNELS);
     Serial.printf("     Raw Data Rate: %d KB/s\n", (AUDIO_SAMPLE_RATE * AUDIO_BITS_PER_SAMPLE * AUDIO_CHANNELS) / 8000);
@@ -1236,7 +3174,7 @@ void handleTestCommand(const String& command) {
     // Show mesh status
     Serial.printf("   Mesh Network:\n");
     Serial.printf("     Active: %s\n", meshNetworkActive ? "Yes" : "No");
-    Serial.printf("     Devices: %d/%d\n", meshDeviceCount, MAX_MESH_DEVICES);
+    Serial.printf("     Devices: %d/%d\n", meshPeers.count, MAX_MESH_DEVICES);
     
     // Show first few bytes of buffer content
     Serial.printf("   Buffer Preview: ");
@@ -1304,7 +3242,7 @@ void handleTestCommand(const String& command) {
         Serial.printf("Parsed %d bytes from hex data\n", actualLength);
         
         // Store in buffer and send
-        if (audioBufferIndex + actualLength <= AUDIO_BUFFER_SIZE) {
+        if (audioBufferIndex + actualLength <= kAudioBufferBytes) {
           memcpy(audioBuffer + audioBufferIndex, testData, actualLength);
           audioBufferIndex += actualLength;
           Serial.printf("Test audio chunk '%s' added to buffer (total: %d bytes)\n", chunkId.c_str(), audioBufferIndex);
@@ -1323,12 +3261,223 @@ void handleTestCommand(const String& command) {
     
   } else if (command == "clear_buffer") {
     // Clear audio buffer
-    memset(audioBuffer, 0, AUDIO_BUFFER_SIZE);
+    memset(audioBuffer, 0, kAudioBufferBytes);
     audioBufferIndex = 0;
     audioSequenceNumber = 0;
    // Serial.println("🧹 Audio buffer cleared");
   } else if (command == "send_beep") {
-    sendBeepOnce();
+    generatorBeep();
+  } else if (command == "gen_stats") {
+    printGeneratorStats();
+  } else if (command.startsWith("gen:") || command.startsWith("gen_sink:") || command.startsWith("gen_level:")) {
+    generatorCommand(command);
+  } else if (command == "meter_stats") {
+    printMeterStats();
+  } else if (command == "meter_reset") {
+    audioMeterReset(meterMeshOut);
+    audioMeterReset(meterGenerator);
+    Serial.println("Audio meters reset");
+  } else if (command == "bench_meter") {
+    benchMeter();
+  } else if (command == "bench_resampler") {
+    benchResampler();
+  } else if (command == "bench_wm") {
+    benchWmHeader();
+  } else if (command == "bench_fanout") {
+    benchFanout();
+  } else if (command == "bench_groups" || command.startsWith("bench_groups:")) {
+    int payload = command.length() > 13 ? command.substring(13).toInt() : 60;
+    benchGroups(payload > 0 && payload <= ESP_NOW_MAX_DATA_LEN - WM_HEADER_V2_MAX_SIZE ? payload : 60);
+  } else if (command == "talk_groups") {
+    printTalkGroups();
+  } else if (command.startsWith("talk:")) {
+    int group = command.substring(5).toInt();
+    if (group >= 0 && group < MAX_TALK_GROUPS) {
+      phoneTalkGroup = (uint8_t)group;
+      Serial.printf("🗣️ Phone A talks to group %d\n", group);
+    } else {
+      Serial.printf("Usage: talk:<0-%d>\n", MAX_TALK_GROUPS - 1);
+    }
+  } else if (command.startsWith("group:")) {
+    int index = -1, mask = -1;
+    sscanf(command.c_str() + 6, "%d:%i", &index, &mask);
+    setPeerGroups(index, mask);
+  } else if (command == "bench_peers") {
+    benchPeers();
+  } else if (command == "bench_members") {
+    benchMembers();
+  } else if (command == "members") {
+    printMemberLog();
+  } else if (command == "fd_stats") {
+    printPeerHealth();
+  } else if (command == "channel_stats") {
+    printChannelStats();
+  } else if (command.startsWith("channel:")) {
+    int channel = command.substring(8).toInt();
+    if (!announceChannelSwitch((uint8_t)channel)) {
+      Serial.printf("Cannot move to channel %d (leader: %s, candidates 0x%04X, on %u)\n", channel,
+                    isMeshCoordinator ? "yes" : "no", MESH_CHANNEL_MASK, meshChannel);
+    }
+  } else if (command == "log_stats") {
+    dlogPrintStats();
+  } else if (command.startsWith("log_mode:")) {
+    if (dlogSetOutput(command.substring(9).c_str())) {
+      Serial.printf("Deferred log output: %s\n", command.substring(9).c_str());
+    } else {
+      Serial.println("Usage: log_mode:<text|binary|off>");
+    }
+  } else if (command == "timers") {
+    timerWheelPrintStats(housekeepingWheel, "HOUSEKEEPING");
+  } else if (command == "timers_reset") {
+    timerWheelResetStats(housekeepingWheel);
+    Serial.println("Timer stats reset");
+  } else if (command == "fanout_stats") {
+    printFanoutStats();
+  } else if (command == "fanout_stress" || command.startsWith("fanout_stress:")) {
+    uint32_t seconds = command.length() > 14 ? (uint32_t)command.substring(14).toInt() : 5;
+    if (seconds > 0 && seconds <= 60) fanoutStress(seconds);
+  } else if (command == "bench_agc") {
+    benchAgc();
+  } else if (command == "bench_transcode") {
+    if (transcodeBenchRunning) {
+      Serial.println("Transcode bench already running");
+    } else {
+      transcodeBenchRunning = true;
+      if (xTaskCreatePinnedToCore(benchTranscodeTask, "benchTranscode", 32768, NULL, 1, NULL, 1) != pdPASS) {
+        transcodeBenchRunning = false;
+        Serial.println("❌ Transcode bench: no memory for the task");
+      }
+    }
+  } else if (command == "layouts") {
+    taskLayoutPrintResults();
+  } else if (command.startsWith("layout:")) {
+    int index = command.substring(7).toInt();
+    if (command.length() > 7 && taskLayoutSelect(index)) {
+      Serial.printf("Task layout %d (%s) saved, restarting\n", index, kTaskLayouts[index].name);
+      delay(100);
+      ESP.restart();
+    } else {
+      Serial.printf("Usage: layout:<0..%d>\n", kTaskLayoutCount - 1);
+    }
+  } else if (command == "layout_stats") {
+    taskLayoutPrintStats(0, false);
+  } else if (command == "bench_layout" || command.startsWith("bench_layout:")) {
+    uint32_t seconds = command.length() > 13 ? (uint32_t)command.substring(13).toInt() : 10;
+    if (layoutBenchSeconds != 0) {
+      Serial.println("Layout bench already running");
+    } else if (seconds > 0 && seconds <= 300) {
+      layoutBenchSeconds = seconds;
+      xTaskCreatePinnedToCore(layoutBenchTask, "layoutBench", 4096, NULL, 1, NULL, tskNO_AFFINITY);
+    }
+  } else if (command == "deadline_stats") {
+    deadlinePrintStats();
+  } else if (command == "deadline_reset") {
+    deadlineReset();
+    Serial.println("Deadline counters reset");
+  } else if (command == "beacon_stats") {
+    printBeaconStats();
+  } else if (command == "airtime_stats") {
+    printAirtimeStats();
+  } else if (command == "airtime_reset") {
+    airtimeReset();
+    heartbeatsSent = heartbeatsSuppressed = membersPiggybacked = 0;
+    memberDeltasSent = memberDeltaBytes = memberSnapshotsSent = memberSnapshotFrames = 0;
+    Serial.println("Airtime counters reset");
+  } else if (command == "mesh_forget") {
+    meshStateClear();
+    Serial.println("Saved mesh session cleared, the next start begins a new one");
+  } else if (command == "mem_map") {
+    memPlacePrintMap();
+  } else if (command == "pool_stats") {
+    bufferPrintStats(BUF_FW_COORD);
+  } else if (command == "pool_reset") {
+    bufferHighWaterReset();
+    Serial.println("Buffer high-water marks reset");
+  } else if (command == "bench_mem") {
+    memPlaceBench();
+  } else if (command == "alloc_stats") {
+    allocTrackPrintStats();
+  } else if (command == "alloc_reset") {
+    allocTrackReset();
+    Serial.println("Allocation counters reset");
+  } else if (command == "alloc_check" || command.startsWith("alloc_check:")) {
+    uint32_t seconds = command.length() > 12 ? (uint32_t)command.substring(12).toInt() : 600;
+    if (!ALLOC_TRACK_ENABLED) {
+      Serial.println("alloc_check needs the alloc_track build (pio run -e alloc_track)");
+    } else if (allocCheckSeconds != 0) {
+      Serial.println("Alloc check already running");
+    } else if (seconds > 0 && seconds <= 3600) {
+      allocCheckSeconds = seconds;
+      xTaskCreatePinnedToCore(allocCheckTask, "allocCheck", 4096, NULL, 1, NULL, tskNO_AFFINITY);
+    }
+  } else if (command == "ble_in_stats") {
+    printBleInStats();
+  } else if (command == "ble_in_reset") {
+    bleInWrites = 0;
+    bleInBytes = 0;
+    bleInDrops = 0;
+    bleInTruncated = 0;
+    bleInXoffSent = 0;
+    bleInXonSent = 0;
+    bufferHighWaterClear(BUF_POOL_BLE_IN_QUEUE);
+    Serial.println("BLE ingest stats reset");
+  } else if (command == "rx_stats") {
+    printMeshRxStats();
+  } else if (command == "rx_reset") {
+    for (int b = 0; b < MESH_RX_HIST_BUCKETS; b++) meshRxHist[b] = 0;
+    meshRxMaxCycles = 0;
+    meshRxDrops = 0;
+    Serial.println("Mesh RX stats reset");
+  } else if (command == "transcode_stats") {
+    printTranscodeStats();
+  } else if (command.startsWith("transcode:")) {
+    // transcode:<group>:off | transcode:<group>:<bitrate>:<frame_ms>[:<complexity>]
+    int group = -1, bitrate = 0, frameMs = 0, complexity = 2;
+    char mode[8] = {0};
+    const char* args = command.c_str() + strlen("transcode:");
+    if (sscanf(args, "%d:%7[^:]", &group, mode) == 2 && strcmp(mode, "off") == 0 &&
+        group >= 0 && group < MAX_TALK_GROUPS) {
+      TranscodeProfile p = transcodeProfile(group);
+      p.enabled = false;
+      transcodeSetProfile(group, p);
+      Serial.printf("Transcode off for group %d\n", group);
+    } else if (sscanf(args, "%d:%d:%d:%d", &group, &bitrate, &frameMs, &complexity) >= 3 &&
+               group >= 0 && group < MAX_TALK_GROUPS) {
+      TranscodeProfile p;
+      p.enabled = true;
+      p.bitrate = bitrate > 0 ? bitrate : 0;
+      p.frameMs = frameMs > 0 && frameMs <= 255 ? frameMs : 0;
+      p.complexity = complexity >= 0 && complexity <= 255 ? complexity : 255;
+      if (!transcodeProfileValid(p)) {
+        Serial.printf("❌ Invalid profile: 6000..64000 bps, 10/20/40/60 ms, complexity 0..10, "
+                      "at most %d B per frame\n", OPUS_TRANSCODE_MAX_PACKET);
+      } else {
+        transcodeSetProfile(group, p);
+        transcodeConfigPending[group] = true;
+        if (TranscodeTaskHandle) xTaskNotifyGive(TranscodeTaskHandle);
+        Serial.printf("Transcode group %d -> %d bps, %d ms frames, complexity %d\n", group, bitrate, frameMs, complexity);
+      }
+    } else {
+      Serial.println("Usage: transcode:<group>:off | transcode:<group>:<bitrate>:<frame_ms>[:<complexity>]");
+    }
+  } else if (command == "agc:on" || command == "agc:off") {
+    agcEnabled = (command == "agc:on");
+    agcResetPending = true;
+    Serial.printf("AGC/noise gate %s\n", agcEnabled ? "enabled" : "disabled");
+  } else if (command == "agc_stats") {
+    Serial.printf("AGC: %s, gain %.1f dB, gate %s, input RMS %u, blocks %lu (gated %lu)\n",
+                  agcEnabled ? "on" : "off",
+                  20.0f * log10f(meshAgc.lastOutGainQ12 > 0 ? meshAgc.lastOutGainQ12 / 4096.0f : 1e-5f),
+                  meshAgc.gateOpen ? "open" : "closed", meshAgc.lastInRms,
+                  (unsigned long)meshAgc.blocks, (unsigned long)meshAgc.gatedBlocks);
+  } else if (command.startsWith("mesh_rate:")) {
+    uint32_t rate = (uint32_t)command.substring(strlen("mesh_rate:")).toInt();
+    if (rate == 8000 || rate == AUDIO_SAMPLE_RATE) {
+      pendingMeshSampleRate = rate;
+      Serial.printf("Mesh audio rate change to %lu Hz queued\n", (unsigned long)rate);
+    } else {
+      Serial.println("Usage: mesh_rate:<8000|16000>");
+    }
   } else if (command.startsWith("send_ping:")) {
     String text = command.substring(strlen("send_ping:"));
     if (text.length() == 0) {
@@ -1346,26 +3495,379 @@ void handleTestCommand(const String& command) {
       msgLen = headerLen;
       memcpy(msg + msgLen, text.c_str(), text.length());
       msgLen += text.length();
-      Serial.printf("📡 Sending PING '%s' (%d bytes) to %d mesh devices\n", text.c_str(), msgLen, meshDeviceCount);
-      for (int i = 0; i < meshDeviceCount; i++) {
-        if (meshDevices[i].isActive) {
-          esp_err_t res = esp_now_send(meshDevices[i].mac, (uint8_t*)msg, msgLen);
-          (void)res;
-        }
+      Serial.printf("📡 Sending PING '%s' (%d bytes) to %d mesh devices\n", text.c_str(), msgLen, meshPeers.count);
+      const FanoutSnapshot* fanout = fanoutAcquire(meshFanout);
+      for (int i = 0; i < fanout->count; i++) {
+        esp_err_t res = meshSend(fanout->peers[i].mac, (uint8_t*)msg, msgLen);
+        (void)res;
       }
+      fanoutRelease(meshFanout, fanout);
     } else {
       Serial.println("PING too large");
     }
   } else {
     Serial.printf("Unknown command: %s\n", command.c_str());
-    Serial.println("Available commands: buffer_status, test_compression, start_audio_stream, stop_audio_stream, send_audio_chunk:chunk_id:hex_data, clear_buffer");
+    Serial.println("Available commands: buffer_status, test_compression, start_audio_stream, stop_audio_stream, send_audio_chunk:chunk_id:hex_data, clear_buffer, meter_stats, meter_reset, bench_meter, bench_resampler, mesh_rate:<hz>, agc:<on|off>, agc_stats, bench_agc, bench_wm, send_beep, gen:<sine|sweep|pink|impulse|stop>[:...], gen_sink:<mesh|ble>, gen_level:<dBFS>, gen_stats, timers, timers_reset, log_stats, log_mode:<text|binary|off>, beacon_stats, mesh_forget, members, bench_members, fd_stats, channel_stats, channel:<n>, airtime_stats, airtime_reset, fanout_stats, bench_fanout, bench_peers, talk_groups, talk:<g>, group:<peer>:<mask>, bench_groups[:<B>], fanout_stress[:<s>], rx_stats, rx_reset, ble_in_stats, ble_in_reset, layouts, layout:<n>, layout_stats, bench_layout[:<s>], deadline_stats, deadline_reset, mem_map, bench_mem, pool_stats, pool_reset, alloc_stats, alloc_reset, alloc_check[:<s>], transcode:<group>:..., transcode_stats, bench_transcode");
+  }
+}
+
+// Mesh management that used to run in loop(), now placed by the task layout
+TaskHandle_t HousekeepingTaskHandle = NULL;
+
+// Housekeeping timers: beacons, election, heartbeats, cleanup, statistics.
+// HousekeepingTask sleeps until the next deadline instead of polling.
+
+static uint64_t wheelClockUs() {
+  return (uint64_t)esp_timer_get_time();
+}
+
+static void beaconTimer(void* arg) {
+  if (!meshNetworkActive || !isMeshCoordinator) return;
+  if (meshOffChannel) return;  // surveying: the next beacon is at most an interval late
+  sendMeshBeacon();
+  if (switchChannel) sendChannelSwitch();
+}
+
+// Ends survey dwells and applies announced moves to the millisecond tick;
+// starts one survey per CHAN_SURVEY_PERIOD_MS while this node leads
+static void channelTimer(void* arg) {
+  if (!meshNetworkActive) return;
+  uint32_t now = millis();
+  if (surveyPausedMs) {
+    if (__atomic_load_n(&meshTxInFlight, __ATOMIC_SEQ_CST) > 0 && now - surveyPausedMs < CHAN_DRAIN_MS) return;
+    tuneChannelSurvey();
+  } else if (surveyChannel && esp_timer_get_time() - surveyStartUs >= CHAN_DWELL_MS * 1000ULL) {
+    endChannelSurvey(now);
+  }
+  if (switchChannel && (int32_t)(now - switchAtMs) >= 0 && !surveyChannel && !standbyHomeChannel) {
+    applyChannelSwitch(now);
+  }
+  if ((int32_t)(now - nextSurveyMs) < 0) return;
+  nextSurveyMs = now + CHAN_SURVEY_PERIOD_MS;
+  if (!isMeshCoordinator) return;
+  rollChannelSecond(now);
+  if (!switchChannel && !surveyChannel) startChannelSurvey(now);
+}
+
+static void standbyListenOn(uint8_t channel, uint32_t now) {
+  esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+  meshChannel = channel;
+  standbyListenUntilMs = now + CHAN_STANDBY_LISTEN_MS;
+}
+
+// Standby whose leader's lease ran out, at boot included: the mesh may have
+// moved on an announcement we missed, and a claim here would split it. So
+// listen on every other candidate for CHAN_STANDBY_LISTEN_MS first. A
+// beacon heard there renews the lease and we stay; otherwise go back and
+// claim after the backoff. Returns true while the election must wait.
+static bool standbySearch(uint32_t leaseUntil, uint32_t now) {
+  if (!standbyHomeChannel) {
+    if ((int32_t)(now - leaseUntil) < 0 || leaseUntil == standbySearchedLease || switchChannel) return false;
+    int others = __builtin_popcount(MESH_CHANNEL_MASK) - (chanValid(MESH_CHANNEL_MASK, meshChannel) ? 1 : 0);
+    standbySearchedLease = leaseUntil;
+    if (others <= 0) return false;
+    standbyHomeChannel = meshChannel;
+    standbyChannelsLeft = (uint8_t)others;
+    standbySearchLease = leaseUntil;
+    standbySearches++;
+    standbyListenOn(chanNextScan(MESH_CHANNEL_MASK, meshChannel), now);
+    return true;
+  }
+  if (leaseUntil != standbySearchLease) {
+    standbyHomeChannel = 0;
+    standbyFoundElsewhere++;
+    meshStateDirty = true;
+    Serial.printf("📶 Found the leader on channel %u\n", meshChannel);
+    return false;
+  }
+  if ((int32_t)(now - standbyListenUntilMs) < 0) return true;
+  if (--standbyChannelsLeft > 0) {
+    standbyListenOn(chanNextScan(MESH_CHANNEL_MASK, meshChannel), now);
+    return true;
+  }
+  standbyListenOn(standbyHomeChannel, now);
+  standbyHomeChannel = 0;
+  portENTER_CRITICAL(&electionMux);
+  electionDeferClaim(election, now);
+  portEXIT_CRITICAL(&electionMux);
+  return false;
+}
+
+static void electionTimer(void* arg) {
+  if (!meshNetworkActive) return;
+  uint32_t now = millis();
+  portENTER_CRITICAL(&electionMux);
+  bool standby = election.role == ELECTION_STANDBY;
+  uint32_t leaseUntil = election.leaseUntilMs;
+  portEXIT_CRITICAL(&electionMux);
+  if (standby && standbySearch(leaseUntil, now)) return;
+  portENTER_CRITICAL(&electionMux);
+  ElectionEvent event = electionTick(election, now);
+  portEXIT_CRITICAL(&electionMux);
+  if (event == ELECTION_BECAME_LEADER) becomeMeshLeader();
+}
+
+// While audio flows, peers see us in every frame and get the membership
+// version in the WM extension, so heartbeats would only cost airtime. Audio
+// for one talk group misses the peers outside it, so it does not count.
+static bool meshAudioFlowing() {
+  uint32_t now = millis();
+  return airtimeIdleMs(AIRTIME_AUDIO, now) < MESH_HEARTBEAT_INTERVAL &&
+         now - lastFullFanoutMs < MESH_HEARTBEAT_INTERVAL;
+}
+
+static void heartbeatTimer(void* arg) {
+  if (!meshNetworkActive || !isMeshCoordinator) return;
+  if (meshAudioFlowing() || meshOffChannel) {  // a survey would drop it; peers time out after several
+    heartbeatsSuppressed++;
+    return;
+  }
+  sendMeshHeartbeat();
+}
+
+
+static void cleanupTimer(void* arg) {
+  if (!meshNetworkActive) return;
+  cleanupInactiveDevices();
+  updateMeshStatusLED();
+}
+
+static void statisticsTimer(void* arg) {
+  AllocScope scope(ALLOC_SUB_CONSOLE);
+  printStatistics();
+}
+
+// Save membership after a change; at most one NVS write per MESH_STATE_MIN_SAVE_MS
+static void meshStatePersistTimer(void* arg) {
+  static uint32_t lastSaveMs = 0;
+  uint32_t now = millis();
+  if (!meshStateDirty || !meshStateSaveDue(lastSaveMs, now)) return;
+  // During a standby search meshChannel is the channel being listened on,
+  // not the mesh's; leave the change pending until the search settles
+  if (!isMeshCoordinator && standbyHomeChannel) return;
+  meshStateDirty = false;
+  lastSaveMs = now;
+  if (!isMeshCoordinator) {
+    // A standby has no session worth resuming, only the mesh's channel
+    meshStateClear();
+    if (meshStateSaveChannel(meshChannel)) {
+      meshStateSaves++;
+    } else {
+      meshStateDirty = true;
+    }
+    return;
+  }
+  {
+    MeshTableLock lock;
+    meshStateScratch.channel = meshChannel;
+    meshStateScratch.epoch = meshEpoch;
+    meshStateScratch.peers = meshPeers;
+  }
+  if (meshStateSaveCoord(meshStateScratch)) {
+    meshStateSaves++;
+  } else {
+    meshStateDirty = true;
+  }
+}
+
+// Suspect peers whose phi crossed the threshold, probe the suspected ones
+// and republish the fan-out when the set of suspects changed. phi is
+// computed from a copy, outside peerHealthMux.
+static void peerHealthTimer(void* arg) {
+  if (!isMeshCoordinator) return;
+  uint32_t now = millis();
+  uint8_t probes[FD_MAX_PEERS][6];
+  int suspected = 0;
+  for (int i = 0; i < FD_MAX_PEERS; i++) {
+    FdPeer p;
+    portENTER_CRITICAL(&peerHealthMux);
+    bool candidate = fdCandidate(peerHealth, i, p);
+    portEXIT_CRITICAL(&peerHealthMux);
+    if (!candidate || fdPhi(p, now) < FD_PHI_SUSPECT) continue;
+    portENTER_CRITICAL(&peerHealthMux);
+    if (fdSuspect(peerHealth, i, p.lastMs, now)) suspected++;
+    portEXIT_CRITICAL(&peerHealthMux);
+  }
+  portENTER_CRITICAL(&peerHealthMux);
+  int probeCount = fdProbesDue(peerHealth, now, probes, FD_MAX_PEERS);
+  bool recovered = peerHealthRecovered;
+  peerHealthRecovered = false;
+  uint32_t detectMs = peerHealth.lastDetectMs;
+  uint32_t recoveries = peerHealth.recoveries;
+  portEXIT_CRITICAL(&peerHealthMux);
+
+  if (suspected) DLOG(MESH, WARN, PEER_SUSPECTED, suspected, detectMs);
+  if (recovered) DLOG(MESH, INFO, PEER_RECOVERED, recoveries);
+  if (suspected || recovered) {
+    MeshTableLock lock;
+    publishMeshFanout();
+  }
+  for (int i = 0; i < probeCount; i++) {
+    uint8_t frame[FD_PROBE_SIZE];
+    fdEncodeProbe(peerProbeSeq++, frame);
+    meshSend(probes[i], frame, sizeof(frame));
+  }
+}
+
+// A publish that found every spare snapshot pinned by a sender
+static void fanoutRetryTimer(void* arg) {
+  if (!meshFanoutDirty) return;
+  MeshTableLock lock;
+  publishMeshFanout();
+}
+
+#ifdef ALLOC_TRACK
+static void allocRateTimer(void* arg) {
+  allocTrackTick();
+}
+#endif
+
+static void setupHousekeepingTimers() {
+  timerWheelInit(housekeepingWheel, wheelClockUs);
+  timerWheelAdd(housekeepingWheel, "beacon", beaconTimer, NULL,
+                MESH_BEACON_INTERVAL_MS * 1000UL, MESH_BEACON_INTERVAL_MS * 1000UL);
+  timerWheelAdd(housekeepingWheel, "election", electionTimer, NULL,
+                MESH_ELECTION_TICK_MS * 1000UL, MESH_ELECTION_TICK_MS * 1000UL);
+  timerWheelAdd(housekeepingWheel, "heartbeat", heartbeatTimer, NULL,
+                MESH_HEARTBEAT_INTERVAL * 1000UL, MESH_HEARTBEAT_INTERVAL * 1000UL);
+  timerWheelAdd(housekeepingWheel, "cleanup", cleanupTimer, NULL, DEVICE_TIMEOUT * 1000UL, DEVICE_TIMEOUT * 1000UL);
+  timerWheelAdd(housekeepingWheel, "statistics", statisticsTimer, NULL, 10000000UL, 10000000UL);
+  timerWheelAdd(housekeepingWheel, "mesh_state", meshStatePersistTimer, NULL, 1000000UL, 1000000UL);
+  timerWheelAdd(housekeepingWheel, "fanout_retry", fanoutRetryTimer, NULL, 100000UL, 100000UL);
+  timerWheelAdd(housekeepingWheel, "channel", channelTimer, NULL, CHAN_TICK_MS * 1000UL, CHAN_TICK_MS * 1000UL);
+  timerWheelAdd(housekeepingWheel, "peer_health", peerHealthTimer, NULL,
+                FD_TICK_MS * 1000UL, FD_TICK_MS * 1000UL);
+#ifdef ALLOC_TRACK
+  timerWheelAdd(housekeepingWheel, "alloc_rate", allocRateTimer, NULL, 1000000UL, 1000000UL);
+#endif
+}
+
+void HousekeepingTask(void *pvParameters) {
+  allocTrackSetSubsystem(ALLOC_SUB_CONTROL);
+  for (;;) {
+    uint32_t start = taskStageNowUs();
+    uint32_t waitUs = timerWheelRunDue(housekeepingWheel);
+    taskStageAddBusy(TASK_STAGE_HOUSEKEEPING, start);
+    uint32_t dueUs = taskStageNowUs() + waitUs;
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS((waitUs + 999) / 1000));
+    if ((int32_t)(taskStageNowUs() - dueUs) >= 0) taskStageRecordLatency(TASK_STAGE_HOUSEKEEPING, dueUs);
+  }
+}
+
+// Layout benchmark: reset the stage counters, inject mesh control traffic at
+// 50 packets/s through the RX pool and MeshDispatchTask for the window, then
+// report and save. The packets go to handleLayoutBenchPacket, never to
+// handleMeshMessage, so a live node keeps its peers and counters.
+void layoutBenchTask(void *pvParameters) {
+  static const char kPacket[] = "{\"type\":\"layout_bench\"}";
+  static const uint8_t kBenchMac[6] = { 0x02, 0, 0, 0, 0, 0xBE };  // locally administered
+  layoutBenchPackets = 0;
+  uint32_t windowUs = layoutBenchSeconds * 1000000UL;
+  Serial.printf("⏱️ Layout bench: %lu s on layout %d (%s)\n", (unsigned long)layoutBenchSeconds,
+                taskLayoutActiveIndex(), taskLayoutActive().name);
+  taskStageReset();
+  uint32_t startUs = taskStageNowUs();
+  TickType_t xLastWakeTime = xTaskGetTickCount();
+  while (taskStageNowUs() - startUs < windowUs) {
+    meshRxEnqueue(kBenchMac, (const uint8_t*)kPacket, sizeof(kPacket) - 1, true);
+    vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(20));
+  }
+  taskLayoutPrintStats(taskStageNowUs() - startUs, true);
+  Serial.printf("  bench packets dispatched: %lu\n", (unsigned long)layoutBenchPackets);
+  layoutBenchSeconds = 0;
+  vTaskDelete(NULL);
+}
+
+// Allocation check: simulate a phone stream (a 20 ms narrowband WM frame,
+// cut in two like BLE writes) through WM reassembly, group routing and the
+// fan-out snapshot, plus one mesh heartbeat a second through the real RX
+// path. The stream has its own reassembly buffer and stops short of
+// meshSend, so it never reaches the air or mixes with Phone A's frames.
+// Counters are reset after a one second warm-up; any allocation in a steady
+// subsystem during the window fails.
+#define ALLOC_CHECK_STREAM_ID 255
+#define ALLOC_CHECK_SAMPLES   160  // 20 ms at 8 kHz
+
+// sendWmToMesh up to the send: pin the snapshot, pick the group's peers and
+// add the membership extension, then count the sends instead of making them
+static void allocCheckRoute(const uint8_t* frame, int len, void* ctx) {
+  WmHeader header;
+  if (wmParseHeader(frame, len, header) <= 0) return;
+  uint8_t group = (header.flags & WM_FLAG_GROUP) ? header.group : phoneTalkGroup;
+  if (group >= MAX_TALK_GROUPS) return;
+  const FanoutSnapshot* fanout = fanoutAcquire(meshFanout);
+  uint8_t withMembers[ESP_NOW_MAX_DATA_LEN];
+  uint8_t targets = fanout->groups[group];
+  if (targets) wmAddMembership(frame, len, fanout->count, memberLogVersion8(), withMembers, sizeof(withMembers));
+  *(uint32_t*)ctx += __builtin_popcount(targets);
+  fanoutRelease(meshFanout, fanout);
+}
+
+void allocCheckTask(void *pvParameters) {
+  static const char kHeartbeat[] = "{\"type\":\"mesh_heartbeat\",\"source\":\"alloc_check\"}";
+  static const uint8_t kCheckMac[6] = { 0x02, 0, 0, 0, 0, 0xAC };  // locally administered
+  static uint8_t rxBuffer[2 * (WM_HEADER_V2_SIZE + ALLOC_CHECK_SAMPLES)];
+  WmReassembler rx;
+  wmReassemblerInit(rx, rxBuffer, sizeof(rxBuffer));
+  uint32_t sends = 0;
+  uint8_t frame[WM_HEADER_V2_SIZE + ALLOC_CHECK_SAMPLES];
+  memset(frame + WM_HEADER_V2_SIZE, 0xFF, ALLOC_CHECK_SAMPLES);  // u-law silence
+  WmHeader header;
+  header.type = WM_TYPE_ULAW_NB;
+  header.streamId = ALLOC_CHECK_STREAM_ID;
+  header.payloadLen = ALLOC_CHECK_SAMPLES;
+
+  uint32_t windowUs = allocCheckSeconds * 1000000UL;
+  Serial.printf("🧮 Alloc check: %lu s simulated stream, %d mesh peers\n",
+                (unsigned long)allocCheckSeconds, fanoutCount(meshFanout));
+  uint32_t frames = 0;
+  uint32_t warmupUs = taskStageNowUs();
+  uint32_t startUs = 0;
+  bool measuring = false;
+  TickType_t xLastWakeTime = xTaskGetTickCount();
+  for (;;) {
+    uint32_t now = taskStageNowUs();
+    if (!measuring && now - warmupUs >= 1000000UL) {
+      allocTrackReset();
+      startUs = now;
+      measuring = true;
+    }
+    if (measuring && now - startUs >= windowUs) break;
+    header.flags = frames == 0 ? WM_FLAG_MARKER : 0;
+    header.sequence = frames;
+    header.timestamp = frames * ALLOC_CHECK_SAMPLES * (WM_TIMESTAMP_HZ / 8000);
+    wmWriteHeaderV2(frame, header);
+    {
+      AllocScope ble(ALLOC_SUB_BLE);  // charged like BleIngestTask
+      int split = 1 + frames % (sizeof(frame) - 1);
+      wmReassemblerFeed(rx, frame, split, kWmMaxFrameBytes, allocCheckRoute, &sends);
+      wmReassemblerFeed(rx, frame + split, sizeof(frame) - split, kWmMaxFrameBytes, allocCheckRoute, &sends);
+    }
+    if (frames % 50 == 0) OnDataRecv(kCheckMac, (const uint8_t*)kHeartbeat, sizeof(kHeartbeat) - 1);
+    frames++;
+    vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(20));
   }
+
+  uint32_t steady = allocTrackSteadyCount();
+  allocTrackPrintStats();
+  Serial.printf("%s Alloc check: %lu allocations in audio/mesh/ble/control over %lu s (%lu frames, %lu sends skipped)\n",
+                steady ? "❌ FAIL" : "✅ PASS", (unsigned long)steady,
+                (unsigned long)allocCheckSeconds, (unsigned long)frames, (unsigned long)sends);
+  allocCheckSeconds = 0;
+  vTaskDelete(NULL);
 }
 
 void setup() {
   // Initialize serial communication
   Serial.begin(115200);
   Serial.println("\n\n=== ESP32-S3 BLE AUDIO SERVER STARTING ===");
+  dlogInit();
+
+  // Place large buffers before any callback can touch them
+  bleInQueue = (IncomingBleItem*)memPlaceAlloc(MEM_BULK, bufferPoolBytes(BUF_POOL_BLE_IN_QUEUE), "bleInQueue");
+  memPlaceRegister(MEM_FAST, wmRxBuffer, sizeof(wmRxBuffer), "wmRxBuffer");
+  memPlaceRegister(MEM_FAST, meshRxPool, sizeof(meshRxPool), "meshRxPool");
+  memPlaceRegister(MEM_FAST, transcodeQueue, sizeof(transcodeQueue), "transcodeQueue");
   
   // Initialize Neopixel LED
   pixels.begin();
@@ -1376,8 +3878,38 @@ void setup() {
   pinMode(CONNECTION_LED_PIN, OUTPUT);
   digitalWrite(CONNECTION_LED_PIN, LOW);
   
+  // Level meters
+  audioMeterInit(meterMeshOut, "mesh_out");
+  audioMeterInit(meterGenerator, "generator");
+  
+  // Mesh AGC / noise gate
+  AgcConfig agcConfig;
+  agcDefaultConfig(agcConfig);
+  agcInit(meshAgc, agcConfig);
+  
+  // Transcode profiles (all off until set per group)
+  for (int g = 0; g < MAX_TALK_GROUPS; g++) {
+    transcodeDefaultProfile(transcodeProfiles[g]);
+  }
+  
+  // Mesh table lock and the empty fan-out set, before any task can touch them
+  meshTableMutex = xSemaphoreCreateRecursiveMutex();
+  fanoutInit(meshFanout);
+  
+  // Core, priority and stack of every stage come from the task layout table
+  taskLayoutLoad();
+  Serial.printf("Task layout %d (%s)\n", taskLayoutActiveIndex(), taskLayoutActive().name);
+  
+  // Low-priority drain for DLOG() records from the hot paths
+  taskLayoutSpawn(TASK_STAGE_LOG, dlogDrainTask, "LogDrain", NULL);
+  
+  // Mesh dispatch must exist before the RX callback is registered
+  taskLayoutSpawn(TASK_STAGE_INGEST, MeshDispatchTask, "MeshDispatch", &MeshDispatchTaskHandle);
+  taskLayoutSpawn(TASK_STAGE_BLE_INGEST, BleIngestTask, "BleIngest", &BleIngestTaskHandle);
+  
   // Initialize ESP-NOW Mesh
   setupESPNOWMesh();
+  bleServing = !meshNetworkActive;  // else from the first election win
   
   // Initialize BLE
   Serial.println("Initializing BLE...");
@@ -1428,7 +3960,11 @@ void setup() {
   pAdvertising->setScanResponseData(scanData);
   
   pAdvertising->setMinPreferred(0x0);  // keep minimal preferred params
-  BLEDevice::startAdvertising();
+  if (bleServing) {
+    BLEDevice::startAdvertising();
+  } else {
+    Serial.println("BLE advertising starts once this node leads the mesh");
+  }
   
   Serial.println("=== BLE SERVER READY ===");
   Serial.printf("Device name: %s\n", DEVICE_NAME);
@@ -1440,33 +3976,33 @@ void setup() {
   blinkStatusLED(0, 255, 255, 3); // Cyan blink when ready
 
   // Create the dedicated audio sender task
-  xTaskCreatePinnedToCore(
-      AudioSenderTask,          /* Task function. */
-      "AudioSender",            /* name of task. */
-      4096,                     /* Stack size of task */
-      NULL,                     /* parameter of the task */
-      1,                        /* priority of the task */
-      &AudioSenderTaskHandle,   /* Task handle to keep track of created task */
-      1);                       /* pin task to core 1 */
+  senderDeadline = deadlineRegister("AudioSender", AUDIO_SENDER_PERIOD_MS * 1000);
+  loopDeadline = deadlineRegister("loop", LOOP_PERIOD_MS * 1000);
+  taskLayoutSpawn(TASK_STAGE_SEND, AudioSenderTask, "AudioSender", &AudioSenderTaskHandle);
+
+  // Opus transcode stage (idle until a group profile is enabled; libopus needs a deep stack)
+  taskLayoutSpawn(TASK_STAGE_TRANSCODE, TranscodeTask, "Transcode", &TranscodeTaskHandle);
+
+  // Heartbeats, device cleanup and statistics
+  setupHousekeepingTimers();
+  taskLayoutSpawn(TASK_STAGE_HOUSEKEEPING, HousekeepingTask, "Housekeeping", &HousekeepingTaskHandle);
 
+  // Test-signal generator (idle until gen:/send_beep/BEEP)
+  taskLayoutSpawn(TASK_STAGE_GENERATOR, GeneratorTask, "Generator", &GeneratorTaskHandle);
+
+  memPlacePrintMap();
 }
 
 void loop() {
+  deadlineBegin(loopDeadline);
   // Handle BLE connection state changes
-  if (pendingBeep) { pendingBeep = false; sendBeepOnce(); }
-  // Drain BLE incoming queue
-  {
-    IncomingBleItem item;
-    int processed = 0;
-    while (processed < 8 && bleInPop(item)) {
-      addAudioData(item.data, item.length);
-      processed++;
-    }
-  }
+  // BLE writes are drained by BleIngestTask
   if (!deviceConnected && oldDeviceConnected) {
     delay(500); // give the bluetooth stack the chance to get things ready
-    pServer->startAdvertising(); // restart advertising
-    Serial.println("Restart advertising");
+    if (bleServing) {
+      pServer->startAdvertising(); // restart advertising
+      Serial.println("Restart advertising");
+    }
     oldDeviceConnected = deviceConnected;
   }
   
@@ -1476,7 +4012,7 @@ void loop() {
   
   // Handle BLE connections
   if (deviceConnected) {
-    // Audio processing now handled by addAudioData() → sendAudioChunks() flow
+    // Audio is handled by BleIngestTask → ingestBleWmFrames() → forwardWmToMesh()
     // No need to process audioBuffer here anymore
   }
   
@@ -1491,43 +4027,9 @@ void loop() {
     }
   }
   
-  // Audio streaming management is now handled by the dedicated AudioSenderTask
-  // if (isAudioStreaming) {
-  //   sendAudioChunks();
-  // }
-  
-  // Mesh network management
-  if (meshNetworkActive) {
-    // Send heartbeat to all mesh devices
-    static unsigned long lastHeartbeat = 0;
-    if (millis() - lastHeartbeat >= MESH_HEARTBEAT_INTERVAL) {
-      sendMeshHeartbeat();
-      lastHeartbeat = millis();
-    }
-    
-    // Broadcast mesh status
-    static unsigned long lastStatusBroadcast = 0;
-    if (millis() - lastStatusBroadcast >= MESH_BROADCAST_INTERVAL) {
-      broadcastMeshStatus();
-      lastStatusBroadcast = millis();
-    }
-    
-    // Cleanup inactive devices and update LED
-    static unsigned long lastCleanup = 0;
-    if (millis() - lastCleanup >= DEVICE_TIMEOUT) {
-      cleanupInactiveDevices();
-      updateMeshStatusLED();
-      lastCleanup = millis();
-    }
-  }
-  
-  // Print statistics periodically
-  static unsigned long lastStats = 0;
-  if (millis() - lastStats >= 10000) {  // Every 10 seconds
-    printStatistics();
-    lastStats = millis();
-  }
+  // Audio streaming is handled by AudioSenderTask, mesh management by HousekeepingTask
   
   // Small delay to prevent watchdog issues
-  delay(10);
+  deadlineEnd(loopDeadline);
+  delay(LOOP_PERIOD_MS);
 }
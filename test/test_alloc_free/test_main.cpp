@@ -0,0 +1,282 @@
+/*
+ * Host allocation check over the portable stream path: ten simulated
+ * minutes of a phone stream through every lib/ stage a frame meets between
+ * Phone A and Phone B, with malloc/calloc/realloc wrapped by lib/AllocTrack
+ * (the alloc_track env's -Wl,--wrap flags) and operator new routed through
+ * malloc. Any allocation charged to the stream fails the test.
+ *
+ *   phone:       SignalGen -> u-law -> WM v2 frame -> cut into BLE writes
+ *   coordinator: WmReassembler -> talk group -> FanoutSet -> membership
+ *                extension -> airtime accounting -> DLOG on a failed send
+ *   client:      WM parse -> sequence -> u-law decode -> AudioMeter ->
+ *                Resampler 8 -> 16 kHz -> AutoGain
+ *   housekeeping: TimerWheel on a virtual clock republishing the fan-out
+ *                every 10 s and draining the log every second
+ *
+ * pio test -e native_alloc
+ */
+
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+#include "AllocTrack.h"
+#include "AudioMeter.h"
+#include "AutoGain.h"
+#include "DeferredLog.h"
+#include "FanoutSet.h"
+#include "G711.h"
+#include "MeshAirtime.h"
+#include "Resampler.h"
+#include "SignalGen.h"
+#include "TalkGroup.h"
+#include "TimerWheel.h"
+#include "WmFrame.h"
+
+#if !ALLOC_TRACK_ENABLED
+#error "build with -DALLOC_TRACK and -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc (env:native_alloc)"
+#endif
+
+// operator new goes through the wrapped malloc, as it does on the ESP32
+void* operator new(size_t size) {
+  void* p = malloc(size ? size : 1);
+  if (!p) abort();
+  return p;
+}
+void* operator new[](size_t size) {
+  void* p = malloc(size ? size : 1);
+  if (!p) abort();
+  return p;
+}
+// Out of line, or GCC sees free() meeting a new-expression and warns
+__attribute__((noinline)) void operator delete(void* p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete[](void* p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept { free(p); }
+__attribute__((noinline)) void operator delete[](void* p, size_t) noexcept { free(p); }
+
+#define STREAM_SECONDS 600
+#define FRAME_MS       20
+#define FRAME_SAMPLES  160   // 20 ms at 8 kHz
+#define BLE_WRITE_MAX  100   // bytes per simulated BLE write
+#define PEERS          3
+
+static uint64_t virtualUs;
+static uint64_t virtualClock() { return virtualUs; }
+
+// Coordinator
+static uint8_t wmRxBuffer[2048];
+static WmReassembler phoneRx;
+static FanoutSet fanout;
+static TimerWheel housekeeping;
+static uint8_t phoneTalkGroup;
+static uint8_t membersVersion;
+static uint32_t membershipDueFrames;
+
+// "Air" between coordinator and one client
+static uint8_t air[256];
+static int airLen;
+
+// Client
+static Resampler upsampler;
+static Agc agc;
+static AudioMeter meter;
+static uint32_t highestSequence;
+static bool haveSequence;
+
+// Counters for the final checks
+static uint32_t framesSent, framesReceived, sendsFailed, logRecords, republishes;
+
+static void publishPeers(uint32_t generation) {
+  FanoutSnapshot* snap = fanoutBeginWrite(fanout);
+  if (!snap) return;  // pinned: the next tick tries again
+  snap->count = PEERS - (generation & 1);  // a peer leaves and joins
+  for (int i = 0; i < snap->count; i++) {
+    memset(snap->peers[i].mac, 0x10 + i, 6);
+    snap->peers[i].mac[0] = 0x02;
+    memcpy(snap->peers[i].name, "peer", 5);
+    snap->groups[0] |= (uint8_t)(1u << i);
+  }
+  fanoutPublish(fanout);
+  membersVersion++;
+  membershipDueFrames = 0;  // announce the change on the next frame
+}
+
+static void republishTimer(void* arg) {
+  publishPeers(++republishes);
+}
+
+static void drainLogTimer(void* arg) {
+  DlogRecord rec;
+  char line[128];
+  while (dlogRead(rec)) {
+    dlogFormat(rec, line, sizeof(line));
+    logRecords++;
+  }
+  allocTrackTick();
+}
+
+static void clientReceive(const uint8_t* frame, int len) {
+  WmHeader h;
+  if (wmParseHeader(frame, len, h) <= 0 || h.headerLen + h.payloadLen > len) return;
+  TEST_ASSERT_EQUAL(WM_TYPE_ULAW_NB, h.type);
+  uint32_t sequence = h.version == 1 && haveSequence ? wmExtendSequence(highestSequence, (uint16_t)h.sequence)
+                                                     : h.sequence;
+  if (!haveSequence || sequence > highestSequence) highestSequence = sequence;
+  haveSequence = true;
+
+  int16_t pcm[FRAME_SAMPLES];
+  int16_t up[2 * FRAME_SAMPLES + 8];
+  const uint8_t* payload = frame + h.headerLen;
+  for (int i = 0; i < h.payloadLen && i < FRAME_SAMPLES; i++) pcm[i] = g711UlawToLinear(payload[i]);
+  audioMeterUpdatePcm16(meter, pcm, FRAME_SAMPLES);
+  int n = resamplerProcess(upsampler, pcm, FRAME_SAMPLES, up, resamplerMaxOutput(upsampler, FRAME_SAMPLES));
+  agcProcess(agc, up, n);
+  framesReceived++;
+}
+
+// Coordinator's forwardWmToMesh/sendWmToMesh with the radio replaced by the
+// air buffer; peer 1 "fails" every 100th send
+static void coordinatorForward(const uint8_t* frame, int len, void* ctx) {
+  WmHeader h;
+  if (wmParseHeader(frame, len, h) <= 0 || h.headerLen + h.payloadLen > len) return;
+  uint8_t op, value;
+  if (tgPhoneParse(frame, h, op, value)) return;
+  uint8_t group = (h.flags & WM_FLAG_GROUP) ? h.group : phoneTalkGroup;
+  if (group >= MAX_TALK_GROUPS) return;
+
+  const FanoutSnapshot* snap = fanoutAcquire(fanout);
+  uint8_t withMembers[250];
+  uint8_t targets = snap->groups[group];
+  if (targets && membershipDueFrames-- == 0) {
+    int extended = wmAddMembership(frame, len, snap->count, membersVersion, withMembers, sizeof(withMembers));
+    if (extended > 0) {
+      frame = withMembers;
+      len = extended;
+      membershipDueFrames = 1000 / FRAME_MS;  // about once a second
+    }
+  }
+  uint32_t nowMs = (uint32_t)(virtualUs / 1000);
+  for (uint32_t bits = targets; bits; bits &= bits - 1) {
+    int i = __builtin_ctz(bits);
+    if (i == 1 && framesSent % 100 == 0) {
+      sendsFailed++;
+      DLOG(MESH, WARN, WM_SEND_FAILED, i, (uint32_t)(snap->peers[i].mac[4] << 8 | snap->peers[i].mac[5]), 0x3066);
+      continue;
+    }
+    airtimeNoteSend(snap->peers[i].mac, frame, len, nowMs);
+    if (i == 0) {
+      memcpy(air, frame, len);
+      airLen = len;
+    }
+  }
+  fanoutRelease(fanout, snap);
+  framesSent++;
+}
+
+void setUp() {
+  virtualUs = 1000000;
+  dlogInit();
+  airtimeReset();
+  fanoutInit(fanout);
+  wmReassemblerInit(phoneRx, wmRxBuffer, sizeof(wmRxBuffer));
+  timerWheelInit(housekeeping, virtualClock);
+  resamplerInit(upsampler, 8000, 16000);
+  AgcConfig cfg;
+  agcDefaultConfig(cfg);
+  agcInit(agc, cfg);
+  audioMeterInit(meter, "phone b");
+  phoneTalkGroup = 0;
+  membersVersion = 0;
+  haveSequence = false;
+  framesSent = framesReceived = sendsFailed = logRecords = republishes = 0;
+}
+
+void tearDown() {
+  allocTrackSetSubsystem(ALLOC_SUB_OTHER);
+}
+
+// The wraps are live: without them the stream test would pass vacuously
+static void test_hooks_count_allocations() {
+  allocTrackSetSubsystem(ALLOC_SUB_AUDIO);
+  allocTrackReset();
+  void* p = malloc(32);
+  int* q = new int[4];
+  p = realloc(p, 64);
+  allocTrackSetSubsystem(ALLOC_SUB_CONSOLE);
+  delete[] q;
+  free(p);
+  TEST_ASSERT_EQUAL(3, allocCounters[ALLOC_SUB_AUDIO].count);
+  TEST_ASSERT_EQUAL(3, allocTrackSteadyCount());
+}
+
+static void test_ten_minute_stream_does_not_allocate() {
+  publishPeers(0);
+  timerWheelAdd(housekeeping, "republish", republishTimer, nullptr, 10000000, 10000000);
+  timerWheelAdd(housekeeping, "drainLog", drainLogTimer, nullptr, 1000000, 1000000);
+
+  SigGenConfig genCfg;
+  sigGenDefaultConfig(genCfg);
+  genCfg.type = SIGGEN_SWEEP;
+  static SigGen gen;
+  TEST_ASSERT_TRUE(sigGenInit(gen, genCfg, 8000));
+
+  // Everything from here on is the stream; counters start clean
+  allocTrackSetSubsystem(ALLOC_SUB_AUDIO);
+  allocTrackReset();
+
+  const uint32_t frames = STREAM_SECONDS * 1000 / FRAME_MS;
+  uint8_t frame[WM_HEADER_V2_MAX_SIZE + FRAME_SAMPLES];
+  int16_t pcm[FRAME_SAMPLES];
+  WmHeader header;
+  memset(&header, 0, sizeof(header));
+  header.type = WM_TYPE_ULAW_NB;
+  header.streamId = 7;
+  header.payloadLen = FRAME_SAMPLES;
+  srand(3);
+  for (uint32_t f = 0; f < frames; f++) {
+    // Phone A
+    sigGenRender(gen, pcm, FRAME_SAMPLES);
+    header.flags = (f == 0 ? WM_FLAG_MARKER : 0) | (f % 2 ? WM_FLAG_GROUP : 0);
+    header.group = 0;
+    header.sequence = f;
+    header.timestamp = f * FRAME_SAMPLES * (WM_TIMESTAMP_HZ / 8000);
+    int len = wmWriteHeaderV2(frame, header);
+    for (int i = 0; i < FRAME_SAMPLES; i++) frame[len + i] = g711LinearToUlaw(pcm[i]);
+    len += FRAME_SAMPLES;
+
+    // BLE writes cut the frame anywhere
+    airLen = 0;
+    for (int offset = 0; offset < len;) {
+      int chunk = 1 + rand() % BLE_WRITE_MAX;
+      if (chunk > len - offset) chunk = len - offset;
+      wmReassemblerFeed(phoneRx, frame + offset, chunk, 4000, coordinatorForward, nullptr);
+      offset += chunk;
+    }
+    if (airLen > 0) clientReceive(air, airLen);
+
+    virtualUs += FRAME_MS * 1000;
+    timerWheelRunDue(housekeeping);
+  }
+  drainLogTimer(nullptr);
+
+  uint32_t steady = allocTrackSteadyCount();
+  allocTrackSetSubsystem(ALLOC_SUB_OTHER);
+  printf("  %lu frames sent, %lu received, %lu failed sends logged, %lu fan-out republishes\n",
+         (unsigned long)framesSent, (unsigned long)framesReceived, (unsigned long)sendsFailed,
+         (unsigned long)republishes);
+  TEST_ASSERT_EQUAL(frames, framesSent);
+  TEST_ASSERT_EQUAL(frames, framesReceived);
+  TEST_ASSERT_EQUAL(frames - 1, highestSequence);
+  TEST_ASSERT_EQUAL(sendsFailed, logRecords);
+  TEST_ASSERT_GREATER_THAN(50, republishes);
+  TEST_ASSERT_GREATER_THAN(0, meter.blocks);
+  TEST_ASSERT_EQUAL_MESSAGE(0, steady, "allocations on the stream path");
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_hooks_count_allocations);
+  RUN_TEST(test_ten_minute_stream_does_not_allocate);
+  return UNITY_END();
+}
@@ -0,0 +1,155 @@
+/*
+ * Host harness over agcProcess: settle time after level steps, gate hold
+ * and hysteresis, and that the gain never leaves its configured bounds.
+ * 300 Hz tones in 10 ms blocks at 16 kHz, as the console bench_agc.
+ * pio test -e native -f test_auto_gain
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unity.h>
+
+#include "AudioMeter.h"
+#include "AutoGain.h"
+
+#define SAMPLE_RATE   16000
+#define BLOCK_SAMPLES (SAMPLE_RATE / 100)  // 10 ms
+
+static Agc agc;
+static AgcConfig cfg;
+static int16_t block[BLOCK_SAMPLES];
+static long sampleIndex;
+
+// Next 10 ms of a 300 Hz tone at dbfs RMS, run through the AGC; returns the
+// output block RMS
+static uint16_t feedTone(float dbfs) {
+  double amp = 32767.0 * pow(10.0, dbfs / 20.0) * M_SQRT2;  // RMS -> peak
+  if (amp > 32767.0) amp = 32767.0;
+  for (int i = 0; i < BLOCK_SAMPLES; i++, sampleIndex++) {
+    block[i] = (int16_t)lround(amp * sin(2.0 * M_PI * 300.0 * (double)sampleIndex / SAMPLE_RATE));
+  }
+  agcProcess(agc, block, BLOCK_SAMPLES);
+  AudioMeterBlock level;
+  audioMeterMeasurePcm16(block, BLOCK_SAMPLES, level);
+  return audioMeterRms(level, BLOCK_SAMPLES);
+}
+
+static bool nearTarget(uint16_t rms) {  // within 1 dB
+  return rms > (cfg.targetRms * 891UL) / 1000 && rms < (cfg.targetRms * 1122UL) / 1000;
+}
+
+// Blocks until the output stays within 1 dB of target for the rest of the
+// step; -1 if it never settles
+static int settleBlocks(float dbfs, int blocks) {
+  int settled = -1;
+  for (int b = 0; b < blocks; b++) {
+    bool within = nearTarget(feedTone(dbfs));
+    if (within && settled < 0) settled = b;
+    if (!within) settled = -1;
+  }
+  return settled;
+}
+
+void setUp() {
+  agcDefaultConfig(cfg);
+  agcInit(agc, cfg);
+  sampleIndex = 0;
+}
+
+void tearDown() {}
+
+// Release (gain rising) is the slow direction: ~5% of the error per block,
+// about 400 ms from unity to +12 dB
+static void test_settles_after_quiet_step() {
+  int blocks = settleBlocks(-30.0f, 200);
+  printf("  -30 dBFS from unity: settled after %d ms\n", blocks * 10);
+  TEST_ASSERT_TRUE(blocks >= 0);
+  TEST_ASSERT_LESS_OR_EQUAL(50, blocks);
+}
+
+// Attack halves the error every block, so a loud step settles within 100 ms
+static void test_settles_after_loud_step() {
+  settleBlocks(-30.0f, 200);
+  int blocks = settleBlocks(-6.0f, 100);
+  printf("  -30 -> -6 dBFS: settled after %d ms\n", blocks * 10);
+  TEST_ASSERT_TRUE(blocks >= 0);
+  TEST_ASSERT_LESS_OR_EQUAL(10, blocks);
+}
+
+// Below gateCloseRms the gate holds for gateHoldBlocks, then drops to the floor
+static void test_gate_holds_then_closes() {
+  settleBlocks(-20.0f, 100);
+  TEST_ASSERT_TRUE(agc.gateOpen);
+  uint32_t gatedBefore = agc.gatedBlocks;
+  for (int b = 1; b < cfg.gateHoldBlocks; b++) {
+    feedTone(-60.0f);
+    TEST_ASSERT_TRUE_MESSAGE(agc.gateOpen, "closed before the hold ran out");
+  }
+  feedTone(-60.0f);
+  TEST_ASSERT_FALSE(agc.gateOpen);
+  TEST_ASSERT_EQUAL(cfg.gateFloorQ12, agc.lastOutGainQ12);
+  TEST_ASSERT_EQUAL(gatedBefore + 1, agc.gatedBlocks);
+}
+
+// Between the close and open thresholds a closed gate stays closed and an
+// open one stays open
+static void test_gate_hysteresis() {
+  const float between = 20.0f * log10f(((cfg.gateOpenRms + cfg.gateCloseRms) / 2) / 32767.0f);
+  for (int b = 0; b < 50; b++) feedTone(between);
+  TEST_ASSERT_FALSE_MESSAGE(agc.gateOpen, "opened below gateOpenRms");
+  TEST_ASSERT_EQUAL(50, agc.gatedBlocks);
+
+  feedTone(-30.0f);
+  TEST_ASSERT_TRUE(agc.gateOpen);
+  for (int b = 0; b < 3 * cfg.gateHoldBlocks; b++) feedTone(between);
+  TEST_ASSERT_TRUE_MESSAGE(agc.gateOpen, "closed above gateCloseRms");
+}
+
+// Once the gate has closed the AGC gain is frozen, so background noise is
+// never boosted; the hold blocks still adapt since the gate is open then
+static void test_gate_freezes_agc_gain() {
+  settleBlocks(-20.0f, 100);
+  for (int b = 0; b < cfg.gateHoldBlocks; b++) feedTone(-70.0f);
+  TEST_ASSERT_FALSE(agc.gateOpen);
+  int32_t gain = agc.agcGainQ12;
+  for (int b = 0; b < 100; b++) feedTone(-70.0f);
+  TEST_ASSERT_EQUAL(gain, agc.agcGainQ12);
+  TEST_ASSERT_EQUAL(cfg.gateFloorQ12, agc.lastOutGainQ12);
+}
+
+// Random level steps including silence, full scale and levels just above
+// the gate: the AGC gain stays in [minGainQ12, maxGainQ12] and the applied
+// gain is either that or the gate floor
+static void test_gain_within_bounds() {
+  srand(1);
+  bool sawMax = false;
+  for (int step = 0; step < 400; step++) {
+    float dbfs = -75.0f + (float)(rand() % 7600) / 100.0f;  // -75 .. +1 dBFS
+    int blocks = 1 + rand() % 60;
+    for (int b = 0; b < blocks; b++) {
+      feedTone(dbfs);
+      TEST_ASSERT_TRUE(agc.agcGainQ12 >= cfg.minGainQ12 && agc.agcGainQ12 <= cfg.maxGainQ12);
+      uint16_t applied = agc.lastOutGainQ12;
+      TEST_ASSERT_TRUE(applied == cfg.gateFloorQ12 || (applied >= cfg.minGainQ12 && applied <= cfg.maxGainQ12));
+      if (agc.agcGainQ12 > cfg.maxGainQ12 * 95 / 100) sawMax = true;
+    }
+  }
+  TEST_ASSERT_TRUE(sawMax);
+  // Quiet speech just above the gate pins the boost limit
+  for (int b = 0; b < 300; b++) feedTone(-44.0f);
+  TEST_ASSERT_TRUE(agc.gateOpen);
+  TEST_ASSERT_LESS_OR_EQUAL(cfg.maxGainQ12, agc.agcGainQ12);
+  TEST_ASSERT_GREATER_OR_EQUAL(cfg.maxGainQ12 * 95 / 100, agc.agcGainQ12);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_settles_after_quiet_step);
+  RUN_TEST(test_settles_after_loud_step);
+  RUN_TEST(test_gate_holds_then_closes);
+  RUN_TEST(test_gate_hysteresis);
+  RUN_TEST(test_gate_freezes_agc_gain);
+  RUN_TEST(test_gain_within_bounds);
+  return UNITY_END();
+}
@@ -0,0 +1,121 @@
+/*
+ * Host stress test for lib/FanoutSet under ThreadSanitizer: one writer
+ * publishes as fast as it can while four readers check that every snapshot
+ * they pin is complete and never goes back in version. The host twin of
+ * the console fanout_stress, with TSan reporting any race on a snapshot a
+ * reader still holds. pio test -e native_tsan
+ */
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <unity.h>
+
+#include "FanoutSet.h"
+
+#define STRESS_READERS 4
+#define STRESS_MS      2000
+
+static FanoutSet set;
+static std::atomic<bool> running;
+static std::atomic<uint32_t> reads;
+static std::atomic<uint32_t> errors;
+
+static void fill(FanoutSnapshot* snap, uint32_t version) {
+  snap->count = version % (FANOUT_MAX_PEERS + 1);
+  for (int i = 0; i < snap->count; i++) {
+    memset(snap->peers[i].mac, (uint8_t)(version + i), 6);
+    snprintf(snap->peers[i].name, sizeof(snap->peers[i].name), "v%lu", (unsigned long)version);
+  }
+  for (int g = 0; g < FANOUT_MAX_GROUPS; g++) snap->groups[g] = (uint8_t)(version >> g);
+}
+
+static void writer() {
+  while (running.load(std::memory_order_relaxed)) {
+    FanoutSnapshot* snap = fanoutBeginWrite(set);
+    if (snap) {
+      fill(snap, set.version + 1);
+      fanoutPublish(set);
+    } else {
+      std::this_thread::yield();  // every spare buffer pinned, as fanoutRetryTimer waits
+    }
+  }
+}
+
+static void reader() {
+  uint32_t last = 0;
+  char expected[FANOUT_NAME_LEN];
+  while (running.load(std::memory_order_relaxed)) {
+    const FanoutSnapshot* snap = fanoutAcquire(set);
+    uint32_t version = snap->version;
+    uint8_t mask = (uint8_t)((1u << snap->count) - 1);
+    bool ok = version >= last && snap->count == version % (FANOUT_MAX_PEERS + 1);
+    snprintf(expected, sizeof(expected), "v%lu", (unsigned long)version);
+    for (int i = 0; ok && i < snap->count; i++) {
+      for (int b = 0; b < 6; b++) ok = ok && snap->peers[i].mac[b] == (uint8_t)(version + i);
+      ok = ok && strcmp(snap->peers[i].name, expected) == 0;
+    }
+    for (int g = 0; ok && g < FANOUT_MAX_GROUPS; g++) ok = snap->groups[g] == ((uint8_t)(version >> g) & mask);
+    fanoutRelease(set, snap);
+    last = version;
+    if (!ok) errors.fetch_add(1, std::memory_order_relaxed);
+    reads.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void setUp() {
+  fanoutInit(set);
+  reads = 0;
+  errors = 0;
+}
+
+void tearDown() {}
+
+// A buffer a reader still holds is never handed to the writer
+static void test_pinned_snapshot_not_reclaimed() {
+  const FanoutSnapshot* pinned[FANOUT_BUFFERS];
+  for (int i = 0; i < FANOUT_BUFFERS - 1; i++) {
+    pinned[i] = fanoutAcquire(set);
+    FanoutSnapshot* snap = fanoutBeginWrite(set);
+    TEST_ASSERT_NOT_NULL(snap);
+    TEST_ASSERT_TRUE(snap != pinned[i]);
+    fill(snap, set.version + 1);
+    fanoutPublish(set);
+  }
+  // Current + three pinned older versions: nothing left to build in
+  pinned[FANOUT_BUFFERS - 1] = fanoutAcquire(set);
+  TEST_ASSERT_NULL(fanoutBeginWrite(set));
+  TEST_ASSERT_EQUAL(1, set.publishStalls);
+  TEST_ASSERT_EQUAL(FANOUT_BUFFERS - 1, fanoutPublish(set));  // nothing to publish
+
+  fanoutRelease(set, pinned[0]);
+  FanoutSnapshot* snap = fanoutBeginWrite(set);
+  TEST_ASSERT_TRUE(snap == pinned[0]);
+  for (int i = 1; i < FANOUT_BUFFERS; i++) fanoutRelease(set, pinned[i]);
+}
+
+static void test_one_writer_four_readers() {
+  running = true;
+  std::thread threads[STRESS_READERS + 1];
+  threads[0] = std::thread(writer);
+  for (int i = 1; i <= STRESS_READERS; i++) threads[i] = std::thread(reader);
+  std::this_thread::sleep_for(std::chrono::milliseconds(STRESS_MS));
+  running = false;
+  for (std::thread& t : threads) t.join();
+
+  printf("  %lu publishes, %lu reads, %lu stalls, %lu reader retries\n", (unsigned long)set.publishes,
+         (unsigned long)reads.load(), (unsigned long)set.publishStalls, (unsigned long)set.readerRetries);
+  TEST_ASSERT_EQUAL(0, errors.load());
+  TEST_ASSERT_GREATER_THAN(1000, set.publishes);
+  TEST_ASSERT_GREATER_THAN(1000, reads.load());
+  TEST_ASSERT_EQUAL(set.version, set.publishes);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_pinned_snapshot_not_reclaimed);
+  RUN_TEST(test_one_writer_four_readers);
+  return UNITY_END();
+}
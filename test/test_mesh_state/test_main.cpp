@@ -0,0 +1,250 @@
+/*
+ * Host test for lib/MeshState behind an in-memory NVS stand-in: client,
+ * coordinator and standby state survive a save/load round trip, and a
+ * blob or resync frame from another MESH_STATE_VERSION reads as nothing
+ * stored. pio test -e native -f test_mesh_state
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#include "MeshState.h"
+
+// NVS stand-in: a few key/blob slots with the Preferences rules MeshState
+// relies on (keys up to 15 characters, a blob read back only at its size)
+#define FAKE_NVS_SLOTS    8
+#define FAKE_NVS_KEY_MAX  15
+#define FAKE_NVS_BLOB_MAX (sizeof(MeshCoordState) + 64)
+
+struct FakeNvsSlot {
+  char key[FAKE_NVS_KEY_MAX + 1];
+  size_t len;
+  uint8_t blob[FAKE_NVS_BLOB_MAX];
+};
+
+static FakeNvsSlot nvs[FAKE_NVS_SLOTS];
+static uint32_t nvsWrites;
+
+static FakeNvsSlot* nvsFind(const char* key) {
+  for (FakeNvsSlot& slot : nvs) {
+    if (slot.key[0] && strcmp(slot.key, key) == 0) return &slot;
+  }
+  return nullptr;
+}
+
+static size_t fakeRead(const char* key, void* buf, size_t len) {
+  const FakeNvsSlot* slot = nvsFind(key);
+  if (!slot || slot->len != len) return 0;
+  memcpy(buf, slot->blob, len);
+  return len;
+}
+
+static bool fakeWrite(const char* key, const void* buf, size_t len) {
+  if (strlen(key) > FAKE_NVS_KEY_MAX || len > FAKE_NVS_BLOB_MAX) return false;
+  FakeNvsSlot* slot = nvsFind(key);
+  for (int i = 0; !slot && i < FAKE_NVS_SLOTS; i++) {
+    if (!nvs[i].key[0]) slot = &nvs[i];
+  }
+  if (!slot) return false;
+  strcpy(slot->key, key);
+  slot->len = len;
+  memcpy(slot->blob, buf, len);
+  nvsWrites++;
+  return true;
+}
+
+static void fakeErase(const char* key) {
+  FakeNvsSlot* slot = nvsFind(key);
+  if (slot) memset(slot, 0, sizeof(*slot));
+}
+
+static const MeshStateStore kFakeNvs = { fakeRead, fakeWrite, fakeErase };
+
+static int storedKeys() {
+  int n = 0;
+  for (const FakeNvsSlot& slot : nvs) n += slot.key[0] != 0;
+  return n;
+}
+
+// Key MeshState uses for a blob at another layout version
+static void keyFor(char* out, const char* base, int version) {
+  snprintf(out, FAKE_NVS_KEY_MAX + 1, "%s%d", base, version);
+}
+
+static void fillCoord(MeshCoordState& state) {
+  memset(&state, 0, sizeof(state));
+  state.channel = 6;
+  state.epoch = 0xA5C31234;
+  peerTableInit(state.peers);
+  static const uint8_t macs[3][6] = {
+    { 0x02, 1, 2, 3, 4, 5 }, { 0x02, 1, 2, 3, 4, 6 }, { 0x02, 1, 2, 3, 4, 7 }
+  };
+  peerTableAdd(state.peers, macs[0], "ESP32_B_Client", "client", 1000);
+  peerTableAdd(state.peers, macs[1], "ESP32_C_Client", "client", 2000);
+  peerTableAdd(state.peers, macs[2], "ESP32_D_Standby", "coordinator", 3000);
+  peerTableSetActive(state.peers, 0, true);
+  peerTableSetActive(state.peers, 2, true);
+  peerTableSetGroups(state.peers, 1, 0x05);
+}
+
+void setUp() {
+  memset(nvs, 0, sizeof(nvs));
+  nvsWrites = 0;
+  meshStateInit(&kFakeNvs);
+}
+
+void tearDown() {}
+
+static void test_client_round_trip() {
+  MeshClientState saved = { { 0x02, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE }, 11, 0x01020304 };
+  TEST_ASSERT_TRUE(meshStateSaveClient(saved));
+  MeshClientState loaded;
+  memset(&loaded, 0, sizeof(loaded));
+  TEST_ASSERT_TRUE(meshStateLoadClient(loaded));
+  TEST_ASSERT_EQUAL_MEMORY(saved.coordinatorMac, loaded.coordinatorMac, 6);
+  TEST_ASSERT_EQUAL(saved.channel, loaded.channel);
+  TEST_ASSERT_EQUAL(saved.epoch, loaded.epoch);
+
+  // Epoch 0 is "no session", not a session to resync
+  saved.epoch = 0;
+  TEST_ASSERT_TRUE(meshStateSaveClient(saved));
+  TEST_ASSERT_FALSE(meshStateLoadClient(loaded));
+}
+
+static void test_coord_round_trip() {
+  static MeshCoordState saved, loaded;
+  fillCoord(saved);
+  TEST_ASSERT_TRUE(meshStateSaveCoord(saved));
+  memset(&loaded, 0, sizeof(loaded));
+  TEST_ASSERT_TRUE(meshStateLoadCoord(loaded));
+  TEST_ASSERT_EQUAL(saved.channel, loaded.channel);
+  TEST_ASSERT_EQUAL(saved.epoch, loaded.epoch);
+  TEST_ASSERT_EQUAL(3, loaded.peers.count);
+  TEST_ASSERT_EQUAL(saved.peers.activeMask, loaded.peers.activeMask);
+  TEST_ASSERT_EQUAL(0x05, peerTableGroups(loaded.peers, 1));
+  TEST_ASSERT_EQUAL(1, peerTableFind(loaded.peers, saved.peers.macs[1]));
+  TEST_ASSERT_EQUAL_STRING("ESP32_D_Standby", peerTableName(loaded.peers, 2));
+  TEST_ASSERT_EQUAL_STRING("coordinator", peerTableType(loaded.peers, 2));
+}
+
+// A stored table is never trusted to index itself
+static void test_coord_rejects_corrupt_table() {
+  static MeshCoordState state, loaded;
+  fillCoord(state);
+  state.peers.count = PEER_TABLE_MAX + 1;
+  TEST_ASSERT_TRUE(meshStateSaveCoord(state));
+  TEST_ASSERT_FALSE(meshStateLoadCoord(loaded));
+
+  fillCoord(state);
+  state.peers.nameRef[1] = state.peers.names.used;  // past the pool
+  TEST_ASSERT_TRUE(meshStateSaveCoord(state));
+  TEST_ASSERT_FALSE(meshStateLoadCoord(loaded));
+
+  fillCoord(state);
+  state.peers.names.bytes[state.peers.names.used - 1] = 'x';  // last name loses its NUL
+  TEST_ASSERT_TRUE(meshStateSaveCoord(state));
+  TEST_ASSERT_FALSE(meshStateLoadCoord(loaded));
+}
+
+static void test_channel_round_trip() {
+  uint8_t channel = 0;
+  TEST_ASSERT_FALSE(meshStateLoadChannel(channel));
+  TEST_ASSERT_TRUE(meshStateSaveChannel(13));
+  TEST_ASSERT_TRUE(meshStateLoadChannel(channel));
+  TEST_ASSERT_EQUAL(13, channel);
+  TEST_ASSERT_TRUE(meshStateSaveChannel(0));
+  TEST_ASSERT_FALSE(meshStateLoadChannel(channel));
+}
+
+// Blobs written by another firmware version read as nothing stored: an
+// older key is never looked up, and a same-key blob of another size (a
+// layout change without a version bump) is refused by the exact-size read
+static void test_version_mismatch_reads_nothing() {
+  static MeshCoordState coord, loaded;
+  fillCoord(coord);
+  MeshClientState client = { { 0x02, 1, 1, 1, 1, 1 }, 6, 77 };
+  uint8_t channel = 9;
+  char key[FAKE_NVS_KEY_MAX + 1];
+  for (int version = 0; version < MESH_STATE_VERSION + 3; version++) {
+    if (version == MESH_STATE_VERSION) continue;
+    keyFor(key, "client", version);
+    TEST_ASSERT_TRUE(fakeWrite(key, &client, sizeof(client)));
+    keyFor(key, "coord", version);
+    TEST_ASSERT_TRUE(fakeWrite(key, &coord, sizeof(coord)));
+    keyFor(key, "chan", version);
+    TEST_ASSERT_TRUE(fakeWrite(key, &channel, sizeof(channel)));
+    MeshClientState c;
+    uint8_t ch;
+    TEST_ASSERT_FALSE(meshStateLoadClient(c));
+    TEST_ASSERT_FALSE(meshStateLoadCoord(loaded));
+    TEST_ASSERT_FALSE(meshStateLoadChannel(ch));
+    memset(nvs, 0, sizeof(nvs));
+  }
+
+  uint8_t shorter[sizeof(MeshClientState) - 4];
+  memcpy(shorter, &client, sizeof(shorter));
+  keyFor(key, "client", MESH_STATE_VERSION);
+  TEST_ASSERT_TRUE(fakeWrite(key, shorter, sizeof(shorter)));
+  MeshClientState c;
+  TEST_ASSERT_FALSE(meshStateLoadClient(c));
+  TEST_ASSERT_TRUE(meshStateSaveClient(client));  // the current layout replaces it
+  TEST_ASSERT_TRUE(meshStateLoadClient(c));
+}
+
+static void test_resync_frame_versioned() {
+  uint8_t frame[MESH_RESYNC_SIZE];
+  TEST_ASSERT_EQUAL(MESH_RESYNC_SIZE, meshResyncEncode(MESH_RESYNC_FLAG_ACK, 0xDEADBEEF, frame));
+  uint8_t flags = 0;
+  uint32_t epoch = 0;
+  TEST_ASSERT_TRUE(meshResyncParse(frame, sizeof(frame), flags, epoch));
+  TEST_ASSERT_EQUAL(MESH_RESYNC_FLAG_ACK, flags);
+  TEST_ASSERT_EQUAL(0xDEADBEEF, epoch);
+
+  frame[2] = MESH_STATE_VERSION - 1;  // a client still on the old firmware
+  TEST_ASSERT_FALSE(meshResyncParse(frame, sizeof(frame), flags, epoch));
+  frame[2] = MESH_STATE_VERSION + 1;
+  TEST_ASSERT_FALSE(meshResyncParse(frame, sizeof(frame), flags, epoch));
+  frame[2] = MESH_STATE_VERSION;
+  TEST_ASSERT_FALSE(meshResyncParse(frame, sizeof(frame) - 1, flags, epoch));
+}
+
+// mesh_forget erases every key MeshState writes
+static void test_clear_forgets_everything() {
+  static MeshCoordState coord, loaded;
+  fillCoord(coord);
+  MeshClientState client = { { 0x02, 1, 1, 1, 1, 1 }, 6, 77 };
+  TEST_ASSERT_TRUE(meshStateSaveClient(client));
+  TEST_ASSERT_TRUE(meshStateSaveCoord(coord));
+  TEST_ASSERT_TRUE(meshStateSaveChannel(6));
+  TEST_ASSERT_EQUAL(3, storedKeys());
+  meshStateClear();
+  TEST_ASSERT_EQUAL(0, storedKeys());
+  uint8_t channel;
+  TEST_ASSERT_FALSE(meshStateLoadClient(client));
+  TEST_ASSERT_FALSE(meshStateLoadCoord(loaded));
+  TEST_ASSERT_FALSE(meshStateLoadChannel(channel));
+}
+
+// Host builds have no NVS to fall back on
+static void test_no_store_saves_nothing() {
+  meshStateInit(nullptr);
+  MeshClientState client = { { 0x02, 1, 1, 1, 1, 1 }, 6, 77 };
+  TEST_ASSERT_FALSE(meshStateSaveClient(client));
+  TEST_ASSERT_FALSE(meshStateLoadClient(client));
+  meshStateClear();
+  TEST_ASSERT_EQUAL(0, nvsWrites);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_client_round_trip);
+  RUN_TEST(test_coord_round_trip);
+  RUN_TEST(test_coord_rejects_corrupt_table);
+  RUN_TEST(test_channel_round_trip);
+  RUN_TEST(test_version_mismatch_reads_nothing);
+  RUN_TEST(test_resync_frame_versioned);
+  RUN_TEST(test_clear_forgets_everything);
+  RUN_TEST(test_no_store_saves_nothing);
+  return UNITY_END();
+}
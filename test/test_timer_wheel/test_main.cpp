@@ -0,0 +1,222 @@
+/*
+ * Host test for lib/TimerWheel on a virtual clock: no timer fires before
+ * its deadline at any level of the wheel, missed periods are skipped and
+ * counted, and callbacks can re-arm or cancel timers (their own or others).
+ * pio test -e native -f test_timer_wheel
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+#include "TimerWheel.h"
+
+static uint64_t virtualUs;
+static uint64_t virtualClock() { return virtualUs; }
+
+static TimerWheel wheel;
+
+#define MAX_FIRES 64
+
+struct Probe {
+  int id;
+  uint32_t fires;
+  uint32_t early;
+  uint64_t at[MAX_FIRES];    // clock at each fire
+  // Optional actions from inside the callback
+  uint32_t rearmUs;          // timerWheelArm(self, rearmUs) while rearms > 0
+  uint32_t rearms;
+  int cancelId;              // timerWheelCancel(cancelId), -1 = none
+  uint32_t runUs;            // callback run time on the virtual clock
+};
+
+static void probeFire(void* arg) {
+  Probe& p = *(Probe*)arg;
+  if (virtualUs < wheel.timers[p.id].deadlineUs) p.early++;
+  if (p.fires < MAX_FIRES) p.at[p.fires] = virtualUs;
+  p.fires++;
+  virtualUs += p.runUs;
+  if (p.rearms > 0) {
+    p.rearms--;
+    timerWheelArm(wheel, p.id, p.rearmUs);
+  }
+  if (p.cancelId >= 0) timerWheelCancel(wheel, p.cancelId);
+}
+
+static void probeInit(Probe& p) {
+  memset(&p, 0, sizeof(p));
+  p.cancelId = -1;
+}
+
+static int addProbe(Probe& p, uint32_t firstUs, uint32_t periodUs) {
+  p.id = timerWheelAdd(wheel, "probe", probeFire, &p, firstUs, periodUs);
+  TEST_ASSERT_TRUE(p.id >= 0);
+  return p.id;
+}
+
+// Advance like the housekeeping task: run everything due, sleep as told
+static void runFor(uint64_t us) {
+  uint64_t end = virtualUs + us;
+  while (virtualUs < end) {
+    uint32_t sleepUs = timerWheelRunDue(wheel);
+    if (sleepUs == 0) sleepUs = 1;
+    virtualUs = virtualUs + sleepUs < end ? virtualUs + sleepUs : end;
+  }
+  timerWheelRunDue(wheel);
+}
+
+void setUp() {
+  virtualUs = 5000000;  // not tick 0, so first deadlines do not line up with the wheel
+  timerWheelInit(wheel, virtualClock);
+}
+
+void tearDown() {}
+
+// Periods on every level and past the wheel's ~4.4 min horizon; the clock
+// jumps by random amounts so timers are also found late. Nothing may fire
+// before its deadline, and an on-time driver fires every period exactly.
+static void test_no_early_fires() {
+  static const uint32_t kPeriodsUs[] = { 1000, 7000, 63000, 65000, 999000, 4100000, 60000000 };
+  const int count = sizeof(kPeriodsUs) / sizeof(kPeriodsUs[0]);
+  static Probe probes[8];
+  for (int i = 0; i < count; i++) {
+    probeInit(probes[i]);
+    addProbe(probes[i], kPeriodsUs[i], kPeriodsUs[i]);
+  }
+  static Probe far;
+  probeInit(far);
+  addProbe(far, 300000000, 0);  // 5 min one-shot, parks at the top level
+
+  runFor(120000000);  // on time for 2 min
+  for (int i = 0; i < count; i++) {
+    TEST_ASSERT_EQUAL(0, probes[i].early);
+    TEST_ASSERT_EQUAL(120000000 / kPeriodsUs[i], probes[i].fires);
+    TEST_ASSERT_EQUAL(0, wheel.timers[probes[i].id].latenessMaxUs);
+    TEST_ASSERT_EQUAL(0, wheel.timers[probes[i].id].missed);
+  }
+
+  srand(7);
+  uint64_t end = virtualUs + 200000000;
+  while (virtualUs < end) {
+    virtualUs += 1 + rand() % 20000;
+    timerWheelRunDue(wheel);
+  }
+  for (int i = 0; i < count; i++) TEST_ASSERT_EQUAL(0, probes[i].early);
+  TEST_ASSERT_EQUAL(1, far.fires);
+  TEST_ASSERT_EQUAL(0, far.early);
+  TEST_ASSERT_TRUE(far.at[0] >= 5000000 + 300000000ULL);
+  TEST_ASSERT_FALSE(wheel.timers[far.id].armed);
+  TEST_ASSERT_GREATER_THAN(0, wheel.cascades);
+}
+
+// A late fire re-arms from the previous deadline and skips whole periods
+static void test_missed_periods_counted() {
+  static Probe p;
+  probeInit(p);
+  addProbe(p, 10000, 10000);
+  uint64_t start = virtualUs;
+  runFor(10000);
+  TEST_ASSERT_EQUAL(1, p.fires);
+
+  virtualUs = start + 75000;  // deadlines 20..70 ms all passed
+  timerWheelRunDue(wheel);
+  TEST_ASSERT_EQUAL(2, p.fires);
+  TEST_ASSERT_EQUAL(5, wheel.timers[p.id].missed);        // 30, 40, 50, 60, 70 ms skipped
+  TEST_ASSERT_EQUAL(55000, wheel.timers[p.id].latenessMaxUs);
+  TEST_ASSERT_EQUAL(start + 80000, wheel.timers[p.id].deadlineUs);
+  TEST_ASSERT_EQUAL(5000, timerWheelNextDelayUs(wheel));
+
+  // Back on the grid: the next fire is on time
+  runFor(5000);
+  TEST_ASSERT_EQUAL(3, p.fires);
+  TEST_ASSERT_EQUAL(start + 80000, p.at[2]);
+
+  // A callback that overruns its own period skips the periods it covered
+  p.runUs = 25000;
+  runFor(10000);
+  TEST_ASSERT_EQUAL(4, p.fires);
+  TEST_ASSERT_EQUAL(start + 90000, p.at[3]);
+  TEST_ASSERT_EQUAL(7, wheel.timers[p.id].missed);        // 100 and 110 ms ran into the callback
+  TEST_ASSERT_EQUAL(start + 120000, wheel.timers[p.id].deadlineUs);
+  TEST_ASSERT_EQUAL(0, p.early);
+}
+
+// A timer armed from its own callback fires delayUs after the callback, not
+// on its period, and a one-shot can chain itself
+static void test_self_rearm() {
+  static Probe oneShot, periodic;
+  probeInit(oneShot);
+  oneShot.rearmUs = 3000;
+  oneShot.rearms = 4;
+  addProbe(oneShot, 2000, 0);
+
+  probeInit(periodic);
+  periodic.rearmUs = 50000;
+  periodic.rearms = 1;
+  addProbe(periodic, 10000, 10000);
+  uint64_t start = virtualUs;
+
+  runFor(100000);
+  TEST_ASSERT_EQUAL(5, oneShot.fires);
+  for (int i = 0; i < 5; i++) TEST_ASSERT_EQUAL(start + 2000 + 3000 * i, oneShot.at[i]);
+  TEST_ASSERT_FALSE(wheel.timers[oneShot.id].armed);
+
+  // Fired at 10 ms, re-armed to 60 ms, then back on its 10 ms period
+  TEST_ASSERT_EQUAL(start + 10000, periodic.at[0]);
+  TEST_ASSERT_EQUAL(start + 60000, periodic.at[1]);
+  TEST_ASSERT_EQUAL(start + 70000, periodic.at[2]);
+  TEST_ASSERT_EQUAL(6, periodic.fires);  // 10, 60, 70, 80, 90, 100 ms
+  TEST_ASSERT_EQUAL(0, wheel.timers[periodic.id].missed);
+
+  // timerWheelArm from outside moves a pending deadline
+  timerWheelArm(wheel, periodic.id, 30000);
+  runFor(29000);
+  TEST_ASSERT_EQUAL(6, periodic.fires);
+  runFor(1000);
+  TEST_ASSERT_EQUAL(7, periodic.fires);
+  TEST_ASSERT_EQUAL(0, oneShot.early + periodic.early);
+}
+
+// Cancel before the deadline, from the timer's own callback, and of another
+// timer due in the same tick; a cancelled timer can be armed again
+static void test_cancel() {
+  static Probe pending, self, first, second;
+  probeInit(pending);
+  addProbe(pending, 5000, 5000);
+  timerWheelCancel(wheel, pending.id);
+
+  probeInit(self);
+  addProbe(self, 4000, 4000);
+  self.cancelId = self.id;
+
+  // Due in the same tick and each cancels the other: whichever runs first wins
+  probeInit(first);
+  probeInit(second);
+  addProbe(first, 8000, 0);
+  addProbe(second, 8000, 0);
+  first.cancelId = second.id;
+  second.cancelId = first.id;
+
+  runFor(50000);
+  TEST_ASSERT_EQUAL(0, pending.fires);
+  TEST_ASSERT_EQUAL(1, self.fires);
+  TEST_ASSERT_FALSE(wheel.timers[self.id].armed);
+  TEST_ASSERT_EQUAL(1, first.fires + second.fires);
+  TEST_ASSERT_EQUAL(TIMER_WHEEL_IDLE_US, timerWheelNextDelayUs(wheel));
+
+  uint64_t armedAt = virtualUs;
+  timerWheelArm(wheel, pending.id, 2000);
+  runFor(12000);
+  TEST_ASSERT_EQUAL(3, pending.fires);  // 2 ms, then its 5 ms period
+  TEST_ASSERT_EQUAL(armedAt + 2000, pending.at[0]);
+  TEST_ASSERT_EQUAL(armedAt + 7000, pending.at[1]);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_no_early_fires);
+  RUN_TEST(test_missed_periods_counted);
+  RUN_TEST(test_self_rearm);
+  RUN_TEST(test_cancel);
+  return UNITY_END();
+}